@@ -0,0 +1,151 @@
+#include "Airtime.h"
+
+
+////////////////////////////////////////////////////////
+///// AirtimeModel
+////////////////////////////////////////////////////////
+
+// Indexed by SPED.airDataRate
+static const uint8_t spreadingFactor[] = { 12, 11, 11, 10, 9, 8, 8, 8 };
+static const uint16_t bandwidthKhz[] = { 125, 250, 500, 500, 500, 500, 500, 500 };
+
+AirtimeModel::AirtimeModel(uint8_t airDataRate, bool fec, uint8_t wakeUpTime) {
+    configure(airDataRate, fec, wakeUpTime);
+}
+
+void AirtimeModel::configure(uint8_t airDataRate, bool fec, uint8_t wakeUpTime) {
+    airDataRate &= 0x07;
+    _sf = spreadingFactor[airDataRate];
+    _codingRate = fec ? 2 : 1;
+    _symbolUs = ((uint32_t)1000 << _sf) / bandwidthKhz[airDataRate];
+    _ldro = _symbolUs > AIRTIME_LDRO_SYMBOL_US;
+    _wakeUpMs = 250 * ((wakeUpTime & 0x07) + 1);
+}
+
+uint32_t AirtimeModel::packetUs(size_t length, bool wakeUp) const {
+    // Preamble lasts 4.25 symbols more than programmed
+    uint32_t preambleUs = wakeUp ? _wakeUpMs * 1000
+                                 : ((4 * AIRTIME_PREAMBLE_SYMBOLS + 17) * _symbolUs) / 4;
+
+    // Explicit header, CRC on
+    int32_t bits = 8 * (int32_t)length - 4 * _sf + 28 + 16;
+    int32_t bitsPerBlock = 4 * (_sf - (_ldro ? 2 : 0));
+    int32_t blocks = bits > 0 ? (bits + bitsPerBlock - 1) / bitsPerBlock : 0;
+    uint32_t symbols = 8 + blocks * (_codingRate + 4);
+
+    return preambleUs + symbols * _symbolUs;
+}
+
+
+////////////////////////////////////////////////////////
+///// DutyCycle
+////////////////////////////////////////////////////////
+
+DutyCycle::DutyCycle(uint16_t permille, uint32_t windowMs) {
+    setLimit(permille, windowMs, 0);
+}
+
+void DutyCycle::setLimit(uint16_t permille, uint32_t windowMs, uint32_t now) {
+    _permille = permille > 1000 ? 1000 : permille;
+    // permille of a ms is exactly permille us
+    _capacityUs = windowMs * _permille;
+    // Rounded up, so the slots before the one in progress span at least the window
+    _slotMs = (windowMs + DUTY_CYCLE_SLOTS - 1) / DUTY_CYCLE_SLOTS;
+    if (_slotMs == 0) {
+        _slotMs = 1;
+    }
+    for (uint8_t i = 0; i <= DUTY_CYCLE_SLOTS; i++) {
+        _slotUs[i] = 0;
+    }
+    _head = 0;
+    _headStart = now;
+    _windowUs = 0;
+}
+
+void DutyCycle::advance(uint32_t now) {
+    uint32_t elapsed = now - _headStart;
+    if (elapsed < _slotMs) {
+        return;
+    }
+
+    // Everything expired, no need to walk the slots one by one
+    if (elapsed / _slotMs > DUTY_CYCLE_SLOTS) {
+        for (uint8_t i = 0; i <= DUTY_CYCLE_SLOTS; i++) {
+            _slotUs[i] = 0;
+        }
+        _windowUs = 0;
+        _headStart = now - elapsed % _slotMs;
+        return;
+    }
+
+    // The oldest slot becomes the new one in progress
+    while (now - _headStart >= _slotMs) {
+        _head = (_head + 1) % (DUTY_CYCLE_SLOTS + 1);
+        _windowUs -= _slotUs[_head];
+        _slotUs[_head] = 0;
+        _headStart += _slotMs;
+    }
+}
+
+uint32_t DutyCycle::availableUs(uint32_t now) {
+    if (!limited()) {
+        return UINT32_MAX;
+    }
+    advance(now);
+    return _windowUs < _capacityUs ? _capacityUs - _windowUs : 0;
+}
+
+uint32_t DutyCycle::delayMs(uint32_t airtimeUs, uint32_t now) {
+    if (!limited()) {
+        return 0;
+    }
+    if (airtimeUs > _capacityUs) {
+        return UINT32_MAX;
+    }
+    advance(now);
+    if ((uint64_t)_windowUs + airtimeUs <= _capacityUs) {
+        return 0;
+    }
+
+    // Wait for the oldest slots to leave the window until the packet fits
+    uint32_t windowUs = _windowUs;
+    for (uint8_t k = 1; k <= DUTY_CYCLE_SLOTS + 1; k++) {
+        windowUs -= _slotUs[(_head + k) % (DUTY_CYCLE_SLOTS + 1)];
+        if ((uint64_t)windowUs + airtimeUs <= _capacityUs) {
+            return _headStart + k * _slotMs - now;
+        }
+    }
+    return UINT32_MAX;
+}
+
+void DutyCycle::charge(uint32_t airtimeUs, uint32_t now) {
+    _usedUs += airtimeUs;
+    if (!limited()) {
+        return;
+    }
+    advance(now);
+    _slotUs[_head] += airtimeUs;
+    _windowUs += airtimeUs;
+}
+
+DutyCycleState DutyCycle::save(uint32_t now) {
+    DutyCycleState state;
+    advance(now);
+    for (uint8_t k = 1; k <= DUTY_CYCLE_SLOTS + 1; k++) {
+        state.slotUs[k - 1] = _slotUs[(_head + k) % (DUTY_CYCLE_SLOTS + 1)];
+    }
+    state.intoSlotMs = now - _headStart;
+    return state;
+}
+
+void DutyCycle::restore(const DutyCycleState& state, uint32_t now, uint32_t elapsedMs) {
+    _windowUs = 0;
+    for (uint8_t i = 0; i <= DUTY_CYCLE_SLOTS; i++) {
+        _slotUs[i] = state.slotUs[i];
+        _windowUs += _slotUs[i];
+    }
+    _head = DUTY_CYCLE_SLOTS;
+    // Back-dated by the sleep, then what expired meanwhile leaves the window
+    _headStart = now - state.intoSlotMs - elapsedMs;
+    advance(now);
+}
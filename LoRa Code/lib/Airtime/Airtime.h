@@ -0,0 +1,151 @@
+#ifndef AIRTIME_H
+#define AIRTIME_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+
+
+////////////////////////////////////////////////////////
+///// Airtime model
+////////////////////////////////////////////////////////
+//
+// The E32 runs an SX127x in LoRa mode. EBYTE only gives nominal air data
+// rates, the spreading factor and bandwidth behind each one below are the
+// ones commonly reported for these modules:
+//
+//      code    nominal     SF  BW
+//      0       0.3k        12  125 kHz (low data rate optimize)
+//      1       1.2k        11  250 kHz
+//      2       2.4k        11  500 kHz
+//      3       4.8k        10  500 kHz
+//      4       9.6k         9  500 kHz
+//      5-7     19.2k        8  500 kHz
+//
+// Packet time follows the Semtech formula (explicit header, CRC on,
+// 8 symbol preamble). FEC_1_ON is taken as coding rate 4/6 and FEC_0_OFF
+// as 4/5, EBYTE does not say, so the estimate errs on the long side.
+// In wake-up mode (mode 1) the preamble lasts the whole wake-up time.
+
+#define AIRTIME_PREAMBLE_SYMBOLS    8
+#define AIRTIME_LDRO_SYMBOL_US      16000   // Low data rate optimize above this symbol time
+
+// Regulatory budget, ETSI EN 300 220 counts it over one hour
+#define DUTY_CYCLE_WINDOW_MS        3600000UL
+#define DUTY_CYCLE_SLOTS            60      // Window split in slots (1 min for an hour), one more is kept
+
+
+/**
+ * @brief Time on air of one E32 packet for a given configuration
+ */
+class AirtimeModel {
+    public:
+        /**
+         * @brief Construct a model
+         *
+         * @param airDataRate SPED.airDataRate code
+         * @param fec OPTION.fec
+         * @param wakeUpTime OPTION.wirelessWakeupTime code
+         */
+        AirtimeModel(uint8_t airDataRate = 2, bool fec = true, uint8_t wakeUpTime = 0);
+
+        void configure(uint8_t airDataRate, bool fec, uint8_t wakeUpTime);
+
+        /**
+         * @brief Time on air of one packet
+         *
+         * @param length Bytes written to the module for this packet (header included)
+         * @param wakeUp Sent in wake-up mode, with the long preamble
+         * @return uint32_t Airtime in microseconds
+         */
+        uint32_t packetUs(size_t length, bool wakeUp = false) const;
+
+        uint32_t symbolUs() const { return _symbolUs; }
+        uint32_t wakeUpMs() const { return _wakeUpMs; }
+
+    private:
+        uint8_t _sf;
+        uint8_t _codingRate;        // 1-4 for 4/5-4/8
+        bool _ldro;
+        uint32_t _symbolUs;
+        uint32_t _wakeUpMs;
+};
+
+
+/**
+ * @brief Airtime budget counters
+ */
+struct AirtimeStats {
+    uint32_t usedMs;        // Airtime charged since boot
+    uint32_t availableMs;   // Left in the window now
+    uint32_t budgetMs;      // Allowed per window, 0 when no limit is set
+    uint32_t deferred;      // Frames held back for lack of budget
+    uint32_t refused;       // Blocking sends refused: no budget, outside the TDMA slot or channel busy
+};
+
+
+/**
+ * @brief Airtime sent in the last window, kept through deep sleep
+ */
+struct DutyCycleState {
+    uint32_t slotUs[DUTY_CYCLE_SLOTS + 1];  // Oldest first, the last one is the slot in progress
+    uint32_t intoSlotMs;                    // Time already spent in the slot in progress
+};
+
+/**
+ * @brief Sliding window sum of airtime
+ *
+ * Airtime is summed per slot of window / DUTY_CYCLE_SLOTS. A packet goes
+ * out only if it fits in permille * window together with everything sent
+ * in the slot in progress and the DUTY_CYCLE_SLOTS before it. Any window
+ * of that length lies within those slots, so no window ever holds more
+ * than the budget, while short bursts still go out back to back.
+ */
+class DutyCycle {
+    public:
+        // permille = 0 means no limit (only counts)
+        DutyCycle(uint16_t permille = 0, uint32_t windowMs = DUTY_CYCLE_WINDOW_MS);
+
+        // Starts over with nothing sent in the window
+        void setLimit(uint16_t permille, uint32_t windowMs, uint32_t now);
+        bool limited() const { return _permille > 0; }
+
+        /**
+         * @brief How long until a packet of this airtime fits the budget
+         *
+         * @param airtimeUs Airtime of the packet
+         * @param now Time in ms
+         * @return uint32_t 0 to send now, otherwise ms to wait (UINT32_MAX if it never fits)
+         */
+        uint32_t delayMs(uint32_t airtimeUs, uint32_t now);
+
+        // Add the packet's airtime to the window
+        void charge(uint32_t airtimeUs, uint32_t now);
+
+        /**
+         * @brief Carry the window through deep sleep
+         *
+         * save() before sleeping, then restore() after setLimit() on wake-up,
+         * with the time spent asleep (millis() starts over).
+         */
+        DutyCycleState save(uint32_t now);
+        void restore(const DutyCycleState& state, uint32_t now, uint32_t elapsedMs);
+
+        uint32_t availableUs(uint32_t now);
+        uint32_t capacityUs() const { return _capacityUs; }
+        uint64_t usedUs() const { return _usedUs; }
+
+    private:
+        uint16_t _permille;
+        uint32_t _capacityUs = 0;
+        uint32_t _slotMs = 1;
+        uint32_t _slotUs[DUTY_CYCLE_SLOTS + 1];
+        uint8_t _head = 0;          // Slot in progress
+        uint32_t _headStart = 0;    // When it started
+        uint32_t _windowUs = 0;     // Sum of all slots
+        uint64_t _usedUs = 0;
+
+        void advance(uint32_t now);
+};
+
+#endif // AIRTIME_H
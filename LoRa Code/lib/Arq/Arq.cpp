@@ -0,0 +1,348 @@
+#include "Arq.h"
+#include <string.h>
+
+static_assert(256 % ARQ_MAX_WINDOW == 0, "Slots are indexed by sequence modulo the window");
+static_assert(ARQ_MAX_WINDOW <= 32, "SACK bitmap is 32 bits");
+
+
+////////////////////////////////////////////////////////
+///// Helpers
+////////////////////////////////////////////////////////
+
+bool isArqData(const uint8_t* data, size_t length) {
+    return length > ARQ_HEADER_SIZE && data[0] == ARQ_DATA_MAGIC;
+}
+
+bool isArqAck(const uint8_t* data, size_t length) {
+    // An ACK has a fixed size, anything longer is another frame type
+    return length == ARQ_ACK_SIZE && data[0] == ARQ_ACK_MAGIC;
+}
+
+
+////////////////////////////////////////////////////////
+///// ArqSender
+////////////////////////////////////////////////////////
+
+ArqSender::ArqSender(uint8_t window)
+    : _window(window == 0 ? 1 : (window > ARQ_MAX_WINDOW ? ARQ_MAX_WINDOW : window))
+{
+}
+
+bool ArqSender::offer(const uint8_t* data, size_t size) {
+    if (!canOffer() || size == 0 || size > ARQ_PAYLOAD) {
+        return false;
+    }
+    Slot& s = slot(_next++);
+    memcpy(s.data, data, size);
+    s.size = (uint8_t)size;
+    s.sent = false;
+    s.acked = false;
+    s.resend = false;
+    s.retries = 0;
+    return true;
+}
+
+bool ArqSender::hasWork() const {
+    for (uint8_t seq = _base; seq != _next; seq++) {
+        const Slot& s = _slots[seq % ARQ_MAX_WINDOW];
+        if (!s.acked && (!s.sent || s.resend)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t ArqSender::poll(uint32_t now, uint8_t* out, size_t capacity) {
+    if (_awaitingAck) {
+        if (now - _timerStart < (_burstOnAir ? _rto : ARQ_RTO_MAX_MS)) {
+            return 0;
+        }
+        // No answer to the burst: all of it is presumed lost, back off
+        _awaitingAck = false;
+        _stats.timeouts++;
+        _rto = (_rto * 2 > ARQ_RTO_MAX_MS) ? ARQ_RTO_MAX_MS : _rto * 2;
+        for (uint8_t seq = _base; seq != _next; seq++) {
+            Slot& s = slot(seq);
+            if (s.sent && !s.acked) {
+                s.resend = true;
+            }
+        }
+    }
+
+    // Give up on frames out of retries, the base moving on tells the receiver to skip them
+    for (uint8_t seq = _base; seq != _next; seq++) {
+        Slot& s = slot(seq);
+        if (s.resend && !s.acked && s.retries >= ARQ_MAX_RETRIES) {
+            s.acked = true;
+            _stats.failed++;
+        }
+    }
+    advance();
+
+    for (uint8_t seq = _base; seq != _next; seq++) {
+        Slot& s = slot(seq);
+        if (s.acked || (s.sent && !s.resend)) {
+            continue;
+        }
+        if (capacity < (size_t)ARQ_HEADER_SIZE + s.size) {
+            return 0;
+        }
+
+        if (s.sent) {
+            s.retries++;
+            _stats.retransmits++;
+        } else {
+            _stats.sent++;
+        }
+        s.sent = true;
+        s.resend = false;
+        s.sentAt = now;
+        s.order = ++_order;
+
+        bool last = !hasWork();
+        out[0] = ARQ_DATA_MAGIC;
+        out[1] = seq;
+        out[2] = _base;
+        out[3] = last ? ARQ_FLAG_LAST : 0;
+        memcpy(out + ARQ_HEADER_SIZE, s.data, s.size);
+
+        if (last) {
+            _awaitingAck = true;
+            _burstOnAir = false;
+            _burstSeq = seq;
+            _burstOrder = s.order;
+            _timerStart = now;
+        }
+        return ARQ_HEADER_SIZE + s.size;
+    }
+    return 0;
+}
+
+void ArqSender::onBurstSent(uint32_t now) {
+    if (!_awaitingAck) {
+        return;
+    }
+    _timerStart = now;
+    _burstOnAir = true;
+    Slot& s = slot(_burstSeq);
+    if (s.order == _burstOrder) {
+        s.sentAt = now;
+    }
+}
+
+bool ArqSender::onAck(const uint8_t* frame, size_t length, uint32_t now) {
+    if (!isArqAck(frame, length)) {
+        return false;
+    }
+
+    uint8_t next = frame[1];
+    uint32_t bitmap = (uint32_t)frame[2] | ((uint32_t)frame[3] << 8)
+                    | ((uint32_t)frame[4] << 16) | ((uint32_t)frame[5] << 24);
+
+    // Stale or from another session: the receiver cannot be past what we sent
+    if ((uint8_t)(next - _base) > inFlight()) {
+        return true;
+    }
+
+    Slot* newest = nullptr;
+    bool progress = false;
+    for (uint8_t seq = _base; seq != _next; seq++) {
+        Slot& s = slot(seq);
+        if (s.acked || !s.sent) {
+            continue;
+        }
+        uint8_t ahead = seq - next;     // Distance past the cumulative point
+        bool received = (uint8_t)(seq - _base) < (uint8_t)(next - _base)
+                     || (ahead >= 1 && ahead <= 32 && (bitmap & (1UL << (ahead - 1))));
+        if (!received) {
+            continue;
+        }
+        s.acked = true;
+        progress = true;
+        _stats.acked++;
+        // Karn: a retransmitted frame's ACK could belong to any of its copies
+        if (s.retries == 0 && (newest == nullptr || s.order > newest->order)) {
+            newest = &s;
+        }
+    }
+
+    if (newest != nullptr) {
+        sampleRtt(now - newest->sentAt);
+    }
+    else if (progress && _measured) {
+        // Back from a backoff without a clean sample
+        sampleRtt(_srtt);
+    }
+
+    if (_awaitingAck) {
+        // The receiver answers once per burst, whatever it did not list was lost
+        for (uint8_t seq = _base; seq != _next; seq++) {
+            Slot& s = slot(seq);
+            if (s.sent && !s.acked && s.order <= _burstOrder) {
+                s.resend = true;
+            }
+        }
+        _awaitingAck = false;
+    }
+
+    advance();
+    return true;
+}
+
+void ArqSender::sampleRtt(uint32_t rtt) {
+    if (!_measured) {
+        _srtt = rtt;
+        _rttvar = rtt / 2;
+        _measured = true;
+    }
+    else {
+        uint32_t error = _srtt > rtt ? _srtt - rtt : rtt - _srtt;
+        _rttvar = (3 * _rttvar + error) / 4;
+        _srtt = (7 * _srtt + rtt) / 8;
+    }
+    _rto = _srtt + 4 * _rttvar;
+    if (_rto < ARQ_RTO_MIN_MS) _rto = ARQ_RTO_MIN_MS;
+    if (_rto > ARQ_RTO_MAX_MS) _rto = ARQ_RTO_MAX_MS;
+}
+
+void ArqSender::advance() {
+    while (_base != _next && slot(_base).acked) {
+        _base++;
+    }
+}
+
+ArqStats ArqSender::stats() const {
+    ArqStats stats = _stats;
+    stats.srttMs = _srtt;
+    stats.rtoMs = _rto;
+    return stats;
+}
+
+
+////////////////////////////////////////////////////////
+///// ArqReceiver
+////////////////////////////////////////////////////////
+
+ArqReceiver::ArqReceiver() {
+    for (uint8_t i = 0; i < ARQ_MAX_WINDOW; i++) {
+        _slots[i].present = false;
+    }
+}
+
+void ArqReceiver::skipTo(uint8_t seq) {
+    // Sequences the sender gave up on are marked present with no payload
+    for (; _expected != seq; _expected++) {
+        if ((uint8_t)(_expected - _deliver) >= ARQ_MAX_WINDOW) {
+            return; // Reader is behind, the next frame tries again
+        }
+        Slot& s = slot(_expected);
+        if (!s.present) {
+            s.present = true;
+            s.size = 0;
+            _stats.skipped++;
+        }
+    }
+}
+
+bool ArqReceiver::accept(const uint8_t* frame, size_t length, uint32_t now) {
+    if (!isArqData(frame, length)) {
+        return false;
+    }
+
+    uint8_t seq = frame[1];
+    uint8_t base = frame[2];
+    size_t size = length - ARQ_HEADER_SIZE;
+    if (size > ARQ_PAYLOAD) {
+        return true; // Not ours to deliver, but not anything else either
+    }
+
+    _lastFrameAt = now;
+    _ackPending = true;
+    if (frame[3] & ARQ_FLAG_LAST) {
+        _ackNow = true;
+    }
+
+    if (_synced && base != _expected && (uint8_t)(base - _expected) <= ARQ_MAX_WINDOW) {
+        skipTo(base);
+    }
+    else if (!_synced || (uint8_t)(_expected - base) > ARQ_MAX_WINDOW) {
+        // First frame, or the sender restarted: follow its window
+        for (uint8_t i = 0; i < ARQ_MAX_WINDOW; i++) {
+            _slots[i].present = false;
+        }
+        _expected = base;
+        _deliver = base;
+        _synced = true;
+    }
+
+    // Frames past a skipped one may already be here, a copy of one must not hold the ACK back
+    advance();
+
+    if ((uint8_t)(seq - _expected) >= 128) {
+        _stats.duplicates++; // Already received, the ACK tells the sender again
+        return true;
+    }
+    if ((uint8_t)(seq - _deliver) >= ARQ_MAX_WINDOW) {
+        return true; // No room until read() catches up, the sender retries
+    }
+
+    Slot& s = slot(seq);
+    if (s.present) {
+        _stats.duplicates++;
+        return true;
+    }
+    memcpy(s.data, frame + ARQ_HEADER_SIZE, size);
+    s.size = (uint8_t)size;
+    s.present = true;
+    advance();
+    return true;
+}
+
+void ArqReceiver::advance() {
+    while ((uint8_t)(_expected - _deliver) < ARQ_MAX_WINDOW && slot(_expected).present) {
+        _expected++;
+    }
+}
+
+size_t ArqReceiver::read(uint8_t* buf, size_t cap) {
+    while (_deliver != _expected) {
+        Slot& s = slot(_deliver++);
+        s.present = false;
+        if (s.size == 0) {
+            continue; // Skipped
+        }
+        size_t size = s.size > cap ? cap : s.size;
+        memcpy(buf, s.data, size);
+        _stats.delivered++;
+        return size;
+    }
+    return 0;
+}
+
+bool ArqReceiver::ackDue(uint32_t now) const {
+    return _ackNow || (_ackPending && now - _lastFrameAt >= _ackTimeoutMs);
+}
+
+size_t ArqReceiver::ack(uint8_t* out, size_t capacity) {
+    if (capacity < ARQ_ACK_SIZE) {
+        return 0;
+    }
+
+    uint32_t bitmap = 0;
+    for (uint8_t i = 0; i < 32; i++) {
+        uint8_t seq = _expected + 1 + i;
+        if ((uint8_t)(seq - _deliver) < ARQ_MAX_WINDOW && slot(seq).present) {
+            bitmap |= (1UL << i);
+        }
+    }
+
+    out[0] = ARQ_ACK_MAGIC;
+    out[1] = _expected;
+    for (uint8_t i = 0; i < 4; i++) {
+        out[2 + i] = (bitmap >> (8 * i)) & 0xFF;
+    }
+
+    _ackNow = false;
+    _ackPending = false;
+    return ARQ_ACK_SIZE;
+}
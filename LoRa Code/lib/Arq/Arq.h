@@ -0,0 +1,203 @@
+#ifndef ARQ_H
+#define ARQ_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaFrame.h"
+
+
+////////////////////////////////////////////////////////
+///// Frame formats
+////////////////////////////////////////////////////////
+//
+//  Data                            ACK
+//  byte 0 : magic (0xA7)           byte 0   : magic (0xAC)
+//  byte 1 : sequence               byte 1   : next sequence expected (everything before it arrived)
+//  byte 2 : oldest unacked seq     byte 2-5 : SACK bitmap (LE), bit i = (next + 1 + i) arrived
+//  byte 3 : flags
+//  byte 4+: payload
+//
+// Half duplex: the sender sends its window as one burst and flags the last
+// frame. The receiver answers that frame with a single ACK, so it never
+// talks over the burst. Whatever the ACK does not cover was lost and goes
+// out again in the next burst. A lost ACK or a lost last frame is caught by
+// the retransmit timeout on the sender and the ACK timeout on the receiver.
+
+#define ARQ_DATA_MAGIC          0xA7
+#define ARQ_ACK_MAGIC           0xAC
+#define ARQ_HEADER_SIZE         4
+#define ARQ_ACK_SIZE            6
+#define ARQ_PAYLOAD             (LORA_PAYLOAD_MAX - ARQ_HEADER_SIZE)
+
+#define ARQ_FLAG_LAST           0x01    // Last frame of a burst, ACK now
+
+#define ARQ_MAX_WINDOW          16      // Frames in flight (SACK bitmap and 8 bit sequence limit)
+#define ARQ_RTO_INITIAL_MS      3000
+#define ARQ_RTO_MIN_MS          300
+#define ARQ_RTO_MAX_MS          30000
+#define ARQ_MAX_RETRIES         8       // Then the frame is given up and the receiver skips it
+
+// True if a received frame is an ARQ data frame
+bool isArqData(const uint8_t* data, size_t length);
+
+// True if a received frame is an ARQ ACK
+bool isArqAck(const uint8_t* data, size_t length);
+
+
+/**
+ * @brief Counters of both ARQ ends
+ */
+struct ArqStats {
+    uint32_t sent;          // Data frames handed out, first transmissions
+    uint32_t retransmits;
+    uint32_t timeouts;      // Retransmit timer expiries
+    uint32_t acked;
+    uint32_t failed;        // Given up after ARQ_MAX_RETRIES
+    uint32_t srttMs;        // Smoothed round trip time, 0 until measured
+    uint32_t rtoMs;
+    uint32_t delivered;     // Receiver: payloads handed out in order
+    uint32_t duplicates;
+    uint32_t skipped;       // Receiver: sequences the sender gave up on
+};
+
+
+/**
+ * @brief Sending end: sliding window, selective repeat, adaptive timeout
+ *
+ * RTT is sampled from frames acked on their first transmission only
+ * (Karn), smoothed as in RFC 6298 and the timeout doubles on each expiry.
+ */
+class ArqSender {
+    public:
+        // Window in frames, 1 is stop-and-wait, at most ARQ_MAX_WINDOW
+        ArqSender(uint8_t window = 8);
+
+        /**
+         * @brief Queue one payload
+         *
+         * @param data Payload
+         * @param size At most ARQ_PAYLOAD
+         * @return false Window full or too big
+         */
+        bool offer(const uint8_t* data, size_t size);
+
+        /**
+         * @brief Next frame to put on air
+         *
+         * Retransmissions first, then new payloads. Nothing is returned while
+         * the ACK of the last burst is awaited, unless the timeout expired.
+         *
+         * @param now Time in ms
+         * @param out Output buffer, LORA_PAYLOAD_MAX bytes is always enough
+         * @param capacity Size of the output buffer
+         * @return size_t Frame length, 0 if nothing to send now
+         */
+        size_t poll(uint32_t now, uint8_t* out, size_t capacity);
+
+        // Last frame of the burst is on air: the timeout and its RTT count from here,
+        // not from poll(), when it may still wait behind the rest of the burst.
+        // Until this is called the burst only times out after ARQ_RTO_MAX_MS.
+        void onBurstSent(uint32_t now);
+
+        // Feed a received ACK frame
+        bool onAck(const uint8_t* frame, size_t length, uint32_t now);
+
+        size_t inFlight() const { return (uint8_t)(_next - _base); }
+        bool canOffer() const { return inFlight() < _window; }
+        bool idle() const { return inFlight() == 0; }
+        ArqStats stats() const;
+
+    private:
+        struct Slot {
+            uint8_t data[ARQ_PAYLOAD];
+            uint8_t size;
+            bool sent;
+            bool acked;
+            bool resend;        // Reported lost, goes out with the next burst
+            uint8_t retries;
+            uint32_t sentAt;
+            uint32_t order;     // Transmission counter, orders sends inside a burst
+        };
+
+        uint8_t _window;
+        Slot _slots[ARQ_MAX_WINDOW];
+        uint8_t _base = 0;          // Oldest unacked
+        uint8_t _next = 0;          // Next sequence to assign
+        uint32_t _order = 0;
+
+        bool _awaitingAck = false;
+        bool _burstOnAir = false;
+        uint8_t _burstSeq = 0;      // Frame that closed the burst
+        uint32_t _burstOrder = 0;
+        uint32_t _timerStart = 0;
+
+        // RFC 6298 estimator
+        bool _measured = false;
+        uint32_t _srtt = 0;
+        uint32_t _rttvar = 0;
+        uint32_t _rto = ARQ_RTO_INITIAL_MS;
+
+        ArqStats _stats = {};
+
+        Slot& slot(uint8_t seq) { return _slots[seq % ARQ_MAX_WINDOW]; }
+        bool hasWork() const;
+        void sampleRtt(uint32_t rtt);
+        void advance();
+};
+
+
+/**
+ * @brief Receiving end: reorders, delivers in sequence and builds ACKs
+ */
+class ArqReceiver {
+    public:
+        ArqReceiver();
+
+        /**
+         * @brief Feed a received data frame
+         *
+         * @param frame Received bytes
+         * @param length Number of received bytes
+         * @param now Time in ms
+         * @return false Not a data frame
+         */
+        bool accept(const uint8_t* frame, size_t length, uint32_t now);
+
+        // Next payload in sequence, 0 if none (extra bytes are dropped)
+        size_t read(uint8_t* buf, size_t cap);
+
+        // True once the burst ended, or ackTimeoutMs after its last frame if that one was lost
+        bool ackDue(uint32_t now) const;
+        void setAckTimeout(uint32_t ms) { _ackTimeoutMs = ms; }
+
+        // Write the ACK and clear ackDue()
+        size_t ack(uint8_t* out, size_t capacity);
+
+        ArqStats stats() const { return _stats; }
+
+    private:
+        struct Slot {
+            uint8_t data[ARQ_PAYLOAD];
+            uint8_t size;
+            bool present;
+        };
+
+        Slot _slots[ARQ_MAX_WINDOW];
+        uint8_t _expected = 0;      // Everything before it arrived
+        uint8_t _deliver = 0;       // Next sequence read() hands out
+        bool _synced = false;       // First frame seen, _expected follows the sender
+
+        bool _ackNow = false;
+        bool _ackPending = false;   // Frames arrived since the last ACK
+        uint32_t _lastFrameAt = 0;
+        uint32_t _ackTimeoutMs = 1000;
+
+        ArqStats _stats = {};
+
+        Slot& slot(uint8_t seq) { return _slots[seq % ARQ_MAX_WINDOW]; }
+        void skipTo(uint8_t seq);
+        void advance();
+};
+
+#endif // ARQ_H
@@ -0,0 +1,135 @@
+#include "Batcher.h"
+#include <string.h>
+
+
+////////////////////////////////////////////////////////
+///// Batcher
+////////////////////////////////////////////////////////
+
+Batcher::Batcher(size_t capacity)
+    : _capacity(capacity > LORA_PAYLOAD_MAX ? LORA_PAYLOAD_MAX : capacity)
+{
+}
+
+Batcher::Stream* Batcher::findStream(uint8_t id) {
+    for (uint8_t i = 0; i < _streamCount; i++) {
+        if (_streams[i].id == id) {
+            return &_streams[i];
+        }
+    }
+    return nullptr;
+}
+
+bool Batcher::addStream(uint8_t id, uint8_t maxSamples, uint32_t maxLatencyMs) {
+    Stream* stream = findStream(id);
+    if (stream == nullptr) {
+        if (_streamCount >= BATCH_MAX_STREAMS) {
+            return false;
+        }
+        stream = &_streams[_streamCount++];
+        stream->id = id;
+        stream->samples = 0;
+    }
+    stream->maxSamples = maxSamples > 0 ? maxSamples : 1;
+    stream->maxLatencyMs = maxLatencyMs;
+    return true;
+}
+
+bool Batcher::add(uint8_t stream, const uint8_t* data, size_t length, uint32_t now) {
+    Stream* s = findStream(stream);
+    if (s == nullptr || length > UINT8_MAX) {
+        return false;
+    }
+
+    if (BATCH_HEADER_SIZE + _length + BATCH_RECORD_HEADER + length > _capacity) {
+        // Would overflow the frame: this batch is as full as it gets
+        _full = !empty();
+        return false;
+    }
+
+    _body[_length++] = stream;
+    _body[_length++] = (uint8_t)length;
+    memcpy(_body + _length, data, length);
+    _length += length;
+    _records++;
+
+    uint32_t due = now + s->maxLatencyMs;
+    if (!_hasDeadline || (int32_t)(due - _deadline) < 0) {
+        _deadline = due;
+        _hasDeadline = true;
+    }
+    if (++s->samples >= s->maxSamples) {
+        _full = true;
+    }
+    return true;
+}
+
+bool Batcher::ready(uint32_t now) const {
+    if (empty()) {
+        return false;
+    }
+    return _full || (int32_t)(now - _deadline) >= 0;
+}
+
+uint32_t Batcher::msUntilDue(uint32_t now) const {
+    if (empty() || ready(now)) {
+        return 0;
+    }
+    return _deadline - now;
+}
+
+size_t Batcher::take(uint8_t sequence, uint8_t* out, size_t capacity) {
+    if (empty() || capacity < size()) {
+        return 0;
+    }
+
+    out[0] = BATCH_MAGIC;
+    out[1] = sequence;
+    out[2] = _records;
+    memcpy(out + BATCH_HEADER_SIZE, _body, _length);
+    size_t length = size();
+
+    _length = 0;
+    _records = 0;
+    _full = false;
+    _hasDeadline = false;
+    for (uint8_t i = 0; i < _streamCount; i++) {
+        _streams[i].samples = 0;
+    }
+    return length;
+}
+
+
+////////////////////////////////////////////////////////
+///// BatchReader
+////////////////////////////////////////////////////////
+
+bool BatchReader::begin(const uint8_t* data, size_t length) {
+    if (length < BATCH_HEADER_SIZE || data[0] != BATCH_MAGIC) {
+        return false;
+    }
+    _data = data;
+    _length = length;
+    _pos = BATCH_HEADER_SIZE;
+    _sequence = _data[1];
+    _count = _data[2];
+    _read = 0;
+    return true;
+}
+
+bool BatchReader::next(uint8_t* stream, const uint8_t** data, size_t* length) {
+    if (_read >= _count || _pos + BATCH_RECORD_HEADER > _length) {
+        return false;
+    }
+    size_t recordLength = _data[_pos + 1];
+    if (_pos + BATCH_RECORD_HEADER + recordLength > _length) {
+        return false; // Truncated
+    }
+
+    *stream = _data[_pos];
+    *data = _data + _pos + BATCH_RECORD_HEADER;
+    *length = recordLength;
+    _pos += BATCH_RECORD_HEADER + recordLength;
+    _read++;
+    return true;
+}
@@ -0,0 +1,128 @@
+#ifndef BATCHER_H
+#define BATCHER_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaFrame.h"
+
+
+////////////////////////////////////////////////////////
+///// Batch frame
+////////////////////////////////////////////////////////
+//
+//  byte 0 : magic (0xBA)
+//  byte 1 : batch sequence
+//  byte 2 : record count
+//  then per record, in the order they were added:
+//      stream id, length, bytes
+//
+// Every frame pays the preamble, the LoRa header and the fixed transmission
+// prefix, so packing several samples into one frame divides that cost.
+
+#define BATCH_MAGIC             0xBA
+#define BATCH_HEADER_SIZE       3
+#define BATCH_RECORD_HEADER     2
+#define BATCH_MAX_STREAMS       4
+
+
+/**
+ * @brief Accumulates samples of several streams into one frame
+ *
+ * A batch is ready when the next sample would not fit, when a stream has
+ * collected its sample count, or when a sample has waited its stream's
+ * latency bound, whichever comes first.
+ */
+class Batcher {
+    public:
+        // Frame size limit, at most LORA_PAYLOAD_MAX
+        Batcher(size_t capacity = LORA_PAYLOAD_MAX);
+
+        /**
+         * @brief Declare a stream and its bounds
+         *
+         * @param id Stream id written in each record
+         * @param maxSamples Batch is ready once this stream holds this many samples
+         * @param maxLatencyMs Batch is ready once a sample of this stream is this old
+         * @return false Too many streams
+         */
+        bool addStream(uint8_t id, uint8_t maxSamples, uint32_t maxLatencyMs);
+
+        /**
+         * @brief Add one sample
+         *
+         * @param stream Stream id given to addStream()
+         * @param data Sample bytes
+         * @param length Sample length
+         * @param now Time in ms
+         * @return false Unknown stream, or no room left (take() the batch first)
+         */
+        bool add(uint8_t stream, const uint8_t* data, size_t length, uint32_t now);
+
+        // True when the batch has to go out now
+        bool ready(uint32_t now) const;
+
+        // Time left before ready() turns true by latency, 0 if ready or empty
+        uint32_t msUntilDue(uint32_t now) const;
+
+        /**
+         * @brief Write the batch frame and start a new batch
+         *
+         * @param sequence Batch sequence number written in the header
+         * @param out Output buffer
+         * @param capacity Size of the output buffer
+         * @return size_t Frame length, 0 if empty or the buffer is too small
+         */
+        size_t take(uint8_t sequence, uint8_t* out, size_t capacity);
+
+        bool empty() const { return _records == 0; }
+        uint8_t records() const { return _records; }
+        size_t size() const { return BATCH_HEADER_SIZE + _length; }
+
+    private:
+        struct Stream {
+            uint8_t id;
+            uint8_t maxSamples;
+            uint32_t maxLatencyMs;
+            uint8_t samples;        // In the current batch
+        };
+
+        size_t _capacity;
+        Stream _streams[BATCH_MAX_STREAMS];
+        uint8_t _streamCount = 0;
+
+        uint8_t _body[LORA_PAYLOAD_MAX];
+        size_t _length = 0;
+        uint8_t _records = 0;
+        bool _full = false;         // A sample count was reached or the last add() did not fit
+        bool _hasDeadline = false;
+        uint32_t _deadline = 0;     // Earliest sample time + its stream's latency bound
+
+        Stream* findStream(uint8_t id);
+};
+
+
+/**
+ * @brief Walks the records of a received batch frame
+ */
+class BatchReader {
+    public:
+        // False if not a batch frame
+        bool begin(const uint8_t* data, size_t length);
+
+        uint8_t sequence() const { return _sequence; }
+        uint8_t count() const { return _count; }
+
+        // Next record, false at the end or on a truncated record
+        bool next(uint8_t* stream, const uint8_t** data, size_t* length);
+
+    private:
+        const uint8_t* _data = nullptr;
+        size_t _length = 0;
+        size_t _pos = 0;
+        uint8_t _sequence = 0;
+        uint8_t _count = 0;
+        uint8_t _read = 0;
+};
+
+#endif // BATCHER_H
@@ -0,0 +1,34 @@
+#include "BootProfile.h"
+
+static const char* phaseNames[BOOT_PHASE_COUNT] = { "serial", "module", "config", "normal" };
+
+
+BootProfile::BootProfile() {
+    for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+        _at[i] = 0;
+    }
+}
+
+void BootProfile::mark(BootPhase phase) {
+    if (phase < BOOT_PHASE_COUNT && _at[phase] == 0) {
+        _at[phase] = millis();
+    }
+}
+
+void BootProfile::print(Print& out) const {
+    out.print(_fastBoot ? "Boot (fast): " : "Boot: ");
+    for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (i > 0) {
+            out.print(" | ");
+        }
+        out.print(phaseNames[i]);
+        out.print(' ');
+        if (_at[i] == 0) {
+            out.print('-');
+        } else {
+            out.print(_at[i]);
+            out.print(" ms");
+        }
+    }
+    out.println();
+}
@@ -0,0 +1,46 @@
+#ifndef BOOTPROFILE_H
+#define BOOTPROFILE_H
+
+//Dependencies
+#include <Arduino.h>
+
+
+// Boot phases, in the order setup() reaches them
+enum BootPhase : uint8_t {
+    BOOT_SERIAL_UP,
+    BOOT_MODULE_READY,
+    BOOT_CONFIG_VERIFIED,
+    BOOT_NORMAL_MODE,
+    BOOT_PHASE_COUNT
+};
+
+/**
+ * @brief Records when each boot phase is reached
+ *
+ * Times are millis() since reset, so they include the ROM/bootloader time
+ * before setup() starts.
+ */
+class BootProfile {
+    public:
+        BootProfile();
+
+        // Timestamp a phase (first call wins)
+        void mark(BootPhase phase);
+
+        // ms since reset when the phase was reached, 0 if not reached
+        uint32_t at(BootPhase phase) const { return _at[phase]; }
+
+        // Fast boot skipped prints and fixed delays
+        void setFastBoot(bool fastBoot) { _fastBoot = fastBoot; }
+        bool isFastBoot() const { return _fastBoot; }
+
+        // Print all phases on one line
+        // e.g. "Boot (fast): serial 312 ms | module 415 ms | config 415 ms | normal 418 ms"
+        void print(Print& out) const;
+
+    private:
+        uint32_t _at[BOOT_PHASE_COUNT];
+        bool _fastBoot = false;
+};
+
+#endif // BOOTPROFILE_H
@@ -0,0 +1,154 @@
+#include "ChannelPlan.h"
+
+static_assert(CHANNEL_PLAN_MAX <= 255, "Channels are counted on one byte");
+
+
+////////////////////////////////////////////////////////
+///// Helpers
+////////////////////////////////////////////////////////
+
+bool isHopSync(const uint8_t* data, size_t length) {
+    return length == HOP_SYNC_SIZE && data[0] == HOP_SYNC_MAGIC;
+}
+
+
+////////////////////////////////////////////////////////
+///// ChannelPlan
+////////////////////////////////////////////////////////
+
+ChannelPlan::ChannelPlan() {
+    for (uint8_t i = 0; i < CHANNEL_PLAN_MAX; i++) {
+        _channels[i] = 0;
+    }
+}
+
+ChannelPlan::ChannelPlan(uint8_t first, uint8_t count, uint8_t spacing) : ChannelPlan() {
+    if (spacing == 0) {
+        spacing = 1;
+    }
+    for (uint16_t i = 0, channel = first; i < count && channel <= CHANNEL_MAX; i++, channel += spacing) {
+        add(channel);
+    }
+}
+
+bool ChannelPlan::add(uint8_t channel) {
+    if (_count >= CHANNEL_PLAN_MAX || channel > CHANNEL_MAX || contains(channel)) {
+        return false;
+    }
+    _channels[_count++] = channel;
+    return true;
+}
+
+bool ChannelPlan::contains(uint8_t channel) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_channels[i] == channel) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+////////////////////////////////////////////////////////
+///// HopSchedule
+////////////////////////////////////////////////////////
+
+HopSchedule::HopSchedule(const ChannelPlan& plan, uint32_t seed, uint16_t dwellMs)
+    : _plan(plan), _seed(seed), _dwellMs(dwellMs == 0 ? 1 : dwellMs) {}
+
+uint8_t HopSchedule::channelAt(uint32_t hop) const {
+    uint8_t count = _plan.count();
+    if (count <= 1) {
+        return _plan.channel(0);
+    }
+
+    // Shuffle of the plan for this cycle, same on every end from the seed
+    uint8_t order[CHANNEL_PLAN_MAX];
+    for (uint8_t i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    uint32_t random = _seed ^ ((hop / count) * 2654435769UL);
+    for (uint8_t i = count - 1; i > 0; i--) {
+        random = random * 1103515245 + 12345;
+        uint8_t j = (random >> 16) % (i + 1);
+        uint8_t swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+    return _plan.channel(order[hop % count]);
+}
+
+void HopSchedule::start(uint32_t now) {
+    _epoch = now;
+    _master = true;
+}
+
+bool HopSchedule::onSync(const uint8_t* frame, size_t length, uint32_t now, uint32_t latencyMs) {
+    if (!isHopSync(frame, length)) {
+        return false;
+    }
+
+    uint32_t hop = frame[1] | (frame[2] << 8) | ((uint32_t)frame[3] << 16) | ((uint32_t)frame[4] << 24);
+    uint16_t into = frame[5] | (frame[6] << 8);
+    uint16_t dwellMs = frame[7] | (frame[8] << 8);
+    if (_master || dwellMs == 0 || frame[9] != _plan.count()) {
+        return true; // Another network's plan
+    }
+    _dwellMs = dwellMs;
+    _epoch = now - latencyMs - into - hop * dwellMs;
+    _heard = true;
+    _syncAt = now;
+    _syncHop = hop;
+    return true;
+}
+
+size_t HopSchedule::writeSync(uint8_t* out, uint32_t now) const {
+    if (!_master) {
+        return 0;
+    }
+    uint32_t current = hop(now);
+    uint16_t into = (now - _epoch) - current * _dwellMs;
+    out[0] = HOP_SYNC_MAGIC;
+    out[1] = current & 0xFF;
+    out[2] = (current >> 8) & 0xFF;
+    out[3] = (current >> 16) & 0xFF;
+    out[4] = current >> 24;
+    out[5] = into & 0xFF;
+    out[6] = into >> 8;
+    out[7] = _dwellMs & 0xFF;
+    out[8] = _dwellMs >> 8;
+    out[9] = _plan.count();
+    return HOP_SYNC_SIZE;
+}
+
+bool HopSchedule::synced(uint32_t now) const {
+    return _master || (_heard && now - _syncAt < (uint32_t)HOP_LOST_HOPS * _dwellMs);
+}
+
+bool HopSchedule::awaitingSync(uint32_t now) const {
+    if (_master || !synced(now)) {
+        return false;
+    }
+    uint32_t into = (now - _epoch) % _dwellMs;
+    return hop(now) != _syncHop && into < _dwellMs / 2;
+}
+
+uint8_t HopSchedule::channel(uint32_t now) const {
+    if (synced(now)) {
+        return channelAt(hop(now));
+    }
+    // Stay a whole cycle and one more hop on each channel, the gateway comes by once
+    uint32_t scanMs = (uint32_t)(_plan.count() + 1) * _dwellMs;
+    return _plan.channel((now / scanMs) % (_plan.count() == 0 ? 1 : _plan.count()));
+}
+
+uint32_t HopSchedule::msToChange(uint32_t now) const {
+    if (_plan.count() <= 1) {
+        return UINT32_MAX;
+    }
+    if (synced(now)) {
+        return _dwellMs - (now - _epoch) % _dwellMs;
+    }
+    uint32_t scanMs = (uint32_t)(_plan.count() + 1) * _dwellMs;
+    return scanMs - now % scanMs;
+}
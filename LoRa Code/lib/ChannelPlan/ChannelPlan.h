@@ -0,0 +1,143 @@
+#ifndef CHANNELPLAN_H
+#define CHANNELPLAN_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+
+
+////////////////////////////////////////////////////////
+///// Channels
+////////////////////////////////////////////////////////
+//
+// The 868/915 MHz E32 tunes CHAN 0-69, 1 MHz apart from 862 MHz. A plan is
+// the set of channels a network uses. Buoys are split over them by id
+// (one gateway module per channel, or one group per gateway), or a gateway
+// and its buoys hop over all of them on a shared pseudo-random schedule.
+//
+// Hop sync frame, sent by the gateway on each channel it hops to:
+//
+//  byte 0 : magic (0xE5)
+//  byte 1 : hop number (32 bit, little endian)
+//  byte 5 : ms into the hop when written to the module (16 bit, little endian)
+//  byte 7 : dwell time in ms (16 bit, little endian)
+//  byte 9 : channels in the plan
+//
+// A buoy that is not in step sits on one channel for longer than a whole
+// cycle, hears the gateway come by and follows from there. Once in step it
+// keeps quiet at the start of each hop until the sync came, so its own
+// frames (half duplex) do not hide it.
+
+#define CHANNEL_MAX             69      // Highest CHAN
+#define CHANNEL_BASE_MHZ        862     // Frequency of CHAN 0
+#define CHANNEL_PLAN_MAX        16
+
+#define HOP_SYNC_MAGIC          0xE5
+#define HOP_SYNC_SIZE           10
+#define HOP_LOST_HOPS           8       // Hops a follower keeps its timing without a sync
+
+// True if a received frame is a hop sync
+bool isHopSync(const uint8_t* data, size_t length);
+
+
+/**
+ * @brief Set of channels used by a network
+ */
+class ChannelPlan {
+    public:
+        ChannelPlan();
+
+        /**
+         * @brief Evenly spaced channels
+         *
+         * @param first First channel
+         * @param count Number of channels (up to CHANNEL_PLAN_MAX, cut at CHANNEL_MAX)
+         * @param spacing Channels between two of the plan, 1 MHz each
+         */
+        ChannelPlan(uint8_t first, uint8_t count, uint8_t spacing = 1);
+
+        // False if full, out of range or already in
+        bool add(uint8_t channel);
+        bool contains(uint8_t channel) const;
+
+        uint8_t count() const { return _count; }
+        uint8_t channel(uint8_t index) const { return _channels[index % (_count == 0 ? 1 : _count)]; }
+
+        // Static split: consecutive ids land on consecutive channels
+        uint8_t channelForNode(uint16_t node) const { return channel(node % (_count == 0 ? 1 : _count)); }
+
+        static uint16_t frequencyMHz(uint8_t channel) { return CHANNEL_BASE_MHZ + channel; }
+
+    private:
+        uint8_t _channels[CHANNEL_PLAN_MAX];
+        uint8_t _count = 0;
+};
+
+
+/**
+ * @brief Pseudo-random hopping over a plan, for the gateway (master) and its buoys
+ */
+class HopSchedule {
+    public:
+        /**
+         * @brief Construct a schedule
+         *
+         * @param plan Channels to hop over
+         * @param seed Same on the gateway and its buoys, picks the order
+         * @param dwellMs Time on each channel, well above the retune time
+         */
+        HopSchedule(const ChannelPlan& plan = ChannelPlan(), uint32_t seed = 0, uint16_t dwellMs = 10000);
+
+        // Every cycle of count() hops visits each channel once, in an order drawn from the seed
+        uint8_t channelAt(uint32_t hop) const;
+
+        // Gateway: hop 0 starts now, always in step from then on
+        void start(uint32_t now);
+
+        /**
+         * @brief Follow the gateway from a received sync frame
+         *
+         * @param frame Received bytes
+         * @param length Number of received bytes
+         * @param now Time in ms the frame was received
+         * @param latencyMs Time from the gateway writing it to its module to now
+         * @return false Not a sync frame
+         */
+        bool onSync(const uint8_t* frame, size_t length, uint32_t now, uint32_t latencyMs);
+
+        /**
+         * @brief Write the sync frame for the current hop
+         *
+         * @param out At least HOP_SYNC_SIZE bytes
+         * @param now Time in ms
+         * @return size_t HOP_SYNC_SIZE, 0 if not started
+         */
+        size_t writeSync(uint8_t* out, uint32_t now) const;
+
+        bool synced(uint32_t now) const;
+
+        // Follower: this hop's sync is still due, sending now could cover it (stops halfway through the hop)
+        bool awaitingSync(uint32_t now) const;
+        uint32_t hop(uint32_t now) const { return (now - _epoch) / _dwellMs; }
+
+        // Channel to be on now: the hop's when in step, a slow scan otherwise
+        uint8_t channel(uint32_t now) const;
+
+        // Time left on the current channel
+        uint32_t msToChange(uint32_t now) const;
+
+        uint16_t dwellMs() const { return _dwellMs; }
+        const ChannelPlan& plan() const { return _plan; }
+
+    private:
+        ChannelPlan _plan;
+        uint32_t _seed;
+        uint16_t _dwellMs;
+        uint32_t _epoch = 0;        // Start of hop 0
+        bool _master = false;
+        bool _heard = false;
+        uint32_t _syncAt = 0;       // Last sync heard
+        uint32_t _syncHop = 0;      // and its hop
+};
+
+#endif // CHANNELPLAN_H
@@ -0,0 +1,89 @@
+#include "Csma.h"
+
+static_assert(CSMA_MIN_WINDOW >= 1 && CSMA_MIN_WINDOW <= CSMA_MAX_WINDOW, "Backoff window bounds");
+
+
+////////////////////////////////////////////////////////
+///// CsmaBackoff
+////////////////////////////////////////////////////////
+
+CsmaBackoff::CsmaBackoff(uint32_t slotMs, uint32_t seed) {
+    configure(slotMs);
+    setSeed(seed);
+}
+
+void CsmaBackoff::configure(uint32_t slotMs) {
+    _slotMs = slotMs == 0 ? 1 : slotMs;
+}
+
+void CsmaBackoff::setSeed(uint32_t seed) {
+    _random = seed;
+}
+
+void CsmaBackoff::onBusy(uint32_t now, uint32_t holdMs) {
+    uint32_t until = now + holdMs;
+    if (!busy(now) || (int32_t)(until - _busyUntil) > 0) {
+        _busyUntil = until;
+    }
+}
+
+void CsmaBackoff::onCollision() {
+    _stats.collisions++;
+    widen();
+}
+
+uint32_t CsmaBackoff::delayMs(uint32_t now) {
+    if (busy(now)) {
+        if (!_deferred) {
+            _deferred = true;
+            _stats.busy++;
+        }
+        if (_backingOff && !_frozen) {
+            // Someone else got there first: keep what is left for later, next frames draw from a wider window
+            int32_t left = (int32_t)(_backoffUntil - now);
+            _backoffLeft = left > 0 ? left : 0;
+            _frozen = true;
+            widen();
+        }
+        return _busyUntil - now;
+    }
+
+    if (_frozen) {
+        _frozen = false;
+        _backoffUntil = now + _backoffLeft;
+    }
+    else if (_deferred && !_backingOff) {
+        // Channel just cleared, every node that waited on it draws its own slot
+        uint32_t backoff = (next() % _window) * _slotMs;
+        _backoffUntil = now + backoff;
+        _backingOff = true;
+        _stats.backoffs++;
+        _stats.backoffMs += backoff;
+    }
+    if (_backingOff && (int32_t)(_backoffUntil - now) > 0) {
+        return _backoffUntil - now;
+    }
+    _backingOff = false;
+    _deferred = false;
+    return 0;
+}
+
+void CsmaBackoff::onSent() {
+    _stats.sent++;
+    _window = _window / 2 < CSMA_MIN_WINDOW ? CSMA_MIN_WINDOW : _window / 2;
+}
+
+CsmaStats CsmaBackoff::stats() const {
+    CsmaStats stats = _stats;
+    stats.window = _window;
+    return stats;
+}
+
+void CsmaBackoff::widen() {
+    _window = _window * 2 > CSMA_MAX_WINDOW ? CSMA_MAX_WINDOW : _window * 2;
+}
+
+uint32_t CsmaBackoff::next() {
+    _random = _random * 1103515245 + 12345;
+    return _random >> 16;
+}
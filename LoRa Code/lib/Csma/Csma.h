@@ -0,0 +1,103 @@
+#ifndef CSMA_H
+#define CSMA_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+
+
+////////////////////////////////////////////////////////
+///// Carrier sense with random backoff
+////////////////////////////////////////////////////////
+//
+// A frame that finds the channel busy waits for it to clear, then for a
+// random number of backoff slots, so nodes that were all waiting on the
+// same packet do not start together once it ends. Traffic during the
+// backoff freezes it until the channel clears again. The window the slots
+// are drawn from doubles whenever that happens or a collision is seen,
+// and halves with every frame sent.
+//
+// The caller tells what the channel looks like (onBusy()). The E32 gives
+// no carrier detect: it only shows a packet once received, AUX going LOW
+// right before the module outputs it on the UART. Until that tail has
+// passed the channel counts as busy, and the backoff slot is one packet
+// long since another node's packet can only be seen after the fact.
+
+#define CSMA_MIN_WINDOW         2       // Backoff slots drawn from at first
+#define CSMA_MAX_WINDOW         64
+
+/**
+ * @brief Carrier sense counters
+ */
+struct CsmaStats {
+    uint32_t sent;          // Frames let through
+    uint32_t busy;          // Frames that found the channel busy
+    uint32_t backoffs;      // Random backoffs drawn
+    uint32_t backoffMs;     // Total backoff drawn
+    uint32_t collisions;    // Traffic heard while our own frame was on air
+    uint16_t window;        // Current backoff window, in slots
+};
+
+
+/**
+ * @brief Decides when the next frame may go on air
+ */
+class CsmaBackoff {
+    public:
+        /**
+         * @brief Construct a backoff
+         *
+         * @param slotMs Backoff slot, the time a packet needs to be noticed by the others
+         * @param seed Different on every node, or they all draw the same backoffs
+         */
+        CsmaBackoff(uint32_t slotMs = 100, uint32_t seed = 1);
+
+        void configure(uint32_t slotMs);
+        void setSeed(uint32_t seed);
+        uint32_t slotMs() const { return _slotMs; }
+
+        /**
+         * @brief Traffic seen on the channel
+         *
+         * @param now Time in ms
+         * @param holdMs The channel counts as busy this long from now
+         */
+        void onBusy(uint32_t now, uint32_t holdMs);
+        bool busy(uint32_t now) const { return (int32_t)(_busyUntil - now) > 0; }
+
+        // Our own frame went through another one: widen the window
+        void onCollision();
+
+        /**
+         * @brief How long the frame at the head of the queue has to wait
+         *
+         * Draws the backoff once the channel clears, call it again after
+         * the wait (or on new traffic) until it returns 0.
+         *
+         * @param now Time in ms
+         * @return uint32_t 0 to send now, otherwise ms to wait
+         */
+        uint32_t delayMs(uint32_t now);
+
+        // The frame went on air
+        void onSent();
+
+        CsmaStats stats() const;
+
+    private:
+        uint32_t _slotMs;
+        uint16_t _window = CSMA_MIN_WINDOW;
+        uint32_t _busyUntil = 0;
+        bool _deferred = false;         // Head frame saw the channel busy, backoff due once clear
+        bool _backingOff = false;
+        bool _frozen = false;           // Backoff paused by traffic, _backoffLeft to go
+        uint32_t _backoffUntil = 0;
+        uint32_t _backoffLeft = 0;
+        uint32_t _random;
+        CsmaStats _stats = {};
+
+        void widen();
+        uint32_t next();
+};
+
+#endif // CSMA_H
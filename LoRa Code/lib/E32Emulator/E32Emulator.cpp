@@ -0,0 +1,454 @@
+#include "E32Emulator.h"
+#include <chrono>
+
+#define CMD_SAVE        0xC0
+#define CMD_READ        0xC1
+#define CMD_LOSE        0xC2
+#define CMD_VERSION     0xC3
+#define CMD_RESET       0xC4
+
+#define COMMAND_IDLE_US 100000  // A half received command is dropped after this
+
+// UART baud of each SPED.uartBaudRate code
+static const uint32_t uartBaud[] = { 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200 };
+
+// Nominal air bit rate of each SPED.airDataRate code (5-7 are all 19.2k)
+static const uint32_t airBps[] = { 300, 1200, 2400, 4800, 9600, 19200, 19200, 19200 };
+
+
+////////////////////////////////////////////////////////
+///// AirChannel
+////////////////////////////////////////////////////////
+
+AirChannel::AirChannel() {
+    _running = true;
+    _thread = std::thread(&AirChannel::run, this);
+}
+
+AirChannel::~AirChannel() {
+    _running = false;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void AirChannel::setLatencyMs(uint32_t latencyMs) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _latencyUs = latencyMs * 1000;
+}
+
+void AirChannel::setLossRate(float lossRate) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _lossRate = lossRate;
+}
+
+void AirChannel::setBurstLength(float meanPackets) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _burstLength = meanPackets < 1.0f ? 1.0f : meanPackets;
+    _fading = false;
+}
+
+void AirChannel::setBitRate(uint32_t bps) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _bitRate = bps;
+}
+
+uint32_t AirChannel::packets() {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _packets;
+}
+
+uint32_t AirChannel::collisions() {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _collisions;
+}
+
+void AirChannel::attach(E32Emulator* module) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _modules.push_back(module);
+}
+
+void AirChannel::detach(E32Emulator* module) {
+    std::lock_guard<std::mutex> guard(_lock);
+    for (size_t i = 0; i < _modules.size(); i++) {
+        if (_modules[i] == module) {
+            _modules.erase(_modules.begin() + i);
+            break;
+        }
+    }
+    for (size_t i = 0; i < _onAir.size(); i++) {
+        if (_onAir[i].sender == module) {
+            _onAir[i].sender = nullptr;
+        }
+    }
+}
+
+uint64_t AirChannel::airtimeUs(uint8_t airDataRate, size_t length, uint8_t wakeUpTime, bool wakeUp) const {
+    uint32_t bps = _bitRate > 0 ? _bitRate : airBps[airDataRate & 0x07];
+    uint64_t us = (uint64_t)(length + E32_AIR_OVERHEAD_BYTES) * 8 * 1000000 / bps;
+    if (wakeUp) {
+        // Long preamble so modules in power saving mode catch it
+        us += (uint64_t)250000 * (wakeUpTime + 1);
+    }
+    return us;
+}
+
+void AirChannel::transmit(const Packet& packet) {
+    // Called from run() with the lock held
+    Packet sent = packet;
+    for (Packet& other : _onAir) {
+        if (other.chan == sent.chan && other.startUs < sent.endUs && other.endUs > sent.startUs) {
+            if (!other.collided) {
+                _collisions++;
+            }
+            other.collided = true;
+            sent.collided = true;
+        }
+    }
+    _onAir.push_back(sent);
+    _packets++;
+}
+
+bool AirChannel::lost() {
+    if (_lossRate <= 0.0f) {
+        return false;
+    }
+    float draw = (float)rand() / RAND_MAX;
+    if (_burstLength <= 1.0f || _lossRate >= 1.0f) {
+        return draw < _lossRate;
+    }
+
+    // Two states: every packet is lost while fading, none otherwise.
+    // Leaving the fade at 1/L gives fades of L packets on average, entering
+    // it is set so the time spent fading stays at the loss rate.
+    if (_fading) {
+        _fading = draw >= 1.0f / _burstLength;
+    } else {
+        _fading = draw < _lossRate / (_burstLength * (1.0f - _lossRate));
+    }
+    return _fading;
+}
+
+void AirChannel::run() {
+    while (_running) {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            uint64_t now = (uint64_t)esp_timer_get_time();
+
+            for (E32Emulator* module : _modules) {
+                module->tick(now);
+            }
+
+            // Deliver packets that are off the air (plus latency) to everyone else
+            for (size_t i = 0; i < _onAir.size();) {
+                Packet& packet = _onAir[i];
+                if (packet.endUs + _latencyUs > now) {
+                    i++;
+                    continue;
+                }
+                for (E32Emulator* module : _modules) {
+                    if (module == packet.sender) {
+                        continue;
+                    }
+                    Packet heard = packet;
+                    if (lost()) {
+                        heard.collided = true;
+                    }
+                    module->receive(heard, now);
+                }
+                _onAir.erase(_onAir.begin() + i);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(E32_TICK_US));
+    }
+}
+
+
+////////////////////////////////////////////////////////
+///// E32Emulator
+////////////////////////////////////////////////////////
+
+E32Emulator::E32Emulator(HardwareSerial& serial, AirChannel& air, int m0Pin, int m1Pin, int auxPin)
+    : _serial(serial), _air(air), _m0Pin(m0Pin), _m1Pin(m1Pin), _auxPin(auxPin)
+{
+    _saved = { 0x00, 0x00, E32_DEFAULT_SPED, E32_DEFAULT_CHAN, E32_DEFAULT_OPTION };
+    _running = _saved;
+    if (_auxPin >= 0) {
+        digitalWrite(_auxPin, LOW); // Power-on self check until the first tick
+    }
+    _air.attach(this);
+}
+
+E32Emulator::~E32Emulator() {
+    _air.detach(this);
+}
+
+void E32Emulator::setRegisters(const E32Registers& registers, bool persist) {
+    std::lock_guard<std::mutex> guard(_air._lock);
+    _running = registers;
+    if (persist) {
+        _saved = registers;
+    }
+}
+
+E32Registers E32Emulator::getRegisters() {
+    std::lock_guard<std::mutex> guard(_air._lock);
+    return _running;
+}
+
+void E32Emulator::powerCycle() {
+    std::lock_guard<std::mutex> guard(_air._lock);
+    _running = _saved;
+    _mode = 0xFF;
+    _txQueue.clear();
+    _queuedBytes = 0;
+    _pendingLength = 0;
+    _inMessage = false;
+    _output.clear();
+}
+
+uint8_t E32Emulator::getMode() {
+    std::lock_guard<std::mutex> guard(_air._lock);
+    return _mode;
+}
+
+E32Stats E32Emulator::getStats() {
+    std::lock_guard<std::mutex> guard(_air._lock);
+    return _stats;
+}
+
+void E32Emulator::tick(uint64_t nowUs) {
+    readMode(nowUs);
+    readUart(nowUs);
+
+    // End of a UART message: whatever is left goes out as the last packet
+    if (_inMessage && nowUs - _lastByteUs >= (uint64_t)E32_UART_GAP_BYTES * _serial.byteTimeUs()) {
+        cutPacket();
+        _inMessage = false;
+    }
+
+    if (!_txQueue.empty() && nowUs >= _txUntil && nowUs >= _busyUntil) {
+        startTransmission(nowUs);
+    }
+
+    flushOutput(nowUs);
+    driveAux(nowUs);
+}
+
+void E32Emulator::readMode(uint64_t nowUs) {
+    uint8_t m0 = _m0Pin >= 0 ? digitalRead(_m0Pin) : LOW;
+    uint8_t m1 = _m1Pin >= 0 ? digitalRead(_m1Pin) : LOW;
+    uint8_t mode = (m1 << 1) | m0;
+
+    if (mode == _mode) {
+        return;
+    }
+
+    // First tick is the power-on self check
+    _busyUntil = nowUs + (_mode == 0xFF ? E32_RESET_MS : E32_MODE_SWITCH_MS) * 1000ULL;
+    _mode = mode;
+    _commandLength = 0;
+}
+
+bool E32Emulator::uartMatches() const {
+    // Sleep mode always talks 9600, other modes the configured baud
+    uint32_t wanted = (_mode == 3) ? 9600 : uartBaud[_running.uartBaudRate()];
+    return _serial.baudRate() == wanted;
+}
+
+void E32Emulator::readUart(uint64_t nowUs) {
+    uint8_t bytes[64];
+    size_t count;
+
+    while ((count = _serial.takeTx(bytes, sizeof(bytes))) > 0) {
+
+        // Wrong baud is garbage, busy or power saving modules do not listen
+        if (!uartMatches() || nowUs < _busyUntil || _mode == 2) {
+            continue;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (_mode == 3) {
+                if (_commandLength > 0 && nowUs - _commandLastUs > COMMAND_IDLE_US) {
+                    _commandLength = 0;
+                }
+                _command[_commandLength++] = bytes[i];
+                _commandLastUs = nowUs;
+                handleCommand(nowUs);
+                continue;
+            }
+
+            if (_queuedBytes + _pendingLength >= E32_BUFFER_SIZE) {
+                _stats.bufferOverflows++;
+                continue;
+            }
+
+            if (!_inMessage) {
+                _inMessage = true;
+                _headerLength = 0;
+                _pendingLength = 0;
+            }
+            _lastByteUs = nowUs;
+
+            // Fixed transmission: first 3 bytes of the message are the destination
+            if (_running.fixedTransmission() && _headerLength < 3) {
+                _header[_headerLength++] = bytes[i];
+                continue;
+            }
+
+            _pending[_pendingLength++] = bytes[i];
+            if (_pendingLength == E32_PACKET_MAX) {
+                cutPacket();
+            }
+        }
+    }
+}
+
+void E32Emulator::handleCommand(uint64_t nowUs) {
+    uint8_t head = _command[0];
+
+    if (head == CMD_SAVE || head == CMD_LOSE) {
+        if (_commandLength < 6) {
+            return;
+        }
+        _running = { _command[1], _command[2], _command[3], _command[4], _command[5] };
+        if (head == CMD_SAVE) {
+            _saved = _running;
+        }
+        _commandLength = 0;
+        _stats.commands++;
+        reply(_command, 6, nowUs);
+        return;
+    }
+
+    if (head == CMD_READ || head == CMD_VERSION || head == CMD_RESET) {
+        if (_commandLength < 3) {
+            if (_command[_commandLength - 1] != head) {
+                _commandLength = 0;
+            }
+            return;
+        }
+        _commandLength = 0;
+        _stats.commands++;
+
+        if (head == CMD_READ) {
+            uint8_t answer[6] = { CMD_SAVE, _running.addh, _running.addl, _running.sped, _running.chan, _running.option };
+            reply(answer, sizeof(answer), nowUs);
+        }
+        else if (head == CMD_VERSION) {
+            uint8_t answer[4] = { CMD_VERSION, E32_VERSION_FREQUENCY, E32_VERSION, E32_FEATURES };
+            reply(answer, sizeof(answer), nowUs);
+        }
+        else {
+            _running = _saved;
+            _busyUntil = nowUs + E32_RESET_MS * 1000ULL;
+        }
+        return;
+    }
+
+    // Not a command head, the module ignores it
+    _commandLength = 0;
+}
+
+void E32Emulator::reply(const uint8_t* data, size_t length, uint64_t nowUs) {
+    _busyUntil = nowUs + E32_COMMAND_MS * 1000ULL;
+
+    Output output;
+    output.atUs = _busyUntil;
+    output.length = length;
+    memcpy(output.data, data, length);
+    _output.push_back(output);
+}
+
+void E32Emulator::cutPacket() {
+    bool fixed = _running.fixedTransmission();
+    if (_pendingLength == 0 || (fixed && _headerLength < 3)) {
+        _pendingLength = 0;
+        return;
+    }
+
+    AirChannel::Packet packet;
+    packet.sender = this;
+    packet.chan = fixed ? _header[2] : _running.chan;
+    packet.airDataRate = _running.airDataRate();
+    packet.address = fixed ? (((uint16_t)_header[0] << 8) | _header[1]) : _running.address();
+    packet.wakeUp = false;
+    packet.collided = false;
+    packet.startUs = 0;
+    packet.endUs = 0;
+    packet.length = _pendingLength;
+    memcpy(packet.data, _pending, _pendingLength);
+
+    _txQueue.push_back(packet);
+    _queuedBytes += _pendingLength;
+    _pendingLength = 0;
+}
+
+void E32Emulator::startTransmission(uint64_t nowUs) {
+    if (_mode != 0 && _mode != 1) {
+        return; // Waits in the buffer until back in a transmitting mode
+    }
+
+    AirChannel::Packet packet = _txQueue.front();
+    _txQueue.pop_front();
+    _queuedBytes -= packet.length;
+
+    packet.wakeUp = (_mode == 1);
+    packet.startUs = nowUs;
+    packet.endUs = nowUs + _air.airtimeUs(packet.airDataRate, packet.length, _running.wakeUpTime(), packet.wakeUp);
+    _txStartUs = packet.startUs;
+    _txUntil = packet.endUs;
+
+    _stats.packetsSent++;
+    _stats.bytesSent += packet.length;
+    _air.transmit(packet);
+}
+
+void E32Emulator::receive(const AirChannel::Packet& packet, uint64_t nowUs) {
+    if (packet.chan != _running.chan) {
+        return; // Other channel, never heard
+    }
+
+    uint16_t address = _running.address();
+    bool addressed = packet.address == address || packet.address == 0xFFFF || address == 0xFFFF;
+    if (!addressed) {
+        return;
+    }
+
+    // Half duplex: we were on air ourselves
+    bool transmitting = _txStartUs < packet.endUs && _txUntil > packet.startUs;
+    bool listening = (_mode == 0 || _mode == 1 || (_mode == 2 && packet.wakeUp)) && nowUs >= _busyUntil;
+
+    if (packet.collided || transmitting || !listening || packet.airDataRate != _running.airDataRate()) {
+        _stats.packetsMissed++;
+        return;
+    }
+
+    // AUX goes LOW a little before the data comes out
+    Output output;
+    output.atUs = nowUs + E32_RX_AUX_LEAD_US;
+    output.length = packet.length;
+    memcpy(output.data, packet.data, packet.length);
+    _output.push_back(output);
+    _stats.packetsReceived++;
+}
+
+void E32Emulator::flushOutput(uint64_t nowUs) {
+    while (!_output.empty() && _output.front().atUs <= nowUs) {
+        _serial.injectRx(_output.front().data, _output.front().length);
+        _output.erase(_output.begin());
+    }
+}
+
+void E32Emulator::driveAux(uint64_t nowUs) {
+    if (_auxPin < 0) {
+        return;
+    }
+    bool busy = nowUs < _busyUntil
+        || _inMessage
+        || !_txQueue.empty()
+        || nowUs < _txUntil
+        || !_output.empty()
+        || _serial.rxBusy();
+    digitalWrite(_auxPin, busy ? LOW : HIGH);
+}
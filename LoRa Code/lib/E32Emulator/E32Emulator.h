@@ -0,0 +1,236 @@
+#ifndef E32EMULATOR_H
+#define E32EMULATOR_H
+
+//Dependencies
+// Native env only, the module sits on the far end of a NativeArduino HardwareSerial
+#include <Arduino.h>
+#include <deque>
+#include <thread>
+#include <vector>
+
+
+////////////////////////////////////////////////////////
+///// Module model
+////////////////////////////////////////////////////////
+//
+// Modes follow M0/M1 (M0 = bit 0, M1 = bit 1), AUX is driven LOW while busy.
+//
+//  Mode 0 normal      : UART data is sent, packets are received
+//  Mode 1 wake-up     : same, every packet carries a wake-up preamble
+//  Mode 2 power saving: UART input ignored, only wake-up packets are received
+//  Mode 3 sleep       : configuration commands at 9600 8N1
+//
+//  C0 + 5 params : write, kept over power down, echoed back
+//  C2 + 5 params : write, lost on power down, echoed back
+//  C1 C1 C1      : read, answered with C0 + 5 params
+//  C3 C3 C3      : version, answered with C3 + 3 bytes
+//  C4 C4 C4      : reset
+//
+// Params are ADDH, ADDL, SPED, CHAN, OPTION in the datasheet register layout.
+// In fixed transmission the first 3 bytes of each UART message are the
+// destination ADDH, ADDL, CHAN. In transparent mode every byte is sent as is
+// and only reaches modules with the same address and channel (0xFFFF listens
+// to, and sends to, everyone).
+
+#define E32_PACKET_MAX          58      // Bytes per air packet (sub-packet)
+#define E32_BUFFER_SIZE         512     // UART -> air buffer
+#define E32_UART_GAP_BYTES      3       // UART idle time (in bytes) that ends a message
+#define E32_AIR_OVERHEAD_BYTES  6       // Preamble, header and CRC per packet
+#define E32_RX_AUX_LEAD_US      2000    // AUX goes LOW this long before received data is output
+#define E32_MODE_SWITCH_MS      10      // AUX LOW after M0/M1 change
+#define E32_COMMAND_MS          20      // AUX LOW while a command is processed
+#define E32_RESET_MS            100
+#define E32_TICK_US             100     // Simulation step
+#define E32_VERSION_FREQUENCY   0x32    // Frequency byte of the C3 answer, as in the datasheet example
+#define E32_VERSION             0x44
+#define E32_FEATURES            0x14
+
+// Factory defaults: address 0, 9600 8N1, 2.4k air, channel 6 (868 MHz), transparent, 30 dBm
+#define E32_DEFAULT_SPED        0x1A
+#define E32_DEFAULT_CHAN        0x06
+#define E32_DEFAULT_OPTION      0x44
+
+/**
+ * @brief Raw parameter registers of one module
+ */
+struct E32Registers {
+    uint8_t addh;
+    uint8_t addl;
+    uint8_t sped;
+    uint8_t chan;
+    uint8_t option;
+
+    uint16_t address() const { return ((uint16_t)addh << 8) | addl; }
+    uint8_t airDataRate() const { return sped & 0x07; }
+    uint8_t uartBaudRate() const { return (sped >> 3) & 0x07; }
+    bool fixedTransmission() const { return (option & 0x80) != 0; }
+    uint8_t wakeUpTime() const { return (option >> 3) & 0x07; }
+};
+
+/**
+ * @brief Counters of one emulated module
+ */
+struct E32Stats {
+    uint32_t packetsSent;
+    uint32_t bytesSent;         // Payload bytes put on air
+    uint32_t packetsReceived;   // Output to the UART
+    uint32_t packetsMissed;     // Heard on our channel but lost (collision, loss, busy, wrong rate)
+    uint32_t bufferOverflows;   // UART bytes dropped, module buffer full
+    uint32_t commands;          // Configuration commands handled
+};
+
+class E32Emulator;
+
+
+/**
+ * @brief Shared radio medium between emulated modules
+ *
+ * Runs the simulation thread for every module attached to it. Packets that
+ * overlap in time on the same channel are both lost.
+ */
+class AirChannel {
+    public:
+        AirChannel();
+        ~AirChannel();
+
+        // Delay added between the end of a packet on air and its delivery
+        void setLatencyMs(uint32_t latencyMs);
+
+        // Probability (0-1) that a packet is lost on its way to each receiver
+        void setLossRate(float lossRate);
+
+        // Lose packets in fades of this mean length (Gilbert-Elliott) at the same
+        // average loss rate, 1 keeps every loss independent
+        void setBurstLength(float meanPackets);
+
+        // Force an air bit rate in bps for every packet, 0 follows each module's SPED
+        void setBitRate(uint32_t bps);
+
+        uint32_t packets();
+        uint32_t collisions();
+
+    private:
+        friend class E32Emulator;
+
+        struct Packet {
+            E32Emulator* sender;
+            uint8_t chan;
+            uint8_t airDataRate;
+            uint16_t address;       // Destination (fixed) or sender address (transparent)
+            bool wakeUp;
+            bool collided;
+            uint64_t startUs;
+            uint64_t endUs;
+            uint8_t length;
+            uint8_t data[E32_PACKET_MAX];
+        };
+
+        std::mutex _lock;
+        std::thread _thread;
+        volatile bool _running = false;
+
+        std::vector<E32Emulator*> _modules;
+        std::vector<Packet> _onAir;
+
+        uint32_t _latencyUs = 0;
+        float _lossRate = 0.0f;
+        float _burstLength = 1.0f;
+        bool _fading = false;           // Bad state of the burst loss model
+        uint32_t _bitRate = 0;
+        uint32_t _packets = 0;
+        uint32_t _collisions = 0;
+
+        void attach(E32Emulator* module);
+        void detach(E32Emulator* module);
+        void transmit(const Packet& packet);
+        bool lost();
+        uint64_t airtimeUs(uint8_t airDataRate, size_t length, uint8_t wakeUpTime, bool wakeUp) const;
+        void run();
+};
+
+
+/**
+ * @brief Byte level emulation of an EBYTE E32 module
+ *
+ * Reads what the sketch writes on a HardwareSerial, follows the M0/M1 pins,
+ * drives AUX and answers on the same serial, like the module on the board.
+ */
+class E32Emulator {
+    public:
+        /**
+         * @brief Attach a module to a serial port and pins
+         *
+         * @param serial Port the sketch (e.g. LoRa) talks to the module on
+         * @param air Medium shared with the other modules
+         * @param m0Pin M0 pin, -1 if tied LOW
+         * @param m1Pin M1 pin, -1 if tied LOW
+         * @param auxPin AUX pin, -1 if not wired
+         */
+        E32Emulator(HardwareSerial& serial, AirChannel& air, int m0Pin = -1, int m1Pin = -1, int auxPin = -1);
+        ~E32Emulator();
+
+        // Program the registers directly (a module configured beforehand)
+        void setRegisters(const E32Registers& registers, bool persist = true);
+        E32Registers getRegisters();
+
+        // Power cycle: the running registers fall back to the saved ones
+        void powerCycle();
+
+        uint8_t getMode();
+        E32Stats getStats();
+
+    private:
+        friend class AirChannel;
+
+        HardwareSerial& _serial;
+        AirChannel& _air;
+        int _m0Pin;
+        int _m1Pin;
+        int _auxPin;
+
+        E32Registers _saved;
+        E32Registers _running;
+        uint8_t _mode = 0xFF;
+        uint64_t _busyUntil = 0;    // Mode switch, command or reset in progress
+
+        // Sleep mode command bytes
+        uint8_t _command[6];
+        uint8_t _commandLength = 0;
+        uint64_t _commandLastUs = 0;
+
+        // UART -> air: the current message is cut into packets as it fills up
+        std::deque<AirChannel::Packet> _txQueue;
+        size_t _queuedBytes = 0;
+        uint8_t _pending[E32_PACKET_MAX];
+        size_t _pendingLength = 0;
+        uint8_t _header[3];         // Fixed transmission ADDH, ADDL, CHAN of the current message
+        uint8_t _headerLength = 0;
+        bool _inMessage = false;
+        uint64_t _lastByteUs = 0;
+        uint64_t _txStartUs = 0;
+        uint64_t _txUntil = 0;
+
+        // Air -> UART
+        struct Output {
+            uint64_t atUs;
+            uint8_t length;
+            uint8_t data[E32_PACKET_MAX];
+        };
+        std::vector<Output> _output;
+
+        E32Stats _stats = {};
+
+        void tick(uint64_t nowUs);
+        void readMode(uint64_t nowUs);
+        void readUart(uint64_t nowUs);
+        void handleCommand(uint64_t nowUs);
+        void cutPacket();
+        void startTransmission(uint64_t nowUs);
+        void receive(const AirChannel::Packet& packet, uint64_t nowUs);
+        void flushOutput(uint64_t nowUs);
+        void driveAux(uint64_t nowUs);
+        bool uartMatches() const;
+        void reply(const uint8_t* data, size_t length, uint64_t nowUs);
+};
+
+#endif // E32EMULATOR_H
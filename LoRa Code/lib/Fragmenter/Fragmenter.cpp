@@ -0,0 +1,204 @@
+#include "Fragmenter.h"
+#include <string.h>
+
+static_assert(FRAG_MAX_FRAGMENTS <= 32, "Fragment bitmap is 32 bits");
+
+
+////////////////////////////////////////////////////////
+///// Helpers
+////////////////////////////////////////////////////////
+
+bool isFragment(const uint8_t* data, size_t length) {
+    return length > FRAG_HEADER_SIZE
+        && data[0] == FRAG_MAGIC
+        && data[3] > 0
+        && data[2] < data[3];
+}
+
+
+////////////////////////////////////////////////////////
+///// Fragmenter
+////////////////////////////////////////////////////////
+
+bool Fragmenter::begin(const uint8_t* data, size_t size) {
+    if (pending() || size == 0 || size > FRAG_MAX_MESSAGE) {
+        return false;
+    }
+    memcpy(_message, data, size);
+    _size = size;
+    _messageId++;
+    _index = 0;
+    _count = (size + FRAG_PAYLOAD - 1) / FRAG_PAYLOAD;
+    return true;
+}
+
+size_t Fragmenter::next(uint8_t* out, size_t capacity) {
+    if (!pending()) {
+        return 0;
+    }
+
+    size_t offset = (size_t)_index * FRAG_PAYLOAD;
+    size_t chunk = _size - offset;
+    if (chunk > FRAG_PAYLOAD) {
+        chunk = FRAG_PAYLOAD;
+    }
+    if (capacity < FRAG_HEADER_SIZE + chunk) {
+        return 0;
+    }
+
+    out[0] = FRAG_MAGIC;
+    out[1] = _messageId;
+    out[2] = _index;
+    out[3] = _count;
+    memcpy(out + FRAG_HEADER_SIZE, _message + offset, chunk);
+    _index++;
+
+    return FRAG_HEADER_SIZE + chunk;
+}
+
+
+////////////////////////////////////////////////////////
+///// Reassembler
+////////////////////////////////////////////////////////
+
+Reassembler::Reassembler() {
+    for (uint8_t i = 0; i < FRAG_SLOTS; i++) {
+        _slots[i].used = false;
+    }
+    for (uint8_t i = 0; i < FRAG_RECENT; i++) {
+        _recent[i].used = false;
+    }
+}
+
+Reassembler::Slot* Reassembler::findSlot(uint16_t node, uint8_t messageId, uint8_t count, uint32_t now) {
+    Slot* freeSlot = nullptr;
+    Slot* oldest = nullptr;
+
+    for (uint8_t i = 0; i < FRAG_SLOTS; i++) {
+        Slot& slot = _slots[i];
+        if (!slot.used) {
+            if (freeSlot == nullptr) {
+                freeSlot = &slot;
+            }
+            continue;
+        }
+        if (slot.node == node && slot.messageId == messageId) {
+            if (slot.count == count) {
+                return &slot;
+            }
+            // Same id, different shape: the sender moved on, start over
+            slot.used = false;
+            return findSlot(node, messageId, count, now);
+        }
+        if (oldest == nullptr || (int32_t)(slot.lastUpdate - oldest->lastUpdate) < 0) {
+            oldest = &slot;
+        }
+    }
+
+    Slot* slot = freeSlot;
+    if (slot == nullptr) {
+        slot = oldest;
+        _stats.evicted++;
+    }
+
+    slot->used = true;
+    slot->node = node;
+    slot->messageId = messageId;
+    slot->count = count;
+    slot->received = 0;
+    slot->bitmap = 0;
+    slot->size = 0;
+    slot->lastUpdate = now;
+    return slot;
+}
+
+bool Reassembler::recentlyCompleted(uint16_t node, uint8_t messageId, uint8_t count, uint32_t now) const {
+    for (uint8_t i = 0; i < FRAG_RECENT; i++) {
+        const Recent& recent = _recent[i];
+        if (recent.used && recent.node == node && recent.messageId == messageId
+            && recent.count == count && now - recent.completedAt < FRAG_TIMEOUT_MS) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t Reassembler::accept(const uint8_t* frame, size_t length, uint32_t now, uint16_t node) {
+    expire(now);
+
+    if (!isFragment(frame, length)) {
+        _stats.invalid++;
+        return 0;
+    }
+
+    uint8_t messageId = frame[1];
+    uint8_t index = frame[2];
+    uint8_t count = frame[3];
+    size_t chunk = length - FRAG_HEADER_SIZE;
+
+    // Every fragment but the last is full, so its offset follows from the index
+    bool last = (index == count - 1);
+    if (count > FRAG_MAX_FRAGMENTS || chunk > FRAG_PAYLOAD || (!last && chunk != FRAG_PAYLOAD)) {
+        _stats.invalid++;
+        return 0;
+    }
+
+    // Late copy of a fragment whose message is already out
+    if (recentlyCompleted(node, messageId, count, now)) {
+        _stats.duplicates++;
+        return 0;
+    }
+
+    Slot* slot = findSlot(node, messageId, count, now);
+    slot->lastUpdate = now;
+
+    if (slot->bitmap & (1UL << index)) {
+        _stats.duplicates++;
+        return 0;
+    }
+
+    memcpy(slot->data + (size_t)index * FRAG_PAYLOAD, frame + FRAG_HEADER_SIZE, chunk);
+    slot->bitmap |= (1UL << index);
+    slot->received++;
+    if (last) {
+        slot->size = (size_t)index * FRAG_PAYLOAD + chunk;
+    }
+
+    if (slot->received < slot->count) {
+        return 0;
+    }
+
+    // Complete: the slot is free again but keeps its data until reused
+    slot->used = false;
+    _completed = slot->data;
+
+    Recent& recent = _recent[_recentNext];
+    _recentNext = (_recentNext + 1) % FRAG_RECENT;
+    recent.used = true;
+    recent.node = node;
+    recent.messageId = messageId;
+    recent.count = count;
+    recent.completedAt = now;
+    _stats.completed++;
+    return slot->size;
+}
+
+void Reassembler::expire(uint32_t now) {
+    for (uint8_t i = 0; i < FRAG_SLOTS; i++) {
+        Slot& slot = _slots[i];
+        if (slot.used && now - slot.lastUpdate >= FRAG_TIMEOUT_MS) {
+            slot.used = false;
+            _stats.timedOut++;
+        }
+    }
+}
+
+size_t Reassembler::inProgress() const {
+    size_t count = 0;
+    for (uint8_t i = 0; i < FRAG_SLOTS; i++) {
+        if (_slots[i].used) {
+            count++;
+        }
+    }
+    return count;
+}
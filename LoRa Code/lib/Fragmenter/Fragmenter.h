@@ -0,0 +1,150 @@
+#ifndef FRAGMENTER_H
+#define FRAGMENTER_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaFrame.h"
+
+
+////////////////////////////////////////////////////////
+///// Fragment format
+////////////////////////////////////////////////////////
+//
+//  byte 0 : magic (0xF7)
+//  byte 1 : message id
+//  byte 2 : fragment index
+//  byte 3 : fragment count
+//  byte 4+: payload, FRAG_PAYLOAD bytes for every fragment but the last
+//
+// A fragment fills one LoRa frame, which is one E32 sub-packet once the
+// fixed header is added, so the module never splits or merges it.
+
+#define FRAG_MAGIC              0xF7
+#define FRAG_HEADER_SIZE        4
+#define FRAG_PAYLOAD            (LORA_PAYLOAD_MAX - FRAG_HEADER_SIZE)
+
+#define FRAG_MAX_MESSAGE        1024
+#define FRAG_MAX_FRAGMENTS      ((FRAG_MAX_MESSAGE + FRAG_PAYLOAD - 1) / FRAG_PAYLOAD)
+#define FRAG_SLOTS              4       // Messages reassembled at the same time
+#define FRAG_TIMEOUT_MS         5000    // Incomplete message dropped after this long without a fragment
+#define FRAG_RECENT             8       // Completed messages remembered for FRAG_TIMEOUT_MS, late fragments dropped
+
+// True if a received frame is a fragment
+bool isFragment(const uint8_t* data, size_t length);
+
+
+/**
+ * @brief Splits one message into fragments
+ *
+ * The message is copied in, so the caller's buffer can be reused right away.
+ */
+class Fragmenter {
+    public:
+        /**
+         * @brief Start a new message
+         *
+         * @param data Message bytes
+         * @param size Message size, at most FRAG_MAX_MESSAGE
+         * @return false Too big, empty, or the previous message is not fully out yet
+         */
+        bool begin(const uint8_t* data, size_t size);
+
+        /**
+         * @brief Write the next fragment
+         *
+         * @param out Output buffer, LORA_PAYLOAD_MAX bytes is always enough
+         * @param capacity Size of the output buffer
+         * @return size_t Fragment length, 0 when the message is done
+         */
+        size_t next(uint8_t* out, size_t capacity);
+
+        bool pending() const { return _index < _count; }
+        uint8_t messageId() const { return _messageId; }
+
+    private:
+        uint8_t _message[FRAG_MAX_MESSAGE];
+        size_t _size = 0;
+        uint8_t _messageId = 0;
+        uint8_t _index = 0;
+        uint8_t _count = 0;
+};
+
+
+/**
+ * @brief Counters of the reassembly table
+ */
+struct ReassemblyStats {
+    uint32_t completed;
+    uint32_t timedOut;      // Dropped after FRAG_TIMEOUT_MS
+    uint32_t evicted;       // Dropped to make room (table full)
+    uint32_t duplicates;    // Includes late fragments of a completed message
+    uint32_t invalid;       // Bad header or size
+};
+
+/**
+ * @brief Bounded reassembly table
+ *
+ * Up to FRAG_SLOTS messages are rebuilt at once, keyed by sender and
+ * message id, so two nodes using the same id do not mix. Fragments may
+ * arrive in any order. A full table evicts the message that has waited
+ * longest, and accept() drops stale ones. The last FRAG_RECENT completed
+ * messages are remembered, so a late duplicate fragment is dropped instead
+ * of opening a new slot.
+ */
+class Reassembler {
+    public:
+        Reassembler();
+
+        /**
+         * @brief Feed one received frame
+         *
+         * @param frame Received bytes
+         * @param length Number of received bytes
+         * @param now Time in ms
+         * @param node Sender (e.g. from the node header), 0 if unknown
+         * @return size_t Message length when this fragment completed it, 0 otherwise
+         */
+        size_t accept(const uint8_t* frame, size_t length, uint32_t now, uint16_t node = 0);
+
+        // Completed message, valid until the next accept()
+        const uint8_t* message() const { return _completed; }
+
+        // Drop messages that stopped receiving fragments
+        void expire(uint32_t now);
+
+        size_t inProgress() const;
+        ReassemblyStats stats() const { return _stats; }
+
+    private:
+        struct Slot {
+            bool used;
+            uint16_t node;
+            uint8_t messageId;
+            uint8_t count;
+            uint8_t received;
+            uint32_t bitmap;        // Bit i = fragment i received
+            size_t size;            // Known once the last fragment arrived
+            uint32_t lastUpdate;
+            uint8_t data[FRAG_MAX_MESSAGE];
+        };
+
+        struct Recent {
+            bool used;
+            uint16_t node;
+            uint8_t messageId;
+            uint8_t count;
+            uint32_t completedAt;
+        };
+
+        Slot _slots[FRAG_SLOTS];
+        Recent _recent[FRAG_RECENT];
+        uint8_t _recentNext = 0;
+        const uint8_t* _completed = nullptr;
+        ReassemblyStats _stats = {};
+
+        Slot* findSlot(uint16_t node, uint8_t messageId, uint8_t count, uint32_t now);
+        bool recentlyCompleted(uint16_t node, uint8_t messageId, uint8_t count, uint32_t now) const;
+};
+
+#endif // FRAGMENTER_H
@@ -0,0 +1,139 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+//Dependencies
+// Plain C++ only (no Arduino.h) so the ring also builds on a Linux host
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+// Producer and consumer indices sit on cache lines of their own, so the core
+// moving one does not keep invalidating the other's line (false sharing).
+// 64 covers the ESP32-S3 data cache (32 or 64 bytes) and most hosts.
+#ifndef FRAME_RING_CACHE_LINE
+#define FRAME_RING_CACHE_LINE 64
+#endif
+
+/**
+ * @brief Lock-free single producer / single consumer ring of byte frames
+ *
+ * Each slot holds one frame of up to SLOT_SIZE bytes. The producer (e.g. the
+ * UART event task) and the consumer (e.g. the receive task) may run on
+ * different cores without any lock. When the ring is full new frames are
+ * dropped and counted. Each frame carries a 32 bit tag (e.g. the TX queue's
+ * frame id) from commit() to peek().
+ *
+ * @tparam SLOTS Number of frames, must be a power of two
+ * @tparam SLOT_SIZE Maximum bytes per frame
+ */
+template <size_t SLOTS, size_t SLOT_SIZE>
+class FrameRing {
+    static_assert(SLOTS >= 2 && (SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two");
+
+    public:
+        FrameRing() : _head(0), _dropped(0), _tail(0) {}
+
+        ////////////////////////////////////////////////////////
+        ///// Producer side
+        ////////////////////////////////////////////////////////
+
+        // Slot to fill in place, nullptr (and counted as dropped) if full
+        uint8_t* reserve() {
+            uint32_t head = _head.load(std::memory_order_relaxed);
+            if (head - _tail.load(std::memory_order_acquire) >= SLOTS) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            return _slots[head & (SLOTS - 1)];
+        }
+
+        // Publish the slot returned by reserve()
+        void commit(size_t length, uint32_t tag = 0) {
+            uint32_t head = _head.load(std::memory_order_relaxed);
+            _lengths[head & (SLOTS - 1)] = length > SLOT_SIZE ? SLOT_SIZE : length;
+            _tags[head & (SLOTS - 1)] = tag;
+            _head.store(head + 1, std::memory_order_release);
+        }
+
+        // Copy a frame in, truncated to SLOT_SIZE
+        bool push(const uint8_t* data, size_t length, uint32_t tag = 0) {
+            uint8_t* slot = reserve();
+            if (slot == nullptr) {
+                return false;
+            }
+            memcpy(slot, data, length > SLOT_SIZE ? SLOT_SIZE : length);
+            commit(length, tag);
+            return true;
+        }
+
+        ////////////////////////////////////////////////////////
+        ///// Consumer side
+        ////////////////////////////////////////////////////////
+
+        // Oldest frame without removing it, nullptr if empty
+        const uint8_t* peek(size_t* length, uint32_t* tag = nullptr) const {
+            uint32_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail == _head.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            *length = _lengths[tail & (SLOTS - 1)];
+            if (tag != nullptr) {
+                *tag = _tags[tail & (SLOTS - 1)];
+            }
+            return _slots[tail & (SLOTS - 1)];
+        }
+
+        // Frame index places behind the oldest, nullptr past the newest
+        const uint8_t* peekAt(size_t index, size_t* length) const {
+            uint32_t tail = _tail.load(std::memory_order_relaxed);
+            if (index >= _head.load(std::memory_order_acquire) - tail) {
+                return nullptr;
+            }
+            uint32_t slot = (tail + index) & (SLOTS - 1);
+            *length = _lengths[slot];
+            return _slots[slot];
+        }
+
+        // Drop the frame returned by peek()
+        void release() {
+            _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Copy the oldest frame out and remove it, returns bytes copied (0 if empty)
+        size_t pop(uint8_t* buf, size_t cap) {
+            size_t length;
+            const uint8_t* frame = peek(&length);
+            if (frame == nullptr) {
+                return 0;
+            }
+            if (length > cap) {
+                length = cap;
+            }
+            memcpy(buf, frame, length);
+            release();
+            return length;
+        }
+
+        ////////////////////////////////////////////////////////
+        ///// Either side
+        ////////////////////////////////////////////////////////
+
+        size_t count() const {
+            return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+        }
+        bool empty() const { return count() == 0; }
+        size_t capacity() const { return SLOTS; }
+        uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    private:
+        alignas(FRAME_RING_CACHE_LINE) std::atomic<uint32_t> _head;    // Written by producer only
+        std::atomic<uint32_t> _dropped;                                 // Producer side too
+        alignas(FRAME_RING_CACHE_LINE) std::atomic<uint32_t> _tail;    // Written by consumer only
+
+        alignas(FRAME_RING_CACHE_LINE) uint16_t _lengths[SLOTS];
+        uint32_t _tags[SLOTS];
+        uint8_t _slots[SLOTS][SLOT_SIZE];
+};
+
+#endif // FRAMERING_H
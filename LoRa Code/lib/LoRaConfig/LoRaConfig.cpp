@@ -1,4 +1,5 @@
 #include "LoRaConfig.h"
+#include <Preferences.h>
 
 void testfunc() {
     Serial.println("LoRaConfig test function called");
@@ -7,13 +8,18 @@ void testfunc() {
 // LoRa class implementation
 
 
-LoRa::LoRa(uint8_t M0_pin, uint8_t M1_pin, uint8_t LoRa_RX, uint8_t LoRa_TX)
-    : _loraRxPin(LoRa_RX), _loraTxPin(LoRa_TX), _m0Pin(M0_pin), _m1Pin(M1_pin),
-    _loraModule(&Serial1, _auxPin, UART_BPS_RATE_9600)
+LoRa::LoRa(uint8_t M0_pin, uint8_t M1_pin, uint8_t LoRa_RX, uint8_t LoRa_TX, int8_t AUX_pin)
+    : LoRa(Serial1, M0_pin, M1_pin, LoRa_RX, LoRa_TX, AUX_pin) {}
+
+LoRa::LoRa(HardwareSerial& serial, uint8_t M0_pin, uint8_t M1_pin, uint8_t LoRa_RX, uint8_t LoRa_TX,
+           int8_t AUX_pin, const char* nvsNamespace)
+    : _loraRxPin(LoRa_RX), _loraTxPin(LoRa_TX), _auxPin(AUX_pin), _m0Pin(M0_pin), _m1Pin(M1_pin),
+    _serial(&serial), _loraModule(&serial, _auxPin, UART_BPS_RATE_9600), _nvsNamespace(nvsNamespace)
 {
 
     
-    if (_m0Pin == -1 && _m1Pin == -1) {
+    // Default -1 arrives here as 255 (uint8_t)
+    if (_m0Pin == (uint8_t)-1 && _m1Pin == (uint8_t)-1) {
         // Pins externally pulled LOW or HIGH
         _externalModePins = true;
     }
@@ -24,7 +30,8 @@ LoRa::LoRa(uint8_t M0_pin, uint8_t M1_pin, uint8_t LoRa_RX, uint8_t LoRa_TX)
 }
 
 LoRa::~LoRa() {
-    // Destructor implementation
+    endRadioTask();
+    endReceiveTask();
 }
 
 void LoRa::begin() {
@@ -33,45 +40,200 @@ void LoRa::begin() {
         pinMode(_m0Pin, OUTPUT);
         pinMode(_m1Pin, OUTPUT);
     }
-    Serial1.begin(9600, SERIAL_8N1, _loraRxPin, _loraTxPin);
+    _serial->begin(9600, SERIAL_8N1, _loraRxPin, _loraTxPin);
 
 
-    // Start LoRa module
+    // Start LoRa module (also sets AUX as input)
     _loraModule.begin();
 
-    delay(100); // Allow time for module to initialize
+    // Wait for the power-on self check (AUX HIGH)
+    startTransition(LORA_BOOT_FALLBACK_MS);
+    waitReady();
 
 }
 
 
-void LoRa::setConfigMode() {
-    if (!_externalModePins) {
-        digitalWrite(_m0Pin, HIGH);
-        digitalWrite(_m1Pin, HIGH);
-        _isConfigMode = true;
-        _isNormalMode = false;
-        delay(500); // Time for module to switch to config mode
+void LoRa::setWakeUpMode() {
+    lockRadio();
+    if (requestMode(MODE_1_WAKE_UP)) {
+        waitReady();
     }
-    
+    unlockRadio();
+}
+
+void LoRa::setPowerSavingMode() {
+    lockRadio();
+    // Frames still queued would stay in the module until the next transmitting mode
+    flushTx(LORA_AUX_TIMEOUT_MS);
+    if (requestMode(MODE_2_POWER_SAVING)) {
+        waitReady();
+    }
+    unlockRadio();
+}
 
+void LoRa::setConfigMode() {
+    lockRadio();
+    if (requestMode(MODE_3_PROGRAM)) {
+        waitReady();
+    }
+    unlockRadio();
 }
 
 void LoRa::setNormalMode() {
-    if (!_externalModePins) {
-        digitalWrite(_m0Pin, LOW);
-        digitalWrite(_m1Pin, LOW);
-        _isConfigMode = false;
-        _isNormalMode = true;
-        delay(500); // Time for module to switch to normal mode
+    lockRadio();
+    if (requestMode(MODE_0_NORMAL)) {
+        waitReady();
+    }
+    unlockRadio();
+}
+
+bool LoRa::sleep(uint32_t timeoutMs) {
+    if (_externalModePins) {
+        return false;
     }
-   
+    lockRadio();
+    flushTx(timeoutMs);
+    bool asleep = requestMode(MODE_3_SLEEP) && waitReady();
+    unlockRadio();
+    if (!asleep) {
+        return false;
+    }
+    // Deep sleep lets go of every pad unless it is latched
+    gpio_hold_en((gpio_num_t)_m0Pin);
+    gpio_hold_en((gpio_num_t)_m1Pin);
+    gpio_deep_sleep_hold_en();
+    return true;
+}
+
+bool LoRa::wake() {
+    lockRadio();
+    bool awake = requestMode(MODE_0_NORMAL) && waitReady();
+    unlockRadio();
+    return awake;
 }
 
+bool LoRa::requestMode(MODE_TYPE mode, ModeCallback callback, void* context) {
 
-void LoRa::printConfiguration() {
+    if (_externalModePins || _switching) {
+        return false;
+    }
+
+    // M0 is bit 0 and M1 is bit 1 of the mode number (latched by sleep() until here)
+    gpio_hold_dis((gpio_num_t)_m0Pin);
+    gpio_hold_dis((gpio_num_t)_m1Pin);
+    pinMode(_m0Pin, OUTPUT);
+    pinMode(_m1Pin, OUTPUT);
+    digitalWrite(_m0Pin, (mode & 0x01) ? HIGH : LOW);
+    digitalWrite(_m1Pin, (mode & 0x02) ? HIGH : LOW);
+
+    // Nothing may be sent until the module reports the new mode
+    _mode = mode;
+    _isConfigMode = false;
+    _isNormalMode = false;
+    _canTransmit = false;
+    _canReceive = false;
+    _modeCallback = callback;
+    _modeContext = context;
+    startTransition(LORA_MODE_FALLBACK_MS);
+
+    return true;
+}
+
+void LoRa::startTransition(uint32_t fallbackMs) {
+    _switching = true;
+    _switchStart = millis();
+    _switchFallbackMs = fallbackMs;
+}
+
+void LoRa::update() {
+
+    lockRadio();
+    pumpApplication();
+    pumpReliable();
+    pumpFec();
+    pumpFragments();
+    if (_hopping) {
+        pumpHopping();
+    }
+    pumpTx();
+    pumpTransition();
+    unlockRadio();
+}
+
+void LoRa::pumpTransition() {
+
+    if (!_switching) {
+        return;
+    }
+
+    unsigned long elapsed = millis() - _switchStart;
+
+    if (_auxPin != LORA_NO_PIN) {
+        // Module pulls AUX LOW while switching and releases it once ready
+        if (elapsed >= LORA_AUX_SETTLE_MS && digitalRead(_auxPin) == HIGH) {
+            finishTransition(true);
+        }
+        else if (elapsed >= LORA_AUX_TIMEOUT_MS) {
+            finishTransition(false);
+        }
+    }
+    else if (elapsed >= _switchFallbackMs) {
+        finishTransition(true);
+    }
+}
+
+void LoRa::finishTransition(bool success) {
+    _switching = false;
+
+    // Flags follow the pins even on timeout so the caller can retry
+    _isConfigMode = (_mode == MODE_3_PROGRAM);
+    _isNormalMode = (_mode == MODE_0_NORMAL);
+    _canTransmit = (_mode == MODE_0_NORMAL || _mode == MODE_1_WAKE_UP);
+    _canReceive = (_mode != MODE_3_PROGRAM);
+
+    if (_modeCallback != nullptr) {
+        ModeCallback callback = _modeCallback;
+        _modeCallback = nullptr;
+        callback(_mode, success, _modeContext);
+    }
+}
+
+bool LoRa::isReady() {
+    update();
+    return !_switching;
+}
+
+bool LoRa::waitReady(uint32_t timeoutMs) {
+    unsigned long start = millis();
+    while (!isReady() && millis() - start < timeoutMs) {
+        delay(1); // Lets other tasks run
+    }
+    return !_switching;
+}
+
+
+bool LoRa::readConfiguration() {
+    lockRadio();
     ResponseStructContainer c;
     c = _loraModule.getConfiguration();
-    Configuration configuration = *(Configuration*) c.data;
+
+    if (c.status.code == 1 && c.data != nullptr) {
+        _config = *(Configuration*) c.data;
+        _configValid = true;
+    }
+
+    c.close();
+    unlockRadio();
+    return _configValid;
+}
+
+void LoRa::printConfiguration() {
+    // Only the first print costs a UART round trip
+    if (!_configValid && !readConfiguration()) {
+        Serial.println("Failed to read configuration");
+        return;
+    }
+    Configuration configuration = _config;
 
     Serial.println("CURRENT CONFIGURATION:");
     Serial.println("----------------------------------------");
@@ -82,7 +244,7 @@ void LoRa::printConfiguration() {
     Serial.print(" | Channel: ");
     Serial.print(configuration.CHAN, DEC);
     Serial.print(" (");
-    Serial.print(862 + configuration.CHAN);
+    Serial.print(ChannelPlan::frequencyMHz(configuration.CHAN));
     Serial.println(" MHz)");
     
     Serial.print("Transmission Mode: ");
@@ -100,23 +262,16 @@ void LoRa::printConfiguration() {
     Serial.print("TX Power: ");
     Serial.println(configuration.OPTION.getTransmissionPowerDescription());
     Serial.println("----------------------------------------");
-
-    c.close();
 }
 
-bool LoRa::config(uint8_t high, uint8_t low, uint8_t channel) {
-
-    bool success = false;
+Configuration LoRa::buildConfiguration(uint8_t high, uint8_t low, uint8_t channel) const {
 
-    ResponseStructContainer c;
-    c = _loraModule.getConfiguration();
-    Configuration configuration = *(Configuration*) c.data;
+    // Every field is set below, so nothing has to be read from the module first
+    Configuration configuration = Configuration();
 
     configuration.ADDH = high;
     configuration.ADDL = low;
     configuration.CHAN = channel; // recommended 0x30 for 910MHz
-    // Set new channel for message transmission
-    _channel = channel;
     // Set to transparent transmission
     configuration.OPTION.fixedTransmission = FT_TRANSPARENT_TRANSMISSION;
     
@@ -132,72 +287,1255 @@ bool LoRa::config(uint8_t high, uint8_t low, uint8_t channel) {
     configuration.OPTION.fec = FEC_1_ON;
     configuration.OPTION.ioDriveMode = IO_D_MODE_PUSH_PULLS_PULL_UPS;
     configuration.OPTION.transmissionPower = POWER_21;
-    
-    // Save configuration
-    ResponseStatus rs = _loraModule.setConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE);
+
+    return configuration;
+}
+
+bool LoRa::configMatches(const Configuration& a, const Configuration& b) {
+    return a.ADDH == b.ADDH
+        && a.ADDL == b.ADDL
+        && a.CHAN == b.CHAN
+        && a.SPED.airDataRate == b.SPED.airDataRate
+        && a.SPED.uartBaudRate == b.SPED.uartBaudRate
+        && a.SPED.uartParity == b.SPED.uartParity
+        && a.OPTION.fixedTransmission == b.OPTION.fixedTransmission
+        && a.OPTION.ioDriveMode == b.OPTION.ioDriveMode
+        && a.OPTION.wirelessWakeupTime == b.OPTION.wirelessWakeupTime
+        && a.OPTION.fec == b.OPTION.fec
+        && a.OPTION.transmissionPower == b.OPTION.transmissionPower;
+}
+
+// NVS record: version, ADDH, ADDL, CHAN, SPED, OPTION in E32 register layout
+static void packConfiguration(const Configuration& c, uint8_t* out) {
+    out[0] = LORA_NVS_VERSION;
+    out[1] = c.ADDH;
+    out[2] = c.ADDL;
+    out[3] = c.CHAN;
+    out[4] = (c.SPED.uartParity << 6) | (c.SPED.uartBaudRate << 3) | c.SPED.airDataRate;
+    out[5] = (c.OPTION.fixedTransmission << 7) | (c.OPTION.ioDriveMode << 6)
+           | (c.OPTION.wirelessWakeupTime << 3) | (c.OPTION.fec << 2) | c.OPTION.transmissionPower;
+}
+
+bool LoRa::nvsMatches(const Configuration& configuration) const {
+    uint8_t stored[LORA_NVS_RECORD_SIZE];
+    uint8_t wanted[LORA_NVS_RECORD_SIZE];
+    packConfiguration(configuration, wanted);
+
+    Preferences prefs;
+    if (!prefs.begin(_nvsNamespace, true)) {
+        return false; // Namespace not created yet
+    }
+    size_t length = prefs.getBytes("cfg", stored, sizeof(stored));
+    // Module may still run a temporary config if only the ESP32 was reset
+    bool temporary = prefs.getBool("tmp", false);
+    prefs.end();
+
+    return !temporary && length == sizeof(stored) && memcmp(stored, wanted, sizeof(stored)) == 0;
+}
+
+void LoRa::nvsStore(const Configuration& configuration) const {
+    uint8_t record[LORA_NVS_RECORD_SIZE];
+    packConfiguration(configuration, record);
+
+    Preferences prefs;
+    prefs.begin(_nvsNamespace, false);
+    prefs.putBytes("cfg", record, sizeof(record));
+    prefs.remove("tmp");
+    prefs.end();
+}
+
+void LoRa::nvsMarkTemporary() const {
+    Preferences prefs;
+    prefs.begin(_nvsNamespace, false);
+    prefs.putBool("tmp", true);
+    prefs.end();
+}
+
+bool LoRa::isConfigCached(uint8_t high, uint8_t low, uint8_t channel) const {
+    return !_configTemporary && nvsMatches(buildConfiguration(high, low, channel));
+}
+
+void LoRa::clearConfigCache() {
+    Preferences prefs;
+    prefs.begin(_nvsNamespace, false);
+    prefs.clear();
+    prefs.end();
+    _configValid = false;
+}
+
+bool LoRa::config(uint8_t high, uint8_t low, uint8_t channel, bool persist) {
+    lockRadio();
+    bool configured = applyConfiguration(buildConfiguration(high, low, channel), persist);
+    unlockRadio();
+    return configured;
+}
+
+void LoRa::adoptConfiguration(const Configuration& configuration) {
+
+    // Channel and airtime used for transmission, only once the module runs this config
+    _channel = configuration.CHAN;
+    _airDataRate = configuration.SPED.airDataRate;
+    _airtime.configure(configuration.SPED.airDataRate, configuration.OPTION.fec == FEC_1_ON,
+                       configuration.OPTION.wirelessWakeupTime);
+}
+
+bool LoRa::applyConfiguration(const Configuration& configuration, bool persist) {
+
+    // Warm boot: module EEPROM already holds this config, no UART traffic at all
+    if (persist && !_configTemporary && !_configValid && nvsMatches(configuration)) {
+        _config = configuration;
+        _configValid = true;
+        adoptConfiguration(configuration);
+        _lastConfigResult = CONFIG_CACHED;
+        return true;
+    }
+
+    // Cold boot: one read, then compare field by field
+    if (!_configValid && !readConfiguration()) {
+        _lastConfigResult = CONFIG_FAILED;
+        return false;
+    }
+
+    // A temporary config that matches still has to be saved when persisting
+    if (configMatches(_config, configuration) && (!persist || !_configTemporary)) {
+        if (persist && !nvsMatches(configuration)) {
+            nvsStore(configuration);
+        }
+        adoptConfiguration(configuration);
+        _lastConfigResult = CONFIG_UNCHANGED;
+        return true;
+    }
+
+    // Save configuration (LOSE keeps the EEPROM untouched for temporary changes)
+    ResponseStatus rs = _loraModule.setConfiguration(configuration, persist ? WRITE_CFG_PWR_DWN_SAVE : WRITE_CFG_PWR_DWN_LOSE);
     
     if (rs.code == 1) {
         //Passed
-        success = true;
+        _config = configuration;
+        _configTemporary = !persist;
+        if (persist) {
+            nvsStore(configuration);
+        }
+        else {
+            nvsMarkTemporary();
+        }
 
-        // Power cycle to apply new settings
-        // HOW DO I POWER CYCLE??
+        // Mode round trip restarts the module with the new settings,
+        // each switch only lasts until AUX is HIGH again
         setNormalMode();
-        delay(1000);
         setConfigMode();
-        delay(1000);
 
-    } else {
-        //config failed
-        success = false;
-        // Serial.println(rs.getResponseDescription());
+        adoptConfiguration(configuration);
+        _lastConfigResult = CONFIG_WRITTEN;
+        return true;
     }
 
-    c.close();
+    //config failed, re-read next time (channel and airtime keep the last good config)
+    _configValid = false;
+    _lastConfigResult = CONFIG_FAILED;
+    // Serial.println(rs.getResponseDescription());
+    return false;
+}
+
+bool LoRa::setAirDataRate(uint8_t rate) {
+
+    // Needs a known configuration to change and mode pins to reach config mode
+    if (!_configValid || _externalModePins) {
+        return false;
+    }
+    if (_config.SPED.airDataRate == rate) {
+        return true;
+    }
+
+    Configuration configuration = _config;
+    configuration.SPED.airDataRate = rate;
+    return writeTemporary(configuration);
+}
+
+bool LoRa::setWakeUpTime(uint8_t wakeUpTime) {
 
+    if (!_configValid || _externalModePins) {
+        return false;
+    }
+    if (_config.OPTION.wirelessWakeupTime == wakeUpTime) {
+        return true;
+    }
+
+    Configuration configuration = _config;
+    configuration.OPTION.wirelessWakeupTime = wakeUpTime;
+    return writeTemporary(configuration);
+}
+
+bool LoRa::setChannel(uint8_t channel) {
+
+    if (!_configValid || _externalModePins || channel > CHANNEL_MAX) {
+        return false;
+    }
+    if (_config.CHAN == channel) {
+        return true;
+    }
+
+    Configuration configuration = _config;
+    configuration.CHAN = channel;
+    // Hopping retunes between frames and keeps the queue for the new channel
+    return writeTemporary(configuration, !_hopping);
+}
+
+bool LoRa::writeTemporary(const Configuration& configuration, bool flushQueue) {
+
+    lockRadio();
+
+    // Let queued frames go out with the old settings first
+    if (flushQueue) {
+        flushTx(LORA_AUX_TIMEOUT_MS);
+    }
+
+    // Config responses must not be swallowed by the receive callback
+    if (_asyncReceive) {
+        _serial->onReceive(NULL);
+    }
+
+    MODE_TYPE previous = _mode;
+    setConfigMode();
+
+    bool success = applyConfiguration(configuration, false);
+
+    if (requestMode(previous)) {
+        waitReady();
+    }
+
+    if (_asyncReceive) {
+        _serial->onReceive([this]() { onUartReceive(); }, true);
+    }
+    unlockRadio();
     return success;
 }
 
-void LoRa::sendBroadcastMessage(const String message) {
-    
-    if (_isNormalMode == true) {
-        ResponseStatus rs = _loraModule.sendBroadcastFixedMessage(_channel, message);
+bool LoRa::flushTx(uint32_t timeoutMs) {
+    // The radio task waits, the caller drains the queue itself
+    lockRadio();
+    unsigned long start = millis();
+    update();
+    while (!txIdle() && millis() - start < timeoutMs) {
+        delay(1);
+        update();
     }
+    bool idle = txIdle();
+    unlockRadio();
+    return idle;
 }
-void LoRa::sendMessage( uint8_t ADDH, uint8_t ADDL, const String message) {
-    
-    if (_isNormalMode == true) {
-        ResponseStatus rs = _loraModule.sendFixedMessage(ADDH, ADDL, _channel, message);
+
+bool LoRa::writeFrame(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, size_t size) {
+
+    if (_canTransmit != true || size > LORA_PAYLOAD_MAX) {
+        return false;
     }
+    size_t length = size + LORA_FIXED_HEADER_SIZE;
+    if (_csmaEnabled && !csmaWait()) {
+        _txRefusedCount++;
+        return false;
+    }
+    uint32_t onAirAt = millis() + (length * 10 * 1000) / LORA_UART_BAUD + 1;
+    if ((_tdmaEnabled && tdmaDelayMs(onAirAt, length) > 0)
+        || (_hopping && hopHolds(millis(), onAirAt + estimateAirtimeMs(length)))
+        || !admit(length)) {
+        _txRefusedCount++;
+        return false;
+    }
+
+    // Same layout the E32 library builds, but in a static buffer instead of malloc
+    _txBuffer[0] = ADDH;
+    _txBuffer[1] = ADDL;
+    _txBuffer[2] = _channel;
+    memcpy(_txBuffer + LORA_FIXED_HEADER_SIZE, data, size);
+
+    if (_serial->write(_txBuffer, length) != length) {
+        return false;
+    }
+    chargeAirtime(length);
+    if (_tdmaEnabled) {
+        portENTER_CRITICAL(&_tdmaLock);
+        _tdma.onSent(onAirAt);
+        portEXIT_CRITICAL(&_tdmaLock);
+    }
+    if (_csmaEnabled) {
+        _csma.onSent();
+    }
+    return true;
 }
 
-bool LoRa::checkForMessage() {
-    if (_isNormalMode == true) {
-        if (_loraModule.available() > 0) {
-            receiveMessage();
-            return true;
+bool LoRa::send(const uint8_t* data, size_t size) {
+    uint32_t freeBefore = ESP.getFreeHeap();
+    lockRadio();
+    bool sent = writeFrame(0xFF, 0xFF, data, size); // 0xFFFF = broadcast address
+    unlockRadio();
+    trackHeap(freeBefore);
+    return sent;
+}
+
+bool LoRa::sendTo(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, size_t size) {
+    uint32_t freeBefore = ESP.getFreeHeap();
+    lockRadio();
+    bool sent = writeFrame(ADDH, ADDL, data, size);
+    unlockRadio();
+    trackHeap(freeBefore);
+    return sent;
+}
+
+size_t LoRa::receive(uint8_t* buf, size_t cap) {
+
+    // Frames the radio task let through
+    if (_radioTask != nullptr) {
+        return _appRx.pop(buf, cap);
+    }
+
+    // Frames already split by the UART event task
+    if (_asyncReceive) {
+        return _rxRing.pop(buf, cap);
+    }
+
+    if (_canReceive != true) {
+        return 0;
+    }
+
+    uint32_t freeBefore = ESP.getFreeHeap();
+
+    // The module outputs a packet back to back, so a short idle gap ends the frame.
+    // Take the bytes already there and come back later instead of waiting for it.
+    unsigned long now = millis();
+    if (_serial->available() > 0) {
+        while (_serial->available() > 0) {
+            int c = _serial->read();
+            if (_rxPollReceived < sizeof(_rxPoll)) {
+                _rxPoll[_rxPollReceived] = (uint8_t)c;
+            }
+            _rxPollReceived++;
         }
+        _rxPollLastByte = now;
+        _rxActivity = _rxActivity + 1;
+    }
+    if (_rxPollReceived == 0 || now - _rxPollLastByte < LORA_RX_GAP_MS) {
+        return 0;
+    }
+
+    size_t received = _rxPollReceived;
+    _rxPollReceived = 0;
+    size_t length = stripFixedHeader(_rxPoll, received, received < sizeof(_rxPoll) ? received : sizeof(_rxPoll));
+    if (length > cap) {
+        length = cap;
+    }
+    memcpy(buf, _rxPoll, length);
+
+    trackHeap(freeBefore);
+    return length;
+}
+
+size_t LoRa::stripFixedHeader(uint8_t* frame, size_t received, size_t stored) {
+    // The module is in transparent mode, so every packet starts with the
+    // ADDH/ADDL/CHAN the sender wrote. Longer than a sub-packet means merged
+    // packets or noise, there is no boundary to cut them apart at.
+    if (received <= LORA_FIXED_HEADER_SIZE || received > LORA_SUBPACKET_SIZE
+        || stored <= LORA_FIXED_HEADER_SIZE) {
+        _rxMalformed = _rxMalformed + 1;
+        return 0;
+    }
+    memmove(frame, frame + LORA_FIXED_HEADER_SIZE, stored - LORA_FIXED_HEADER_SIZE);
+    return stored - LORA_FIXED_HEADER_SIZE;
+}
+
+void LoRa::trackHeap(uint32_t freeBefore) {
+    uint32_t freeAfter = ESP.getFreeHeap();
+    if (freeAfter < freeBefore) {
+        _heapStats.allocatingCalls++;
+    }
+    if (freeAfter < _heapStats.minFreeHeap) {
+        _heapStats.minFreeHeap = freeAfter;
+    }
+}
+
+bool LoRa::beginReceiveTask(FrameHandler handler, void* context) {
+
+    if (_asyncReceive) {
+        return true;
+    }
+
+    _rxHandler = handler;
+    _rxContext = context;
+
+    if (handler != nullptr) {
+        if (xTaskCreate(receiveTask, "lora_rx", LORA_RX_TASK_STACK, this, LORA_RX_TASK_PRIORITY, &_rxTask) != pdPASS) {
+            _rxTask = nullptr;
+            return false;
+        }
+    }
+
+    // Callback fires from the UART event task once the line is idle, i.e. once per frame
+    _serial->setRxTimeout(LORA_RX_TIMEOUT_SYMBOLS);
+    _serial->onReceive([this]() { onUartReceive(); }, true);
+    _asyncReceive = true;
+
+    return true;
+}
+
+void LoRa::endReceiveTask() {
+
+    if (!_asyncReceive) {
+        return;
+    }
+
+    _serial->onReceive(NULL);
+    if (_rxTask != nullptr) {
+        vTaskDelete(_rxTask);
+        _rxTask = nullptr;
+    }
+    _asyncReceive = false;
+}
+
+void LoRa::onUartReceive() {
+
+    // Called once the line went idle, so everything waiting is one packet.
+    // Bytes past the slot are read out too, the whole packet is then dropped.
+    if (_serial->available() > 0) {
+        uint8_t* slot = _rxRing.reserve();
+        size_t received = 0;
+        if (slot != nullptr) {
+            received = _serial->read(slot, LORA_RX_BUFFER_SIZE);
+        }
+        // Ring full (counted as dropped): flush so the UART does not back up
+        while (_serial->available() > 0) {
+            _serial->read();
+            received++;
+        }
+        if (slot != nullptr) {
+            size_t length = stripFixedHeader(slot, received, received < LORA_RX_BUFFER_SIZE ? received : LORA_RX_BUFFER_SIZE);
+            if (length > 0) {
+                _rxRing.commit(length);
+            }
+        }
+        _rxActivity = _rxActivity + 1;
+    }
+
+    if (_rxTask != nullptr) {
+        xTaskNotifyGive(_rxTask);
+    }
+    if (_radioTask != nullptr) {
+        xTaskNotifyGive(_radioTask);
+    }
+}
+
+void LoRa::receiveTask(void* param) {
+    LoRa* lora = (LoRa*)param;
+
+    for (;;) {
+        // Sleeps until the UART event task publishes a frame
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        lora->routeReceived();
+    }
+}
+
+void LoRa::routeReceived() {
+    // Drain everything, the frame is read in place
+    size_t length;
+    const uint8_t* frame;
+    while ((frame = _rxRing.peek(&length)) != nullptr) {
+        if (_fec && _fecDecoder.accept(frame, length)) {
+            // One frame may complete several payloads (rebuilt ones)
+            uint8_t payload[FEC_PAYLOAD];
+            size_t size;
+            while ((size = _fecDecoder.read(payload, sizeof(payload))) > 0) {
+                deliver(payload, size);
+            }
+        }
+        else if (!acceptReliable(frame, length)
+                 && !(_tdmaEnabled && acceptBeacon(frame, length))
+                 && !(_hopping && acceptHopSync(frame, length))) {
+            deliver(frame, length);
+        }
+        _rxRing.release();
+    }
+}
+
+void LoRa::deliver(const uint8_t* data, size_t length) {
+    if (_rxHandler != nullptr) {
+        _rxHandler(data, length, _rxContext);
+    }
+    else {
+        _appRx.push(data, length); // Full: counted in droppedFrames()
+    }
+}
+
+bool LoRa::beginRadioTask(BaseType_t core) {
+
+    if (_radioTask != nullptr) {
+        return true;
+    }
+    if (_radioLock == nullptr && (_radioLock = xSemaphoreCreateRecursiveMutex()) == nullptr) {
+        return false;
+    }
+
+    // Frames go through the rings from now on, not a receive task handler
+    endReceiveTask();
+    _radioStop = false;
+    if (xTaskCreatePinnedToCore(radioTask, "lora_radio", LORA_RADIO_TASK_STACK, this,
+                                LORA_RADIO_TASK_PRIORITY, &_radioTask, core) != pdPASS) {
+        _radioTask = nullptr;
+        return false;
+    }
+    return beginReceiveTask();
+}
+
+void LoRa::endRadioTask() {
+
+    if (_radioTask == nullptr) {
+        return;
+    }
+
+    // Let the current pass finish, the task clears the flag on its way out
+    _radioStop = true;
+    xTaskNotifyGive(_radioTask);
+    while (_radioStop) {
+        delay(1);
+    }
+    _radioTask = nullptr;
+    endReceiveTask();
+}
+
+void LoRa::radioTask(void* param) {
+    LoRa* lora = (LoRa*)param;
+
+    while (!lora->_radioStop) {
+        // Woken by a received frame or enqueue(), otherwise paces the queue
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LORA_RADIO_POLL_MS));
+        lora->lockRadio();
+        lora->routeReceived();
+        lora->update();
+        lora->unlockRadio();
+    }
+    lora->_radioStop = false;
+    vTaskDelete(NULL);
+}
+
+bool LoRa::onRadioTask() const {
+    return _radioTask != nullptr && xTaskGetCurrentTaskHandle() == _radioTask;
+}
+
+void LoRa::lockRadio() const {
+    // Recursive: blocking calls nest (setChannel() -> flushTx() -> update())
+    if (_radioLock != nullptr) {
+        xSemaphoreTakeRecursive(_radioLock, portMAX_DELAY);
+    }
+}
+
+void LoRa::unlockRadio() const {
+    if (_radioLock != nullptr) {
+        xSemaphoreGiveRecursive(_radioLock);
+    }
+}
+
+void LoRa::pumpApplication() {
+    // Frames the application queued from its core, in order, with the id enqueue() gave them
+    size_t length;
+    uint32_t id;
+    const uint8_t* frame;
+    while (txSlotsFree() > 0 && (frame = _appTx.peek(&length, &id)) != nullptr) {
+        _txQueue.push(frame, length, id);
+        _appTx.release();
+    }
+}
+
+size_t LoRa::txQueueFree() const {
+    if (_radioTask != nullptr && !onRadioTask()) {
+        return _appTx.capacity() - _appTx.count();
+    }
+    return txSlotsFree();
+}
+
+int32_t LoRa::enqueue(const uint8_t* data, size_t size) {
+    return enqueueTo(0xFF, 0xFF, data, size);
+}
+
+int32_t LoRa::enqueueTo(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, size_t size) {
+
+    if (_radioTask == nullptr || onRadioTask()) {
+        lockRadio();
+        int32_t id = queueFrame(ADDH, ADDL, data, size);
+        unlockRadio();
+        return id;
+    }
+
+    // Application side of the radio task: its own ring, never waits on the radio
+    if (size > LORA_PAYLOAD_MAX) {
+        return -1;
+    }
+    uint8_t* slot = _appTx.reserve();
+    if (slot == nullptr) {
+        return -1; // Backpressure, caller retries later
+    }
+
+    slot[0] = ADDH;
+    slot[1] = ADDL;
+    slot[2] = _channel;
+    memcpy(slot + LORA_FIXED_HEADER_SIZE, data, size);
+    int32_t id = (int32_t)_txEnqueued++;
+    _appTx.commit(size + LORA_FIXED_HEADER_SIZE, id);
+    xTaskNotifyGive(_radioTask);
+    return id;
+}
+
+int32_t LoRa::queueFrame(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, size_t size) {
+
+    if (size > LORA_PAYLOAD_MAX) {
+        return -1;
+    }
+
+    uint8_t* slot = _txQueue.reserve();
+    if (slot == nullptr) {
+        return -1; // Backpressure, caller retries later
+    }
+
+    slot[0] = ADDH;
+    slot[1] = ADDL;
+    slot[2] = _channel;
+    memcpy(slot + LORA_FIXED_HEADER_SIZE, data, size);
+    int32_t id = (int32_t)_txEnqueued++;
+    _txQueue.commit(size + LORA_FIXED_HEADER_SIZE, id);
+    return id;
+}
+
+bool LoRa::enqueueMessage(const uint8_t* data, size_t size) {
+    lockRadio();
+    bool accepted = _fragmenter.begin(data, size);
+    if (accepted) {
+        pumpFragments();
+    }
+    unlockRadio();
+    return accepted;
+}
+
+void LoRa::pumpFragments() {
+    // Fragments are written straight into the queue slots, broadcast like enqueue()
+    while (_fragmenter.pending() && txSlotsFree() > 0) {
+        uint8_t* slot = _txQueue.reserve();
+        slot[0] = 0xFF;
+        slot[1] = 0xFF;
+        slot[2] = _channel;
+        size_t length = _fragmenter.next(slot + LORA_FIXED_HEADER_SIZE, LORA_PAYLOAD_MAX);
+        _txQueue.commit(length + LORA_FIXED_HEADER_SIZE, _txEnqueued++);
     }
-    return false;
 }
 
+size_t LoRa::readMessage(uint8_t* buf, size_t cap) {
+    uint8_t frame[LORA_RX_BUFFER_SIZE];
+    size_t length;
 
-void LoRa::receiveMessage() {
+    // The radio task already took the protocol frames (and decoded FEC) on its core
+    bool routed = _radioTask != nullptr;
 
-    if (_isNormalMode == true) {
-        // receiveMessage returns a ResponseContainer (not ResponseStatus)
-        ResponseContainer rc = _loraModule.receiveMessage();
+    // A single frame can release several payloads, hand out the rest first
+    if (!routed && _fec && (length = _fecDecoder.read(buf, cap)) > 0) {
+        return length;
+    }
+    if (_reliable && (length = readReliable(buf, cap)) > 0) {
+        return length;
+    }
 
-        // check the status code (1 = success) and that data is non-null
-        if (rc.status.code == 1 && rc.data != nullptr) {
-            // rc.data is a C string for simple messages;
-            _lastMessage = rc.data;
+    while ((length = receive(frame, sizeof(frame))) > 0) {
+        size_t size;
+        const uint8_t* message;
+
+        if (!routed && _fec && _fecDecoder.accept(frame, length)) {
+            // Data frames come out right away, lost ones once enough parity arrived
+            size = _fecDecoder.read(buf, cap);
+            if (size == 0) {
+                continue;
+            }
+            return size;
+        }
+        else if (!routed && acceptReliable(frame, length)) {
+            // ARQ data or ACK, payloads come out of readReliable() in order
+            size = readReliable(buf, cap);
+            if (size == 0) {
+                continue;
+            }
+            return size;
+        }
+        else if (!routed && _tdmaEnabled && acceptBeacon(frame, length)) {
+            continue;
+        }
+        else if (!routed && _hopping && acceptHopSync(frame, length)) {
+            continue;
+        }
+        else if (!isFragment(frame, length)) {
+            // Not fragmented, the frame is the message
+            size = length;
+            message = frame;
+        }
+        else {
+            size = _reassembler.accept(frame, length, millis());
+            message = _reassembler.message();
+            if (size == 0) {
+                continue;
+            }
         }
 
+        if (size > cap) {
+            size = cap;
+        }
+        memcpy(buf, message, size);
+        return size;
     }
 
+    _reassembler.expire(millis());
+    return 0;
+}
+
+void LoRa::setReliable(bool enabled, uint8_t window) {
+    ArqSender sender(window);
+    ArqReceiver receiver;
+
+    portENTER_CRITICAL(&_arqLock);
+    _arqSender = sender;
+    _arqReceiver = receiver;
+    _arqBurstFrame = -1;
+    _reliable = enabled;
+    portEXIT_CRITICAL(&_arqLock);
+}
+
+bool LoRa::sendReliable(const uint8_t* data, size_t size) {
+    portENTER_CRITICAL(&_arqLock);
+    bool accepted = _reliable && _arqSender.offer(data, size);
+    portEXIT_CRITICAL(&_arqLock);
+
+    if (accepted) {
+        lockRadio();
+        pumpReliable();
+        unlockRadio();
+    }
+    return accepted;
+}
+
+size_t LoRa::readReliable(uint8_t* buf, size_t cap) {
+    portENTER_CRITICAL(&_arqLock);
+    size_t size = _arqReceiver.read(buf, cap);
+    portEXIT_CRITICAL(&_arqLock);
+    return size;
+}
+
+ArqStats LoRa::getArqStats() const {
+    portENTER_CRITICAL(&_arqLock);
+    ArqStats stats = _arqSender.stats();
+    ArqStats received = _arqReceiver.stats();
+    portEXIT_CRITICAL(&_arqLock);
+
+    stats.delivered = received.delivered;
+    stats.duplicates = received.duplicates;
+    stats.skipped = received.skipped;
+    return stats;
+}
+
+bool LoRa::acceptReliable(const uint8_t* frame, size_t length) {
+    if (!_reliable) {
+        return false;
+    }
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&_arqLock);
+    bool handled = _arqReceiver.accept(frame, length, now) || _arqSender.onAck(frame, length, now);
+    portEXIT_CRITICAL(&_arqLock);
+    return handled;
+}
+
+void LoRa::pumpReliable() {
+    if (!_reliable) {
+        return;
+    }
+    uint32_t now = millis();
+    uint8_t frame[LORA_PAYLOAD_MAX];
+    size_t length = 0;
+
+    // ACK goes first, the peer waits for it before its next burst.
+    // A lost last frame is assumed after two full packets of silence.
+    uint32_t ackTimeout = 2 * estimateAirtimeMs(MAX_SIZE_TX_PACKET);
+    portENTER_CRITICAL(&_arqLock);
+    _arqReceiver.setAckTimeout(ackTimeout);
+    if (txSlotsFree() > 0 && _arqReceiver.ackDue(now)) {
+        length = _arqReceiver.ack(frame, sizeof(frame));
+    }
+    portEXIT_CRITICAL(&_arqLock);
+    if (length > 0) {
+        queueFrame(0xFF, 0xFF, frame, length);
+    }
+
+    while (txSlotsFree() > 0) {
+        portENTER_CRITICAL(&_arqLock);
+        length = _arqSender.poll(now, frame, sizeof(frame));
+        portEXIT_CRITICAL(&_arqLock);
+        if (length == 0) {
+            break;
+        }
+        int32_t id = queueFrame(0xFF, 0xFF, frame, length);
+        if (frame[3] & ARQ_FLAG_LAST) {
+            _arqBurstFrame = id;
+        }
+    }
+}
+
+void LoRa::setFec(uint8_t k, uint8_t m, uint32_t flushMs) {
+    // New redundancy applies from the next group, frames already coded still go out
+    if (k > 0) {
+        _fecEncoder.setRedundancy(k, m);
+    }
+    _fecFlushMs = flushMs;
+    _fec = k > 0;
+}
+
+bool LoRa::sendFec(const uint8_t* data, size_t size) {
+    if (!_fec) {
+        return false;
+    }
+    lockRadio();
+    bool opened = _fecEncoder.groupFill() == 0;
+    bool added = _fecEncoder.add(data, size);
+    if (added && opened) {
+        _fecGroupStart = millis();
+    }
+    if (added) {
+        pumpFec();
+    }
+    unlockRadio();
+    return added;
+}
+
+void LoRa::flushFec() {
+    lockRadio();
+    _fecEncoder.flush();
+    pumpFec();
+    unlockRadio();
+}
+
+void LoRa::pumpFec() {
+    if (!_fec) {
+        return;
+    }
+    if (_fecEncoder.groupFill() > 0 && millis() - _fecGroupStart >= _fecFlushMs) {
+        _fecEncoder.flush();
+    }
+
+    // Coded frames are written straight into the queue slots, broadcast like enqueue()
+    while (_fecEncoder.pending() && txSlotsFree() > 0) {
+        uint8_t* slot = _txQueue.reserve();
+        slot[0] = 0xFF;
+        slot[1] = 0xFF;
+        slot[2] = _channel;
+        size_t length = _fecEncoder.next(slot + LORA_FIXED_HEADER_SIZE, LORA_PAYLOAD_MAX);
+        _txQueue.commit(length + LORA_FIXED_HEADER_SIZE, _txEnqueued++);
+    }
+}
+
+void LoRa::onTxComplete(TxCallback callback, void* context) {
+    _txCallback = callback;
+    _txContext = context;
+}
+
+uint32_t LoRa::estimateAirtimeMs(size_t bytes) const {
+    return (packetAirtimeUs(bytes) + 999) / 1000;
+}
+
+uint32_t LoRa::packetAirtimeUs(size_t length) const {
+    // Mode 1 sends every packet behind the long wake-up preamble
+    return _airtime.packetUs(length, _mode == MODE_1_WAKE_UP);
+}
+
+bool LoRa::admit(size_t length) {
+    return _dutyCycle.delayMs(packetAirtimeUs(length), millis()) == 0;
+}
+
+void LoRa::chargeAirtime(size_t length) {
+    // Only once the module has the whole frame, a failed write never goes on air
+    _dutyCycle.charge(packetAirtimeUs(length), millis());
+}
+
+void LoRa::setDutyCycle(uint16_t permille, uint32_t windowMs) {
+    lockRadio();
+    _dutyCycle.setLimit(permille, windowMs, millis());
+    unlockRadio();
+}
+
+DutyCycleState LoRa::saveDutyCycle() {
+    lockRadio();
+    DutyCycleState state = _dutyCycle.save(millis());
+    unlockRadio();
+    return state;
+}
+
+void LoRa::restoreDutyCycle(const DutyCycleState& state, uint32_t elapsedMs) {
+    lockRadio();
+    _dutyCycle.restore(state, millis(), elapsedMs);
+    unlockRadio();
+}
+
+uint32_t LoRa::airtimeMs(size_t size) const {
+    return estimateAirtimeMs(size + LORA_FIXED_HEADER_SIZE);
+}
+
+uint32_t LoRa::txAdmitDelayMs(size_t size) {
+    // Everything already queued is charged first
+    lockRadio();
+    pumpApplication();
+    uint32_t now = millis();
+    uint64_t pendingUs = 0;
+    for (size_t i = 0; i < _txQueue.count(); i++) {
+        size_t length;
+        if (_txQueue.peekAt(i, &length) != nullptr) {
+            pendingUs += packetAirtimeUs(length);
+        }
+    }
+    pendingUs += packetAirtimeUs(size + LORA_FIXED_HEADER_SIZE);
+    uint32_t wait = pendingUs > UINT32_MAX ? UINT32_MAX : _dutyCycle.delayMs((uint32_t)pendingUs, now);
+    unlockRadio();
+    return wait;
+}
+
+void LoRa::setTdma(uint16_t node) {
+    portENTER_CRITICAL(&_tdmaLock);
+    _tdma = TdmaSchedule(node);
+    _tdmaEnabled = true;
+    portEXIT_CRITICAL(&_tdmaLock);
+}
+
+void LoRa::disableTdma() {
+    portENTER_CRITICAL(&_tdmaLock);
+    _tdmaEnabled = false;
+    portEXIT_CRITICAL(&_tdmaLock);
+}
+
+bool LoRa::acceptBeacon(const uint8_t* frame, size_t length) {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&_tdmaLock);
+    bool beacon = _tdma.onBeacon(frame, length, now);
+    portEXIT_CRITICAL(&_tdmaLock);
+    return beacon;
+}
+
+TdmaSchedule LoRa::getTdmaSchedule() const {
+    portENTER_CRITICAL(&_tdmaLock);
+    TdmaSchedule schedule = _tdma;
+    portEXIT_CRITICAL(&_tdmaLock);
+    return schedule;
+}
+
+uint32_t LoRa::tdmaDelayMs(uint32_t onAirAt, size_t length) const {
+    uint32_t airtime = estimateAirtimeMs(length);
+    portENTER_CRITICAL(&_tdmaLock);
+    uint32_t delay = _tdma.delayMs(onAirAt, airtime);
+    portEXIT_CRITICAL(&_tdmaLock);
+    return delay;
+}
+
+void LoRa::setCsma(bool enabled, uint32_t slotMs) {
+    _csma = CsmaBackoff(1, esp_random());
+    _csmaSlotMs = slotMs;
+    _rxActivitySeen = _rxActivity;
+    _csmaEnabled = enabled;
+}
+
+uint32_t LoRa::csmaDelayMs(unsigned long now) {
+    // Anything received since the last look, or the module about to output a packet
+    uint32_t activity = _rxActivity;
+    bool auxReceiving = _auxPin != LORA_NO_PIN && _txInFlightCount == 0
+        && (long)(now - _txUartDoneAt) >= LORA_AUX_SETTLE_MS && digitalRead(_auxPin) == LOW;
+    if (activity != _rxActivitySeen || auxReceiving) {
+        if (activity != _rxActivitySeen && _txInFlightCount > 0) {
+            // Half duplex: traffic showed up while ours was going out
+            _csma.onCollision();
+        }
+        _rxActivitySeen = activity;
+        _csma.onBusy(now, LORA_CSMA_IFS_MS);
+    }
+
+    // A packet can only be seen once it is over, the slot covers one packet
+    _csma.configure(_csmaSlotMs != 0 ? _csmaSlotMs : estimateAirtimeMs(MAX_SIZE_TX_PACKET));
+    return _csma.delayMs(now);
+}
+
+bool LoRa::csmaWait() {
+    unsigned long start = millis();
+    uint32_t wait;
+    while ((wait = csmaDelayMs(millis())) > 0) {
+        if (millis() - start + wait > LORA_CSMA_MAX_WAIT_MS) {
+            return false;
+        }
+        delay(wait < LORA_RX_GAP_MS ? wait : LORA_RX_GAP_MS);
+    }
+    return true;
+}
+
+void LoRa::setHopping(const ChannelPlan& plan, uint32_t seed, uint16_t dwellMs, bool master) {
+    portENTER_CRITICAL(&_hopLock);
+    _hops = HopSchedule(plan, seed, dwellMs);
+    if (master) {
+        _hops.start(millis());
+    }
+    _hopMaster = master;
+    _hopAnnounced = UINT32_MAX;
+    _hopping = true;
+    portEXIT_CRITICAL(&_hopLock);
+}
+
+void LoRa::disableHopping() {
+    portENTER_CRITICAL(&_hopLock);
+    _hopping = false;
+    portEXIT_CRITICAL(&_hopLock);
+}
+
+bool LoRa::acceptHopSync(const uint8_t* frame, size_t length) {
+    // Written to the gateway's module, sent, then read out of ours (fixed header included)
+    size_t packet = length + LORA_FIXED_HEADER_SIZE;
+    uint32_t uartMs = (packet * 10 * 1000) / LORA_UART_BAUD + 1;
+    uint32_t latency = 2 * uartMs + estimateAirtimeMs(packet);
+    uint32_t now = millis();
+    portENTER_CRITICAL(&_hopLock);
+    bool sync = _hops.onSync(frame, length, now, latency);
+    portEXIT_CRITICAL(&_hopLock);
+    return sync;
+}
+
+HopSchedule LoRa::getHopSchedule() const {
+    portENTER_CRITICAL(&_hopLock);
+    HopSchedule schedule = _hops;
+    portEXIT_CRITICAL(&_hopLock);
+    return schedule;
+}
+
+bool LoRa::hopHolds(unsigned long now, unsigned long doneAt) const {
+    portENTER_CRITICAL(&_hopLock);
+    bool synced = _hops.synced(now) && !_hops.awaitingSync(now);
+    uint8_t channel = _hops.channel(now);
+    uint32_t left = _hops.msToChange(now);
+    portEXIT_CRITICAL(&_hopLock);
+
+    // Nobody to talk to while looking for the gateway or waiting for its sync
+    if (!synced || channel != _channel) {
+        return true;
+    }
+    return left != UINT32_MAX && (long)(doneAt - now) + LORA_HOP_GUARD_MS > (long)left;
+}
+
+void LoRa::pumpHopping() {
+
+    // Retune between frames only
+    if (_switching || _txInFlightCount > 0) {
+        return;
+    }
+
+    unsigned long now = millis();
+    portENTER_CRITICAL(&_hopLock);
+    uint8_t channel = _hops.channel(now);
+    uint32_t hop = _hops.hop(now);
+    portEXIT_CRITICAL(&_hopLock);
+
+    if (channel != _channel && !setChannel(channel)) {
+        return;
+    }
+    if (!_hopMaster || hop == _hopAnnounced) {
+        return;
+    }
+
+    // First frame on the new channel tells the buoys where the schedule stands
+    uint8_t sync[HOP_SYNC_SIZE];
+    portENTER_CRITICAL(&_hopLock);
+    size_t size = _hops.writeSync(sync, millis());
+    portEXIT_CRITICAL(&_hopLock);
+    if (writeFrame(0xFF, 0xFF, sync, size)) {
+        // Keep queued frames out of the same air packet
+        size_t length = size + LORA_FIXED_HEADER_SIZE;
+        now = millis();
+        _txUartDoneAt = now + (length * 10 * 1000) / LORA_UART_BAUD + 1;
+        _txLastDoneAt = _txUartDoneAt + estimateAirtimeMs(length);
+        _hopAnnounced = hop;
+    }
+}
+
+AirtimeStats LoRa::getAirtimeStats() {
+    AirtimeStats stats;
+    lockRadio();
+    uint32_t now = millis();
+    stats.usedMs = (uint32_t)(_dutyCycle.usedUs() / 1000);
+    stats.availableMs = _dutyCycle.limited() ? _dutyCycle.availableUs(now) / 1000 : UINT32_MAX;
+    stats.budgetMs = _dutyCycle.capacityUs() / 1000;
+    stats.deferred = _txDeferredCount;
+    stats.refused = _txRefusedCount;
+    unlockRadio();
+    return stats;
+}
+
+void LoRa::completeTx(TxStatus status) {
+    TxInFlight& frame = _txInFlight[_txInFlightHead];
+    _txInFlightHead = (_txInFlightHead + 1) % LORA_TX_INFLIGHT_MAX;
+    _txInFlightCount--;
+    _txBytesInFlight -= frame.size;
+
+    if (_reliable && (int32_t)frame.id == _arqBurstFrame) {
+        portENTER_CRITICAL(&_arqLock);
+        _arqSender.onBurstSent(millis());
+        portEXIT_CRITICAL(&_arqLock);
+        _arqBurstFrame = -1;
+    }
+
+    if (_txCallback != nullptr) {
+        _txCallback(frame.id, status, _txContext);
+    }
+}
+
+void LoRa::pumpTx() {
+
+    unsigned long now = millis();
+
+    // Complete frames the module is done with. AUX only says "buffer empty",
+    // so with AUX every in-flight frame completes at once.
+    bool auxWired = (_auxPin != LORA_NO_PIN);
+    bool auxIdle = auxWired
+        && (long)(now - _txUartDoneAt) >= LORA_AUX_SETTLE_MS
+        && digitalRead(_auxPin) == HIGH;
+
+    while (_txInFlightCount > 0) {
+        long late = (long)(now - _txInFlight[_txInFlightHead].doneAt);
+        if (auxIdle || (!auxWired && late >= 0)) {
+            completeTx(TX_SENT);
+        }
+        else if (auxWired && late >= LORA_TX_TIMEOUT_MARGIN_MS) {
+            completeTx(TX_TIMEOUT);
+        }
+        else {
+            break;
+        }
+    }
+
+    // Feed the module while its buffer has room, one frame per UART gap
+    // so each frame stays its own air packet
+    while (_canTransmit && !_switching) {
+        size_t length;
+        uint32_t id;
+        const uint8_t* frame = _txQueue.peek(&length, &id);
+        if (frame == nullptr
+            || _txInFlightCount >= LORA_TX_INFLIGHT_MAX
+            || _txBytesInFlight + length > LORA_MODULE_BUFFER_SIZE
+            || (long)(now - _txUartDoneAt) < LORA_TX_GAP_MS) {
+            break;
+        }
+
+        // UART shifts bytes out at 10 bits each, airtime starts once the module has them
+        unsigned long uartMs = (length * 10 * 1000) / LORA_UART_BAUD + 1;
+        unsigned long start = ((long)(_txLastDoneAt - now) > 0) ? _txLastDoneAt : now;
+
+        // Outside the TDMA slot, or the frame would run past it: wait for the next one
+        if (_tdmaEnabled && tdmaDelayMs(start + uartMs, length) > 0) {
+            break;
+        }
+
+        // Retune due, or the frame would still be on air when it is
+        if (_hopping && hopHolds(now, start + uartMs + estimateAirtimeMs(length))) {
+            break;
+        }
+
+        // Channel busy or backing off: the frame waits at the head of the queue
+        if (_csmaEnabled && csmaDelayMs(now) > 0) {
+            break;
+        }
+
+        // Out of airtime budget: the frame waits at the head of the queue
+        if (!admit(length)) {
+            if (!_txDeferred) {
+                _txDeferred = true;
+                _txDeferredCount++;
+            }
+            break;
+        }
+        _txDeferred = false;
+
+        bool written = (_serial->write(frame, length) == length);
+        _txQueue.release();
+
+        if (!written) {
+            if (_txCallback != nullptr) {
+                _txCallback(id, TX_FAILED, _txContext);
+            }
+            continue;
+        }
+
+        chargeAirtime(length);
+        if (_tdmaEnabled) {
+            portENTER_CRITICAL(&_tdmaLock);
+            _tdma.onSent(start + uartMs);
+            portEXIT_CRITICAL(&_tdmaLock);
+        }
+        if (_csmaEnabled) {
+            _csma.onSent();
+        }
+        _txUartDoneAt = now + uartMs;
+        _txLastDoneAt = start + uartMs + estimateAirtimeMs(length);
+
+        uint8_t tail = (_txInFlightHead + _txInFlightCount) % LORA_TX_INFLIGHT_MAX;
+        _txInFlight[tail].id = id;
+        _txInFlight[tail].size = length;
+        _txInFlight[tail].doneAt = _txLastDoneAt;
+        _txInFlightCount++;
+        _txBytesInFlight += length;
+    }
+}
+
+void LoRa::sendBroadcastMessage(const String message) {
+    send((const uint8_t*)message.c_str(), message.length());
+}
+
+void LoRa::sendMessage( uint8_t ADDH, uint8_t ADDL, const String message) {
+    sendTo(ADDH, ADDL, (const uint8_t*)message.c_str(), message.length());
+}
+
+void LoRa::sendBroadcastMessage(const uint8_t* data, uint8_t size) {
+    send(data, size);
+}
+
+void LoRa::sendMessage(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, uint8_t size) {
+    sendTo(ADDH, ADDL, data, size);
+}
+
+bool LoRa::checkForMessage() {
+    return receiveMessage();
+}
+
+
+bool LoRa::receiveMessage() {
+    uint8_t frame[LORA_RX_BUFFER_SIZE];
+    size_t length;
+    bool kept = false;
+
+    while ((length = receive(frame, sizeof(frame))) > 0) {
+        // Frames the rings could not take are gone before this one
+        uint32_t dropped = droppedFrames();
+        _rxHistory.noteDropped(dropped - _rxRingDropsSeen);
+        _rxRingDropsSeen = dropped;
+
+        // Refused with RX_DROP_NEWEST on a full history: nothing new to read
+        if (_rxHistory.push(frame, length, millis())) {
+            kept = true;
+        }
+    }
+    return kept;
+}
+
+const uint8_t* LoRa::getLastMessage() const {
+    const LoRaRxHistory::Entry* entry = _rxHistory.newest();
+    return entry != nullptr ? entry->data : nullptr;
+}
+
+size_t LoRa::getLastMessageLength() const {
+    const LoRaRxHistory::Entry* entry = _rxHistory.newest();
+    return entry != nullptr ? entry->info.length : 0;
 }
 
 void LoRa::printLastMessage() {
-    Serial.println("Last Message Received: " + _lastMessage);
+    Serial.print("Last Message Received: ");
+    Serial.write(getLastMessage(), getLastMessageLength());
+    Serial.println();
 }
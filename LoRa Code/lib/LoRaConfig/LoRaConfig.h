@@ -4,6 +4,132 @@
 //Dependencies
 #include <Arduino.h>
 #include "LoRa_E32.h"
+#include "LoRaFrame.h"
+#include "FrameRing.h"
+#include "RxHistory.h"
+#include "Fragmenter.h"
+#include "Arq.h"
+#include "PacketFec.h"
+#include "Airtime.h"
+#include "Tdma.h"
+#include "Csma.h"
+#include "ChannelPlan.h"
+
+
+// Buffer sizes (frame payload: LORA_PAYLOAD_MAX from LoRaFrame.h)
+#define LORA_RX_BUFFER_SIZE 64
+#define LORA_RX_GAP_MS 5            // UART idle time that ends a received frame
+
+// Event driven receive
+#define LORA_RX_RING_SLOTS 16
+#define LORA_RX_TIMEOUT_SYMBOLS 3   // UART idle time (in bytes) that ends a frame
+#define LORA_RX_TASK_STACK 4096
+#define LORA_RX_TASK_PRIORITY 5
+
+// Radio task: the module's I/O on one core, the application on the other
+#define LORA_RADIO_CORE 0           // Arduino loop() runs on core 1
+#define LORA_RADIO_TASK_STACK 4096
+#define LORA_RADIO_TASK_PRIORITY 5
+#define LORA_RADIO_POLL_MS 2        // Longest sleep between two passes (TX pacing, AUX, ARQ timers)
+#define LORA_APP_RX_SLOTS 16        // Frames handed to the application
+
+// Frames kept by checkForMessage()/receiveMessage() until the application reads them
+#define LORA_RX_HISTORY_SLOTS 16
+typedef RxHistory<LORA_RX_HISTORY_SLOTS, LORA_RX_BUFFER_SIZE> LoRaRxHistory;
+
+// Called from the receive task for every frame, data is only valid during the call
+typedef void (*FrameHandler)(const uint8_t* data, size_t length, void* context);
+
+// Mode transitions
+#define LORA_NO_PIN -1
+#define LORA_AUX_SETTLE_MS 2        // AUX may still read HIGH right after M0/M1 change
+#define LORA_AUX_TIMEOUT_MS 1000    // AUX never came back HIGH
+#define LORA_MODE_FALLBACK_MS 500   // Fixed wait when AUX is not wired
+#define LORA_BOOT_FALLBACK_MS 100   // Power-on self check when AUX is not wired
+
+// Called once a mode transition completes (success = false on AUX timeout)
+typedef void (*ModeCallback)(MODE_TYPE mode, bool success, void* context);
+
+// Transmit queue
+#define LORA_TX_QUEUE_SLOTS 8
+#define LORA_TX_INFLIGHT_MAX 8
+#define LORA_MODULE_BUFFER_SIZE 512     // E32 internal TX buffer
+#define LORA_UART_BAUD 9600
+#define LORA_TX_TIMEOUT_MARGIN_MS 500   // AUX still LOW this long after the estimate
+#define LORA_TX_GAP_MS 4                // UART idle between frames, the module merges anything closer (3 bytes at 9600)
+
+// Outcome of a queued frame
+enum TxStatus : uint8_t {
+    TX_SENT,        // AUX HIGH again (module buffer empty) or estimated airtime elapsed
+    TX_TIMEOUT,     // AUX stayed LOW well past the estimated airtime
+    TX_FAILED       // UART did not accept the frame
+};
+
+// Called from update() once a queued frame is done (on the radio task when there is one)
+typedef void (*TxCallback)(uint32_t frameId, TxStatus status, void* context);
+
+// Frame libraries size their frames from LoRaFrame.h
+static_assert(LORA_SUBPACKET_SIZE == MAX_SIZE_TX_PACKET, "LoRa frame size must match the E32 sub-packet");
+
+// Reliable mode
+#define LORA_ARQ_WINDOW 8
+
+// Carrier sense
+#define LORA_CSMA_IFS_MS 10         // Quiet time after received traffic before the channel counts as free
+#define LORA_CSMA_MAX_WAIT_MS 5000  // Blocking sends give up after waiting this long
+
+// Channel hopping
+#define LORA_HOP_GUARD_MS 100       // Frames must be off air this long before the channel changes (both ends' timing error)
+
+// Airtime budget (868 MHz g1 sub-band: 1 % over an hour)
+#define LORA_DUTY_CYCLE_PERMILLE 10
+
+// Erasure coding
+#define LORA_FEC_K 4                // Data frames per group
+#define LORA_FEC_M 2                // Parity frames per group
+#define LORA_FEC_FLUSH_MS 5000      // A partial group gets its parity after this long
+
+// Configuration cache (NVS)
+#define LORA_NVS_NAMESPACE "lora"
+#define LORA_NVS_VERSION 1
+#define LORA_NVS_RECORD_SIZE 6
+
+// What the last config() call had to do
+enum ConfigResult : uint8_t {
+    CONFIG_CACHED,      // NVS says the module already holds it, no UART traffic
+    CONFIG_UNCHANGED,   // Read from the module, already matching
+    CONFIG_WRITTEN,     // Differed and was written
+    CONFIG_FAILED
+};
+
+
+/**
+ * @brief Non-owning view of a caller buffer (std::span is not available on gnu++11)
+ */
+struct ByteSpan {
+    uint8_t* data;
+    size_t size;
+
+    ByteSpan(uint8_t* d, size_t n) : data(d), size(n) {}
+    template <size_t N> ByteSpan(uint8_t (&array)[N]) : data(array), size(N) {}
+};
+
+struct ConstByteSpan {
+    const uint8_t* data;
+    size_t size;
+
+    ConstByteSpan(const uint8_t* d, size_t n) : data(d), size(n) {}
+    ConstByteSpan(const ByteSpan& s) : data(s.data), size(s.size) {}
+    template <size_t N> ConstByteSpan(const uint8_t (&array)[N]) : data(array), size(N) {}
+};
+
+/**
+ * @brief Free heap tracking for the send/receive path
+ */
+struct HeapStats {
+    uint32_t minFreeHeap;       // Lowest free heap seen by send/receive
+    uint32_t allocatingCalls;   // Calls that returned with less free heap than they started with
+};
 
 
 // LoRa handler class
@@ -22,41 +148,495 @@ class LoRa {
          * @param rxPin RX pin number
          * @param m0Pin M0 control pin
          * @param m1Pin M1 control pin
+         * @param auxPin AUX status pin, LORA_NO_PIN for timed waits
          */    
-        LoRa(uint8_t M0_pin=-1, uint8_t M1_pin=-1, uint8_t LoRa_RX=18, uint8_t LoRa_TX=17);
+        LoRa(uint8_t M0_pin=-1, uint8_t M1_pin=-1, uint8_t LoRa_RX=18, uint8_t LoRa_TX=17, int8_t AUX_pin=LORA_NO_PIN);
+
+        /**
+         * @brief Construct a LoRa object on any UART, one per module
+         *
+         * Every instance has its own queues, receive task and channel, so
+         * one board can drive several modules (e.g. a gateway listening on
+         * two channels with Serial1 and Serial2).
+         *
+         * @param serial UART wired to the module
+         * @param nvsNamespace Where the config cache lives, different for each module
+         */
+        LoRa(HardwareSerial& serial, uint8_t M0_pin, uint8_t M1_pin, uint8_t LoRa_RX, uint8_t LoRa_TX,
+             int8_t AUX_pin = LORA_NO_PIN, const char* nvsNamespace = LORA_NVS_NAMESPACE);
         ~LoRa();
 
-        // Initializes Lora module and Starts UART Serial1
+        // Initializes Lora module and starts its UART
         void begin();
 
         // Set configuration mode (M0 and M1 both HIGH or both LOW)
+        // Blocking: request the mode then wait until the module is ready
         void setConfigMode(); // M0 = HIGH, M1 = HIGH
         void setNormalMode(); // M0 = LOW, M1 = LOW
 
-        // Print out current configuration to Serial
+        // Mode 1 (M0 = HIGH, M1 = LOW): every packet goes out behind a preamble as
+        // long as the wake-up time, so receivers in power saving mode hear it
+        void setWakeUpMode();
+
+        // Mode 2 (M0 = LOW, M1 = HIGH): the module sleeps and listens once per
+        // wake-up time, packets sent in mode 1 still come out of the UART.
+        // Nothing can be sent, queued frames are flushed first.
+        void setPowerSavingMode();
+
+        /**
+         * @brief Start a mode change without blocking
+         *
+         * Drives M0/M1 and returns right away. The transition completes when AUX
+         * goes back HIGH, or after LORA_MODE_FALLBACK_MS if AUX is not wired.
+         * Call update() from loop() to advance it.
+         *
+         * @param mode Target mode
+         * @param callback Called once the transition completes (may be nullptr)
+         * @param context Passed back to the callback
+         * @return false Mode pins not driven by this class or a transition is already running
+         */
+        bool requestMode(MODE_TYPE mode, ModeCallback callback = nullptr, void* context = nullptr);
+
+        // Advance a running mode transition and feed the module, call often (the radio task does, see beginRadioTask())
+        void update();
+
+        // True when no transition is running (advances it first)
+        bool isReady();
+
+        // Yield until ready or timeout, returns isReady()
+        bool waitReady(uint32_t timeoutMs = LORA_AUX_TIMEOUT_MS);
+
+        MODE_TYPE getMode() const { return _mode; }
+
+        /**
+         * @brief Put the module to sleep (mode 3) before the ESP32 sleeps
+         *
+         * Lets the TX queue drain first. M0/M1 are latched HIGH so the module
+         * stays asleep through deep sleep, the next mode change releases them.
+         *
+         * @param timeoutMs Longest wait for queued frames to go out
+         * @return true Module asleep
+         */
+        bool sleep(uint32_t timeoutMs = LORA_AUX_TIMEOUT_MS);
+
+        // Back to normal mode after a light sleep (after deep sleep begin() and setNormalMode() do it)
+        bool wake();
+
+        // Print out current configuration to Serial (cached after the first read)
         void printConfiguration();
 
-        // Configure LoRa module parameters
-        bool config(uint8_t high = 0x01, uint8_t low = 0x02, uint8_t channel = 0x30);
+        // Read configuration from the module into the cache (config mode only)
+        bool readConfiguration();
+
+        /**
+         * @brief Configure LoRa module parameters, writing only what changed
+         *
+         * The wanted config is compared field by field with the cached one and
+         * only written on a difference. A config known to be in the module
+         * EEPROM (stored in NVS) skips the UART entirely on warm boots.
+         *
+         * @param high Address high byte
+         * @param low Address low byte
+         * @param channel Channel (862 MHz + channel)
+         * @param persist true saves to module EEPROM, false is lost on power down
+         * @return true Module holds the wanted configuration
+         */
+        bool config(uint8_t high = 0x01, uint8_t low = 0x02, uint8_t channel = 0x30, bool persist = true);
+
+        ConfigResult getLastConfigResult() const { return _lastConfigResult; }
+
+        // True if config() with these values would not touch the UART (fast boot check)
+        bool isConfigCached(uint8_t high = 0x01, uint8_t low = 0x02, uint8_t channel = 0x30) const;
+
+        // Forget the cached configuration (e.g. module swapped)
+        void clearConfigCache();
+
+        /**
+         * @brief Change the air data rate with a temporary (PWR_DWN_LOSE) write
+         *
+         * Flushes the TX queue, goes through config mode and returns to the
+         * previous mode. The EEPROM keeps the rate from config().
+         *
+         * @param rate AIR_DATA_RATE_xxx code
+         * @return true Module now runs at this rate
+         */
+        bool setAirDataRate(uint8_t rate);
+        uint8_t getAirDataRate() const { return _airDataRate; }
+
+        /**
+         * @brief Change the wake-up time with a temporary write, like setAirDataRate()
+         *
+         * In mode 1 it is the length of the preamble sent, in mode 2 how
+         * often the module listens. A sender's must be at least the
+         * receiver's: longer saves receiver current, but adds up to that
+         * much latency (and airtime) to every packet sent in mode 1.
+         *
+         * @param wakeUpTime WAKE_UP_xxx code, 250 ms steps from 250 to 2000 ms
+         * @return true Module now uses this wake-up time
+         */
+        bool setWakeUpTime(uint8_t wakeUpTime);
+        uint8_t getWakeUpTime() const { return _config.OPTION.wirelessWakeupTime; }
 
-        // Send string message
+        /**
+         * @brief Retune to another channel with a temporary write, like setAirDataRate()
+         *
+         * The module runs in transparent mode, so it sends and listens on
+         * its configured CHAN only: every channel change is a config write.
+         *
+         * @param channel CHAN, 0 to CHANNEL_MAX (ChannelPlan::frequencyMHz())
+         * @return true Module now runs on this channel
+         */
+        bool setChannel(uint8_t channel);
+        uint8_t getChannel() const { return _channel; }
+
+        /**
+         * @brief Broadcast bytes on the current channel without heap allocation
+         *
+         * @param data Payload
+         * @param size Payload size, at most LORA_PAYLOAD_MAX
+         * @return true Bytes handed to the module
+         */
+        bool send(const uint8_t* data, size_t size);
+        bool send(ConstByteSpan payload) { return send(payload.data, payload.size); }
+
+        // Same as send() but to a single address
+        bool sendTo(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, size_t size);
+        bool sendTo(uint8_t ADDH, uint8_t ADDL, ConstByteSpan payload) { return sendTo(ADDH, ADDL, payload.data, payload.size); }
+
+        /**
+         * @brief Read one pending frame into a caller buffer without heap allocation
+         *
+         * The ADDH/ADDL/CHAN the sender wrote in front of the frame is stripped.
+         * When polling, never waits: a frame still arriving comes out of a later
+         * call, once the UART stayed idle for LORA_RX_GAP_MS.
+         *
+         * @param buf Destination
+         * @param cap Size of destination, extra bytes of the frame are dropped
+         * @return size_t Bytes copied, 0 if nothing was pending
+         */
+        size_t receive(uint8_t* buf, size_t cap);
+        size_t receive(ByteSpan buf) { return receive(buf.data, buf.size); }
+
+        // Send string message (wrappers around send/sendTo)
         void sendBroadcastMessage(const String message);
         void sendMessage( uint8_t ADDH=0x01, uint8_t ADDL=0x02, const String message = "");
 
+        // Send binary payload (e.g. an encoded telemetry frame)
+        void sendBroadcastMessage(const uint8_t* data, uint8_t size);
+        void sendMessage(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, uint8_t size);
+
         bool checkForMessage();
 
-        void receiveMessage();
+        // Move every complete frame into the receive history (wrapper around receive),
+        // true if at least one was kept
+        bool receiveMessage();
 
         void printLastMessage();
 
+        // Raw bytes of the newest frame in the history (may hold binary data), nullptr/0 once popped
+        const uint8_t* getLastMessage() const;
+        size_t getLastMessageLength() const;
+
+        /**
+         * @brief Read the oldest frame of the receive history
+         *
+         * checkForMessage()/receiveMessage() keep up to LORA_RX_HISTORY_SLOTS
+         * frames, so a burst from several nodes waits here instead of each
+         * frame overwriting the last one.
+         *
+         * @param buf Destination
+         * @param cap Size of destination, extra bytes are dropped
+         * @param info Arrival time, status and frames lost before it (may be nullptr)
+         * @return size_t Frame length copied, 0 if the history is empty
+         */
+        size_t popMessage(uint8_t* buf, size_t cap, RxFrameInfo* info = nullptr) { return _rxHistory.pop(buf, cap, info); }
+        size_t messageCount() const { return _rxHistory.count(); }
+
+        // Peek/iterate/clear the frames not popped yet
+        LoRaRxHistory& rxHistory() { return _rxHistory; }
+        const LoRaRxHistory& rxHistory() const { return _rxHistory; }
+
+        // Overwrite the oldest frame (default) or refuse the new one when the history is full
+        void setRxDropPolicy(RxDropPolicy policy) { _rxHistory.setDropPolicy(policy); }
+
+        /**
+         * @brief Switch from polling to event driven receive
+         *
+         * The UART event task drains every frame into a lock-free ring as soon as
+         * the line goes idle. With a handler, a receive task wakes on each frame
+         * and calls it. Without one, frames wait in the ring for
+         * checkForMessage()/receive(), which must then not be mixed with a handler.
+         *
+         * @param handler Called for each frame from the receive task (may be nullptr)
+         * @param context Passed back to the handler
+         * @return true Receive path started
+         */
+        bool beginReceiveTask(FrameHandler handler = nullptr, void* context = nullptr);
+        void endReceiveTask();
+
+        // Frames waiting in the rings / lost because one was full or the packet was malformed
+        size_t pendingFrames() const { return _rxRing.count() + _appRx.count(); }
+        uint32_t droppedFrames() const { return _rxRing.dropped() + _appRx.dropped() + _rxMalformed; }
+
+        /**
+         * @brief Move the module's I/O to a task of its own, pinned to one core
+         *
+         * The task wakes on every received frame and every LORA_RADIO_POLL_MS:
+         * it takes the protocol frames (ARQ, FEC, beacons, hop syncs) and runs
+         * update(). The application on the other core only meets it through
+         * two lock-free single producer / single consumer rings:
+         * enqueue()/enqueueTo() fill one, receive()/readMessage()/
+         * checkForMessage() empty the other (FEC payloads come out decoded,
+         * ARQ ones through readReliable()). Serial prints or sensor reads in
+         * loop() then never hold the radio up, and loop() need not call
+         * update() any more.
+         *
+         * Anything else that drives the module (send(), mode changes,
+         * config(), setAirDataRate()/setChannel(), flushTx(), sleep())
+         * takes the radio lock and runs on the caller's core while the task
+         * waits. Set up TDMA, CSMA, hopping, ARQ, FEC and the duty cycle
+         * before starting it. No receive handler meanwhile.
+         *
+         * @param core Core to pin the task to
+         * @return true Task running
+         */
+        bool beginRadioTask(BaseType_t core = LORA_RADIO_CORE);
+        void endRadioTask();
+        bool hasRadioTask() const { return _radioTask != nullptr; }
+
+        /**
+         * @brief Queue a broadcast frame, sent from update() as the module frees up
+         *
+         * Frames are pipelined into the module while its buffer has room and
+         * completed when AUX goes back HIGH (or by airtime estimate without AUX).
+         *
+         * @param data Payload
+         * @param size Payload size, at most LORA_PAYLOAD_MAX
+         * @return int32_t Frame id passed to the TX callback, -1 if queue full or too big
+         */
+        int32_t enqueue(const uint8_t* data, size_t size);
+        int32_t enqueueTo(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, size_t size);
+
+        // Per-frame status callback
+        void onTxComplete(TxCallback callback, void* context = nullptr);
+
+        // Backpressure (free slots of the application's ring with the radio task)
+        size_t txQueueDepth() const { return _txQueue.count() + _appTx.count(); }
+        size_t txQueueFree() const;
+        size_t txInFlight() const { return _txInFlightCount; }
+        bool txIdle() const { return txQueueDepth() == 0 && _txInFlightCount == 0; }
+
+        // Run update() until every queued frame is done, true if it emptied in time
+        bool flushTx(uint32_t timeoutMs);
+
+        /**
+         * @brief Queue a message larger than one frame (up to FRAG_MAX_MESSAGE bytes)
+         *
+         * The message is copied and split into fragments sized to the E32
+         * sub-packet, which update() feeds into the TX queue as it drains.
+         *
+         * @param data Message bytes
+         * @param size Message size
+         * @return false Previous message still going out, or size is 0 or too big
+         */
+        bool enqueueMessage(const uint8_t* data, size_t size);
+        bool messagePending() const { return _fragmenter.pending(); }
+
+        /**
+         * @brief Read the next complete message
+         *
+         * Fragments go through the reassembly table, reliable payloads come
+         * out in order (see setReliable()), coded ones through the erasure
+         * decoder (see setFec()), any other frame is returned as it is.
+         *
+         * @param buf Destination
+         * @param cap Size of destination, extra bytes are dropped
+         * @return size_t Message length copied, 0 if no message completed
+         */
+        size_t readMessage(uint8_t* buf, size_t cap);
+
+        ReassemblyStats getReassemblyStats() const { return _reassembler.stats(); }
+
+        /**
+         * @brief Turn reliable delivery on or off
+         *
+         * Payloads given to sendReliable() are numbered and kept until the
+         * peer acknowledges them, lost ones are sent again. Received reliable
+         * frames are reordered and acknowledged by update(). Both ends must
+         * enable it. Incoming frames have to go through readMessage() or the
+         * receive task, which route ARQ frames here.
+         *
+         * @param enabled Reliable mode on/off (off drops anything unacked)
+         * @param window Frames in flight before waiting for an ACK, 1 is stop-and-wait
+         */
+        void setReliable(bool enabled, uint8_t window = LORA_ARQ_WINDOW);
+        bool isReliable() const { return _reliable; }
+
+        /**
+         * @brief Queue a payload for reliable delivery
+         *
+         * @param data Payload
+         * @param size At most ARQ_PAYLOAD bytes
+         * @return false Not in reliable mode, window full (retry later) or too big
+         */
+        bool sendReliable(const uint8_t* data, size_t size);
+        bool reliableWindowFree() const { return _reliable && _arqSender.canOffer(); }
+        bool reliableIdle() const { return !_reliable || _arqSender.idle(); }
+
+        // Next reliable payload in order, 0 if none
+        size_t readReliable(uint8_t* buf, size_t cap);
+
+        // Sender counters with the receiver's delivered/duplicates/skipped
+        ArqStats getArqStats() const;
+
+        /**
+         * @brief Turn packet erasure coding on or off
+         *
+         * Payloads given to sendFec() go out as they are, followed by m parity
+         * frames per group of k. The receiver rebuilds up to m lost frames per
+         * group without asking for them again, so it suits bursts of lost
+         * packets on a one way link. Both ends must enable it (any k, m on the
+         * receiving side). Decoding runs in the receive task or readMessage(),
+         * whichever reads the frames.
+         *
+         * @param k Data frames per group (1-15), 0 turns it off
+         * @param m Parity frames per group (0-8), overhead is m / k
+         * @param flushMs A partial group is closed this long after its first payload
+         */
+        void setFec(uint8_t k = LORA_FEC_K, uint8_t m = LORA_FEC_M, uint32_t flushMs = LORA_FEC_FLUSH_MS);
+        bool isFecEnabled() const { return _fec; }
+
+        /**
+         * @brief Queue a payload protected by the erasure code
+         *
+         * @param data Payload
+         * @param size At most FEC_PAYLOAD bytes
+         * @return false FEC off, too big, or the previous group is still going out (retry later)
+         */
+        bool sendFec(const uint8_t* data, size_t size);
+        bool fecPending() const { return _fecEncoder.pending(); }
+
+        // Close the current group now, its parity goes out with the next update()
+        void flushFec();
+
+        FecStats getFecStats() const { return _fecDecoder.stats(); }
+
+        /**
+         * @brief Limit transmit airtime to a duty cycle
+         *
+         * Every packet is charged its airtime from the configuration in use
+         * (see AirtimeModel). Queued frames wait in the TX queue until the
+         * budget covers them, blocking send()/sendTo() return false instead.
+         * Airtime is counted whether a limit is set or not.
+         *
+         * @param permille Duty cycle in 1/1000, 0 removes the limit
+         * @param windowMs Any window this long holds at most permille of it on air
+         */
+        void setDutyCycle(uint16_t permille, uint32_t windowMs = DUTY_CYCLE_WINDOW_MS);
+
+        // Airtime of the last window, to keep in RTC memory through deep sleep
+        DutyCycleState saveDutyCycle();
+
+        // Back from deep sleep, after setDutyCycle(): elapsedMs is the time spent asleep
+        void restoreDutyCycle(const DutyCycleState& state, uint32_t elapsedMs);
+
+        // Airtime of one packet carrying this payload, in the current mode
+        uint32_t airtimeMs(size_t size) const;
+
+        // How long a payload of this size would wait for budget, 0 if it goes out now.
+        // Callers can keep filling a frame meanwhile instead of queueing a small one.
+        uint32_t txAdmitDelayMs(size_t size);
+
+        AirtimeStats getAirtimeStats();
+
+        /**
+         * @brief Only transmit inside this node's TDMA slot
+         *
+         * Queued frames wait at the head of the TX queue until they fit in
+         * the slot the gateway announced for this node (the shared slot until
+         * then), nothing goes out before the first beacon or once beacons
+         * were missed for TDMA_LOST_BEACONS superframes. Blocking send()/
+         * sendTo() return false outside the slot. Beacons are taken by
+         * readMessage() and the receive task, raw receive() callers hand
+         * them to acceptBeacon().
+         *
+         * @param node Id the gateway assigns slots to (the node header id)
+         */
+        void setTdma(uint16_t node);
+        void disableTdma();
+        bool isTdmaEnabled() const { return _tdmaEnabled; }
+
+        // Take the timing of a beacon, false if the frame is not one
+        bool acceptBeacon(const uint8_t* frame, size_t length);
+
+        // Copy of the node's schedule (slot, superframe, beacons heard)
+        TdmaSchedule getTdmaSchedule() const;
+
+        /**
+         * @brief Listen before talk, with random exponential backoff
+         *
+         * Received traffic (bytes from the module, or AUX LOW with nothing
+         * of ours in flight) marks the channel busy. A frame that finds it
+         * busy waits for it to clear plus a random backoff (see CsmaBackoff),
+         * queued frames at the head of the TX queue, blocking send()/sendTo()
+         * for up to LORA_CSMA_MAX_WAIT_MS before returning false.
+         *
+         * No effect on the E32: it only shows a packet once it was
+         * received, so a packet already on air is never caught. Measured
+         * against plain ALOHA it delivered no more (77/75/21 % against
+         * 78/76/22 % at rising load, 9 of 17 frames either way with two
+         * modules). It is not congestion control. Give many buoys TDMA
+         * slots instead (setTdma()).
+         *
+         * @param enabled Carrier sense on/off
+         * @param slotMs Backoff slot, 0 follows the airtime of a full frame
+         */
+        void setCsma(bool enabled, uint32_t slotMs = 0);
+        bool isCsmaEnabled() const { return _csmaEnabled; }
+        CsmaStats getCsmaStats() const { return _csma.stats(); }
+
+        /**
+         * @brief Hop over the channels of a plan, on a schedule shared with the gateway
+         *
+         * update() retunes (setChannel()) once the frames on air are done,
+         * queued frames are held back when they would still be on air at
+         * the next change. The gateway (master) starts the schedule and sends
+         * a hop sync frame after every retune. A buoy follows the syncs it
+         * hears and holds its frames until it heard one, or once it heard
+         * none for HOP_LOST_HOPS hops, while it scans the plan for the gateway.
+         * Each hop it also holds them until that hop's sync is in.
+         * Syncs are taken by readMessage() and the receive task, raw
+         * receive() callers hand them to acceptHopSync().
+         *
+         * @param plan Channels to hop over, the same on every end
+         * @param seed Hop order, the same on every end
+         * @param dwellMs Time on each channel, well above the retune time
+         * @param master Gateway: keeps the time and sends the syncs
+         */
+        void setHopping(const ChannelPlan& plan, uint32_t seed, uint16_t dwellMs, bool master);
+        void disableHopping();
+        bool isHopping() const { return _hopping; }
+
+        // Follow a hop sync, false if the frame is not one
+        bool acceptHopSync(const uint8_t* frame, size_t length);
+
+        // Copy of the hop schedule (plan, dwell, sync state)
+        HopSchedule getHopSchedule() const;
+
+        // Heap watermark of the send/receive path
+        HeapStats getHeapStats() const { return _heapStats; }
+
     private:
         // Pins
         uint8_t _loraRxPin;
         uint8_t _loraTxPin;
-        uint8_t _auxPin = -1; // Not used in this class
+        int8_t _auxPin;
         uint8_t _m0Pin;
         uint8_t _m1Pin;
 
+        // UART connected to the module
+        HardwareSerial* _serial;
+
         // LoRa module object
         LoRa_E32 _loraModule; 
 
@@ -66,13 +646,181 @@ class LoRa {
         // State of the LoRa module (e.g., config or normal) 
         bool _isConfigMode = false;
         bool _isNormalMode = true;
+        bool _canTransmit = true;   // Mode 0 or 1
+        bool _canReceive = true;    // Mode 0, 1 or 2
+
+        // Mode transition state machine
+        MODE_TYPE _mode = MODE_0_NORMAL;
+        bool _switching = false;
+        unsigned long _switchStart = 0;
+        uint32_t _switchFallbackMs = 0;
+        ModeCallback _modeCallback = nullptr;
+        void* _modeContext = nullptr;
 
-        // Channel for fixed message sending
+        void startTransition(uint32_t fallbackMs);
+        void finishTransition(bool success);
+
+        // Channel the module runs on
         uint8_t _channel = 0x30;
 
-        // Last message received
-        String _lastMessage = "";
+        // Cached module configuration
+        const char* _nvsNamespace;
+        Configuration _config;
+        bool _configValid = false;
+        bool _configTemporary = false;  // Running config was written with PWR_DWN_LOSE
+        ConfigResult _lastConfigResult = CONFIG_FAILED;
+
+        Configuration buildConfiguration(uint8_t high, uint8_t low, uint8_t channel) const;
+        bool applyConfiguration(const Configuration& configuration, bool persist);
+        void adoptConfiguration(const Configuration& configuration);
+        bool writeTemporary(const Configuration& configuration, bool flushQueue = true);
+        static bool configMatches(const Configuration& a, const Configuration& b);
+        bool nvsMatches(const Configuration& configuration) const;
+        void nvsStore(const Configuration& configuration) const;
+        void nvsMarkTemporary() const;
+
+        // Static TX buffer and receive history, nothing on the send/receive path touches the heap
+        uint8_t _txBuffer[MAX_SIZE_TX_PACKET];
+        LoRaRxHistory _rxHistory;
+        uint32_t _rxRingDropsSeen = 0;  // _rxRing.dropped() already charged to the history
+
+        HeapStats _heapStats = { UINT32_MAX, 0 };
+
+        // Polled receive: frame read so far, complete once the line is idle
+        uint8_t _rxPoll[LORA_RX_BUFFER_SIZE];
+        size_t _rxPollReceived = 0;
+        unsigned long _rxPollLastByte = 0;
+
+        // Event driven receive (UART event task -> ring -> receive task)
+        FrameRing<LORA_RX_RING_SLOTS, LORA_RX_BUFFER_SIZE> _rxRing;
+        bool _asyncReceive = false;
+        TaskHandle_t _rxTask = nullptr;
+        FrameHandler _rxHandler = nullptr;
+        void* _rxContext = nullptr;
+
+        void onUartReceive();
+
+        // Packets with no payload or longer than one sub-packet (merged packets, noise)
+        volatile uint32_t _rxMalformed = 0;
+
+        size_t stripFixedHeader(uint8_t* frame, size_t received, size_t stored);
+        static void receiveTask(void* param);
+
+        // Protocol frames out of _rxRing, the rest to the handler or _appRx
+        void routeReceived();
+        void deliver(const uint8_t* data, size_t length);
+
+        // Radio task, the application side fills _appTx and empties _appRx
+        FrameRing<LORA_TX_QUEUE_SLOTS, MAX_SIZE_TX_PACKET> _appTx;
+        FrameRing<LORA_APP_RX_SLOTS, LORA_RX_BUFFER_SIZE> _appRx;
+        TaskHandle_t _radioTask = nullptr;
+        volatile bool _radioStop = false;
+        SemaphoreHandle_t _radioLock = nullptr;    // Recursive, held by the task for each pass
+
+        static void radioTask(void* param);
+        bool onRadioTask() const;
+        void lockRadio() const;
+        void unlockRadio() const;
+        void pumpApplication();
+
+        // Transmit queue (frames stored with their fixed transmission header)
+        struct TxInFlight {
+            uint32_t id;
+            uint16_t size;
+            unsigned long doneAt;   // Estimated end of airtime
+        };
+
+        // Only touched by whoever runs update() (under the radio lock with the task), frame id as tag
+        FrameRing<LORA_TX_QUEUE_SLOTS, MAX_SIZE_TX_PACKET> _txQueue;
+        TxInFlight _txInFlight[LORA_TX_INFLIGHT_MAX];
+        uint8_t _txInFlightHead = 0;
+        uint8_t _txInFlightCount = 0;
+        size_t _txBytesInFlight = 0;
+        std::atomic<uint32_t> _txEnqueued{0};  // Next frame id, from either side
+        unsigned long _txUartDoneAt = 0;    // Last queued byte has left the UART
+        unsigned long _txLastDoneAt = 0;
+        TxCallback _txCallback = nullptr;
+        void* _txContext = nullptr;
+
+        // Messages larger than one frame
+        Fragmenter _fragmenter;
+        Reassembler _reassembler;
+
+        // Reliable mode, shared by the receive task and update()
+        bool _reliable = false;
+        ArqSender _arqSender;
+        ArqReceiver _arqReceiver;
+        mutable portMUX_TYPE _arqLock = portMUX_INITIALIZER_UNLOCKED;
+        int32_t _arqBurstFrame = -1;    // TX queue id of the frame closing the burst
+
+        void pumpReliable();
+        bool acceptReliable(const uint8_t* frame, size_t length);
+
+        // Erasure coding, the encoder belongs to update(), the decoder to the reading path
+        bool _fec = false;
+        uint32_t _fecFlushMs = LORA_FEC_FLUSH_MS;
+        unsigned long _fecGroupStart = 0;   // First payload of the open group
+        FecEncoder _fecEncoder;
+        FecDecoder _fecDecoder;
+
+        void pumpFec();
+
+        // Air data rate set by config(), used for airtime estimates
+        uint8_t _airDataRate = AIR_DATA_RATE_010_24;
+
+        // Airtime of the running configuration and the duty cycle budget
+        AirtimeModel _airtime;
+        DutyCycle _dutyCycle;
+        bool _txDeferred = false;       // Head of the TX queue already counted as deferred
+        uint32_t _txDeferredCount = 0;
+        uint32_t _txRefusedCount = 0;
+
+        // TDMA slot of this node, beacons come from the receive task
+        bool _tdmaEnabled = false;
+        TdmaSchedule _tdma;
+        mutable portMUX_TYPE _tdmaLock = portMUX_INITIALIZER_UNLOCKED;
+
+        uint32_t tdmaDelayMs(uint32_t onAirAt, size_t length) const;
+
+        // Carrier sense, receive activity is counted by whoever reads the UART
+        bool _csmaEnabled = false;
+        uint32_t _csmaSlotMs = 0;       // 0: airtime of a full frame
+        CsmaBackoff _csma;
+        volatile uint32_t _rxActivity = 0;
+        uint32_t _rxActivitySeen = 0;
+
+        uint32_t csmaDelayMs(unsigned long now);
+        bool csmaWait();
+
+        // Channel hopping, syncs come from the receive task
+        bool _hopping = false;
+        bool _hopMaster = false;
+        uint32_t _hopAnnounced = UINT32_MAX;   // Last hop the sync went out for
+        HopSchedule _hops;
+        mutable portMUX_TYPE _hopLock = portMUX_INITIALIZER_UNLOCKED;
+
+        void pumpHopping();
+        bool hopHolds(unsigned long now, unsigned long doneAt) const;
+
+        uint32_t packetAirtimeUs(size_t length) const;
+        bool admit(size_t length);
+        void chargeAirtime(size_t length);
+
+        void pumpTx();
+        void pumpTransition();
+        void pumpFragments();
+
+        // Into _txQueue from the update() side, returns the frame id or -1
+        int32_t queueFrame(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, size_t size);
+        size_t txSlotsFree() const { return _txQueue.capacity() - _txQueue.count(); }
+        void completeTx(TxStatus status);
+        uint32_t estimateAirtimeMs(size_t bytes) const;
+
+        // Write header + payload straight to the UART
+        bool writeFrame(uint8_t ADDH, uint8_t ADDL, const uint8_t* data, size_t size);
 
+        // Record free heap around a send/receive call
+        void trackHeap(uint32_t freeBefore);
 
 };
 
@@ -0,0 +1,23 @@
+#ifndef LORAFRAME_H
+#define LORAFRAME_H
+
+//Dependencies
+// Plain C++ only (no Arduino.h) so the frame libraries also build on a Linux host
+#include <stdint.h>
+#include <stddef.h>
+
+
+////////////////////////////////////////////////////////
+///// Frame size
+////////////////////////////////////////////////////////
+//
+// One frame is one E32 sub-packet. The sender writes ADDH/ADDL/CHAN in front
+// of it and the receiving module (transparent mode) hands those 3 bytes back,
+// LoRa strips them before any frame library sees the frame. Libraries always
+// find their header at offset 0 and fill at most LORA_PAYLOAD_MAX bytes.
+
+#define LORA_SUBPACKET_SIZE     58      // E32 MAX_SIZE_TX_PACKET
+#define LORA_FIXED_HEADER_SIZE  3       // ADDH, ADDL, CHAN in front of every frame
+#define LORA_PAYLOAD_MAX        (LORA_SUBPACKET_SIZE - LORA_FIXED_HEADER_SIZE)
+
+#endif // LORAFRAME_H
@@ -0,0 +1,652 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <malloc.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+HWCDC Serial;
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+EspClass ESP;
+
+
+////////////////////////////////////////////////////////
+///// Time
+////////////////////////////////////////////////////////
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long millis() {
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)esp_timer_get_time();
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+
+////////////////////////////////////////////////////////
+///// GPIO
+////////////////////////////////////////////////////////
+
+// Unconnected inputs read HIGH (pull-ups), which is also what an idle AUX reads
+static std::atomic<uint8_t> gpioLevels[NATIVE_GPIO_COUNT];
+static std::once_flag gpioInit;
+
+static void initGpio() {
+    for (size_t i = 0; i < NATIVE_GPIO_COUNT; i++) {
+        gpioLevels[i] = HIGH;
+    }
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    std::call_once(gpioInit, initGpio);
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    std::call_once(gpioInit, initGpio);
+    if (pin < NATIVE_GPIO_COUNT) {
+        gpioLevels[pin] = value ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    std::call_once(gpioInit, initGpio);
+    return pin < NATIVE_GPIO_COUNT ? gpioLevels[pin].load() : LOW;
+}
+
+
+////////////////////////////////////////////////////////
+///// Misc
+////////////////////////////////////////////////////////
+
+long random(long howbig) {
+    return howbig <= 0 ? 0 : (long)(esp_random() % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig) {
+    return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    srand((unsigned int)seed);
+}
+
+uint32_t esp_random() {
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+float temperatureRead() {
+    return 42.0f;
+}
+
+uint32_t EspClass::getFreeHeap() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    uint32_t freeHeap = (uint32_t)mallinfo2().fordblks;
+#else
+    uint32_t freeHeap = (uint32_t)mallinfo().fordblks;
+#endif
+    if (freeHeap < _minFreeHeap) {
+        _minFreeHeap = freeHeap;
+    }
+    return freeHeap;
+}
+
+uint32_t EspClass::getCycleCount() {
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+#endif
+}
+
+void EspClass::restart() {
+    fflush(stdout);
+    exit(0);
+}
+
+
+////////////////////////////////////////////////////////
+///// String
+////////////////////////////////////////////////////////
+
+static std::string formatNumber(unsigned long n, unsigned char base) {
+    if (base < 2) {
+        base = 10;
+    }
+    char buf[8 * sizeof(long) + 1];
+    char* p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    do {
+        char digit = n % base;
+        *--p = digit < 10 ? digit + '0' : digit + 'A' - 10;
+        n /= base;
+    } while (n);
+    return std::string(p);
+}
+
+static std::string formatSigned(long n, unsigned char base) {
+    if (n < 0 && base == DEC) {
+        return "-" + formatNumber(-(unsigned long)n, base);
+    }
+    return formatNumber((unsigned long)n, base);
+}
+
+static std::string formatFloat(double value, unsigned int decimalPlaces) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+    return std::string(buf);
+}
+
+String::String(unsigned char value, unsigned char base) : _s(formatNumber(value, base)) {}
+String::String(int value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _s(formatNumber(value, base)) {}
+String::String(long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _s(formatNumber(value, base)) {}
+String::String(float value, unsigned int decimalPlaces) : _s(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : _s(formatFloat(value, decimalPlaces)) {}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t pos = _s.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from) const {
+    return from >= _s.length() ? String() : String(_s.substr(from));
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        unsigned int swap = from;
+        from = to;
+        to = swap;
+    }
+    return from >= _s.length() ? String() : String(_s.substr(from, to - from));
+}
+
+
+////////////////////////////////////////////////////////
+///// Print / Stream
+////////////////////////////////////////////////////////
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::printNumber(unsigned long n, int base) {
+    std::string s = formatNumber(n, base);
+    return write(s.c_str(), s.length());
+}
+
+size_t Print::printSigned(long n, int base) {
+    std::string s = formatSigned(n, base);
+    return write(s.c_str(), s.length());
+}
+
+size_t Print::print(double n, int digits) {
+    std::string s = formatFloat(n, digits);
+    return write(s.c_str(), s.length());
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (length < 0) {
+        return 0;
+    }
+    return write(buf, (size_t)length < sizeof(buf) ? length : sizeof(buf) - 1);
+}
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) {
+            return c;
+        }
+        delayMicroseconds(100);
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) {
+            break;
+        }
+        buffer[count++] = (uint8_t)c;
+    }
+    return count;
+}
+
+size_t HWCDC::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HWCDC::write(const uint8_t* buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HWCDC::flush() {
+    fflush(stdout);
+}
+
+
+////////////////////////////////////////////////////////
+///// HardwareSerial
+////////////////////////////////////////////////////////
+
+// Stands in for the UART event task of the ESP32 driver
+static std::mutex eventLock;
+static HardwareSerial* eventPorts[4];
+static bool eventThreadRunning = false;
+
+static void uartEventThread() {
+    for (;;) {
+        uint64_t now = (uint64_t)esp_timer_get_time();
+        for (size_t i = 0; i < sizeof(eventPorts) / sizeof(eventPorts[0]); i++) {
+            HardwareSerial* port;
+            {
+                std::lock_guard<std::mutex> guard(eventLock);
+                port = eventPorts[i];
+            }
+            if (port != nullptr) {
+                port->pollEvents(now);
+            }
+        }
+        delayMicroseconds(100);
+    }
+}
+
+HardwareSerial::HardwareSerial(int uartNum)
+    : _uartNum(uartNum)
+{
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin,
+                           bool invert, unsigned long timeoutMs, uint8_t rxfifoFullThreshold) {
+    (void)config;
+    (void)rxPin;
+    (void)txPin;
+    (void)invert;
+    (void)timeoutMs;
+    (void)rxfifoFullThreshold;
+    updateBaudRate(baud);
+}
+
+void HardwareSerial::end() {
+    onReceive(NULL);
+    std::lock_guard<std::mutex> guard(_lock);
+    _rx.clear();
+    _tx.clear();
+}
+
+void HardwareSerial::updateBaudRate(unsigned long baud) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _baud = baud > 0 ? baud : 9600;
+}
+
+size_t HardwareSerial::readyCount(uint64_t nowUs) const {
+    // Bytes are queued in arrival order, so count until the first one still shifting in
+    size_t count = 0;
+    for (const TimedByte& b : _rx) {
+        if (b.readyUs > nowUs) {
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> guard(_lock);
+    return (int)readyCount((uint64_t)esp_timer_get_time());
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_rx.empty() || _rx.front().readyUs > (uint64_t)esp_timer_get_time()) {
+        return -1;
+    }
+    uint8_t c = _rx.front().value;
+    _rx.pop_front();
+    return c;
+}
+
+int HardwareSerial::peek() {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_rx.empty() || _rx.front().readyUs > (uint64_t)esp_timer_get_time()) {
+        return -1;
+    }
+    return _rx.front().value;
+}
+
+size_t HardwareSerial::read(uint8_t* buffer, size_t size) {
+    std::lock_guard<std::mutex> guard(_lock);
+    uint64_t now = (uint64_t)esp_timer_get_time();
+    size_t count = 0;
+    while (count < size && !_rx.empty() && _rx.front().readyUs <= now) {
+        buffer[count++] = _rx.front().value;
+        _rx.pop_front();
+    }
+    return count;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    std::lock_guard<std::mutex> guard(_lock);
+    uint64_t now = (uint64_t)esp_timer_get_time();
+    uint64_t byteUs = byteTimeUs();
+    if (_txFreeUs < now) {
+        _txFreeUs = now;
+    }
+    for (size_t i = 0; i < size; i++) {
+        _txFreeUs += byteUs;
+        _tx.push_back({ buffer[i], _txFreeUs });
+    }
+    return size;
+}
+
+int HardwareSerial::availableForWrite() {
+    return 128;
+}
+
+void HardwareSerial::flush() {
+    uint64_t doneUs;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        doneUs = _txFreeUs;
+    }
+    while ((uint64_t)esp_timer_get_time() < doneUs) {
+        delayMicroseconds(100);
+    }
+}
+
+bool HardwareSerial::setRxTimeout(uint8_t symbolsTimeout) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _rxTimeoutSymbols = symbolsTimeout;
+    return true;
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool onlyOnTimeout) {
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _onReceive = function;
+        _onlyOnTimeout = onlyOnTimeout;
+        _rxEventPending = !_rx.empty();
+    }
+
+    std::lock_guard<std::mutex> guard(eventLock);
+    eventPorts[_uartNum & 3] = function ? this : nullptr;
+    if (function && !eventThreadRunning) {
+        eventThreadRunning = true;
+        std::thread(uartEventThread).detach();
+    }
+}
+
+size_t HardwareSerial::setRxBufferSize(size_t size) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _rxBufferSize = size;
+    return size;
+}
+
+size_t HardwareSerial::takeTx(uint8_t* buffer, size_t size) {
+    std::lock_guard<std::mutex> guard(_lock);
+    uint64_t now = (uint64_t)esp_timer_get_time();
+    size_t count = 0;
+    while (count < size && !_tx.empty() && _tx.front().readyUs <= now) {
+        buffer[count++] = _tx.front().value;
+        _tx.pop_front();
+    }
+    return count;
+}
+
+void HardwareSerial::injectRx(const uint8_t* data, size_t size) {
+    std::lock_guard<std::mutex> guard(_lock);
+    uint64_t now = (uint64_t)esp_timer_get_time();
+    uint64_t byteUs = byteTimeUs();
+    if (_rxFreeUs < now) {
+        _rxFreeUs = now;
+    }
+    for (size_t i = 0; i < size; i++) {
+        _rxFreeUs += byteUs;
+        if (_rx.size() >= _rxBufferSize) {
+            _rxOverflows++;
+            continue;
+        }
+        _rx.push_back({ data[i], _rxFreeUs });
+    }
+    _rxEventPending = true;
+}
+
+bool HardwareSerial::rxBusy() {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _rxFreeUs > (uint64_t)esp_timer_get_time();
+}
+
+void HardwareSerial::pollEvents(uint64_t nowUs) {
+    OnReceiveCb callback;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_onReceive || !_rxEventPending || _rx.empty()) {
+            return;
+        }
+        // Idle line for the timeout, or the FIFO threshold when not only on timeout
+        bool idle = _rxFreeUs <= nowUs && nowUs - _rxFreeUs >= (uint64_t)_rxTimeoutSymbols * byteTimeUs();
+        bool full = !_onlyOnTimeout && readyCount(nowUs) >= 112;
+        if (!idle && !full) {
+            return;
+        }
+        _rxEventPending = !idle;
+        callback = _onReceive;
+    }
+    callback();
+}
+
+
+////////////////////////////////////////////////////////
+///// FreeRTOS
+////////////////////////////////////////////////////////
+
+struct NativeTask {
+    std::mutex lock;
+    std::condition_variable wake;
+    uint32_t notifications = 0;
+    bool deleted = false;
+    TaskFunction_t function = nullptr;
+    void* parameter = nullptr;
+};
+
+// Thrown inside a task to unwind it, like vTaskDelete(NULL)
+struct NativeTaskExit {};
+
+static thread_local NativeTask* currentTask = nullptr;
+
+static NativeTask* selfTask() {
+    // Threads not started by xTaskCreate (e.g. main) get a handle on first use
+    if (currentTask == nullptr) {
+        currentTask = new NativeTask();
+    }
+    return currentTask;
+}
+
+static void taskEntry(NativeTask* task) {
+    currentTask = task;
+    try {
+        task->function(task->parameter);
+    }
+    catch (const NativeTaskExit&) {
+    }
+}
+
+static void exitIfDeleted(NativeTask* task) {
+    bool deleted;
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        deleted = task->deleted;
+    }
+    if (deleted) {
+        throw NativeTaskExit();
+    }
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+    (void)name;
+    (void)stackDepth;
+    (void)priority;
+
+    // Never freed: a deleted task may still be between two calls into the shim
+    NativeTask* task = new NativeTask();
+    task->function = function;
+    task->parameter = parameter;
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    std::thread(taskEntry, task).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t coreId) {
+    (void)coreId;
+    return xTaskCreate(function, name, stackDepth, parameter, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == currentTask) {
+        throw NativeTaskExit();
+    }
+    // Another task: it leaves at its next blocking call
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->deleted = true;
+    task->wake.notify_all();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    NativeTask* self = selfTask();
+    std::unique_lock<std::mutex> guard(self->lock);
+    self->wake.wait_for(guard, std::chrono::milliseconds(ticks), [self]() { return self->deleted; });
+    guard.unlock();
+    exitIfDeleted(self);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return selfTask();
+}
+
+BaseType_t xPortGetCoreID() {
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notifications++;
+    task->wake.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    NativeTask* self = selfTask();
+    std::unique_lock<std::mutex> guard(self->lock);
+    auto ready = [self]() { return self->notifications > 0 || self->deleted; };
+
+    if (ticksToWait == portMAX_DELAY) {
+        self->wake.wait(guard, ready);
+    }
+    else {
+        self->wake.wait_for(guard, std::chrono::milliseconds(ticksToWait), ready);
+    }
+
+    uint32_t count = self->notifications;
+    if (count > 0) {
+        self->notifications = clearCountOnExit ? 0 : count - 1;
+    }
+    guard.unlock();
+    exitIfDeleted(self);
+    return count;
+}
+
+struct NativeMutex {
+    std::recursive_timed_mutex lock;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new NativeMutex();
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return new NativeMutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait) {
+    if (ticksToWait == portMAX_DELAY) {
+        mutex->lock.lock();
+        return pdTRUE;
+    }
+    return mutex->lock.try_lock_for(std::chrono::milliseconds(ticksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    mutex->lock.unlock();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticksToWait) {
+    return xSemaphoreTake(mutex, ticksToWait);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex) {
+    return xSemaphoreGive(mutex);
+}
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    while (__atomic_exchange_n(&mux->owner, 1, __ATOMIC_ACQUIRE) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+}
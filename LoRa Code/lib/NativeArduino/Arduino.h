@@ -0,0 +1,371 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+//Dependencies
+// Host (Linux) stand-in for the parts of Arduino-ESP32 and FreeRTOS this
+// project uses. Only built by the native env (see platformio.ini), so the
+// libs in lib/ run unmodified against the emulated module in E32Emulator.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+
+////////////////////////////////////////////////////////
+///// Core
+////////////////////////////////////////////////////////
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT           0x01
+#define OUTPUT          0x03
+#define INPUT_PULLUP    0x05
+#define INPUT_PULLDOWN  0x09
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define SERIAL_8N1 0x800001c
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+#define NATIVE_GPIO_COUNT 64
+
+// Time since start, same clock for the sketch, the emulated module and the UARTs
+unsigned long millis();
+unsigned long micros();
+int64_t esp_timer_get_time();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// GPIO is a table of levels: the sketch drives M0/M1, the emulated module drives AUX
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// Pin hold through deep sleep, nothing to latch on the host
+typedef int gpio_num_t;
+inline int gpio_hold_en(gpio_num_t) { return 0; }
+inline int gpio_hold_dis(gpio_num_t) { return 0; }
+inline void gpio_deep_sleep_hold_en() {}
+inline void gpio_deep_sleep_hold_dis() {}
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+// Chip temperature, fixed on the host
+float temperatureRead();
+
+
+/**
+ * @brief Subset of the Arduino String backed by std::string
+ */
+class String {
+    public:
+        String(const char* s = "") : _s(s != nullptr ? s : "") {}
+        String(const std::string& s) : _s(s) {}
+        String(char c) : _s(1, c) {}
+        explicit String(unsigned char value, unsigned char base = DEC);
+        explicit String(int value, unsigned char base = DEC);
+        explicit String(unsigned int value, unsigned char base = DEC);
+        explicit String(long value, unsigned char base = DEC);
+        explicit String(unsigned long value, unsigned char base = DEC);
+        explicit String(float value, unsigned int decimalPlaces = 2);
+        explicit String(double value, unsigned int decimalPlaces = 2);
+
+        const char* c_str() const { return _s.c_str(); }
+        unsigned int length() const { return _s.length(); }
+        bool isEmpty() const { return _s.empty(); }
+        char operator[](unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+
+        String& operator+=(const String& rhs) { _s += rhs._s; return *this; }
+        String& operator+=(const char* rhs) { _s += rhs; return *this; }
+        String& operator+=(char rhs) { _s += rhs; return *this; }
+        friend String operator+(const String& lhs, const String& rhs) { return String(lhs._s + rhs._s); }
+
+        bool operator==(const String& rhs) const { return _s == rhs._s; }
+        bool operator!=(const String& rhs) const { return _s != rhs._s; }
+        bool equals(const String& rhs) const { return _s == rhs._s; }
+
+        int indexOf(char c, unsigned int from = 0) const;
+        String substring(unsigned int from) const;
+        String substring(unsigned int from, unsigned int to) const;
+        long toInt() const { return atol(_s.c_str()); }
+        float toFloat() const { return (float)atof(_s.c_str()); }
+
+    private:
+        std::string _s;
+};
+
+
+////////////////////////////////////////////////////////
+///// Print / Stream
+////////////////////////////////////////////////////////
+
+class Print {
+    public:
+        virtual ~Print() {}
+
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t* buffer, size_t size);
+        size_t write(const char* str) { return str == nullptr ? 0 : write((const uint8_t*)str, strlen(str)); }
+        size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+        size_t print(const char* s) { return write(s); }
+        size_t print(const String& s) { return write(s.c_str(), s.length()); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(unsigned char n, int base = DEC) { return printNumber(n, base); }
+        size_t print(int n, int base = DEC) { return printSigned(n, base); }
+        size_t print(unsigned int n, int base = DEC) { return printNumber(n, base); }
+        size_t print(long n, int base = DEC) { return printSigned(n, base); }
+        size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+        size_t print(double n, int digits = 2);
+
+        size_t println() { return write("\r\n"); }
+        template <typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+        template <typename T> size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+
+        size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+        virtual void flush() {}
+
+    private:
+        size_t printNumber(unsigned long n, int base);
+        size_t printSigned(long n, int base);
+};
+
+class Stream : public Print {
+    public:
+        virtual int available() = 0;
+        virtual int read() = 0;
+        virtual int peek() = 0;
+
+        void setTimeout(unsigned long timeoutMs) { _timeout = timeoutMs; }
+        unsigned long getTimeout() const { return _timeout; }
+
+        // Waits up to the timeout for each byte
+        size_t readBytes(uint8_t* buffer, size_t length);
+        size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+
+    protected:
+        unsigned long _timeout = 1000;
+        int timedRead();
+};
+
+
+////////////////////////////////////////////////////////
+///// Serial ports
+////////////////////////////////////////////////////////
+
+typedef std::function<void(void)> OnReceiveCb;
+
+/**
+ * @brief Virtual UART with byte timing
+ *
+ * Bytes written by the sketch leave one byte time (10 bits at the baud rate)
+ * apart and are picked up by the device on the other end with takeTx().
+ * Bytes from the device (injectRx()) arrive at the same pace, so idle gaps,
+ * RX timeouts and a full RX buffer behave like on the ESP32.
+ */
+class HardwareSerial : public Stream {
+    public:
+        HardwareSerial(int uartNum);
+
+        void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1,
+                   bool invert = false, unsigned long timeoutMs = 20000UL, uint8_t rxfifoFullThreshold = 112);
+        void end();
+        void updateBaudRate(unsigned long baud);
+        unsigned long baudRate() const { return _baud; }
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t read(uint8_t* buffer, size_t size);
+        size_t read(char* buffer, size_t size) { return read((uint8_t*)buffer, size); }
+
+        using Print::write;
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buffer, size_t size) override;
+        int availableForWrite();
+
+        // Blocks until every written byte has left the UART
+        void flush() override;
+
+        // UART event task: callback once the line has been idle for this many symbols
+        bool setRxTimeout(uint8_t symbolsTimeout);
+        void onReceive(OnReceiveCb function, bool onlyOnTimeout = false);
+        size_t setRxBufferSize(size_t size);
+        size_t setTxBufferSize(size_t size) { return size; }
+
+        operator bool() const { return true; }
+
+        ////////////////////////////////////////////////////////
+        ///// Device side (the other end of the wire)
+        ////////////////////////////////////////////////////////
+
+        // Bytes that finished shifting out of the sketch's TX line
+        size_t takeTx(uint8_t* buffer, size_t size);
+
+        // Bytes sent by the device, readable once shifted in. Dropped when the RX buffer is full.
+        void injectRx(const uint8_t* data, size_t size);
+
+        // True while device bytes are still shifting in
+        bool rxBusy();
+
+        // Microseconds per byte at the current baud rate
+        uint32_t byteTimeUs() const { return (uint32_t)(10000000UL / _baud); }
+
+        uint32_t rxOverflows() const { return _rxOverflows; }
+
+        // Called by the UART event thread
+        void pollEvents(uint64_t nowUs);
+
+    private:
+        struct TimedByte {
+            uint8_t value;
+            uint64_t readyUs;
+        };
+
+        int _uartNum;
+        unsigned long _baud = 9600;
+        std::mutex _lock;
+
+        std::deque<TimedByte> _rx;
+        std::deque<TimedByte> _tx;
+        uint64_t _rxFreeUs = 0;     // Last device byte fully shifted in
+        uint64_t _txFreeUs = 0;     // Last sketch byte fully shifted out
+        size_t _rxBufferSize = 256;
+        uint32_t _rxOverflows = 0;
+
+        OnReceiveCb _onReceive;
+        bool _onlyOnTimeout = false;
+        uint8_t _rxTimeoutSymbols = 2;
+        bool _rxEventPending = false;
+
+        size_t readyCount(uint64_t nowUs) const;
+};
+
+/**
+ * @brief USB CDC console, prints to stdout
+ */
+class HWCDC : public Stream {
+    public:
+        void begin(unsigned long baud = 115200) { (void)baud; }
+        void end() {}
+
+        int available() override { return 0; }
+        int read() override { return -1; }
+        int peek() override { return -1; }
+
+        using Print::write;
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buffer, size_t size) override;
+        void flush() override;
+
+        operator bool() const { return true; }
+};
+
+extern HWCDC Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+
+////////////////////////////////////////////////////////
+///// ESP
+////////////////////////////////////////////////////////
+
+class EspClass {
+    public:
+        // Free bytes of the host allocator's arena (glibc), only the trend is meaningful
+        uint32_t getFreeHeap();
+        uint32_t getMinFreeHeap() { return _minFreeHeap; }
+        // Host time stamp counter on x86, nanoseconds elsewhere
+        uint32_t getCycleCount();
+        void restart();
+
+    private:
+        uint32_t _minFreeHeap = UINT32_MAX;
+};
+
+extern EspClass ESP;
+
+
+////////////////////////////////////////////////////////
+///// FreeRTOS
+////////////////////////////////////////////////////////
+//
+// Tasks are std::threads, one tick is one millisecond.
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define pdFAIL  0
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+typedef void (*TaskFunction_t)(void*);
+
+struct NativeTask;
+typedef NativeTask* TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                       UBaseType_t priority, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t coreId);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xPortGetCoreID();
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+// Mutexes (plain and recursive) are a std::recursive_timed_mutex
+struct NativeMutex;
+typedef NativeMutex* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticksToWait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex);
+
+// Critical sections are a spinlock
+struct portMUX_TYPE {
+    volatile int owner;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+
+#define portENTER_CRITICAL(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)      vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)  vPortExitCritical(mux)
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,224 @@
+#include "LoRa_E32.h"
+
+
+////////////////////////////////////////////////////////
+///// Descriptions
+////////////////////////////////////////////////////////
+
+String Speed::getAirDataRate() {
+    switch (airDataRate) {
+        case AIR_DATA_RATE_000_03: return "0.3kbps";
+        case AIR_DATA_RATE_001_12: return "1.2kbps";
+        case AIR_DATA_RATE_010_24: return "2.4kbps (default)";
+        case AIR_DATA_RATE_011_48: return "4.8kbps";
+        case AIR_DATA_RATE_100_96: return "9.6kbps";
+        default:                   return "19.2kbps";
+    }
+}
+
+String Speed::getUARTBaudRate() {
+    static const char* rates[] = { "1200bps", "2400bps", "4800bps", "9600bps (default)",
+                                   "19200bps", "38400bps", "57600bps", "115200bps" };
+    return rates[uartBaudRate & 0x07];
+}
+
+String Speed::getUARTParityDescription() {
+    switch (uartParity) {
+        case MODE_01_8O1: return "8O1";
+        case MODE_10_8E1: return "8E1";
+        default:          return "8N1 (Default)";
+    }
+}
+
+String Option::getFixedTransmissionDescription() {
+    return fixedTransmission == FT_FIXED_TRANSMISSION ? "Fixed transmission" : "Transparent transmission (default)";
+}
+
+String Option::getIODroveModeDescription() {
+    return ioDriveMode == IO_D_MODE_PUSH_PULLS_PULL_UPS ? "TXD, RXD, AUX are push-pulls/pull-ups" : "TXD, RXD, AUX are open-collectors";
+}
+
+String Option::getWirelessWakeUPTimeDescription() {
+    return String((unsigned int)(250 * (wirelessWakeupTime + 1))) + "ms";
+}
+
+String Option::getFECDescription() {
+    return fec == FEC_1_ON ? "Turn on Forward Error Correction Switch (Default)" : "Turn off Forward Error Correction Switch";
+}
+
+String Option::getTransmissionPowerDescription() {
+    static const char* powers[] = { "30dBm (Default)", "27dBm", "24dBm", "21dBm" };
+    return powers[transmissionPower & 0x03];
+}
+
+String ResponseStatus::getResponseDescription() {
+    switch (code) {
+        case E32_SUCCESS:                       return "Success";
+        case ERR_E32_NOT_SUPPORT:               return "Not support!";
+        case ERR_E32_NOT_IMPLEMENT:             return "Not implement";
+        case ERR_E32_NOT_INITIAL:               return "Not initial!";
+        case ERR_E32_INVALID_PARAM:             return "Invalid param!";
+        case ERR_E32_DATA_SIZE_NOT_MATCH:       return "Data size not match!";
+        case ERR_E32_BUF_TOO_SMALL:             return "Buff too small!";
+        case ERR_E32_TIMEOUT:                   return "Timeout!!";
+        case ERR_E32_HARDWARE:                  return "Hardware error!";
+        case ERR_E32_HEAD_NOT_RECOGNIZED:       return "Save mode returned not recognized!";
+        case ERR_E32_NO_RESPONSE_FROM_DEVICE:   return "No response from device! (Check wiring)";
+        case ERR_E32_WRONG_UART_CONFIG:         return "Wrong UART configuration! (BPS must be 9600 for configuration)";
+        case ERR_E32_PACKET_TOO_BIG:            return "The device support only 58byte of data transmission!";
+        default:                                return "Invalid status!";
+    }
+}
+
+
+////////////////////////////////////////////////////////
+///// LoRa_E32
+////////////////////////////////////////////////////////
+
+LoRa_E32::LoRa_E32(HardwareSerial* serial, UART_BPS_RATE bpsRate)
+    : _serial(serial), _bpsRate(bpsRate)
+{
+}
+
+LoRa_E32::LoRa_E32(HardwareSerial* serial, byte auxPin, UART_BPS_RATE bpsRate)
+    : _serial(serial), _auxPin((int8_t)auxPin), _bpsRate(bpsRate)
+{
+}
+
+LoRa_E32::LoRa_E32(HardwareSerial* serial, byte auxPin, byte m0Pin, byte m1Pin, UART_BPS_RATE bpsRate)
+    : _serial(serial), _auxPin((int8_t)auxPin), _m0Pin((int8_t)m0Pin), _m1Pin((int8_t)m1Pin), _bpsRate(bpsRate)
+{
+}
+
+bool LoRa_E32::begin() {
+    if (_auxPin != -1) {
+        pinMode(_auxPin, INPUT);
+    }
+    if (_m0Pin != -1 && _m1Pin != -1) {
+        pinMode(_m0Pin, OUTPUT);
+        pinMode(_m1Pin, OUTPUT);
+        digitalWrite(_m0Pin, HIGH);
+        digitalWrite(_m1Pin, HIGH);
+    }
+    _serial->setTimeout(1000);
+    return setMode(MODE_0_NORMAL) == E32_SUCCESS;
+}
+
+Status LoRa_E32::setMode(MODE_TYPE mode) {
+    managedDelay(40);
+    if (_m0Pin == -1 && _m1Pin == -1) {
+        // Mode pins are driven by the caller
+        _mode = mode;
+        return E32_SUCCESS;
+    }
+    digitalWrite(_m0Pin, (mode & 0x01) ? HIGH : LOW);
+    digitalWrite(_m1Pin, (mode & 0x02) ? HIGH : LOW);
+    managedDelay(40);
+    _mode = mode;
+    return waitCompleteResponse(1000);
+}
+
+void LoRa_E32::managedDelay(unsigned long timeout) {
+    delay(timeout);
+}
+
+Status LoRa_E32::waitCompleteResponse(unsigned long timeout, unsigned int waitNoAux) {
+    if (_auxPin == -1) {
+        managedDelay(waitNoAux);
+        return E32_SUCCESS;
+    }
+    unsigned long start = millis();
+    while (digitalRead(_auxPin) == LOW) {
+        if (millis() - start > timeout) {
+            return ERR_E32_TIMEOUT;
+        }
+        delay(1);
+    }
+    // Module needs a little after AUX before taking commands
+    managedDelay(2);
+    return E32_SUCCESS;
+}
+
+void LoRa_E32::cleanUARTBuffer() {
+    while (_serial->available() > 0) {
+        _serial->read();
+    }
+}
+
+void LoRa_E32::writeProgramCommand(PROGRAM_COMMAND command) {
+    uint8_t cmd[3] = { (uint8_t)command, (uint8_t)command, (uint8_t)command };
+    _serial->write(cmd, sizeof(cmd));
+    managedDelay(50);
+}
+
+Status LoRa_E32::sendStruct(const void* structureManaged, uint16_t size) {
+    if (size > MAX_SIZE_TX_PACKET + 2) {
+        return ERR_E32_PACKET_TOO_BIG;
+    }
+    size_t written = _serial->write((const uint8_t*)structureManaged, size);
+    if (written != size) {
+        return written == 0 ? ERR_E32_NO_RESPONSE_FROM_DEVICE : ERR_E32_DATA_SIZE_NOT_MATCH;
+    }
+    return waitCompleteResponse(1000);
+}
+
+Status LoRa_E32::receiveStruct(void* structureManaged, uint16_t size) {
+    size_t length = _serial->readBytes((uint8_t*)structureManaged, size);
+    if (length != size) {
+        return length == 0 ? ERR_E32_NO_RESPONSE_FROM_DEVICE : ERR_E32_DATA_SIZE_NOT_MATCH;
+    }
+    return waitCompleteResponse(1000);
+}
+
+ResponseStructContainer LoRa_E32::getConfiguration() {
+    ResponseStructContainer rc;
+    rc.data = malloc(sizeof(Configuration));
+
+    cleanUARTBuffer();
+    writeProgramCommand(READ_CONFIGURATION);
+
+    rc.status.code = receiveStruct(rc.data, sizeof(Configuration));
+    if (rc.status.code == E32_SUCCESS && ((Configuration*)rc.data)->HEAD != WRITE_CFG_PWR_DWN_SAVE) {
+        rc.status.code = ERR_E32_HEAD_NOT_RECOGNIZED;
+    }
+    return rc;
+}
+
+ResponseStatus LoRa_E32::setConfiguration(Configuration configuration, PROGRAM_COMMAND saveType) {
+    ResponseStatus rc;
+    configuration.HEAD = saveType;
+
+    cleanUARTBuffer();
+    rc.code = sendStruct(&configuration, sizeof(Configuration));
+    if (rc.code != E32_SUCCESS) {
+        return rc;
+    }
+
+    // Module echoes the parameters back
+    rc.code = receiveStruct(&configuration, sizeof(Configuration));
+    if (rc.code == E32_SUCCESS && configuration.HEAD != saveType) {
+        rc.code = ERR_E32_HEAD_NOT_RECOGNIZED;
+    }
+    return rc;
+}
+
+ResponseStructContainer LoRa_E32::getModuleInformation() {
+    ResponseStructContainer rc;
+    rc.data = malloc(sizeof(ModuleInformation));
+
+    cleanUARTBuffer();
+    writeProgramCommand(READ_MODULE_VERSION);
+
+    rc.status.code = receiveStruct(rc.data, sizeof(ModuleInformation));
+    if (rc.status.code == E32_SUCCESS && ((ModuleInformation*)rc.data)->HEAD != READ_MODULE_VERSION) {
+        rc.status.code = ERR_E32_HEAD_NOT_RECOGNIZED;
+    }
+    return rc;
+}
+
+ResponseStatus LoRa_E32::resetModule() {
+    ResponseStatus rc;
+    writeProgramCommand(WRITE_RESET_MODULE);
+    rc.code = waitCompleteResponse(1000);
+    return rc;
+}
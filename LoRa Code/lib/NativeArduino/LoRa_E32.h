@@ -0,0 +1,220 @@
+#ifndef NATIVE_LORA_E32_H
+#define NATIVE_LORA_E32_H
+
+//Dependencies
+// Host build of the part of the xreef LoRa_E32 library used by LoRaConfig.
+// Same names, struct layout and command bytes, so the configuration
+// traffic on the virtual UART is byte for byte what the real library sends.
+#include <Arduino.h>
+
+#define MAX_SIZE_TX_PACKET 58
+
+enum Status {
+    E32_SUCCESS = 1,
+    ERR_E32_UNKNOWN,
+    ERR_E32_NOT_SUPPORT,
+    ERR_E32_NOT_IMPLEMENT,
+    ERR_E32_NOT_INITIAL,
+    ERR_E32_INVALID_PARAM,
+    ERR_E32_DATA_SIZE_NOT_MATCH,
+    ERR_E32_BUF_TOO_SMALL,
+    ERR_E32_TIMEOUT,
+    ERR_E32_HARDWARE,
+    ERR_E32_HEAD_NOT_RECOGNIZED,
+    ERR_E32_NO_RESPONSE_FROM_DEVICE,
+    ERR_E32_WRONG_UART_CONFIG,
+    ERR_E32_PACKET_TOO_BIG
+};
+
+enum MODE_TYPE {
+    MODE_0_NORMAL       = 0,
+    MODE_1_WAKE_UP      = 1,
+    MODE_2_POWER_SAVING = 2,
+    MODE_3_SLEEP        = 3,
+    MODE_3_PROGRAM      = 3,
+    MODE_INIT           = 0xFF
+};
+
+enum PROGRAM_COMMAND {
+    WRITE_CFG_PWR_DWN_SAVE  = 0xC0,
+    READ_CONFIGURATION      = 0xC1,
+    WRITE_CFG_PWR_DWN_LOSE  = 0xC2,
+    READ_MODULE_VERSION     = 0xC3,
+    WRITE_RESET_MODULE      = 0xC4
+};
+
+enum UART_BPS_RATE {
+    UART_BPS_RATE_1200   = 1200,
+    UART_BPS_RATE_2400   = 2400,
+    UART_BPS_RATE_4800   = 4800,
+    UART_BPS_RATE_9600   = 9600,
+    UART_BPS_RATE_19200  = 19200,
+    UART_BPS_RATE_38400  = 38400,
+    UART_BPS_RATE_57600  = 57600,
+    UART_BPS_RATE_115200 = 115200
+};
+
+enum UART_PARITY {
+    MODE_00_8N1 = 0b00,
+    MODE_01_8O1 = 0b01,
+    MODE_10_8E1 = 0b10,
+    MODE_11_8N1 = 0b11
+};
+
+enum UART_BPS_TYPE {
+    UART_BPS_1200   = 0b000,
+    UART_BPS_2400   = 0b001,
+    UART_BPS_4800   = 0b010,
+    UART_BPS_9600   = 0b011,
+    UART_BPS_19200  = 0b100,
+    UART_BPS_38400  = 0b101,
+    UART_BPS_57600  = 0b110,
+    UART_BPS_115200 = 0b111
+};
+
+enum AIR_DATA_RATE {
+    AIR_DATA_RATE_000_03  = 0b000,
+    AIR_DATA_RATE_001_12  = 0b001,
+    AIR_DATA_RATE_010_24  = 0b010,
+    AIR_DATA_RATE_011_48  = 0b011,
+    AIR_DATA_RATE_100_96  = 0b100,
+    AIR_DATA_RATE_101_192 = 0b101,
+    AIR_DATA_RATE_110_192 = 0b110,
+    AIR_DATA_RATE_111_192 = 0b111
+};
+
+enum FIDEX_TRANSMISSION {
+    FT_TRANSPARENT_TRANSMISSION = 0b0,
+    FT_FIXED_TRANSMISSION       = 0b1
+};
+
+enum IO_DRIVE_MODE {
+    IO_D_MODE_OPEN_COLLECTOR        = 0b0,
+    IO_D_MODE_PUSH_PULLS_PULL_UPS   = 0b1
+};
+
+enum WIRELESS_WAKE_UP_TIME {
+    WAKE_UP_250  = 0b000,
+    WAKE_UP_500  = 0b001,
+    WAKE_UP_750  = 0b010,
+    WAKE_UP_1000 = 0b011,
+    WAKE_UP_1250 = 0b100,
+    WAKE_UP_1500 = 0b101,
+    WAKE_UP_1750 = 0b110,
+    WAKE_UP_2000 = 0b111
+};
+
+enum FORWARD_ERROR_CORRECTION_SWITCH {
+    FEC_0_OFF = 0b0,
+    FEC_1_ON  = 0b1
+};
+
+// 1W module (E32_TTL_1W)
+enum TRANSMISSION_POWER {
+    POWER_30 = 0b00,
+    POWER_27 = 0b01,
+    POWER_24 = 0b10,
+    POWER_21 = 0b11
+};
+
+
+////////////////////////////////////////////////////////
+///// Register layout (GCC allocates bit fields from bit 0)
+////////////////////////////////////////////////////////
+
+struct Speed {
+    uint8_t airDataRate : 3;    // bit 0-2
+    uint8_t uartBaudRate : 3;   // bit 3-5
+    uint8_t uartParity : 2;     // bit 6-7
+
+    String getAirDataRate();
+    String getUARTBaudRate();
+    String getUARTParityDescription();
+};
+
+struct Option {
+    byte transmissionPower : 2;     // bit 0-1
+    byte fec : 1;                   // bit 2
+    byte wirelessWakeupTime : 3;    // bit 3-5
+    byte ioDriveMode : 1;           // bit 6
+    byte fixedTransmission : 1;     // bit 7
+
+    String getFixedTransmissionDescription();
+    String getIODroveModeDescription();
+    String getWirelessWakeUPTimeDescription();
+    String getFECDescription();
+    String getTransmissionPowerDescription();
+};
+
+struct Configuration {
+    byte HEAD = 0;
+    byte ADDH = 0;
+    byte ADDL = 0;
+    struct Speed SPED;
+    byte CHAN = 0;
+    struct Option OPTION;
+};
+
+struct ModuleInformation {
+    byte HEAD = 0;
+    byte frequency = 0;
+    byte version = 0;
+    byte features = 0;
+};
+
+struct ResponseStatus {
+    Status code;
+    String getResponseDescription();
+};
+
+struct ResponseStructContainer {
+    void* data;
+    ResponseStatus status;
+    void close() { if (data != nullptr) { free(data); data = nullptr; } }
+};
+
+struct ResponseContainer {
+    String data;
+    ResponseStatus status;
+};
+
+
+/**
+ * @brief Configuration client for an E32 module on a HardwareSerial
+ */
+class LoRa_E32 {
+    public:
+        LoRa_E32(HardwareSerial* serial, UART_BPS_RATE bpsRate = UART_BPS_RATE_9600);
+        LoRa_E32(HardwareSerial* serial, byte auxPin, UART_BPS_RATE bpsRate = UART_BPS_RATE_9600);
+        LoRa_E32(HardwareSerial* serial, byte auxPin, byte m0Pin, byte m1Pin, UART_BPS_RATE bpsRate = UART_BPS_RATE_9600);
+
+        bool begin();
+
+        // Only drives the pins when M0/M1 were given to the constructor
+        Status setMode(MODE_TYPE mode);
+        MODE_TYPE getMode() const { return _mode; }
+
+        ResponseStructContainer getConfiguration();
+        ResponseStatus setConfiguration(Configuration configuration, PROGRAM_COMMAND saveType = WRITE_CFG_PWR_DWN_LOSE);
+        ResponseStructContainer getModuleInformation();
+        ResponseStatus resetModule();
+
+        int available() { return _serial->available(); }
+        void cleanUARTBuffer();
+
+    private:
+        HardwareSerial* _serial;
+        int8_t _auxPin = -1;
+        int8_t _m0Pin = -1;
+        int8_t _m1Pin = -1;
+        UART_BPS_RATE _bpsRate;
+        MODE_TYPE _mode = MODE_0_NORMAL;
+
+        void writeProgramCommand(PROGRAM_COMMAND command);
+        Status sendStruct(const void* structureManaged, uint16_t size);
+        Status receiveStruct(void* structureManaged, uint16_t size);
+        Status waitCompleteResponse(unsigned long timeout = 1000, unsigned int waitNoAux = 100);
+        void managedDelay(unsigned long timeout);
+};
+
+#endif // NATIVE_LORA_E32_H
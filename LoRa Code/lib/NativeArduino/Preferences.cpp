@@ -0,0 +1,105 @@
+#include "Preferences.h"
+#include <map>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t> > Namespace;
+
+static std::mutex nvsLock;
+static std::map<std::string, Namespace> nvs;
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partitionLabel) {
+    (void)partitionLabel;
+    if (_started) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(nvsLock);
+    if (readOnly && nvs.find(name) == nvs.end()) {
+        return false;
+    }
+    nvs[name];
+    _name = name;
+    _readOnly = readOnly;
+    _started = true;
+    return true;
+}
+
+void Preferences::end() {
+    _started = false;
+}
+
+bool Preferences::clear() {
+    if (!_started || _readOnly) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(nvsLock);
+    nvs[_name].clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!_started || _readOnly) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(nvsLock);
+    return nvs[_name].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    if (!_started) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(nvsLock);
+    Namespace& space = nvs[_name];
+    return space.find(key) != space.end();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (!_started || _readOnly || key == nullptr || value == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(nvsLock);
+    const uint8_t* bytes = (const uint8_t*)value;
+    nvs[_name][key].assign(bytes, bytes + length);
+    return length;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    if (!_started || key == nullptr || buffer == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(nvsLock);
+    Namespace& space = nvs[_name];
+    Namespace::iterator it = space.find(key);
+    // NVS refuses to truncate a blob
+    if (it == space.end() || it->second.size() > maxLength) {
+        return 0;
+    }
+    memcpy(buffer, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!_started || key == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(nvsLock);
+    Namespace& space = nvs[_name];
+    Namespace::iterator it = space.find(key);
+    return it == space.end() ? 0 : it->second.size();
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+    uint8_t value = defaultValue;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t value = defaultValue;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+void Preferences::eraseAll() {
+    std::lock_guard<std::mutex> guard(nvsLock);
+    nvs.clear();
+}
@@ -0,0 +1,49 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+//Dependencies
+#include <Arduino.h>
+
+
+/**
+ * @brief In-memory stand-in for the ESP32 NVS Preferences
+ *
+ * Namespaces live for the whole process, so a second LoRa object (or a
+ * second begin()) sees what the first one stored, like a warm boot.
+ */
+class Preferences {
+    public:
+        Preferences() {}
+        ~Preferences() { end(); }
+
+        // Read-only begin fails when the namespace was never written, like NVS
+        bool begin(const char* name, bool readOnly = false, const char* partitionLabel = NULL);
+        void end();
+
+        bool clear();
+        bool remove(const char* key);
+        bool isKey(const char* key);
+
+        size_t putBytes(const char* key, const void* value, size_t length);
+        size_t getBytes(const char* key, void* buffer, size_t maxLength);
+        size_t getBytesLength(const char* key);
+
+        size_t putBool(const char* key, bool value) { return putUChar(key, value ? 1 : 0); }
+        bool getBool(const char* key, bool defaultValue = false) { return getUChar(key, defaultValue ? 1 : 0) != 0; }
+
+        size_t putUChar(const char* key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+        uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+
+        size_t putUInt(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+        uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+
+        // Wipe every namespace (a blank flash)
+        static void eraseAll();
+
+    private:
+        std::string _name;
+        bool _started = false;
+        bool _readOnly = false;
+};
+
+#endif // NATIVE_PREFERENCES_H
@@ -0,0 +1,161 @@
+#include "NodeTable.h"
+#include <string.h>
+
+static_assert(NODE_RECENT_WINDOW <= 32, "Recent sequences are a 32 bit mask");
+
+
+////////////////////////////////////////////////////////
+///// Node header
+////////////////////////////////////////////////////////
+
+bool hasNodeHeader(const uint8_t* data, size_t length) {
+    return length > NODE_HEADER_SIZE && data[0] == NODE_MAGIC;
+}
+
+uint16_t nodeHeaderId(const uint8_t* data) {
+    return ((uint16_t)data[1] << 8) | data[2];
+}
+
+size_t writeNodeHeader(uint8_t* out, uint16_t node, uint8_t sequence) {
+    out[0] = NODE_MAGIC;
+    out[1] = node >> 8;
+    out[2] = node & 0xFF;
+    out[3] = sequence;
+    return NODE_HEADER_SIZE;
+}
+
+
+////////////////////////////////////////////////////////
+///// NodeTable
+////////////////////////////////////////////////////////
+
+NodeTable::NodeTable() {
+    clear();
+}
+
+void NodeTable::clear() {
+    memset(_entries, 0, sizeof(_entries));
+    _stats = {};
+}
+
+bool NodeTable::accept(const uint8_t* frame, size_t length, uint32_t now, NodeFrame* out) {
+    if (!hasNodeHeader(frame, length)) {
+        return false;
+    }
+
+    out->node = nodeHeaderId(frame);
+    out->sequence = frame[3];
+    out->missed = 0;
+    out->payload = frame + NODE_HEADER_SIZE;
+    out->length = length - NODE_HEADER_SIZE;
+    _stats.frames++;
+
+    int index = lookup(out->node);
+    if (index < 0) {
+        out->entry = nullptr;
+        out->verdict = NODE_UNTRACKED;
+        _stats.untracked++;
+        return true;
+    }
+    NodeEntry* entry = &_entries[index];
+    out->entry = entry;
+
+    if (!entry->used) {
+        entry->used = 1;
+        entry->id = out->node;
+        entry->lastSequence = out->sequence;
+        entry->lastSeen = now;
+        entry->received = 1;
+        out->verdict = NODE_FIRST;
+        _stats.nodes++;
+        uint16_t probes = ((index - home(out->node)) & (NODE_TABLE_SLOTS - 1)) + 1;
+        if (probes > _stats.maxProbes) {
+            _stats.maxProbes = probes;
+        }
+        return true;
+    }
+
+    out->verdict = track(*entry, out->sequence, now, &out->missed);
+    if (out->verdict == NODE_DUPLICATE) {
+        _stats.duplicates++;
+    }
+    else if (out->verdict == NODE_GAP) {
+        _stats.gaps++;
+    }
+    return true;
+}
+
+NodeVerdict NodeTable::track(NodeEntry& entry, uint8_t sequence, uint32_t now, uint8_t* missed) {
+    uint8_t ahead = sequence - entry.lastSequence;
+    bool recent = now - entry.lastSeen < NODE_DUPLICATE_MS;
+
+    if (ahead == 0 || ahead >= 128) {
+        // Going back: a copy or a late frame, unless the node rebooted meanwhile
+        uint8_t behind = entry.lastSequence - sequence;
+        if (recent && behind <= NODE_RECENT_WINDOW) {
+            uint32_t bit = behind == 0 ? 0 : 1UL << (behind - 1);
+            if (behind == 0 || (entry.recent & bit)) {
+                entry.duplicates++;
+                return NODE_DUPLICATE;
+            }
+            entry.recent |= bit;
+            entry.received++;
+            entry.lastSeen = now;
+            if (entry.lost > 0) {
+                entry.lost--;
+            }
+            return NODE_LATE;
+        }
+
+        entry.lastSequence = sequence;
+        entry.recent = 0;
+        entry.received++;
+        entry.restarts++;
+        entry.lastSeen = now;
+        return NODE_RESTART;
+    }
+
+    // Newer: the previous newest and everything behind it shift by ahead
+    if (ahead > NODE_RECENT_WINDOW) {
+        entry.recent = 0;
+    }
+    else {
+        entry.recent = (ahead == 32 ? 0 : entry.recent << ahead) | (1UL << (ahead - 1));
+    }
+    entry.lastSequence = sequence;
+    entry.received++;
+    entry.lastSeen = now;
+
+    *missed = ahead - 1;
+    entry.lost += *missed;
+    return *missed > 0 ? NODE_GAP : NODE_IN_ORDER;
+}
+
+uint32_t NodeTable::home(uint16_t node) {
+    // Fibonacci hashing, the top bits of the product spread consecutive ids over the table
+    return (uint32_t)(node * 2654435769UL) >> (32 - NODE_TABLE_BITS);
+}
+
+int NodeTable::lookup(uint16_t node) const {
+    uint32_t index = home(node);
+    for (uint16_t probe = 0; probe < NODE_TABLE_SLOTS; probe++) {
+        const NodeEntry& entry = _entries[index];
+        if (!entry.used || entry.id == node) {
+            return (int)index;
+        }
+        index = (index + 1) & (NODE_TABLE_SLOTS - 1);
+    }
+    return -1;
+}
+
+const NodeEntry* NodeTable::find(uint16_t node) const {
+    int index = lookup(node);
+    return index >= 0 && _entries[index].used ? &_entries[index] : nullptr;
+}
+
+const NodeEntry* NodeTable::slot(size_t index) const {
+    if (index >= NODE_TABLE_SLOTS || !_entries[index].used) {
+        return nullptr;
+    }
+    return &_entries[index];
+}
@@ -0,0 +1,139 @@
+#ifndef NODETABLE_H
+#define NODETABLE_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+
+
+////////////////////////////////////////////////////////
+///// Node header
+////////////////////////////////////////////////////////
+//
+//  byte 0 : magic (0xD7)
+//  byte 1 : node id (16 bit, big endian like ADDH/ADDL)
+//  byte 3 : sequence, one per frame the node sends
+//  byte 4+: the frame (batch, telemetry, ...)
+//
+// The E32 does not tell the receiver who sent a packet, so every buoy puts
+// its id in front of its frames and a gateway can keep apart hundreds of
+// them on one channel.
+
+#define NODE_MAGIC              0xD7
+#define NODE_HEADER_SIZE        4
+
+#define NODE_TABLE_BITS         9
+#define NODE_TABLE_SLOTS        (1 << NODE_TABLE_BITS)  // Keep it about twice the number of buoys
+#define NODE_RECENT_WINDOW      32      // Sequences behind the newest checked for duplicates
+#define NODE_DUPLICATE_MS       60000   // Older than this, a sequence going back is a reboot
+
+// True if a received frame starts with a node header
+bool hasNodeHeader(const uint8_t* data, size_t length);
+
+// Node id of a frame starting with a node header
+uint16_t nodeHeaderId(const uint8_t* data);
+
+/**
+ * @brief Write the node header in front of a frame
+ *
+ * @param out At least NODE_HEADER_SIZE bytes, the frame goes right after
+ * @param node Node id
+ * @param sequence Frame number of this node
+ * @return size_t NODE_HEADER_SIZE
+ */
+size_t writeNodeHeader(uint8_t* out, uint16_t node, uint8_t sequence);
+
+
+// What a frame means for its node
+enum NodeVerdict : uint8_t {
+    NODE_FIRST,         // First frame heard from this node
+    NODE_IN_ORDER,      // Next sequence
+    NODE_GAP,           // Frames missing right before this one (NodeFrame::missed)
+    NODE_LATE,          // Out of order, fills an earlier gap
+    NODE_DUPLICATE,     // Already received, drop it
+    NODE_RESTART,       // Sequence went back (node rebooted), tracking starts over
+    NODE_UNTRACKED      // Table full, delivered without checks
+};
+
+/**
+ * @brief Per-node state, 24 bytes
+ */
+struct NodeEntry {
+    uint16_t id;
+    uint8_t lastSequence;   // Newest sequence received
+    uint8_t used;
+    uint32_t recent;        // Bit i = lastSequence - 1 - i received
+    uint32_t lastSeen;      // ms
+    uint32_t received;
+    uint32_t lost;          // Missing sequences, less the ones that came late
+    uint16_t duplicates;
+    uint16_t restarts;
+};
+
+/**
+ * @brief A received frame once its node header is checked
+ */
+struct NodeFrame {
+    uint16_t node;
+    uint8_t sequence;
+    NodeVerdict verdict;
+    uint8_t missed;             // NODE_GAP: frames missing before this one
+    const uint8_t* payload;     // Frame after the node header
+    size_t length;
+    const NodeEntry* entry;     // nullptr when NODE_UNTRACKED
+};
+
+/**
+ * @brief Table counters
+ */
+struct NodeTableStats {
+    uint32_t frames;        // Frames with a node header
+    uint32_t duplicates;    // Dropped
+    uint32_t gaps;          // Frames flagged NODE_GAP
+    uint32_t untracked;     // Frames of nodes that did not fit in the table
+    uint16_t nodes;         // Nodes in the table
+    uint16_t maxProbes;     // Longest probe sequence seen
+};
+
+
+/**
+ * @brief Flat open addressing table of the nodes heard, constant time per frame
+ *
+ * Linear probing from a multiplicative hash of the id. Nodes are never
+ * removed: a buoy that went quiet keeps its slot and counters.
+ */
+class NodeTable {
+    public:
+        NodeTable();
+
+        /**
+         * @brief Check a received frame against its node's state
+         *
+         * @param frame Received bytes
+         * @param length Number of received bytes
+         * @param now Time in ms
+         * @param out Filled with the node, verdict and the frame after the header
+         * @return false No node header, the frame is left to the caller as is
+         */
+        bool accept(const uint8_t* frame, size_t length, uint32_t now, NodeFrame* out);
+
+        const NodeEntry* find(uint16_t node) const;
+
+        // Walk the table: slots 0..capacity()-1, nullptr for empty ones
+        const NodeEntry* slot(size_t index) const;
+        size_t capacity() const { return NODE_TABLE_SLOTS; }
+
+        NodeTableStats stats() const { return _stats; }
+
+        void clear();
+
+    private:
+        NodeEntry _entries[NODE_TABLE_SLOTS];
+        NodeTableStats _stats = {};
+
+        static uint32_t home(uint16_t node);
+        int lookup(uint16_t node) const;    // Slot holding the node or the empty one it would take, -1 if full
+        NodeVerdict track(NodeEntry& entry, uint8_t sequence, uint32_t now, uint8_t* missed);
+};
+
+#endif // NODETABLE_H
@@ -0,0 +1,418 @@
+#include "PacketFec.h"
+#include <string.h>
+
+static_assert(FEC_MAX_K <= 16 && FEC_MAX_M <= 16, "k and m share one header byte");
+
+
+////////////////////////////////////////////////////////
+///// GF(2^8) arithmetic
+////////////////////////////////////////////////////////
+
+// Polynomial x^8 + x^4 + x^3 + x^2 + 1, exp table doubled so log sums need no modulo
+static uint8_t gfExp[512];
+static uint8_t gfLog[256];
+static bool gfReady = false;
+
+static void gfInit() {
+    if (gfReady) {
+        return;
+    }
+    uint16_t x = 1;
+    for (uint16_t i = 0; i < 255; i++) {
+        gfExp[i] = (uint8_t)x;
+        gfLog[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= 0x11D;
+        }
+    }
+    for (uint16_t i = 255; i < 512; i++) {
+        gfExp[i] = gfExp[i - 255];
+    }
+    gfReady = true;
+}
+
+static inline uint8_t gfMul(uint8_t a, uint8_t b) {
+    return (a == 0 || b == 0) ? 0 : gfExp[gfLog[a] + gfLog[b]];
+}
+
+static inline uint8_t gfInv(uint8_t a) {
+    return gfExp[255 - gfLog[a]];
+}
+
+// Cauchy matrix entry 1 / (x_j + y_i), x_j = 16 + j and y_i = i never collide
+static inline uint8_t coefficient(uint8_t parity, uint8_t data) {
+    return gfInv((uint8_t)((16 + parity) ^ data));
+}
+
+// dst ^= c * src over length bytes
+static void mulAdd(uint8_t* dst, const uint8_t* src, uint8_t c, size_t length) {
+    if (c == 0) {
+        return;
+    }
+    uint8_t logC = gfLog[c];
+    for (size_t i = 0; i < length; i++) {
+        if (src[i] != 0) {
+            dst[i] ^= gfExp[gfLog[src[i]] + logC];
+        }
+    }
+}
+
+static void scale(uint8_t* row, uint8_t c, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        row[i] = gfMul(row[i], c);
+    }
+}
+
+static uint8_t popcount(uint32_t v) {
+    uint8_t n = 0;
+    for (; v; v &= v - 1) {
+        n++;
+    }
+    return n;
+}
+
+
+////////////////////////////////////////////////////////
+///// Helpers
+////////////////////////////////////////////////////////
+
+bool isFec(const uint8_t* data, size_t length) {
+    if (length <= FEC_HEADER_SIZE || data[0] != FEC_MAGIC) {
+        return false;
+    }
+    uint8_t index = data[2];
+    bool valid = (index & FEC_PARITY_FLAG) ? (index & 0x7F) < FEC_MAX_M : index < FEC_MAX_K;
+    return valid && (data[3] >> 4) > 0;
+}
+
+
+////////////////////////////////////////////////////////
+///// FecEncoder
+////////////////////////////////////////////////////////
+
+FecEncoder::FecEncoder(uint8_t k, uint8_t m) {
+    gfInit();
+    setRedundancy(k, m);
+    startGroup();
+}
+
+void FecEncoder::setRedundancy(uint8_t k, uint8_t m) {
+    _nextK = k == 0 ? 1 : (k > FEC_MAX_K ? FEC_MAX_K : k);
+    _nextM = m > FEC_MAX_M ? FEC_MAX_M : m;
+}
+
+void FecEncoder::startGroup() {
+    _k = _nextK;
+    _m = _nextM;
+    _count = 0;
+    _sent = 0;
+    _paritySent = 0;
+    _symbolLength = 0;
+    _closed = false;
+}
+
+bool FecEncoder::add(const uint8_t* data, size_t size) {
+    if (size > FEC_PAYLOAD) {
+        return false;
+    }
+    if (_closed) {
+        if (pending()) {
+            return false;
+        }
+        _group++;
+        startGroup();
+    }
+
+    uint8_t* symbol = _symbols[_count];
+    symbol[0] = (uint8_t)size;
+    memcpy(symbol + 1, data, size);
+    _lengths[_count] = (uint8_t)(size + 1);
+    if (_lengths[_count] > _symbolLength) {
+        _symbolLength = _lengths[_count];
+    }
+
+    if (++_count == _k) {
+        close();
+    }
+    return true;
+}
+
+void FecEncoder::flush() {
+    if (!_closed && _count > 0) {
+        close();
+    }
+}
+
+void FecEncoder::close() {
+    for (uint8_t j = 0; j < _m; j++) {
+        memset(_parity[j], 0, _symbolLength);
+        for (uint8_t i = 0; i < _count; i++) {
+            // Shorter symbols count as zero padded
+            mulAdd(_parity[j], _symbols[i], coefficient(j, i), _lengths[i]);
+        }
+    }
+    _closed = true;
+}
+
+size_t FecEncoder::next(uint8_t* out, size_t capacity) {
+    const uint8_t* symbol;
+    size_t length;
+    uint8_t index;
+
+    if (_sent < _count) {
+        index = _sent;
+        symbol = _symbols[_sent];
+        length = _lengths[_sent];
+    }
+    else if (_closed && _paritySent < _m) {
+        index = FEC_PARITY_FLAG | _paritySent;
+        symbol = _parity[_paritySent];
+        length = _symbolLength;
+    }
+    else {
+        return 0;
+    }
+
+    if (capacity < FEC_HEADER_SIZE + length) {
+        return 0;
+    }
+
+    out[0] = FEC_MAGIC;
+    out[1] = _group;
+    out[2] = index;
+    // Parity frames carry the final data count, a flushed group is shorter than k
+    out[3] = ((_closed ? _count : _k) << 4) | _m;
+    memcpy(out + FEC_HEADER_SIZE, symbol, length);
+
+    if (index & FEC_PARITY_FLAG) {
+        _paritySent++;
+    } else {
+        _sent++;
+    }
+    return FEC_HEADER_SIZE + length;
+}
+
+
+////////////////////////////////////////////////////////
+///// FecDecoder
+////////////////////////////////////////////////////////
+
+FecDecoder::FecDecoder() {
+    gfInit();
+    for (uint8_t i = 0; i < FEC_GROUPS; i++) {
+        _groups[i].used = false;
+    }
+}
+
+FecDecoder::Group* FecDecoder::findGroup(uint8_t id) {
+    Group* newest = nullptr;
+    Group* slot = nullptr;
+
+    for (uint8_t i = 0; i < FEC_GROUPS; i++) {
+        Group& group = _groups[i];
+        if (!group.used) {
+            slot = (slot == nullptr || slot->used) ? &group : slot;
+            continue;
+        }
+        if (group.id == id) {
+            return &group;
+        }
+        if (newest == nullptr || group.age > newest->age) {
+            newest = &group;
+        }
+        if (slot == nullptr || (slot->used && group.age < slot->age)) {
+            slot = &group;
+        }
+    }
+
+    // Late frame of a group already replaced (a far older id means the sender restarted)
+    if (newest != nullptr) {
+        int8_t behind = (int8_t)(id - newest->id);
+        if (behind < 0 && behind > -16) {
+            return nullptr;
+        }
+    }
+
+    retire(*slot);
+    slot->used = true;
+    slot->id = id;
+    slot->k = 0;
+    slot->m = 0;
+    slot->dataMask = 0;
+    slot->deliveredMask = 0;
+    slot->parityMask = 0;
+    slot->symbolLength = 0;
+    slot->age = ++_age;
+    return slot;
+}
+
+void FecDecoder::retire(Group& group) {
+    if (group.used && group.k > 0) {
+        uint32_t all = (1UL << group.k) - 1;
+        _stats.lost += popcount(all & ~group.dataMask);
+    }
+    group.used = false;
+}
+
+bool FecDecoder::accept(const uint8_t* frame, size_t length) {
+    if (!isFec(frame, length)) {
+        return false;
+    }
+
+    uint8_t index = frame[2];
+    const uint8_t* symbol = frame + FEC_HEADER_SIZE;
+    size_t symbolLength = length - FEC_HEADER_SIZE;
+    if (symbolLength > FEC_SYMBOL_MAX) {
+        return true;
+    }
+
+    Group* group = findGroup(frame[1]);
+    if (group == nullptr) {
+        return true;
+    }
+
+    if (index & FEC_PARITY_FLAG) {
+        uint8_t j = index & 0x7F;
+        if (group->parityMask & (1UL << j)) {
+            return true;
+        }
+        memcpy(group->parity[j], symbol, symbolLength);
+        group->parityMask |= (1UL << j);
+        group->k = frame[3] >> 4;
+        group->m = frame[3] & 0x0F;
+        _stats.parity++;
+    }
+    else {
+        if ((group->dataMask & (1UL << index)) || symbol[0] + 1u != symbolLength) {
+            return true; // Duplicate or inconsistent length
+        }
+        memcpy(group->data[index], symbol, symbolLength);
+        group->lengths[index] = (uint8_t)symbolLength;
+        group->dataMask |= (1UL << index);
+        _stats.received++;
+    }
+    if (symbolLength > group->symbolLength) {
+        group->symbolLength = (uint8_t)symbolLength;
+    }
+
+    recover(*group);
+    return true;
+}
+
+void FecDecoder::recover(Group& group) {
+    if (group.k == 0 || group.k > FEC_MAX_K) {
+        return;
+    }
+    uint32_t missing = ((1UL << group.k) - 1) & ~group.dataMask;
+    uint8_t erasures = popcount(missing);
+    if (erasures == 0 || erasures > popcount(group.parityMask)) {
+        return;
+    }
+
+    // Pick as many parity rows as there are erasures and strip the known data out of them
+    uint8_t rows[FEC_MAX_M][FEC_SYMBOL_MAX];
+    uint8_t matrix[FEC_MAX_M][FEC_MAX_M];
+    uint8_t lost[FEC_MAX_M];
+    size_t length = group.symbolLength;
+
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < group.k; i++) {
+        if (missing & (1UL << i)) {
+            lost[n++] = i;
+        }
+    }
+
+    uint8_t r = 0;
+    for (uint8_t j = 0; j < FEC_MAX_M && r < erasures; j++) {
+        if (!(group.parityMask & (1UL << j))) {
+            continue;
+        }
+        memcpy(rows[r], group.parity[j], length);
+        for (uint8_t i = 0; i < group.k; i++) {
+            if (group.dataMask & (1UL << i)) {
+                mulAdd(rows[r], group.data[i], coefficient(j, i), group.lengths[i]);
+            }
+        }
+        for (uint8_t c = 0; c < erasures; c++) {
+            matrix[r][c] = coefficient(j, lost[c]);
+        }
+        r++;
+    }
+
+    // Gauss-Jordan, any square Cauchy submatrix is invertible
+    for (uint8_t c = 0; c < erasures; c++) {
+        uint8_t pivot = c;
+        while (pivot < erasures && matrix[pivot][c] == 0) {
+            pivot++;
+        }
+        if (pivot == erasures) {
+            return;
+        }
+        if (pivot != c) {
+            uint8_t tmp[FEC_SYMBOL_MAX];
+            memcpy(tmp, rows[c], length);
+            memcpy(rows[c], rows[pivot], length);
+            memcpy(rows[pivot], tmp, length);
+            for (uint8_t x = 0; x < erasures; x++) {
+                uint8_t t = matrix[c][x];
+                matrix[c][x] = matrix[pivot][x];
+                matrix[pivot][x] = t;
+            }
+        }
+
+        uint8_t inverse = gfInv(matrix[c][c]);
+        scale(matrix[c], inverse, erasures);
+        scale(rows[c], inverse, length);
+
+        for (uint8_t other = 0; other < erasures; other++) {
+            uint8_t factor = matrix[other][c];
+            if (other == c || factor == 0) {
+                continue;
+            }
+            mulAdd(matrix[other], matrix[c], factor, erasures);
+            mulAdd(rows[other], rows[c], factor, length);
+        }
+    }
+
+    for (uint8_t c = 0; c < erasures; c++) {
+        uint8_t size = rows[c][0];
+        if (size > FEC_PAYLOAD || size + 1u > length) {
+            continue; // Parity did not match, nothing to trust
+        }
+        uint8_t i = lost[c];
+        memcpy(group.data[i], rows[c], size + 1);
+        group.lengths[i] = size + 1;
+        group.dataMask |= (1UL << i);
+        _stats.recovered++;
+    }
+}
+
+size_t FecDecoder::read(uint8_t* buf, size_t cap) {
+    // Oldest group first, then by index
+    Group* oldest = nullptr;
+    for (uint8_t g = 0; g < FEC_GROUPS; g++) {
+        Group& group = _groups[g];
+        if (group.used && (group.dataMask & ~group.deliveredMask)
+            && (oldest == nullptr || group.age < oldest->age)) {
+            oldest = &group;
+        }
+    }
+    if (oldest == nullptr) {
+        return 0;
+    }
+
+    uint32_t ready = oldest->dataMask & ~oldest->deliveredMask;
+    uint8_t i = 0;
+    while (!(ready & (1UL << i))) {
+        i++;
+    }
+    oldest->deliveredMask |= (1UL << i);
+
+    size_t size = oldest->data[i][0];
+    if (size > cap) {
+        size = cap;
+    }
+    memcpy(buf, oldest->data[i] + 1, size);
+    return size;
+}
@@ -0,0 +1,157 @@
+#ifndef PACKETFEC_H
+#define PACKETFEC_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaFrame.h"
+
+
+////////////////////////////////////////////////////////
+///// Frame format
+////////////////////////////////////////////////////////
+//
+//  byte 0 : magic (0xEC)
+//  byte 1 : group id
+//  byte 2 : index, 0..k-1 for data, 0x80 | j for parity j
+//  byte 3 : k (high nibble) | m (low nibble), final once a parity frame carries it
+//  byte 4+: symbol = payload length, payload (parity: coded over zero padded symbols)
+//
+// Systematic Reed-Solomon erasure code over GF(2^8) with a Cauchy matrix:
+// data frames go out untouched as soon as they are given, then m parity
+// frames per group of k. Any k of the k + m frames rebuild the group, so up
+// to m lost packets are recovered wherever they fall in the group, a fade
+// wiping out m packets in a row included. The E32 FEC_1_ON only fixes bit
+// errors inside a packet that was heard at all.
+
+#define FEC_MAGIC               0xEC
+#define FEC_HEADER_SIZE         4
+#define FEC_SYMBOL_MAX          (LORA_PAYLOAD_MAX - FEC_HEADER_SIZE)
+#define FEC_PAYLOAD             (FEC_SYMBOL_MAX - 1)
+
+#define FEC_PARITY_FLAG         0x80
+#define FEC_MAX_K               15
+#define FEC_MAX_M               8
+#define FEC_GROUPS              2       // Groups rebuilt at the same time (late frames of the previous one)
+
+// True if a received frame is a FEC data or parity frame
+bool isFec(const uint8_t* data, size_t length);
+
+
+/**
+ * @brief Counters of the decoding side
+ */
+struct FecStats {
+    uint32_t received;      // Data frames heard directly
+    uint32_t parity;        // Parity frames heard
+    uint32_t recovered;     // Data frames rebuilt from parity
+    uint32_t lost;          // Data frames of groups that could not be rebuilt
+};
+
+
+/**
+ * @brief Adds m parity frames to every group of k data frames
+ */
+class FecEncoder {
+    public:
+        // k data frames per group (1-15), m parity frames (0-8), redundancy = m / k
+        FecEncoder(uint8_t k = 4, uint8_t m = 2);
+
+        // Takes effect with the next group
+        void setRedundancy(uint8_t k, uint8_t m);
+
+        /**
+         * @brief Add one payload to the current group
+         *
+         * @param data Payload
+         * @param size At most FEC_PAYLOAD bytes
+         * @return false Too big, or the previous group's frames are not all out yet
+         */
+        bool add(const uint8_t* data, size_t size);
+
+        // Close a partial group now (parity over the frames it has), e.g. on a timeout
+        void flush();
+
+        /**
+         * @brief Write the next frame to send
+         *
+         * @param out Output buffer, LORA_PAYLOAD_MAX bytes is always enough
+         * @param capacity Size of the output buffer
+         * @return size_t Frame length, 0 if nothing to send
+         */
+        size_t next(uint8_t* out, size_t capacity);
+
+        bool pending() const { return _sent < _count || (_closed && _paritySent < _m); }
+        uint8_t groupFill() const { return _closed ? 0 : _count; }
+
+    private:
+        uint8_t _k;
+        uint8_t _m;
+        uint8_t _nextK;
+        uint8_t _nextM;
+
+        uint8_t _symbols[FEC_MAX_K][FEC_SYMBOL_MAX];
+        uint8_t _lengths[FEC_MAX_K];
+        uint8_t _parity[FEC_MAX_M][FEC_SYMBOL_MAX];
+        uint8_t _symbolLength = 0;      // Longest symbol of the group, parity length
+
+        uint8_t _group = 0;
+        uint8_t _count = 0;             // Data frames in the group
+        uint8_t _sent = 0;              // Data frames written out
+        uint8_t _paritySent = 0;
+        bool _closed = false;           // Parity computed, group waits for next() to drain it
+
+        void close();
+        void startGroup();
+};
+
+
+/**
+ * @brief Delivers data frames as they arrive and rebuilds lost ones from parity
+ *
+ * Rebuilt payloads come out after the ones that arrived directly.
+ */
+class FecDecoder {
+    public:
+        FecDecoder();
+
+        /**
+         * @brief Feed one received frame
+         *
+         * @param frame Received bytes
+         * @param length Number of received bytes
+         * @return false Not a FEC frame
+         */
+        bool accept(const uint8_t* frame, size_t length);
+
+        // Next payload, 0 if none (extra bytes are dropped)
+        size_t read(uint8_t* buf, size_t cap);
+
+        FecStats stats() const { return _stats; }
+
+    private:
+        struct Group {
+            bool used;
+            uint8_t id;
+            uint8_t k;                  // 0 until a parity frame tells
+            uint8_t m;
+            uint32_t dataMask;          // Bit i = data symbol i present
+            uint32_t deliveredMask;     // Bit i = payload i handed to read()
+            uint32_t parityMask;
+            uint8_t symbolLength;       // Longest symbol seen
+            uint8_t lengths[FEC_MAX_K];
+            uint8_t data[FEC_MAX_K][FEC_SYMBOL_MAX];
+            uint8_t parity[FEC_MAX_M][FEC_SYMBOL_MAX];
+            uint32_t age;               // Order of creation, oldest is replaced
+        };
+
+        Group _groups[FEC_GROUPS];
+        uint32_t _age = 0;
+        FecStats _stats = {};
+
+        Group* findGroup(uint8_t id);
+        void retire(Group& group);
+        void recover(Group& group);
+};
+
+#endif // PACKETFEC_H
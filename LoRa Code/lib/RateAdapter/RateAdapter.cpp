@@ -0,0 +1,417 @@
+#include "RateAdapter.h"
+
+
+////////////////////////////////////////////////////////
+///// Control frames
+////////////////////////////////////////////////////////
+
+size_t encodeRateCtrl(const RateCtrlFrame& frame, uint8_t* out, size_t capacity) {
+    if (capacity < RATE_CTRL_SIZE) {
+        return 0;
+    }
+    out[0] = RATE_CTRL_MAGIC;
+    out[1] = frame.type;
+    out[2] = frame.rate;
+    out[3] = frame.token;
+    for (uint8_t i = 0; i < 4; i++) {
+        out[4 + i] = (frame.bitmap >> (8 * i)) & 0xFF;
+    }
+    return RATE_CTRL_SIZE;
+}
+
+bool decodeRateCtrl(const uint8_t* data, size_t length, RateCtrlFrame* frame) {
+    if (length < RATE_CTRL_SIZE || data[0] != RATE_CTRL_MAGIC) {
+        return false;
+    }
+    if (data[1] < RATE_REPORT || data[1] > RATE_SWITCH_ACK || data[2] > RATE_MAX) {
+        return false;
+    }
+    frame->type = (RateCtrlType)data[1];
+    frame->rate = data[2];
+    frame->token = data[3];
+    frame->bitmap = (uint32_t)data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    return true;
+}
+
+uint32_t airDataRateBps(uint8_t rate) {
+    static const uint32_t bps[] = { 300, 1200, 2400, 4800, 9600, 19200, 19200, 19200 };
+    return bps[rate & 0x07];
+}
+
+// Signed distance between 8 bit sequence numbers
+static int8_t seqDiff(uint8_t a, uint8_t b) {
+    return (int8_t)(uint8_t)(a - b);
+}
+
+
+////////////////////////////////////////////////////////
+///// RateAdapter (transmitter)
+////////////////////////////////////////////////////////
+
+RateAdapter::RateAdapter(uint8_t baseRate, uint8_t maxRate)
+    : _baseRate(baseRate), _maxRate(maxRate > RATE_MAX ? RATE_MAX : maxRate),
+    _rate(baseRate), _previousRate(baseRate), _targetRate(baseRate)
+{
+    for (uint8_t r = 0; r <= RATE_MAX; r++) {
+        // Optimistic until measured, so every rate gets probed once
+        _delivery[r] = 1.0f;
+        _probeAfter[r] = 0;
+        _probeBackoff[r] = RATE_PROBE_INTERVAL_MS;
+    }
+}
+
+void RateAdapter::onSent(uint8_t sequence) {
+    if (_sentAtRate == 0) {
+        _firstSeq = sequence;
+    }
+    if (_sentAtRate < UINT16_MAX) {
+        _sentAtRate++;
+    }
+
+    // Receiver answers after the last sequence of each block
+    if (sequence % RATE_REPORT_EVERY == RATE_REPORT_EVERY - 1) {
+        _awaitingAnswer = true;
+    }
+}
+
+void RateAdapter::onControlFrame(const RateCtrlFrame& frame, uint32_t now) {
+    _lastHeard = now;
+
+    if (frame.type == RATE_SWITCH_ACK) {
+        if (_state == REQUESTING && frame.token == _token && frame.rate == _targetRate) {
+            _previousRate = _rate;
+            setRate(_targetRate, now);
+            // Old estimate of this rate is stale (or a past failed probe), measure afresh
+            _delivery[_rate] = 1.0f;
+            _state = VERIFYING;
+            _requestPending = false;
+            _awaitingAnswer = false;
+            _listening = false;
+        }
+        return;
+    }
+
+    if (frame.type != RATE_REPORT) {
+        return;
+    }
+
+    _awaitingAnswer = false;
+    _listening = false;
+    _missedReports = 0;
+
+    // Report sent at another rate (e.g. before the receiver switched) says nothing about this one
+    if (frame.rate != _rate) {
+        return;
+    }
+
+    if (_state == VERIFYING) {
+        // Traffic made it through at the new rate
+        _state = IDLE;
+    }
+
+    updateDelivery(frame);
+    decide(now);
+}
+
+void RateAdapter::updateDelivery(const RateCtrlFrame& report) {
+    uint8_t last = report.token;
+    int sent = 0;
+    int received = 0;
+
+    // Count sequences newer than the previous report that were sent at this rate
+    for (uint8_t i = 0; i < 32; i++) {
+        uint8_t seq = (uint8_t)(last - i);
+        if (_haveReport && seqDiff(seq, _lastReported) <= 0) {
+            break;
+        }
+        if (seqDiff(seq, _firstSeq) < 0 || (uint8_t)(seq - _firstSeq) >= _sentAtRate) {
+            continue;
+        }
+        sent++;
+        if (report.bitmap & (1UL << i)) {
+            received++;
+        }
+    }
+
+    if (!_haveReport || seqDiff(last, _lastReported) > 0) {
+        _lastReported = last;
+        _haveReport = true;
+    }
+
+    if (sent > 0) {
+        float ratio = (float)received / sent;
+        _delivery[_rate] = (1.0f - RATE_EWMA_WEIGHT) * _delivery[_rate] + RATE_EWMA_WEIGHT * ratio;
+    }
+
+    // Rate holds up, forget past back-off
+    if (_delivery[_rate] >= RATE_UP_THRESHOLD) {
+        _probeBackoff[_rate] = RATE_PROBE_INTERVAL_MS;
+    }
+}
+
+void RateAdapter::decide(uint32_t now) {
+    if (_state != IDLE) {
+        return;
+    }
+
+    float current = _delivery[_rate] * airDataRateBps(_rate);
+
+    // Step down when delivery collapses or the slower rate is expected to do better
+    if (_rate > RATE_MIN) {
+        uint8_t lower = _rate - 1;
+        if (_delivery[_rate] < RATE_DOWN_THRESHOLD
+            || _delivery[lower] * airDataRateBps(lower) > current) {
+            backOff(_rate, now);
+            startSwitch(lower);
+            return;
+        }
+    }
+
+    // Probe up once the current rate is solid and has been held long enough.
+    // A failed probe only delays the next one (back-off), it does not rule the rate out.
+    if (_rate < _maxRate) {
+        uint8_t higher = _rate + 1;
+        if (_delivery[_rate] >= RATE_UP_THRESHOLD
+            && now - _rateSince >= RATE_PROBE_INTERVAL_MS
+            && (int32_t)(now - _probeAfter[higher]) >= 0) {
+            startSwitch(higher);
+        }
+    }
+}
+
+void RateAdapter::startSwitch(uint8_t target) {
+    _state = REQUESTING;
+    _targetRate = target;
+    _token++;
+    _retries = 0;
+    _requestPending = true;
+}
+
+void RateAdapter::setRate(uint8_t rate, uint32_t now) {
+    if (rate != _rate) {
+        _rate = rate;
+        _changed = true;
+    }
+    _rateSince = now;
+    _lastHeard = now;
+    _sentAtRate = 0;
+    _haveReport = false;
+    _missedReports = 0;
+}
+
+void RateAdapter::probeFailed(uint8_t rate, uint32_t now) {
+    _delivery[rate] = 0.0f;
+    backOff(rate, now);
+}
+
+void RateAdapter::backOff(uint8_t rate, uint32_t now) {
+    _probeAfter[rate] = now + _probeBackoff[rate];
+    if (_probeBackoff[rate] < RATE_PROBE_BACKOFF_MAX) {
+        _probeBackoff[rate] *= 2;
+    }
+}
+
+uint32_t RateAdapter::listenWindowMs() const {
+    return RATE_LISTEN_MS + (RATE_CTRL_SIZE + LORA_FIXED_HEADER_SIZE) * 8 * 1000 / airDataRateBps(_rate);
+}
+
+bool RateAdapter::holdOff(uint32_t now, bool txIdle) {
+    if (!_awaitingAnswer) {
+        return false;
+    }
+    if (!_listening) {
+        // Window starts once our own frames are off the air
+        if (txIdle) {
+            _listening = true;
+            _listenUntil = now + listenWindowMs();
+        }
+        return true;
+    }
+    if ((int32_t)(now - _listenUntil) < 0) {
+        return true;
+    }
+
+    // Nothing came back
+    _awaitingAnswer = false;
+    _listening = false;
+
+    if (_state == REQUESTING) {
+        if (++_retries < RATE_REQ_RETRIES) {
+            _requestPending = true;
+        }
+        else {
+            // Receiver never confirmed, stay where we are. Only a probe up is
+            // penalized, a step down is simply retried on the next report.
+            if (_targetRate > _rate) {
+                probeFailed(_targetRate, now);
+            }
+            _state = IDLE;
+        }
+    }
+    else if (++_missedReports * RATE_REPORT_EVERY >= 32) {
+        // Bitmap can no longer cover the gap, count the whole window as lost
+        _delivery[_rate] *= (1.0f - RATE_EWMA_WEIGHT);
+        _missedReports = 0;
+        decide(now);
+    }
+    return false;
+}
+
+bool RateAdapter::poll(uint32_t now, RateCtrlFrame* frame) {
+
+    // New rate never carried a report back: both sides revert
+    if (_state == VERIFYING && now - _rateSince >= RATE_VERIFY_TIMEOUT_MS) {
+        uint8_t failed = _rate;
+        setRate(_previousRate, now);
+        probeFailed(failed, now);
+        _state = IDLE;
+    }
+
+    // Link lost at steady state: receiver drops to the base rate too
+    if (_state == IDLE && _rate != _baseRate && now - _lastHeard >= RATE_LINK_TIMEOUT_MS) {
+        setRate(_baseRate, now);
+    }
+
+    if (!_requestPending || _awaitingAnswer) {
+        return false;
+    }
+
+    _requestPending = false;
+    _awaitingAnswer = true;
+    frame->type = RATE_SWITCH_REQ;
+    frame->rate = _targetRate;
+    frame->token = _token;
+    frame->bitmap = 0;
+    return true;
+}
+
+bool RateAdapter::rateChanged() {
+    bool changed = _changed;
+    _changed = false;
+    return changed;
+}
+
+
+////////////////////////////////////////////////////////
+///// RateFollower (receiver)
+////////////////////////////////////////////////////////
+
+RateFollower::RateFollower(uint8_t baseRate)
+    : _baseRate(baseRate), _rate(baseRate), _previousRate(baseRate)
+{
+}
+
+bool RateFollower::follows(uint16_t node, uint32_t now) {
+    if (_haveNode && node == _node) {
+        return true;
+    }
+
+    // Nobody followed yet, or the followed node went quiet at the base rate
+    if (!_haveNode || (_rate == _baseRate && now - _lastHeard >= RATE_LINK_TIMEOUT_MS)) {
+        _node = node;
+        _haveNode = true;
+        _lastSeq = 0;
+        _bitmap = 0;
+        _reportDue = false;
+        _ackDue = false;
+        _othersHeard = false;
+        return true;
+    }
+
+    _othersHeard = true;
+    _otherHeardAt = now;
+    return false;
+}
+
+bool RateFollower::shared(uint32_t now) const {
+    return _othersHeard && now - _otherHeardAt < RATE_LINK_TIMEOUT_MS;
+}
+
+void RateFollower::onDataFrame(uint8_t sequence, uint32_t now, uint16_t node) {
+    if (!follows(node, now)) {
+        return;
+    }
+    _lastHeard = now;
+    _verifying = false; // New rate carries traffic
+
+    int8_t diff = seqDiff(sequence, _lastSeq);
+    if (diff > 0) {
+        _bitmap = (diff >= 32) ? 0 : (_bitmap << diff);
+        _lastSeq = sequence;
+        _bitmap |= 1;
+    }
+    else if (diff > -32) {
+        _bitmap |= (1UL << -diff); // Late frame inside the window
+    }
+
+    if (sequence % RATE_REPORT_EVERY == RATE_REPORT_EVERY - 1) {
+        _reportDue = true;
+    }
+}
+
+void RateFollower::onControlFrame(const RateCtrlFrame& frame, uint32_t now, uint16_t node) {
+    if (!follows(node, now)) {
+        return;
+    }
+    _lastHeard = now;
+
+    // Other buoys on this rate would be cut off: no ACK, the transmitter backs off
+    if (frame.type == RATE_SWITCH_REQ && !shared(now)) {
+        _ackDue = true;
+        _ackRate = frame.rate;
+        _ackToken = frame.token;
+    }
+}
+
+bool RateFollower::poll(uint32_t now, RateCtrlFrame* frame) {
+
+    if (_ackDue) {
+        _ackDue = false;
+        frame->type = RATE_SWITCH_ACK;
+        frame->rate = _ackRate;
+        frame->token = _ackToken;
+        frame->bitmap = 0;
+
+        // ACK goes out at the old rate, then we move
+        if (_ackRate != _rate) {
+            _previousRate = _rate;
+            _rate = _ackRate;
+            _changed = true;
+            _verifying = true;
+            _switchedAt = now;
+        }
+        return true;
+    }
+
+    if (_reportDue) {
+        _reportDue = false;
+        frame->type = RATE_REPORT;
+        frame->rate = _rate;
+        frame->token = _lastSeq;
+        frame->bitmap = _bitmap;
+        return true;
+    }
+
+    // Transmitter never followed (ACK lost): go back
+    if (_verifying && now - _switchedAt >= RATE_VERIFY_TIMEOUT_MS) {
+        _verifying = false;
+        _rate = _previousRate;
+        _changed = true;
+        _lastHeard = now;
+    }
+
+    // Link lost: meet the transmitter at the base rate
+    if (_rate != _baseRate && now - _lastHeard >= RATE_LINK_TIMEOUT_MS) {
+        _rate = _baseRate;
+        _changed = true;
+        _lastHeard = now;
+    }
+
+    return false;
+}
+
+bool RateFollower::rateChanged() {
+    bool changed = _changed;
+    _changed = false;
+    return changed;
+}
@@ -0,0 +1,210 @@
+#ifndef RATEADAPTER_H
+#define RATEADAPTER_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaFrame.h"
+
+
+////////////////////////////////////////////////////////
+///// Control frames
+////////////////////////////////////////////////////////
+//
+//  byte 0   : magic (0xC7)
+//  byte 1   : type
+//  byte 2   : air data rate (E32 SPED.airDataRate code)
+//  byte 3   : token (switch handshake) / last sequence (report)
+//  byte 4-7 : report bitmap, bit i = sequence (last - i) received
+//
+// The transmitter is the controller, the receiver only reports and follows.
+// A switch is REQ -> ACK -> both change rate. Each side falls back on its own
+// when it hears nothing, so a lost ACK or a dead link can't strand them.
+//
+// On a gateway of many buoys the frames travel behind a node header (see
+// NodeTable.h): the buoy's own id on requests, the id of the buoy addressed
+// on reports and ACKs. They are not data frames and skip the node table.
+
+#define RATE_CTRL_MAGIC         0xC7
+#define RATE_CTRL_SIZE          8
+
+#define RATE_MIN                0       // AIR_DATA_RATE_000_03
+#define RATE_MAX                5       // AIR_DATA_RATE_101_192 (6 and 7 are the same rate)
+
+#define RATE_REPORT_EVERY       8       // Receiver reports after every 8th sequence
+#define RATE_LISTEN_MS          150     // Transmitter quiet time for the answer, plus its airtime
+#define RATE_REQ_RETRIES        3
+#define RATE_VERIFY_TIMEOUT_MS  10000   // New rate must carry traffic within this
+#define RATE_LINK_TIMEOUT_MS    30000   // Nothing heard: both sides drop to the base rate
+#define RATE_PROBE_INTERVAL_MS  60000   // Time at a rate before probing the next one up
+#define RATE_PROBE_BACKOFF_MAX  600000  // Failed probes back off up to 10 min
+
+#define RATE_EWMA_WEIGHT        0.25f   // Weight of a new report in the delivery estimate
+#define RATE_UP_THRESHOLD       0.90f   // Delivery needed before probing up
+#define RATE_DOWN_THRESHOLD     0.50f   // Delivery below which we step down
+
+enum RateCtrlType : uint8_t {
+    RATE_REPORT     = 1,    // Receiver -> transmitter, delivery bitmap
+    RATE_SWITCH_REQ = 2,    // Transmitter -> receiver
+    RATE_SWITCH_ACK = 3     // Receiver -> transmitter, receiver switches right after
+};
+
+struct RateCtrlFrame {
+    RateCtrlType type;
+    uint8_t rate;
+    uint8_t token;          // Switch token, or last sequence for a report
+    uint32_t bitmap;
+};
+
+// Serialize a control frame, returns RATE_CTRL_SIZE or 0 if it does not fit
+size_t encodeRateCtrl(const RateCtrlFrame& frame, uint8_t* out, size_t capacity);
+
+// Parse a control frame
+bool decodeRateCtrl(const uint8_t* data, size_t length, RateCtrlFrame* frame);
+
+// Nominal air bit rate of an E32 air data rate code
+uint32_t airDataRateBps(uint8_t rate);
+
+
+/**
+ * @brief Transmitter side rate controller (Minstrel style)
+ *
+ * Keeps an EWMA of the delivery ratio per air rate from the receiver's
+ * reports and picks the neighbouring rate with the best expected
+ * throughput (delivery x bit rate). Higher rates are probed periodically,
+ * with exponential back-off when a probe fails.
+ */
+class RateAdapter {
+    public:
+        RateAdapter(uint8_t baseRate, uint8_t maxRate = RATE_MAX);
+
+        // A data frame with this sequence is being sent at the current rate
+        void onSent(uint8_t sequence);
+
+        // A control frame from the receiver arrived
+        void onControlFrame(const RateCtrlFrame& frame, uint32_t now);
+
+        /**
+         * @brief Half duplex: true while the receiver's answer is expected
+         *
+         * @param now Time in ms
+         * @param txIdle Nothing queued or in flight, the listen window starts from here
+         */
+        bool holdOff(uint32_t now, bool txIdle);
+
+        // Fills a control frame to send, call when holdOff() is false
+        bool poll(uint32_t now, RateCtrlFrame* frame);
+
+        // Rate the radio must be on, and whether it changed since last asked
+        uint8_t rate() const { return _rate; }
+        bool rateChanged();
+
+        // Current delivery estimate for a rate (0-1)
+        float deliveryRatio(uint8_t rate) const { return _delivery[rate]; }
+
+    private:
+        enum State : uint8_t { IDLE, REQUESTING, VERIFYING };
+
+        uint8_t _baseRate;
+        uint8_t _maxRate;
+        uint8_t _rate;
+        uint8_t _previousRate;
+        uint8_t _targetRate;
+        bool _changed = false;
+        State _state = IDLE;
+
+        float _delivery[RATE_MAX + 1];
+        uint32_t _probeAfter[RATE_MAX + 1];     // Earliest time a rate may be probed again
+        uint32_t _probeBackoff[RATE_MAX + 1];
+
+        // Sequences sent at the current rate
+        uint8_t _firstSeq = 0;
+        uint16_t _sentAtRate = 0;
+        uint8_t _lastReported = 0;
+        bool _haveReport = false;
+
+        // Listen window
+        bool _awaitingAnswer = false;
+        bool _listening = false;
+        uint32_t _listenUntil = 0;
+        uint8_t _missedReports = 0;
+
+        // Switch handshake
+        uint8_t _token = 0;
+        uint8_t _retries = 0;
+        bool _requestPending = false;
+        uint32_t _rateSince = 0;
+        uint32_t _lastHeard = 0;
+
+        void updateDelivery(const RateCtrlFrame& report);
+        void decide(uint32_t now);
+        void startSwitch(uint8_t target);
+        void setRate(uint8_t rate, uint32_t now);
+        void probeFailed(uint8_t rate, uint32_t now);
+        void backOff(uint8_t rate, uint32_t now);
+        uint32_t listenWindowMs() const;
+};
+
+
+/**
+ * @brief Receiver side: reports delivery and follows switch requests
+ *
+ * The air rate is the gateway's, shared by every buoy on the channel, so
+ * the follower keeps to one link. It follows the first node it hears and
+ * takes another only once that one went quiet at the base rate. Frames of
+ * other nodes are left out of the reports, and while any other node was
+ * heard within RATE_LINK_TIMEOUT_MS switch requests go unanswered (the
+ * transmitter backs off), since a new rate would cut the others off.
+ */
+class RateFollower {
+    public:
+        RateFollower(uint8_t baseRate);
+
+        // A data frame with this sequence arrived from node (0 without a node header)
+        void onDataFrame(uint8_t sequence, uint32_t now, uint16_t node = 0);
+
+        // A control frame from the transmitter arrived
+        void onControlFrame(const RateCtrlFrame& frame, uint32_t now, uint16_t node = 0);
+
+        // Fills a control frame to send right away (report or ACK)
+        bool poll(uint32_t now, RateCtrlFrame* frame);
+
+        // Rate the radio must be on, and whether it changed since last asked.
+        // Send the frame from poll() before applying a change.
+        uint8_t rate() const { return _rate; }
+        bool rateChanged();
+
+        // Node the reports and ACKs are for
+        uint16_t node() const { return _node; }
+
+        // Other nodes heard lately, no switch allowed
+        bool shared(uint32_t now) const;
+
+    private:
+        uint8_t _baseRate;
+        uint8_t _rate;
+        uint8_t _previousRate;
+        bool _changed = false;
+
+        uint16_t _node = 0;
+        bool _haveNode = false;
+        bool _othersHeard = false;
+        uint32_t _otherHeardAt = 0;
+
+        uint8_t _lastSeq = 0;
+        uint32_t _bitmap = 0;
+        bool _reportDue = false;
+
+        // Pending ACK, the switch happens once it has been handed out
+        bool _ackDue = false;
+        uint8_t _ackRate = 0;
+        uint8_t _ackToken = 0;
+
+        bool _verifying = false;
+        uint32_t _switchedAt = 0;
+        uint32_t _lastHeard = 0;
+
+        bool follows(uint16_t node, uint32_t now);
+};
+
+#endif // RATEADAPTER_H
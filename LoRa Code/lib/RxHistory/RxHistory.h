@@ -0,0 +1,220 @@
+#ifndef RXHISTORY_H
+#define RXHISTORY_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+// Status flags of a received frame
+enum RxStatus : uint8_t {
+    RX_OK           = 0,
+    RX_TRUNCATED    = 1 << 0,   // Filled the whole slot, bytes past it were lost
+    RX_AFTER_DROP   = 1 << 1    // Frames were lost right before this one (see RxFrameInfo::dropped)
+};
+
+// What happens to a frame arriving while the history is full
+enum RxDropPolicy : uint8_t {
+    RX_DROP_OLDEST,     // Overwrite the oldest unread frame
+    RX_DROP_NEWEST      // Keep the unread frames, refuse the new one
+};
+
+/**
+ * @brief Metadata kept with every received frame
+ */
+struct RxFrameInfo {
+    uint32_t sequence;      // Arrival number, frames lost in the history leave a gap
+    uint32_t timestamp;     // Arrival time in ms
+    uint16_t length;        // Bytes kept
+    uint8_t status;         // RxStatus flags
+    uint16_t dropped;       // Frames lost right before this one (UART ring or history full)
+};
+
+/**
+ * @brief History counters
+ */
+struct RxHistoryStats {
+    uint32_t received;      // Frames given to push()
+    uint32_t overwritten;   // Unread frames lost to RX_DROP_OLDEST
+    uint32_t refused;       // New frames lost to RX_DROP_NEWEST
+    uint32_t upstream;      // Frames reported lost before they reached the history
+    uint32_t truncated;
+};
+
+
+/**
+ * @brief Fixed capacity history of received frames with their metadata
+ *
+ * Unlike FrameRing this is used from one task only (the one reading the
+ * frames), which lets RX_DROP_OLDEST overwrite unread frames in place. No
+ * heap allocation, the storage is part of the object.
+ *
+ * @tparam SLOTS Number of frames kept, must be a power of two
+ * @tparam SLOT_SIZE Maximum bytes per frame
+ */
+template <size_t SLOTS, size_t SLOT_SIZE>
+class RxHistory {
+    static_assert(SLOTS >= 2 && (SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two");
+    static_assert(SLOT_SIZE <= UINT16_MAX, "Lengths are 16 bits");
+
+    public:
+        struct Entry {
+            RxFrameInfo info;
+            uint8_t data[SLOT_SIZE];
+        };
+
+        // Walks the unread frames, oldest first
+        class Iterator {
+            public:
+                Iterator(const RxHistory* history, uint32_t position) : _history(history), _position(position) {}
+                const Entry& operator*() const { return _history->_entries[_position & (SLOTS - 1)]; }
+                const Entry* operator->() const { return &**this; }
+                Iterator& operator++() { _position++; return *this; }
+                bool operator!=(const Iterator& other) const { return _position != other._position; }
+
+            private:
+                const RxHistory* _history;
+                uint32_t _position;
+        };
+
+        RxHistory(RxDropPolicy policy = RX_DROP_OLDEST) : _policy(policy) {}
+
+        void setDropPolicy(RxDropPolicy policy) { _policy = policy; }
+        RxDropPolicy dropPolicy() const { return _policy; }
+
+        ////////////////////////////////////////////////////////
+        ///// Writing
+        ////////////////////////////////////////////////////////
+
+        // Frames lost before push() could see them, charged to the next frame kept
+        void noteDropped(uint32_t frames) {
+            _stats.upstream += frames;
+            _pendingDrops += frames;
+            _sequence += frames;
+        }
+
+        /**
+         * @brief Store a received frame
+         *
+         * @param data Frame bytes
+         * @param length Frame length, anything past SLOT_SIZE is cut
+         * @param now Arrival time in ms
+         * @param truncated The caller already had to cut the frame
+         * @return false Full with RX_DROP_NEWEST, the frame was not kept
+         */
+        bool push(const uint8_t* data, size_t length, uint32_t now, bool truncated = false) {
+            _stats.received++;
+            uint32_t sequence = _sequence++;
+
+            if (full()) {
+                if (_policy == RX_DROP_NEWEST) {
+                    _stats.refused++;
+                    _pendingDrops++;
+                    return false;
+                }
+                // The frame after the overwritten one inherits its gap, plus itself
+                _stats.overwritten++;
+                uint32_t lost = _entries[_tail & (SLOTS - 1)].info.dropped + 1;
+                _tail++;
+                addDrops(_entries[_tail & (SLOTS - 1)].info, lost);
+            }
+
+            if (length > SLOT_SIZE) {
+                truncated = true;
+                length = SLOT_SIZE;
+            }
+
+            Entry& entry = _entries[_head & (SLOTS - 1)];
+            memcpy(entry.data, data, length);
+            entry.info.sequence = sequence;
+            entry.info.timestamp = now;
+            entry.info.length = (uint16_t)length;
+            entry.info.status = truncated ? RX_TRUNCATED : RX_OK;
+            entry.info.dropped = 0;
+            if (truncated) {
+                _stats.truncated++;
+            }
+            addDrops(entry.info, _pendingDrops);
+            _pendingDrops = 0;
+            _head++;
+            return true;
+        }
+
+        ////////////////////////////////////////////////////////
+        ///// Reading
+        ////////////////////////////////////////////////////////
+
+        // Unread frame index places after the oldest, nullptr past the newest
+        const Entry* peek(size_t index = 0) const {
+            if (index >= count()) {
+                return nullptr;
+            }
+            return &_entries[(_tail + index) & (SLOTS - 1)];
+        }
+
+        // Most recent unread frame, nullptr if empty
+        const Entry* newest() const {
+            return empty() ? nullptr : &_entries[(_head - 1) & (SLOTS - 1)];
+        }
+
+        /**
+         * @brief Copy the oldest frame out and remove it
+         *
+         * @param buf Destination
+         * @param cap Size of destination, extra bytes are dropped
+         * @param info Filled with the frame's metadata (may be nullptr)
+         * @return size_t Bytes copied, 0 if empty
+         */
+        size_t pop(uint8_t* buf, size_t cap, RxFrameInfo* info = nullptr) {
+            const Entry* entry = peek();
+            if (entry == nullptr) {
+                return 0;
+            }
+            size_t length = entry->info.length > cap ? cap : entry->info.length;
+            memcpy(buf, entry->data, length);
+            if (info != nullptr) {
+                *info = entry->info;
+            }
+            _tail++;
+            return length;
+        }
+
+        // Remove the oldest frame without copying it (after peek())
+        void discard() {
+            if (!empty()) {
+                _tail++;
+            }
+        }
+
+        void clear() { _tail = _head; }
+
+        Iterator begin() const { return Iterator(this, _tail); }
+        Iterator end() const { return Iterator(this, _head); }
+
+        size_t count() const { return _head - _tail; }
+        bool empty() const { return _head == _tail; }
+        bool full() const { return count() >= SLOTS; }
+        size_t capacity() const { return SLOTS; }
+        RxHistoryStats stats() const { return _stats; }
+
+    private:
+        Entry _entries[SLOTS];
+        uint32_t _head = 0;
+        uint32_t _tail = 0;
+        uint32_t _sequence = 0;
+        uint32_t _pendingDrops = 0;     // Lost since the last frame kept
+        RxDropPolicy _policy;
+        RxHistoryStats _stats = {};
+
+        static void addDrops(RxFrameInfo& info, uint32_t frames) {
+            if (frames == 0) {
+                return;
+            }
+            uint32_t total = info.dropped + frames;
+            info.dropped = total > UINT16_MAX ? UINT16_MAX : (uint16_t)total;
+            info.status |= RX_AFTER_DROP;
+        }
+};
+
+#endif // RXHISTORY_H
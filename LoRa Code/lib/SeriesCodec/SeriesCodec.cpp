@@ -0,0 +1,314 @@
+#include "SeriesCodec.h"
+#include <string.h>
+
+
+////////////////////////////////////////////////////////
+///// Helpers
+////////////////////////////////////////////////////////
+
+// Most significant bit first writer, stops (ok = false) at the end of the buffer
+struct BitWriter {
+    uint8_t* buf;
+    size_t capacity;    // In bits
+    size_t pos;
+    bool ok;
+
+    void put(uint32_t value, uint8_t count) {
+        if (!ok || pos + count > capacity) {
+            ok = false;
+            return;
+        }
+        while (count > 0) {
+            uint8_t room = 8 - (pos & 7);
+            uint8_t n = count < room ? count : room;
+            uint8_t chunk = (value >> (count - n)) & ((1u << n) - 1);
+            uint8_t shift = room - n;
+            uint8_t mask = ((1u << n) - 1) << shift;
+            buf[pos >> 3] = (buf[pos >> 3] & ~mask) | (chunk << shift);
+            pos += n;
+            count -= n;
+        }
+    }
+
+    void putSigned(int32_t value) {
+        uint32_t z = zigzagEncode(value);
+        if (z == 0)               { put(0x0, 1); }
+        else if (z < (1u << 4))   { put(0x2, 2); put(z, 4); }
+        else if (z < (1u << 8))   { put(0x6, 3); put(z, 8); }
+        else if (z < (1u << 16))  { put(0xE, 4); put(z, 16); }
+        else                      { put(0xF, 4); put(z, 32); }
+    }
+
+    void putXor(uint32_t x, uint8_t* leading, uint8_t* trailing) {
+        if (x == 0) {
+            put(0x0, 1);
+            return;
+        }
+        uint8_t lead = __builtin_clz(x);
+        uint8_t trail = __builtin_ctz(x);
+        if (*leading != 0xFF && lead >= *leading && trail >= *trailing) {
+            put(0x2, 2);
+            put(x >> *trailing, 32 - *leading - *trailing);
+            return;
+        }
+        uint8_t length = 32 - lead - trail;
+        put(0x3, 2);
+        put(lead, 5);
+        put(length - 1, 5);
+        put(x >> trail, length);
+        *leading = lead;
+        *trailing = trail;
+    }
+};
+
+struct BitReader {
+    const uint8_t* buf;
+    size_t capacity;    // In bits
+    size_t pos;
+    bool ok;
+
+    uint32_t get(uint8_t count) {
+        if (!ok || pos + count > capacity) {
+            ok = false;
+            return 0;
+        }
+        uint32_t value = 0;
+        while (count > 0) {
+            uint8_t room = 8 - (pos & 7);
+            uint8_t n = count < room ? count : room;
+            uint8_t chunk = (buf[pos >> 3] >> (room - n)) & ((1u << n) - 1);
+            value = (value << n) | chunk;
+            pos += n;
+            count -= n;
+        }
+        return value;
+    }
+
+    int32_t getSigned() {
+        uint32_t z;
+        if (get(1) == 0)        { z = 0; }
+        else if (get(1) == 0)   { z = get(4); }
+        else if (get(1) == 0)   { z = get(8); }
+        else if (get(1) == 0)   { z = get(16); }
+        else                    { z = get(32); }
+        return zigzagDecode(z);
+    }
+
+    uint32_t getXor(uint8_t* leading, uint8_t* trailing) {
+        if (get(1) == 0) {
+            return 0;
+        }
+        if (get(1) == 0) {
+            if (*leading == 0xFF) {
+                ok = false; // Window reused before one was sent
+                return 0;
+            }
+            return get(32 - *leading - *trailing) << *trailing;
+        }
+        uint8_t lead = get(5);
+        uint8_t length = get(5) + 1;
+        if (lead + length > 32) {
+            ok = false;
+            return 0;
+        }
+        *leading = lead;
+        *trailing = 32 - lead - length;
+        return get(length) << *trailing;
+    }
+};
+
+// Keyframe width of a field
+static uint8_t rawBits(FieldEncoding encoding) {
+    switch (encoding) {
+        case FIELD_UINT8:   return 8;
+        case FIELD_FIXED16: return 16;
+        default:            return 32;
+    }
+}
+
+// Sign extend a keyframe value to the raw form of fieldToRaw()
+static uint32_t extendRaw(FieldEncoding encoding, uint32_t value) {
+    return encoding == FIELD_FIXED16 ? (uint32_t)(int32_t)(int16_t)value : value;
+}
+
+
+////////////////////////////////////////////////////////
+///// SeriesEncoder
+////////////////////////////////////////////////////////
+
+SeriesEncoder::SeriesEncoder(const TelemetrySchema& schema, size_t capacity)
+    : _schema(schema),
+      _capacity(capacity > SERIES_MAX_BLOCK ? SERIES_MAX_BLOCK : capacity)
+{
+}
+
+bool SeriesEncoder::add(const float* values, uint32_t timestamp) {
+    if (_schema.fieldCount > TELEMETRY_MAX_FIELDS || _samples >= SERIES_MAX_SAMPLES
+        || _capacity <= SERIES_HEADER_SIZE) {
+        return false;
+    }
+
+    // Work on copies, the block only changes if the whole sample fits
+    uint32_t raw[TELEMETRY_MAX_FIELDS];
+    uint8_t leading[TELEMETRY_MAX_FIELDS];
+    uint8_t trailing[TELEMETRY_MAX_FIELDS];
+    BitWriter writer = { _block + SERIES_HEADER_SIZE, (_capacity - SERIES_HEADER_SIZE) * 8, _bits, true };
+    int32_t delta = 0;
+
+    if (_samples == 0) {
+        writer.put(timestamp, 32);
+        for (uint8_t i = 0; i < _schema.fieldCount; i++) {
+            const FieldDef& field = _schema.fields[i];
+            raw[i] = fieldToRaw(field, values[i]);
+            leading[i] = 0xFF;
+            trailing[i] = 0;
+            writer.put(raw[i], rawBits(field.encoding));
+        }
+    }
+    else {
+        delta = (int32_t)(timestamp - _lastTimestamp);
+        writer.putSigned(delta - _lastDelta);
+        for (uint8_t i = 0; i < _schema.fieldCount; i++) {
+            const FieldDef& field = _schema.fields[i];
+            raw[i] = fieldToRaw(field, values[i]);
+            leading[i] = _leading[i];
+            trailing[i] = _trailing[i];
+            if (field.encoding == FIELD_FLOAT32) {
+                writer.putXor(raw[i] ^ _last[i], &leading[i], &trailing[i]);
+            } else {
+                writer.putSigned((int32_t)(raw[i] - _last[i]));
+            }
+        }
+    }
+
+    if (!writer.ok) {
+        return false;
+    }
+
+    if (_samples == 0) {
+        _firstTimestamp = timestamp;
+    }
+    _bits = writer.pos;
+    _samples++;
+    _lastTimestamp = timestamp;
+    _lastDelta = delta;
+    memcpy(_last, raw, sizeof(raw[0]) * _schema.fieldCount);
+    memcpy(_leading, leading, _schema.fieldCount);
+    memcpy(_trailing, trailing, _schema.fieldCount);
+    return true;
+}
+
+size_t SeriesEncoder::take(uint8_t* out, size_t capacity) {
+    size_t length = size();
+    if (empty() || capacity < length) {
+        return 0;
+    }
+
+    // Unused bits of the last byte are left as they were, the count bounds the decoder
+    _block[0] = _schema.id;
+    _block[1] = _samples;
+    memcpy(out, _block, length);
+
+    _bits = 0;
+    _samples = 0;
+    return length;
+}
+
+void SeriesEncoder::save(SeriesState* state) const {
+    state->schemaId = _schema.id;
+    state->samples = _samples;
+    state->bits = (uint16_t)_bits;
+    state->firstTimestamp = _firstTimestamp;
+    state->lastTimestamp = _lastTimestamp;
+    state->lastDelta = _lastDelta;
+    memcpy(state->last, _last, sizeof(_last));
+    memcpy(state->leading, _leading, sizeof(_leading));
+    memcpy(state->trailing, _trailing, sizeof(_trailing));
+    memcpy(state->block, _block, sizeof(_block));
+}
+
+bool SeriesEncoder::restore(const SeriesState& state) {
+    _bits = 0;
+    _samples = 0;
+    if (state.schemaId != _schema.id || SERIES_HEADER_SIZE + (state.bits + 7u) / 8 > _capacity) {
+        return false;
+    }
+    _samples = state.samples;
+    _bits = state.bits;
+    _firstTimestamp = state.firstTimestamp;
+    _lastTimestamp = state.lastTimestamp;
+    _lastDelta = state.lastDelta;
+    memcpy(_last, state.last, sizeof(_last));
+    memcpy(_leading, state.leading, sizeof(_leading));
+    memcpy(_trailing, state.trailing, sizeof(_trailing));
+    memcpy(_block, state.block, sizeof(_block));
+    return true;
+}
+
+
+////////////////////////////////////////////////////////
+///// SeriesDecoder
+////////////////////////////////////////////////////////
+
+SeriesDecoder::SeriesDecoder(const TelemetrySchema& schema)
+    : _schema(schema)
+{
+}
+
+bool SeriesDecoder::begin(const uint8_t* block, size_t length) {
+    if (length < SERIES_HEADER_SIZE || block[0] != _schema.id || _schema.fieldCount > TELEMETRY_MAX_FIELDS) {
+        return false;
+    }
+    _data = block + SERIES_HEADER_SIZE;
+    _totalBits = (length - SERIES_HEADER_SIZE) * 8;
+    _pos = 0;
+    _count = block[1];
+    _read = 0;
+    return true;
+}
+
+bool SeriesDecoder::next(float* values, uint32_t* timestamp) {
+    if (_read >= _count) {
+        return false;
+    }
+
+    BitReader reader = { _data, _totalBits, _pos, true };
+    uint32_t t;
+    int32_t delta = 0;
+
+    if (_read == 0) {
+        t = reader.get(32);
+        for (uint8_t i = 0; i < _schema.fieldCount; i++) {
+            FieldEncoding encoding = _schema.fields[i].encoding;
+            _last[i] = extendRaw(encoding, reader.get(rawBits(encoding)));
+            _leading[i] = 0xFF;
+            _trailing[i] = 0;
+        }
+    }
+    else {
+        delta = _lastDelta + reader.getSigned();
+        t = _lastTimestamp + (uint32_t)delta;
+        for (uint8_t i = 0; i < _schema.fieldCount; i++) {
+            if (_schema.fields[i].encoding == FIELD_FLOAT32) {
+                _last[i] ^= reader.getXor(&_leading[i], &_trailing[i]);
+            } else {
+                _last[i] += (uint32_t)reader.getSigned();
+            }
+        }
+    }
+
+    if (!reader.ok) {
+        _read = _count; // Truncated, nothing after this point can be trusted
+        return false;
+    }
+
+    for (uint8_t i = 0; i < _schema.fieldCount; i++) {
+        values[i] = fieldFromRaw(_schema.fields[i], _last[i]);
+    }
+    *timestamp = t;
+    _pos = reader.pos;
+    _lastTimestamp = t;
+    _lastDelta = delta;
+    _read++;
+    return true;
+}
@@ -0,0 +1,156 @@
+#ifndef SERIESCODEC_H
+#define SERIESCODEC_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+#include "TelemetryCodec.h"
+
+
+////////////////////////////////////////////////////////
+///// Block format
+////////////////////////////////////////////////////////
+//
+//  byte 0 : schema id
+//  byte 1 : sample count
+//  byte 2+: bit stream, most significant bit first
+//      sample 0 (keyframe): timestamp (32 bits), then each field's raw value
+//                           (8 bits for FIELD_UINT8, 16 for FIELD_FIXED16, 32 otherwise)
+//      sample n: timestamp delta-of-delta, then per field
+//                  integer encodings: delta to the previous sample
+//                  FIELD_FLOAT32: XOR with the previous value (Gorilla)
+//
+//  Signed values, zig-zag mapped to z:
+//      '0'                 z = 0
+//      '10'   +  4 bits    z < 2^4     (-8..7, a few LSB of drift or jitter)
+//      '110'  +  8 bits    z < 2^8
+//      '1110' + 16 bits    z < 2^16
+//      '1111' + 32 bits
+//
+//  XOR values:
+//      '0'                 same value as before
+//      '10' + bits         meaningful bits fit the previous leading/trailing zero window
+//      '11' + 5 bits leading zeros + 5 bits (length - 1) + bits
+//
+// Readings change slowly and samples are evenly spaced, so most of them
+// cost a few bits instead of the full field width. Every block starts with
+// a keyframe: a lost frame costs its own samples, never the next ones.
+
+#define SERIES_HEADER_SIZE      2
+#define SERIES_MAX_BLOCK        64
+#define SERIES_MAX_SAMPLES      255
+
+
+/**
+ * @brief Encoder state as plain data, e.g. kept in RTC memory through deep sleep
+ */
+struct SeriesState {
+    uint8_t schemaId;
+    uint8_t samples;
+    uint16_t bits;
+    uint32_t firstTimestamp;
+    uint32_t lastTimestamp;
+    int32_t lastDelta;
+    uint32_t last[TELEMETRY_MAX_FIELDS];
+    uint8_t leading[TELEMETRY_MAX_FIELDS];
+    uint8_t trailing[TELEMETRY_MAX_FIELDS];
+    uint8_t block[SERIES_MAX_BLOCK];
+};
+
+
+/**
+ * @brief Compresses consecutive samples of one schema into a block
+ */
+class SeriesEncoder {
+    public:
+        /**
+         * @brief Construct an encoder
+         *
+         * @param schema Field layout, must outlive the encoder
+         * @param capacity Block size limit, at most SERIES_MAX_BLOCK
+         */
+        SeriesEncoder(const TelemetrySchema& schema, size_t capacity = SERIES_MAX_BLOCK);
+
+        /**
+         * @brief Append one sample
+         *
+         * @param values One value per schema field
+         * @param timestamp Sample time in ms
+         * @return false The sample does not fit, take() the block first (nothing was written)
+         */
+        bool add(const float* values, uint32_t timestamp);
+
+        /**
+         * @brief Write the block and start a new one (with a keyframe)
+         *
+         * @param out Output buffer
+         * @param capacity Size of the output buffer
+         * @return size_t Block length, 0 if empty or the buffer is too small
+         */
+        size_t take(uint8_t* out, size_t capacity);
+
+        bool empty() const { return _samples == 0; }
+        uint8_t samples() const { return _samples; }
+        size_t size() const { return SERIES_HEADER_SIZE + (_bits + 7) / 8; }
+        uint32_t firstTimestamp() const { return _firstTimestamp; }
+
+        // Copy the block being built and the delta references out / back in
+        void save(SeriesState* state) const;
+        // False (encoder left empty) if the state is for another schema or does not fit
+        bool restore(const SeriesState& state);
+
+    private:
+        const TelemetrySchema& _schema;
+        size_t _capacity;
+        uint8_t _block[SERIES_MAX_BLOCK];
+        size_t _bits = 0;               // Written after the header
+        uint8_t _samples = 0;
+
+        // Previous sample, deltas are taken against it
+        uint32_t _firstTimestamp = 0;
+        uint32_t _lastTimestamp = 0;
+        int32_t _lastDelta = 0;
+        uint32_t _last[TELEMETRY_MAX_FIELDS];
+        uint8_t _leading[TELEMETRY_MAX_FIELDS];    // XOR window, 0xFF = none yet
+        uint8_t _trailing[TELEMETRY_MAX_FIELDS];
+};
+
+
+/**
+ * @brief Expands a block written by SeriesEncoder
+ */
+class SeriesDecoder {
+    public:
+        // Schema must outlive the decoder
+        SeriesDecoder(const TelemetrySchema& schema);
+
+        // False if the block is too short or was written for another schema
+        bool begin(const uint8_t* block, size_t length);
+
+        uint8_t count() const { return _count; }
+
+        /**
+         * @brief Read the next sample
+         *
+         * @param values Output, one value per schema field
+         * @param timestamp Output, sample time in ms
+         * @return false No sample left or the block is truncated
+         */
+        bool next(float* values, uint32_t* timestamp);
+
+    private:
+        const TelemetrySchema& _schema;
+        const uint8_t* _data = nullptr;
+        size_t _totalBits = 0;
+        size_t _pos = 0;
+        uint8_t _count = 0;
+        uint8_t _read = 0;
+
+        uint32_t _lastTimestamp = 0;
+        int32_t _lastDelta = 0;
+        uint32_t _last[TELEMETRY_MAX_FIELDS];
+        uint8_t _leading[TELEMETRY_MAX_FIELDS];
+        uint8_t _trailing[TELEMETRY_MAX_FIELDS];
+};
+
+#endif // SERIESCODEC_H
@@ -0,0 +1,78 @@
+#include "SleepCycle.h"
+#include <esp_sleep.h>
+#include <sys/time.h>
+
+#define SLEEP_CYCLE_MAGIC 0x51EE9C1Eu
+
+// Survives deep sleep, cleared by a power on or any other reset
+RTC_DATA_ATTR static uint32_t rtcMagic = 0;
+RTC_DATA_ATTR static CycleStats rtcStats = {};
+
+
+SleepCycle::SleepCycle(SleepMode mode, uint32_t periodMs)
+    : _mode(mode), _periodMs(periodMs)
+{
+}
+
+void SleepCycle::begin() {
+    // esp_timer starts with the app, ROM and bootloader time before it is not counted
+    _cycleStartUs = 0;
+    _resumed = rtcMagic == SLEEP_CYCLE_MAGIC
+            && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+    if (!_resumed) {
+        rtcStats = CycleStats();
+        rtcMagic = SLEEP_CYCLE_MAGIC;
+    }
+}
+
+uint32_t SleepCycle::nowMs() {
+    // The system time runs on the RTC timer, deep sleep included
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint32_t)((uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000);
+}
+
+void SleepCycle::sleep() {
+    int64_t now = esp_timer_get_time();
+    uint32_t awakeUs = (uint32_t)(now - _cycleStartUs);
+    uint64_t periodUs = (uint64_t)_periodMs * 1000;
+    uint64_t sleepUs = awakeUs + SLEEP_MIN_US < periodUs ? periodUs - awakeUs : SLEEP_MIN_US;
+
+    rtcStats.cycles++;
+    rtcStats.lastAwakeUs = awakeUs;
+    rtcStats.totalAwakeUs += awakeUs;
+    rtcStats.lastSleepUs = _mode == SLEEP_NONE ? 0 : (uint32_t)sleepUs;
+
+    switch (_mode) {
+        case SLEEP_NONE:
+            _cycleStartUs = now;
+            break;
+
+        case SLEEP_LIGHT:
+            esp_sleep_enable_timer_wakeup(sleepUs);
+            esp_light_sleep_start();
+            _cycleStartUs = esp_timer_get_time();
+            break;
+
+        case SLEEP_DEEP:
+            esp_sleep_enable_timer_wakeup(sleepUs);
+            esp_deep_sleep_start();
+            break;
+    }
+}
+
+CycleStats SleepCycle::stats() const {
+    return rtcStats;
+}
+
+void SleepCycle::print(Print& out) const {
+    out.print("Cycle ");
+    out.print(rtcStats.cycles);
+    out.print(": awake ");
+    out.print(rtcStats.lastAwakeUs / 1000.0f, 1);
+    out.print(" ms, avg ");
+    out.print(rtcStats.cycles ? (float)(rtcStats.totalAwakeUs / rtcStats.cycles) / 1000.0f : 0.0f, 1);
+    out.print(" ms, sleep ");
+    out.print(rtcStats.lastSleepUs / 1000);
+    out.println(" ms");
+}
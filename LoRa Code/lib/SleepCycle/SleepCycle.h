@@ -0,0 +1,71 @@
+#ifndef SLEEPCYCLE_H
+#define SLEEPCYCLE_H
+
+//Dependencies
+#include <Arduino.h>
+
+
+// How the board spends the time between two cycles
+enum SleepMode : uint8_t {
+    SLEEP_NONE,     // Stay awake, loop() paces itself
+    SLEEP_LIGHT,    // RAM and peripherals kept, execution resumes after the call
+    SLEEP_DEEP      // Only RTC memory kept, the next cycle starts from setup()
+};
+
+#define SLEEP_MIN_US 1000   // Shortest sleep worth entering
+
+
+/**
+ * @brief Per-cycle awake time, kept in RTC memory through deep sleep
+ */
+struct CycleStats {
+    uint32_t cycles;        // Cycles since power on
+    uint32_t lastAwakeUs;   // Wake (or reset) to sleep of the last cycle
+    uint64_t totalAwakeUs;
+    uint32_t lastSleepUs;   // Sleep requested after the last cycle
+};
+
+
+/**
+ * @brief Runs the board as wake, work, sleep cycles of a fixed period
+ *
+ * Awake time is measured from the start of the cycle (boot after a deep
+ * sleep, return from a light sleep) to the sleep call, so awake time times
+ * the active current gives the energy of one cycle. The clock keeps running
+ * through deep sleep, unlike millis().
+ */
+class SleepCycle {
+    public:
+        SleepCycle(SleepMode mode, uint32_t periodMs);
+
+        // Call first thing in setup()
+        void begin();
+
+        // True when this boot is the timer wake-up of a previous cycle's deep sleep
+        bool resumed() const { return _resumed; }
+
+        // ms on a clock that keeps counting through deep sleep
+        static uint32_t nowMs();
+
+        /**
+         * @brief End the cycle: record its awake time and sleep for the rest of the period
+         *
+         * SLEEP_NONE returns right away, SLEEP_LIGHT returns on wake-up and
+         * SLEEP_DEEP never returns. Put the radio to sleep before.
+         */
+        void sleep();
+
+        SleepMode mode() const { return _mode; }
+        CycleStats stats() const;
+
+        // One line, e.g. "Cycle 12: awake 184.2 ms, avg 190.0 ms, sleep 815 ms"
+        void print(Print& out) const;
+
+    private:
+        SleepMode _mode;
+        uint32_t _periodMs;
+        bool _resumed = false;
+        int64_t _cycleStartUs = 0;
+};
+
+#endif // SLEEPCYCLE_H
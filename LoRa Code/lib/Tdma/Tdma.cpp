@@ -0,0 +1,252 @@
+#include "Tdma.h"
+
+static_assert(TDMA_MAX_SLOTS <= 255, "Slots are numbered on one byte");
+
+
+////////////////////////////////////////////////////////
+///// Helpers
+////////////////////////////////////////////////////////
+
+bool isBeacon(const uint8_t* data, size_t length) {
+    return length >= TDMA_BEACON_HEADER && data[0] == TDMA_BEACON_MAGIC
+        && (length - TDMA_BEACON_HEADER) % TDMA_ENTRY_SIZE == 0;
+}
+
+uint32_t tdmaGuardMs(uint32_t superframeMs) {
+    // Both clocks may drift apart for every superframe a node goes without a beacon
+    uint64_t driftUs = (uint64_t)superframeMs * (TDMA_LOST_BEACONS + 1) * 2 * TDMA_CLOCK_PPM / 1000;
+    return TDMA_SYNC_JITTER_MS + (uint32_t)((driftUs + 999) / 1000);
+}
+
+
+////////////////////////////////////////////////////////
+///// TdmaCoordinator
+////////////////////////////////////////////////////////
+
+TdmaCoordinator::TdmaCoordinator(uint8_t slots, uint16_t slotMs) {
+    for (uint8_t i = 0; i < TDMA_MAX_SLOTS; i++) {
+        _used[i] = false;
+        _fresh[i] = false;
+    }
+    configure(slots, slotMs);
+}
+
+void TdmaCoordinator::configure(uint8_t slots, uint16_t slotMs) {
+    _slots = slots < 2 ? 2 : (slots > TDMA_MAX_SLOTS ? TDMA_MAX_SLOTS : slots);
+    _slotMs = slotMs == 0 ? 1 : slotMs;
+    for (uint8_t i = _slots; i < TDMA_MAX_SLOTS; i++) {
+        if (_used[i]) {
+            _used[i] = false;
+            _fresh[i] = false;
+            _assigned--;
+        }
+    }
+    if (_cursor >= _slots) {
+        _cursor = 1;
+    }
+}
+
+uint16_t TdmaCoordinator::slotMsFor(uint32_t airtimeMs, uint8_t framesPerSlot, uint8_t slots) {
+    // The guard grows with the superframe, which grows with the slot: a few rounds settle it
+    uint32_t payloadMs = airtimeMs * (framesPerSlot == 0 ? 1 : framesPerSlot);
+    uint32_t slotMs = payloadMs + 2 * TDMA_SYNC_JITTER_MS;
+    for (uint8_t i = 0; i < 4; i++) {
+        slotMs = payloadMs + 2 * tdmaGuardMs((uint32_t)(slots + 1) * slotMs);
+    }
+    return slotMs > UINT16_MAX ? UINT16_MAX : (uint16_t)slotMs;
+}
+
+int TdmaCoordinator::assign(uint16_t node) {
+    int free = -1;
+    for (uint8_t slot = 1; slot < _slots; slot++) {
+        if (_used[slot] && _nodes[slot] == node) {
+            return slot;
+        }
+        if (!_used[slot] && free < 0) {
+            free = slot;
+        }
+    }
+    if (free < 0) {
+        return TDMA_SHARED_SLOT;
+    }
+    _used[free] = true;
+    _fresh[free] = true;
+    _nodes[free] = node;
+    _assigned++;
+    return free;
+}
+
+void TdmaCoordinator::release(uint16_t node) {
+    for (uint8_t slot = 1; slot < _slots; slot++) {
+        if (_used[slot] && _nodes[slot] == node) {
+            _used[slot] = false;
+            _fresh[slot] = false;
+            _assigned--;
+        }
+    }
+}
+
+size_t TdmaCoordinator::beacon(uint8_t* out, size_t capacity, uint32_t now) {
+    if (capacity < TDMA_BEACON_HEADER) {
+        return 0;
+    }
+    out[0] = TDMA_BEACON_MAGIC;
+    out[1] = _sequence++;
+    out[2] = _slots;
+    out[3] = _slotMs & 0xFF;
+    out[4] = _slotMs >> 8;
+    out[5] = _slots;
+    while (out[5] > 1 && !_used[out[5] - 1]) {
+        out[5]--;
+    }
+    size_t length = TDMA_BEACON_HEADER;
+
+    // New assignments first, then the others round robin, as many as fit
+    bool written[TDMA_MAX_SLOTS] = {};
+    uint8_t entries = 0;
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (uint8_t checked = 1; checked < _slots && entries < TDMA_MAX_ENTRIES
+                                  && length + TDMA_ENTRY_SIZE <= capacity; checked++) {
+            uint8_t slot = checked;
+            if (pass == 1) {
+                slot = _cursor;
+                _cursor = _cursor + 1 >= _slots ? 1 : _cursor + 1;
+            }
+            if (!_used[slot] || written[slot] || (pass == 0 && !_fresh[slot])) {
+                continue;
+            }
+            out[length++] = _nodes[slot] >> 8;
+            out[length++] = _nodes[slot] & 0xFF;
+            out[length++] = slot;
+            _fresh[slot] = false;
+            written[slot] = true;
+            entries++;
+        }
+    }
+
+    // Keep the period when called a little late, restart it after a long pause
+    uint32_t superframe = superframeMs();
+    if (_started && now - _lastBeacon < 2 * superframe) {
+        _lastBeacon += superframe;
+    }
+    else {
+        _lastBeacon = now;
+    }
+    _started = true;
+    return length;
+}
+
+
+////////////////////////////////////////////////////////
+///// TdmaSchedule
+////////////////////////////////////////////////////////
+
+TdmaSchedule::TdmaSchedule(uint16_t node) {
+    setNode(node);
+}
+
+void TdmaSchedule::setNode(uint16_t node) {
+    _node = node;
+    _slot = TDMA_SHARED_SLOT;
+    _backoff = false;
+    _tried = false;
+    _window = 2;
+    _trySlot = TDMA_SHARED_SLOT;
+    _random = node * 2654435769UL + 1;  // Nodes draw different backoffs
+}
+
+bool TdmaSchedule::onBeacon(const uint8_t* frame, size_t length, uint32_t now) {
+    if (!isBeacon(frame, length)) {
+        return false;
+    }
+
+    uint8_t slots = frame[2];
+    uint16_t slotMs = frame[3] | (frame[4] << 8);
+    if (slots < 2 || slotMs == 0) {
+        return true;
+    }
+    if (slots != _slots || slotMs != _slotMs || _slot >= slots) {
+        // New layout, our slot is only known again once announced
+        _slot = TDMA_SHARED_SLOT;
+    }
+    _slots = slots;
+    _slotMs = slotMs;
+    _freeFrom = frame[5] < 1 ? 1 : frame[5];
+    _beaconAt = now;
+    _beacons++;
+
+    for (size_t i = TDMA_BEACON_HEADER; i + TDMA_ENTRY_SIZE <= length; i += TDMA_ENTRY_SIZE) {
+        uint16_t node = (frame[i] << 8) | frame[i + 1];
+        uint8_t slot = frame[i + 2];
+        if (node == _node && slot < slots) {
+            _slot = slot;
+            _backoff = false;
+            _window = 2;
+        }
+        else if (slot == _slot && node != _node) {
+            _slot = TDMA_SHARED_SLOT; // Given to another node
+        }
+    }
+
+    if (_slot == TDMA_SHARED_SLOT) {
+        // Last try was not answered: collided, or no slot left
+        if (_tried && _window < TDMA_SHARED_BACKOFF_MAX) {
+            _window *= 2;
+        }
+        uint8_t free = _freeFrom < slots ? slots - _freeFrom : 0;
+        uint8_t pick = next() % (free + 1);
+        _trySlot = pick == 0 ? TDMA_SHARED_SLOT : _freeFrom + pick - 1;
+    }
+    _tried = false;
+    return true;
+}
+
+bool TdmaSchedule::synced(uint32_t now) const {
+    return _beacons > 0 && now - _beaconAt < (TDMA_LOST_BEACONS + 1) * superframeMs();
+}
+
+uint32_t TdmaSchedule::delayMs(uint32_t onAirAt, uint32_t airtimeMs) const {
+    if (_beacons == 0) {
+        return UINT32_MAX;
+    }
+
+    if (_slot == TDMA_SHARED_SLOT && _backoff && (int32_t)(_sharedAt - onAirAt) > 0) {
+        return _sharedAt - onAirAt;
+    }
+
+    uint32_t superframe = superframeMs();
+    uint32_t guard = tdmaGuardMs(superframe);
+    uint32_t elapsed = onAirAt - _beaconAt;
+    if (elapsed >= 0x80000000UL) {
+        elapsed = 0; // Asked about a time before the beacon
+    }
+
+    // This superframe's window, or the next one if the packet no longer fits
+    uint8_t slot = _slot == TDMA_SHARED_SLOT ? _trySlot : _slot;
+    for (uint32_t k = elapsed / superframe; k <= TDMA_LOST_BEACONS; k++) {
+        uint32_t open = k * superframe + slot * _slotMs + guard;
+        uint32_t close = k * superframe + (slot + 1) * _slotMs - guard;
+        if (open + airtimeMs > close) {
+            return UINT32_MAX; // Does not fit any slot
+        }
+        if (elapsed + airtimeMs <= close) {
+            return elapsed >= open ? 0 : open - elapsed;
+        }
+    }
+    return UINT32_MAX;
+}
+
+void TdmaSchedule::onSent(uint32_t onAirAt) {
+    if (_slot != TDMA_SHARED_SLOT || _beacons == 0) {
+        return;
+    }
+    uint32_t skip = next() % _window;
+    _sharedAt = onAirAt + skip * superframeMs();
+    _backoff = true;
+    _tried = true;
+}
+
+uint32_t TdmaSchedule::next() {
+    _random = _random * 1103515245 + 12345;
+    return _random >> 16;
+}
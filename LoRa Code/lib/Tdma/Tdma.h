@@ -0,0 +1,180 @@
+#ifndef TDMA_H
+#define TDMA_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaFrame.h"
+
+
+////////////////////////////////////////////////////////
+///// Beacon frame
+////////////////////////////////////////////////////////
+//
+//  byte 0 : magic (0xBE)
+//  byte 1 : beacon sequence
+//  byte 2 : slot count, slot 0 is shared (nodes without a slot)
+//  byte 3 : slot length in ms (16 bit, little endian)
+//  byte 5 : first free slot, every slot from it on is free
+//  byte 6+: assignments, 3 bytes each: node id (16 bit, big endian), slot
+//
+// Superframe, timed by every node from the end of the beacon it heard:
+//
+//  | beacon | slot 0 | slot 1 | ... | slot n-1 | beacon | ...
+//  <-slot--><------- slot count * slot length ------->
+//
+// A beacon holds 16 assignments: new ones first, so a node hears its slot
+// in the next beacon, then the rest of the table round robin.
+// Each slot keeps a guard time at both ends for the beacon arrival jitter
+// and the clock drift of both ends over the superframes a node may miss.
+// Nodes without a slot try the shared slot or one of the free ones, drawn
+// again every superframe, so the gateway hears many of them at once. After
+// each try they skip a random number of superframes, drawn from a window
+// that doubles whenever the next beacon gives them no slot.
+
+#define TDMA_BEACON_MAGIC       0xBE
+#define TDMA_BEACON_HEADER      6
+#define TDMA_ENTRY_SIZE         3
+#define TDMA_MAX_ENTRIES        ((LORA_PAYLOAD_MAX - TDMA_BEACON_HEADER) / TDMA_ENTRY_SIZE)
+
+#define TDMA_MAX_SLOTS          128
+#define TDMA_SHARED_SLOT        0
+#define TDMA_SYNC_JITTER_MS     10      // Beacon arrival as seen by a polling receiver
+#define TDMA_CLOCK_PPM          50      // Crystal tolerance of each end
+#define TDMA_LOST_BEACONS       3       // Superframes a node keeps its timing without a beacon
+#define TDMA_SHARED_BACKOFF_MAX 64      // Superframes a node may skip between shared slot frames
+
+// True if a received frame is a beacon
+bool isBeacon(const uint8_t* data, size_t length);
+
+// Guard time at each end of a slot for a given superframe length
+uint32_t tdmaGuardMs(uint32_t superframeMs);
+
+
+/**
+ * @brief Gateway side: hands out slots and writes the beacons
+ */
+class TdmaCoordinator {
+    public:
+        /**
+         * @brief Construct a coordinator
+         *
+         * @param slots Slots per superframe, shared slot included (2-TDMA_MAX_SLOTS)
+         * @param slotMs Slot length, see slotMsFor()
+         */
+        TdmaCoordinator(uint8_t slots = 9, uint16_t slotMs = 1000);
+
+        // Takes effect with the next beacon, assignments past the new count are dropped
+        void configure(uint8_t slots, uint16_t slotMs);
+
+        /**
+         * @brief Slot length that fits frames of this airtime plus both guards
+         *
+         * @param airtimeMs Airtime of the longest frame (LoRa::airtimeMs())
+         * @param framesPerSlot Frames a node may send back to back in its slot
+         * @param slots Slots per superframe
+         * @return uint16_t Slot length in ms
+         */
+        static uint16_t slotMsFor(uint32_t airtimeMs, uint8_t framesPerSlot, uint8_t slots);
+
+        /**
+         * @brief Slot of a node, given one on first call
+         *
+         * @param node Node id (from its node header)
+         * @return int Slot 1..slots-1, TDMA_SHARED_SLOT if none is free
+         */
+        int assign(uint16_t node);
+        void release(uint16_t node);
+
+        bool beaconDue(uint32_t now) const { return !_started || now - _lastBeacon >= superframeMs(); }
+
+        /**
+         * @brief Write the next beacon and start its superframe
+         *
+         * @param out Output buffer, LORA_PAYLOAD_MAX bytes is always enough
+         * @param capacity Size of the output buffer
+         * @param now Time in ms
+         * @return size_t Beacon length
+         */
+        size_t beacon(uint8_t* out, size_t capacity, uint32_t now);
+
+        uint32_t superframeMs() const { return (uint32_t)(_slots + 1) * _slotMs; }
+        uint8_t slots() const { return _slots; }
+        uint16_t slotMs() const { return _slotMs; }
+        uint8_t assigned() const { return _assigned; }
+
+    private:
+        uint8_t _slots;
+        uint16_t _slotMs;
+        uint16_t _nodes[TDMA_MAX_SLOTS];    // Node in each slot
+        bool _used[TDMA_MAX_SLOTS];
+        bool _fresh[TDMA_MAX_SLOTS];        // Assigned since the last beacon
+        uint8_t _assigned = 0;
+        uint8_t _sequence = 0;
+        uint8_t _cursor = 1;                // Next slot announced
+        bool _started = false;
+        uint32_t _lastBeacon = 0;
+};
+
+
+/**
+ * @brief Node side: follows the beacons and tells when the slot is open
+ */
+class TdmaSchedule {
+    public:
+        TdmaSchedule(uint16_t node = 0);
+
+        void setNode(uint16_t node);
+        uint16_t node() const { return _node; }
+
+        /**
+         * @brief Take the timing of a received beacon
+         *
+         * @param frame Received bytes
+         * @param length Number of received bytes
+         * @param now Time in ms the beacon was received
+         * @return false Not a beacon
+         */
+        bool onBeacon(const uint8_t* frame, size_t length, uint32_t now);
+
+        // A beacon was heard within TDMA_LOST_BEACONS superframes
+        bool synced(uint32_t now) const;
+
+        /**
+         * @brief How long until a packet may go on air
+         *
+         * @param onAirAt Time in ms the packet would start on air
+         * @param airtimeMs Its airtime, it has to end before the slot's guard
+         * @return uint32_t 0 to send, otherwise ms to wait (UINT32_MAX without sync)
+         */
+        uint32_t delayMs(uint32_t onAirAt, uint32_t airtimeMs) const;
+
+        // A packet went on air at this time, starts the backoff when in the shared slot
+        void onSent(uint32_t onAirAt);
+
+        // Own slot, TDMA_SHARED_SLOT until the gateway gave one
+        uint8_t slot() const { return _slot; }
+        uint32_t superframeMs() const { return (uint32_t)(_slots + 1) * _slotMs; }
+        uint32_t beacons() const { return _beacons; }
+
+    private:
+        uint16_t _node;
+        uint8_t _slot = TDMA_SHARED_SLOT;
+        uint8_t _slots = 0;
+        uint8_t _freeFrom = 0;
+        uint8_t _trySlot = TDMA_SHARED_SLOT;    // Without a slot: where to try this superframe
+        uint16_t _slotMs = 0;
+        uint32_t _beaconAt = 0;
+        uint32_t _beacons = 0;
+
+        // Shared slot backoff
+        uint32_t _sharedAt = 0;         // Shared slot off limits before this time
+        bool _backoff = false;
+        bool _tried = false;            // Sent in the shared slot, answer due in the next beacon
+        uint8_t _window;                // Superframes to pick the next try from
+        uint32_t _random;
+
+        uint32_t next();
+};
+
+#endif // TDMA_H
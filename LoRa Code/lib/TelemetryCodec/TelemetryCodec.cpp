@@ -0,0 +1,284 @@
+#include "TelemetryCodec.h"
+#include <string.h>
+#include <math.h>
+
+// Buoy schema, must stay identical on transmitter and receiver.
+// Bump the schema id when fields are added or reordered.
+static const FieldDef buoyFields[] = {
+    { "temperature", FIELD_FIXED16, 100.0f },   // degC, 0.01 resolution
+    { "battery",     FIELD_UVARINT, 1000.0f },  // V, sent as mV
+    { "uptime",      FIELD_UVARINT, 1.0f },     // s
+};
+
+const TelemetrySchema BuoySchema = { 0x01, buoyFields, sizeof(buoyFields) / sizeof(buoyFields[0]) };
+
+
+////////////////////////////////////////////////////////
+///// Helpers
+////////////////////////////////////////////////////////
+
+size_t writeVarint(uint32_t value, uint8_t* out, size_t capacity) {
+    size_t n = 0;
+    do {
+        if (n >= capacity) {
+            return 0;
+        }
+        uint8_t b = value & 0x7F;
+        value >>= 7;
+        out[n++] = value ? (b | 0x80) : b;
+    } while (value);
+    return n;
+}
+
+size_t readVarint(const uint8_t* in, size_t length, uint32_t* value) {
+    uint32_t result = 0;
+    for (size_t n = 0; n < length && n < 5; n++) {
+        if (n == 4 && in[n] > 0x0F) {
+            return 0; // Fifth byte only holds the top 4 bits of a uint32
+        }
+        result |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *value = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+// Scale and round, clamped to [lo, hi]
+static int64_t quantize(float value, float scale, int64_t lo, int64_t hi) {
+    double scaled = (double)value * scale;
+    if (scaled != scaled) {
+        return 0; // NaN
+    }
+    scaled = floor(scaled + 0.5);
+    if (scaled < (double)lo) return lo;
+    if (scaled > (double)hi) return hi;
+    return (int64_t)scaled;
+}
+
+static float dequantize(int64_t raw, float scale) {
+    return (float)((double)raw / scale);
+}
+
+// Little endian fixed width helpers
+static void putLE(uint8_t* out, uint32_t v, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint32_t getLE(const uint8_t* in, size_t bytes) {
+    uint32_t v = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        v |= (uint32_t)in[i] << (8 * i);
+    }
+    return v;
+}
+
+
+uint32_t fieldToRaw(const FieldDef& field, float value) {
+    switch (field.encoding) {
+        case FIELD_UINT8:   return (uint32_t)quantize(value, field.scale, 0, UINT8_MAX);
+        case FIELD_FIXED16: return (uint32_t)(int32_t)quantize(value, field.scale, INT16_MIN, INT16_MAX);
+        case FIELD_FIXED32:
+        case FIELD_VARINT:  return (uint32_t)(int32_t)quantize(value, field.scale, INT32_MIN, INT32_MAX);
+        case FIELD_UVARINT: return (uint32_t)quantize(value, field.scale, 0, UINT32_MAX);
+        case FIELD_FLOAT32: {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+    }
+    return 0;
+}
+
+float fieldFromRaw(const FieldDef& field, uint32_t raw) {
+    switch (field.encoding) {
+        case FIELD_UINT8:
+        case FIELD_UVARINT: return dequantize(raw, field.scale);
+        case FIELD_FIXED16:
+        case FIELD_FIXED32:
+        case FIELD_VARINT:  return dequantize((int32_t)raw, field.scale);
+        case FIELD_FLOAT32: {
+            float value;
+            memcpy(&value, &raw, sizeof(value));
+            return value;
+        }
+    }
+    return 0.0f;
+}
+
+
+////////////////////////////////////////////////////////
+///// TelemetryCodec
+////////////////////////////////////////////////////////
+
+TelemetryCodec::TelemetryCodec(const TelemetrySchema& schema)
+    : _schema(schema)
+{
+}
+
+size_t TelemetryCodec::maxFrameSize() const {
+    size_t size = TELEMETRY_HEADER_SIZE;
+    for (uint8_t i = 0; i < _schema.fieldCount; i++) {
+        switch (_schema.fields[i].encoding) {
+            case FIELD_UINT8:   size += 1; break;
+            case FIELD_FIXED16: size += 2; break;
+            case FIELD_FIXED32:
+            case FIELD_FLOAT32: size += 4; break;
+            case FIELD_VARINT:
+            case FIELD_UVARINT: size += 5; break;
+        }
+    }
+    return size;
+}
+
+size_t TelemetryCodec::encode(const float* values, uint8_t sequence, uint8_t* out, size_t capacity) const {
+    if (capacity < TELEMETRY_HEADER_SIZE) {
+        return 0;
+    }
+
+    out[0] = TELEMETRY_MAGIC;
+    out[1] = (TELEMETRY_VERSION << 4);
+    out[2] = _schema.id;
+    out[3] = sequence;
+
+    size_t n = encodeFields(values, out + TELEMETRY_HEADER_SIZE, capacity - TELEMETRY_HEADER_SIZE);
+    return n == 0 ? 0 : TELEMETRY_HEADER_SIZE + n;
+}
+
+size_t TelemetryCodec::encodeFields(const float* values, uint8_t* out, size_t capacity) const {
+    if (_schema.fieldCount > TELEMETRY_MAX_FIELDS) {
+        return 0;
+    }
+    size_t pos = 0;
+
+    for (uint8_t i = 0; i < _schema.fieldCount; i++) {
+        const FieldDef& field = _schema.fields[i];
+        size_t left = capacity - pos;
+        size_t n = 0;
+
+        switch (field.encoding) {
+            case FIELD_UINT8:
+                if (left < 1) return 0;
+                out[pos] = (uint8_t)quantize(values[i], field.scale, 0, UINT8_MAX);
+                n = 1;
+                break;
+            case FIELD_FIXED16:
+                if (left < 2) return 0;
+                putLE(out + pos, (uint16_t)(int16_t)quantize(values[i], field.scale, INT16_MIN, INT16_MAX), 2);
+                n = 2;
+                break;
+            case FIELD_FIXED32:
+                if (left < 4) return 0;
+                putLE(out + pos, (uint32_t)(int32_t)quantize(values[i], field.scale, INT32_MIN, INT32_MAX), 4);
+                n = 4;
+                break;
+            case FIELD_FLOAT32: {
+                if (left < 4) return 0;
+                uint32_t bits;
+                memcpy(&bits, &values[i], sizeof(bits));
+                putLE(out + pos, bits, 4);
+                n = 4;
+                break;
+            }
+            case FIELD_VARINT:
+                n = writeVarint(zigzagEncode((int32_t)quantize(values[i], field.scale, INT32_MIN, INT32_MAX)), out + pos, left);
+                break;
+            case FIELD_UVARINT:
+                n = writeVarint((uint32_t)quantize(values[i], field.scale, 0, UINT32_MAX), out + pos, left);
+                break;
+        }
+
+        if (n == 0) {
+            return 0; // Out of space
+        }
+        pos += n;
+    }
+
+    return pos;
+}
+
+bool TelemetryCodec::decode(const uint8_t* frame, size_t length, float* values, uint8_t* sequence) const {
+    if (!hasHeader(frame, length)) {
+        return false;
+    }
+    if (frame[2] != _schema.id) {
+        return false;
+    }
+    if (sequence != nullptr) {
+        *sequence = frame[3];
+    }
+
+    return decodeFields(frame + TELEMETRY_HEADER_SIZE, length - TELEMETRY_HEADER_SIZE, values) > 0;
+}
+
+size_t TelemetryCodec::decodeFields(const uint8_t* in, size_t length, float* values) const {
+    size_t pos = 0;
+
+    for (uint8_t i = 0; i < _schema.fieldCount; i++) {
+        const FieldDef& field = _schema.fields[i];
+        size_t left = length - pos;
+        size_t n = 0;
+
+        switch (field.encoding) {
+            case FIELD_UINT8:
+                if (left < 1) return 0;
+                values[i] = dequantize(in[pos], field.scale);
+                n = 1;
+                break;
+            case FIELD_FIXED16:
+                if (left < 2) return 0;
+                values[i] = dequantize((int16_t)getLE(in + pos, 2), field.scale);
+                n = 2;
+                break;
+            case FIELD_FIXED32:
+                if (left < 4) return 0;
+                values[i] = dequantize((int32_t)getLE(in + pos, 4), field.scale);
+                n = 4;
+                break;
+            case FIELD_FLOAT32: {
+                if (left < 4) return 0;
+                uint32_t bits = getLE(in + pos, 4);
+                memcpy(&values[i], &bits, sizeof(bits));
+                n = 4;
+                break;
+            }
+            case FIELD_VARINT: {
+                uint32_t raw;
+                n = readVarint(in + pos, left, &raw);
+                if (n == 0) return 0;
+                values[i] = dequantize(zigzagDecode(raw), field.scale);
+                break;
+            }
+            case FIELD_UVARINT: {
+                uint32_t raw;
+                n = readVarint(in + pos, left, &raw);
+                if (n == 0) return 0;
+                values[i] = dequantize(raw, field.scale);
+                break;
+            }
+        }
+
+        if (n == 0) {
+            return 0; // Truncated
+        }
+        pos += n;
+    }
+
+    return pos;
+}
+
+bool TelemetryCodec::hasHeader(const uint8_t* data, size_t length) {
+    return length >= TELEMETRY_HEADER_SIZE
+        && data[0] == TELEMETRY_MAGIC
+        && (data[1] >> 4) == TELEMETRY_VERSION;
+}
+
+int TelemetryCodec::peekSchemaId(const uint8_t* data, size_t length) {
+    if (!hasHeader(data, length)) {
+        return -1;
+    }
+    return data[2];
+}
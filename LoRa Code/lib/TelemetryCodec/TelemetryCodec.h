@@ -0,0 +1,134 @@
+#ifndef TELEMETRYCODEC_H
+#define TELEMETRYCODEC_H
+
+//Dependencies
+// Plain C++ only (no Arduino.h) so the codec also builds on a Linux host
+#include <stdint.h>
+#include <stddef.h>
+
+
+////////////////////////////////////////////////////////
+///// Frame format
+////////////////////////////////////////////////////////
+//
+//  byte 0 : magic (0xB7)
+//  byte 1 : version (high nibble) | flags (low nibble)
+//  byte 2 : schema id
+//  byte 3 : sequence number
+//  byte 4+: fields, in schema order, each with its own encoding
+//
+// A float temperature sent as text costs ~10 bytes, as FIELD_FIXED16 it costs 2.
+
+#define TELEMETRY_MAGIC         0xB7
+#define TELEMETRY_VERSION       1
+#define TELEMETRY_HEADER_SIZE   4
+#define TELEMETRY_MAX_FIELDS    16
+
+
+// How a single field is packed on air
+enum FieldEncoding : uint8_t {
+    FIELD_FIXED16 = 0,  // round(value * scale) as int16, 2 bytes
+    FIELD_FIXED32 = 1,  // round(value * scale) as int32, 4 bytes
+    FIELD_VARINT  = 2,  // round(value * scale) zig-zag varint, 1-5 bytes
+    FIELD_UVARINT = 3,  // round(value * scale) unsigned varint, 1-5 bytes
+    FIELD_UINT8   = 4,  // round(value * scale) as uint8, 1 byte
+    FIELD_FLOAT32 = 5   // raw IEEE754 float, 4 bytes (scale ignored)
+};
+
+/**
+ * @brief Description of one field of a telemetry frame
+ */
+struct FieldDef {
+    const char* name;       // For printing only, never sent
+    FieldEncoding encoding;
+    float scale;            // e.g. 100 for 0.01 resolution
+};
+
+/**
+ * @brief Ordered list of fields shared by transmitter and receiver
+ */
+struct TelemetrySchema {
+    uint8_t id;
+    const FieldDef* fields;
+    uint8_t fieldCount;
+};
+
+// Schema used by the buoys (temperature, battery, uptime)
+extern const TelemetrySchema BuoySchema;
+
+
+/**
+ * @brief Schema-driven binary encoder/decoder for telemetry frames
+ *
+ * Values are passed as floats in schema order and quantized according to
+ * each field's encoding. Out of range values are clamped.
+ */
+class TelemetryCodec {
+    public:
+        /**
+         * @brief Construct a codec for one schema
+         *
+         * @param schema Field layout, must outlive the codec
+         */
+        TelemetryCodec(const TelemetrySchema& schema);
+
+        // Worst case encoded size of a frame for this schema
+        size_t maxFrameSize() const;
+
+        /**
+         * @brief Encode one frame
+         *
+         * @param values One value per schema field
+         * @param sequence Sequence number written in the header
+         * @param out Output buffer
+         * @param capacity Size of the output buffer
+         * @return size_t Frame length, 0 if the buffer is too small
+         */
+        size_t encode(const float* values, uint8_t sequence, uint8_t* out, size_t capacity) const;
+
+        /**
+         * @brief Decode one frame
+         *
+         * @param frame Received bytes
+         * @param length Number of received bytes
+         * @param values Output, one value per schema field
+         * @param sequence Output, sequence number from the header (may be nullptr)
+         * @return true Frame valid and matches this schema
+         */
+        bool decode(const uint8_t* frame, size_t length, float* values, uint8_t* sequence = nullptr) const;
+
+        // Fields only, no header (e.g. one sample of a batch). Return bytes written/read, 0 on error.
+        size_t encodeFields(const float* values, uint8_t* out, size_t capacity) const;
+        size_t decodeFields(const uint8_t* in, size_t length, float* values) const;
+
+        // True if a received frame starts with a telemetry header
+        static bool hasHeader(const uint8_t* data, size_t length);
+
+        // Schema id of a received frame, -1 if not a telemetry frame
+        static int peekSchemaId(const uint8_t* data, size_t length);
+
+        const TelemetrySchema& schema() const { return _schema; }
+
+    private:
+        const TelemetrySchema& _schema;
+};
+
+
+////////////////////////////////////////////////////////
+///// Functions
+////////////////////////////////////////////////////////
+
+// LEB128 varint helpers, return bytes written/read (0 on overflow)
+size_t writeVarint(uint32_t value, uint8_t* out, size_t capacity);
+size_t readVarint(const uint8_t* in, size_t length, uint32_t* value);
+
+// Quantized value of a field as it would be sent (FIELD_FLOAT32: the IEEE754 bits), and back.
+// Signed encodings are sign extended, so deltas of two raw values wrap correctly.
+uint32_t fieldToRaw(const FieldDef& field, float value);
+float fieldFromRaw(const FieldDef& field, uint32_t raw);
+
+// Zig-zag mapping so small negative values stay small
+inline uint32_t zigzagEncode(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+inline int32_t zigzagDecode(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+#endif // TELEMETRYCODEC_H
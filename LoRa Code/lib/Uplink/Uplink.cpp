@@ -0,0 +1,235 @@
+#include "Uplink.h"
+#include <string.h>
+
+static_assert((UPLINK_BUFFER_SIZE & (UPLINK_BUFFER_SIZE - 1)) == 0, "UPLINK_BUFFER_SIZE must be a power of two");
+
+
+////////////////////////////////////////////////////////
+///// CRC and COBS
+////////////////////////////////////////////////////////
+
+uint16_t uplinkCrc(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+size_t cobsEncode(const uint8_t* data, size_t length, uint8_t* out) {
+    // Each code byte tells how far the next zero is (0xFF: 254 bytes and no zero)
+    size_t code = 0;
+    size_t write = 1;
+    uint8_t run = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == 0) {
+            out[code] = run;
+            code = write++;
+            run = 1;
+            continue;
+        }
+        out[write++] = data[i];
+        if (++run == 0xFF) {
+            out[code] = run;
+            code = write++;
+            run = 1;
+        }
+    }
+    out[code] = run;
+    return write;
+}
+
+size_t cobsDecode(uint8_t* data, size_t length) {
+    size_t read = 0;
+    size_t write = 0;
+    while (read < length) {
+        uint8_t code = data[read++];
+        if (code == 0 || read + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            data[write++] = data[read++];
+        }
+        if (code != 0xFF && read < length) {
+            data[write++] = 0;
+        }
+    }
+    return write;
+}
+
+static void putU32(uint8_t* out, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+
+////////////////////////////////////////////////////////
+///// UplinkWriter
+////////////////////////////////////////////////////////
+
+UplinkWriter::UplinkWriter(uint32_t flushMs, size_t batchBytes)
+    : _head(0), _tail(0), _flushMs(flushMs), _batchBytes(batchBytes), _frames(0), _dropped(0)
+{
+}
+
+bool UplinkWriter::send(uint8_t type, const uint8_t* data, size_t length, uint32_t now) {
+    if (length > UPLINK_MAX_PAYLOAD) {
+        return false;
+    }
+
+    // Numbered before the room check so the host sees dropped frames as a gap
+    uint16_t sequence = _sequence++;
+
+    uint8_t frame[UPLINK_MAX_FRAME];
+    frame[0] = type;
+    frame[1] = sequence & 0xFF;
+    frame[2] = sequence >> 8;
+    putU32(frame + 3, now);
+    memcpy(frame + UPLINK_HEADER_SIZE, data, length);
+    size_t size = UPLINK_HEADER_SIZE + length;
+    uint16_t crc = uplinkCrc(frame, size);
+    frame[size++] = crc & 0xFF;
+    frame[size++] = crc >> 8;
+
+    // The first frame also gets a leading delimiter, it ends whatever was printed before
+    uint8_t encoded[UPLINK_MAX_ENCODED + 1];
+    size_t count = 0;
+    if (!_started) {
+        encoded[count++] = 0;
+    }
+    count += cobsEncode(frame, size, encoded + count);
+    encoded[count++] = 0;
+
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (UPLINK_BUFFER_SIZE - (head - _tail.load(std::memory_order_acquire)) < count) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t offset = head & (UPLINK_BUFFER_SIZE - 1);
+    size_t first = count < UPLINK_BUFFER_SIZE - offset ? count : UPLINK_BUFFER_SIZE - offset;
+    memcpy(_buffer + offset, encoded, first);
+    memcpy(_buffer, encoded + first, count - first);
+    _head.store(head + count, std::memory_order_release);
+    _frames.fetch_add(1, std::memory_order_relaxed);
+    _started = true;
+    return true;
+}
+
+size_t UplinkWriter::ready(uint32_t now, const uint8_t** data) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    size_t pending = _head.load(std::memory_order_acquire) - tail;
+    if (pending == 0) {
+        _waiting = false;
+        return 0;
+    }
+    if (!_waiting) {
+        _waiting = true;
+        _waitingSince = now;
+    }
+    if (pending < _batchBytes && now - _waitingSince < _flushMs) {
+        return 0;
+    }
+
+    // Up to the end of the buffer, the wrapped part comes on the next call
+    size_t offset = tail & (UPLINK_BUFFER_SIZE - 1);
+    *data = _buffer + offset;
+    return pending < UPLINK_BUFFER_SIZE - offset ? pending : UPLINK_BUFFER_SIZE - offset;
+}
+
+void UplinkWriter::consume(size_t count) {
+    if (count == 0) {
+        return;
+    }
+    uint32_t tail = _tail.load(std::memory_order_relaxed) + count;
+    _tail.store(tail, std::memory_order_release);
+    _bytes += count;
+    _writes++;
+    if (tail == _head.load(std::memory_order_acquire)) {
+        _waiting = false;
+    }
+}
+
+size_t UplinkWriter::buffered() const {
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+}
+
+UplinkStats UplinkWriter::stats() const {
+    UplinkStats stats;
+    stats.frames = _frames.load(std::memory_order_relaxed);
+    stats.dropped = _dropped.load(std::memory_order_relaxed);
+    stats.bytes = _bytes;
+    stats.writes = _writes;
+    return stats;
+}
+
+
+////////////////////////////////////////////////////////
+///// UplinkReader
+////////////////////////////////////////////////////////
+
+UplinkReader::UplinkReader() {
+}
+
+size_t UplinkReader::feed(const uint8_t* data, size_t length) {
+    if (_ready) {
+        _ready = false;
+        _length = 0;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] != 0) {
+            if (_length < sizeof(_frame)) {
+                _frame[_length++] = data[i];
+            }
+            else {
+                _overflow = true;
+            }
+            continue;
+        }
+
+        // Delimiter, empty frames in between are ignored
+        if (_length > 0 || _overflow) {
+            complete();
+        }
+        if (_ready) {
+            return i + 1;
+        }
+    }
+    return length;
+}
+
+void UplinkReader::complete() {
+    size_t length = _overflow ? 0 : cobsDecode(_frame, _length);
+    _overflow = false;
+    _length = 0;
+
+    if (length < UPLINK_HEADER_SIZE + UPLINK_CRC_SIZE
+        || uplinkCrc(_frame, length - UPLINK_CRC_SIZE) != (_frame[length - 2] | (_frame[length - 1] << 8))) {
+        _stats.crcErrors++;
+        return;
+    }
+
+    uint16_t sequence = _frame[1] | (_frame[2] << 8);
+    if (_synced) {
+        _stats.lost += (uint16_t)(sequence - _expected);
+    }
+    _expected = sequence + 1;
+    _synced = true;
+
+    _stats.frames++;
+    _length = length;
+    _ready = true;
+}
+
+uint32_t UplinkReader::timestamp() const {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        value |= (uint32_t)_frame[3 + i] << (8 * i);
+    }
+    return value;
+}
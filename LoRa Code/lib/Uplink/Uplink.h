@@ -0,0 +1,174 @@
+#ifndef UPLINK_H
+#define UPLINK_H
+
+//Dependencies
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+
+////////////////////////////////////////////////////////
+///// Frame format
+////////////////////////////////////////////////////////
+//
+//  byte 0 : type
+//  byte 1 : sequence (16 bit, little endian), counts dropped frames too
+//  byte 3 : timestamp in ms (32 bit, little endian)
+//  byte 7+: payload
+//  last 2 : CRC-16/CCITT-FALSE of everything before (little endian)
+//
+// The whole frame is COBS encoded and ends with a 0x00 delimiter, so the
+// reader resynchronizes on the next zero after any corruption (or text
+// printed before the uplink started) and the CRC rejects what is left.
+
+#define UPLINK_HEADER_SIZE      7
+#define UPLINK_CRC_SIZE         2
+#define UPLINK_MAX_PAYLOAD      128
+#define UPLINK_MAX_FRAME        (UPLINK_HEADER_SIZE + UPLINK_MAX_PAYLOAD + UPLINK_CRC_SIZE)
+#define UPLINK_MAX_ENCODED      (UPLINK_MAX_FRAME + UPLINK_MAX_FRAME / 254 + 2)   // COBS overhead + delimiter
+
+// Writer side buffering
+#define UPLINK_BUFFER_SIZE      4096    // Encoded bytes waiting for the USB, power of two
+#define UPLINK_BATCH_BYTES      256     // Write as soon as this much is waiting
+#define UPLINK_FLUSH_MS         20      // Or once the oldest byte waited this long
+
+// Frame types
+enum UplinkType : uint8_t {
+    UPLINK_LORA_FRAME   = 0x01,     // Received LoRa frame as is
+    UPLINK_TELEMETRY    = 0x02,     // Decoded sample: node id (16 bit, 0 if none), sequence, one float per schema field
+    UPLINK_TEXT         = 0x03      // Log line
+};
+
+uint16_t uplinkCrc(const uint8_t* data, size_t length);
+
+// COBS encode, out needs length + length / 254 + 1 bytes, returns bytes written (no delimiter)
+size_t cobsEncode(const uint8_t* data, size_t length, uint8_t* out);
+
+// COBS decode in place, returns decoded length, 0 if malformed
+size_t cobsDecode(uint8_t* data, size_t length);
+
+
+/**
+ * @brief Writer counters
+ */
+struct UplinkStats {
+    uint32_t frames;        // Frames buffered
+    uint32_t dropped;       // Frames refused because the buffer was full (USB not read)
+    uint32_t bytes;         // Encoded bytes handed to the serial port
+    uint32_t writes;        // Serial writes
+};
+
+
+/**
+ * @brief Encodes frames into a byte ring drained by batched serial writes
+ *
+ * One task calls send() (e.g. the LoRa receive task), another takes the
+ * encoded bytes with ready()/consume() and writes them to the serial port.
+ * Neither blocks the other: a frame that does not fit is dropped and the
+ * sequence number shows the gap to the host.
+ */
+class UplinkWriter {
+    public:
+        UplinkWriter(uint32_t flushMs = UPLINK_FLUSH_MS, size_t batchBytes = UPLINK_BATCH_BYTES);
+
+        ////////////////////////////////////////////////////////
+        ///// Producer side
+        ////////////////////////////////////////////////////////
+
+        /**
+         * @brief Encode one frame into the buffer
+         *
+         * @param type UplinkType
+         * @param data Payload
+         * @param length At most UPLINK_MAX_PAYLOAD bytes
+         * @param now Time in ms, written in the frame
+         * @return false Too big, or the buffer is full (counted as dropped)
+         */
+        bool send(uint8_t type, const uint8_t* data, size_t length, uint32_t now);
+
+        ////////////////////////////////////////////////////////
+        ///// Consumer side
+        ////////////////////////////////////////////////////////
+
+        /**
+         * @brief Bytes to write now, in one contiguous run
+         *
+         * @param now Time in ms
+         * @param data Set to the first byte
+         * @return size_t Bytes available, 0 until a batch is full or the flush time passed
+         */
+        size_t ready(uint32_t now, const uint8_t** data);
+
+        // Bytes actually written out of what ready() gave
+        void consume(size_t count);
+
+        size_t buffered() const;
+        UplinkStats stats() const;
+
+    private:
+        uint8_t _buffer[UPLINK_BUFFER_SIZE];
+        std::atomic<uint32_t> _head;    // Written by producer only
+        std::atomic<uint32_t> _tail;    // Written by consumer only
+        uint16_t _sequence = 0;
+        bool _started = false;          // A frame is in the stream
+
+        uint32_t _flushMs;
+        size_t _batchBytes;
+        bool _waiting = false;          // Consumer saw bytes it has not written yet
+        uint32_t _waitingSince = 0;
+
+        std::atomic<uint32_t> _frames;
+        std::atomic<uint32_t> _dropped;
+        uint32_t _bytes = 0;
+        uint32_t _writes = 0;
+};
+
+
+/**
+ * @brief Reader counters
+ */
+struct UplinkReaderStats {
+    uint32_t frames;        // Frames with a good CRC
+    uint32_t crcErrors;     // Frames rejected (bad CRC, malformed COBS, too short or too long)
+    uint32_t lost;          // Frames missing from the sequence (dropped by the writer or corrupted)
+};
+
+/**
+ * @brief Host side: splits a byte stream into checked frames
+ */
+class UplinkReader {
+    public:
+        UplinkReader();
+
+        /**
+         * @brief Feed received bytes
+         *
+         * @param data Bytes read from the serial port
+         * @param length Number of bytes
+         * @return size_t Bytes used, stops right after a complete frame (feed the rest again)
+         */
+        size_t feed(const uint8_t* data, size_t length);
+
+        // A frame completed by the last feed(), valid until the next feed()
+        bool available() const { return _ready; }
+        uint8_t type() const { return _frame[0]; }
+        uint16_t sequence() const { return _frame[1] | (_frame[2] << 8); }
+        uint32_t timestamp() const;
+        const uint8_t* payload() const { return _frame + UPLINK_HEADER_SIZE; }
+        size_t payloadLength() const { return _length - UPLINK_HEADER_SIZE - UPLINK_CRC_SIZE; }
+
+        UplinkReaderStats stats() const { return _stats; }
+
+    private:
+        uint8_t _frame[UPLINK_MAX_ENCODED];
+        size_t _length = 0;
+        bool _overflow = false;         // Current frame is too long, skip to the delimiter
+        bool _ready = false;
+        bool _synced = false;           // A sequence number was seen
+        uint16_t _expected = 0;
+        UplinkReaderStats _stats = {};
+
+        void complete();
+};
+
+#endif // UPLINK_H
@@ -0,0 +1,25 @@
+#include "bench.h"
+
+uint32_t testSeconds = 5;
+
+void putU32(uint8_t* out, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) {
+        out[i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+uint32_t getU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+void peerWrite(HardwareSerial& serial, const uint8_t* data, size_t length) {
+    uint8_t packet[LORA_SUBPACKET_SIZE] = { 0xFF, 0xFF, 0 };
+    memcpy(packet + LORA_FIXED_HEADER_SIZE, data, length);
+    serial.write(packet, LORA_FIXED_HEADER_SIZE + length);
+}
+
+void printRate(const char* name, uint32_t frames, uint32_t payloadBytes, unsigned long elapsedMs) {
+    float seconds = elapsedMs / 1000.0f;
+    Serial.printf("%-24s %6u frames  %8.1f frames/s  %8.1f payload B/s\n",
+                  name, (unsigned)frames, frames / seconds, payloadBytes / seconds);
+}
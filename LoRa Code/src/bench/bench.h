@@ -0,0 +1,119 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Native env benches, run in turn by emulator.cpp. One file per library,
+// they measure and print: pass/fail checks live in the test/ suites.
+
+//Dependencies
+#include "LoRaConfig.h"
+#include "E32Emulator.h"
+#include "../pinDef.h"
+#include <stdio.h>
+
+// Module address and channel (same as transmitter.cpp / receiver.cpp)
+#define NODE_ADDH 0x01
+#define NODE_ADDL 0x02
+#define NODE_CHANNEL 0x30
+
+// Pins of the emulated boards (GPIO table only)
+#define NATIVE_AUX_PIN 12   // Module A, wired so the AUX driven paths run
+#define PEER_M0 20
+#define PEER_M1 21
+#define PEER_AUX 22
+#define SECOND_M0 23        // Second gateway module, own LoRa instance on UART 3
+#define SECOND_M1 24
+#define SECOND_AUX 25
+#define SECOND_RX 5         // Same UART pins as the board's (pinDef.h only has them with RECEIVER_SECOND_MODULE)
+#define SECOND_TX 4
+#define SENDER_M0 26        // Second buoy, raw module on UART 0
+#define SENDER_M1 27
+#define SENDER_AUX 28
+
+#define BENCH_PAYLOAD 20
+#define BENCH_ACCESS_MAX_NODES 120
+#define BENCH_ACCESS_MAX_CHANNELS 4     // Gateway with one module per channel
+#define BENCH_CAD_SYMBOLS 2     // What a power saving receiver listens for at each wake-up
+
+// Seconds per timed bench, first argument of the emulator
+extern uint32_t testSeconds;
+
+void putU32(uint8_t* out, uint32_t v);
+uint32_t getU32(const uint8_t* in);
+
+// A peer frame goes out like LoRa::send() writes it: ADDH/ADDL/CHAN, then the frame
+void peerWrite(HardwareSerial& serial, const uint8_t* data, size_t length);
+
+void printRate(const char* name, uint32_t frames, uint32_t payloadBytes, unsigned long elapsedMs);
+
+// What module B hands to its UART. Transparent mode keeps the 3 byte header,
+// frames are counted from bytes since back to back frames may share a packet.
+struct PeerSink {
+    uint32_t bytes = 0;
+
+    void poll() {
+        uint8_t buf[64];
+        size_t n;
+        while ((n = Serial2.read(buf, sizeof(buf))) > 0) {
+            bytes += n;
+        }
+    }
+
+    uint32_t frames() const { return bytes / (BENCH_PAYLOAD + LORA_FIXED_HEADER_SIZE); }
+};
+
+
+////////////////////////////////////////////////////////
+///// LoRaConfig (benchLoRa.cpp)
+////////////////////////////////////////////////////////
+
+void benchSendMessage(LoRa& lora, E32Emulator& peer);
+void benchEnqueue(LoRa& lora);
+void benchRadioTask(LoRa& lora);
+void benchReceive(LoRa& lora);
+void benchRxBurst(LoRa& lora, RxDropPolicy policy);
+void benchDualRadio(LoRa& lora, E32Emulator& peer, AirChannel& air);
+void benchWakeUp(LoRa& lora, E32Emulator& peer);
+
+
+////////////////////////////////////////////////////////
+///// Fragmenter, Arq, PacketFec
+////////////////////////////////////////////////////////
+
+void benchFragments(LoRa& lora);
+void benchReliable(LoRa& lora, uint8_t window);
+void benchFec(LoRa& lora, uint8_t k, uint8_t m);
+void benchFecCodec(uint8_t k, uint8_t m);
+
+
+////////////////////////////////////////////////////////
+///// Gateway side: Uplink, NodeTable
+////////////////////////////////////////////////////////
+
+void benchUplink();
+void benchNodeTable();
+
+
+////////////////////////////////////////////////////////
+///// Channel access: Tdma, Csma, ChannelPlan, Airtime
+////////////////////////////////////////////////////////
+
+enum AccessMode {
+    ACCESS_ALOHA,       // Send as soon as a frame is ready
+    ACCESS_CSMA,        // Carrier sense on what the E32 shows: received packets only
+    ACCESS_CSMA_CAD,    // Same backoff with a radio that detects a preamble (not the E32)
+    ACCESS_TDMA         // Beacon synchronized slots
+};
+
+void benchAccess(uint16_t nodes, AccessMode mode, uint8_t channels = 1);
+void benchCsma(LoRa& lora, AirChannel& air, bool enabled);
+void benchChannels(LoRa& lora, E32Emulator& peer);
+void benchDutyCycle(LoRa& lora, size_t payloadSize);
+
+
+////////////////////////////////////////////////////////
+///// SeriesCodec
+////////////////////////////////////////////////////////
+
+void benchSeries();
+
+#endif // BENCH_H
@@ -0,0 +1,288 @@
+// Channel access: simulated ALOHA, CSMA and TDMA, then CSMA on the emulated link
+#include "bench.h"
+#include "Tdma.h"
+#include "Csma.h"
+#include "ChannelPlan.h"
+
+#define BENCH_ACCESS_PERIOD_MS 30000    // One full frame per buoy this often
+#define BENCH_ACCESS_SECONDS 3600       // Simulated time per node count
+#define BENCH_ACCESS_BEACON_LOSS 5      // % of beacons a buoy misses
+#define BENCH_CSMA_GAP_MS 600        // Mean time between frames of each module
+
+// One packet on the shared channel, lost if anything else is on air meanwhile
+struct SimPacket {
+    uint32_t start;
+    uint32_t end;
+    int16_t sender;     // -1 for the beacon
+    bool collided;
+};
+
+struct SimChannel {
+    SimPacket onAir[BENCH_ACCESS_MAX_NODES + 1];
+    uint8_t count = 0;
+
+    void start(uint32_t now, uint32_t airtimeMs, int16_t sender) {
+        bool busy = count > 0;
+        for (uint8_t i = 0; i < count; i++) {
+            onAir[i].collided = true;
+        }
+        onAir[count++] = { now, now + airtimeMs, sender, busy };
+    }
+
+    // Next packet over at this time, false when none
+    bool finish(uint32_t now, SimPacket* out) {
+        for (uint8_t i = 0; i < count; i++) {
+            if (onAir[i].end == now) {
+                *out = onAir[i];
+                onAir[i] = onAir[--count];
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+
+// Buoys sending one full frame per period to one gateway at 2.4 kbps, with drifting
+// clocks and lost beacons. Time steps by 1 ms, every buoy runs its own CsmaBackoff or
+// TdmaSchedule on its own clock. With several channels the buoys are split by id
+// (ChannelPlan) and the gateway has a module, and a coordinator, on each.
+void benchAccess(uint16_t nodes, AccessMode mode, uint8_t channels) {
+    static TdmaSchedule schedules[BENCH_ACCESS_MAX_NODES];
+    static CsmaBackoff backoffs[BENCH_ACCESS_MAX_NODES];
+    static int32_t drift[BENCH_ACCESS_MAX_NODES];       // ppm
+    static uint32_t nextFrame[BENCH_ACCESS_MAX_NODES];
+    static uint32_t nextCheck[BENCH_ACCESS_MAX_NODES];
+    static uint8_t backlog[BENCH_ACCESS_MAX_NODES];
+    static uint8_t group[BENCH_ACCESS_MAX_NODES];       // Channel of each buoy
+    static bool sending[BENCH_ACCESS_MAX_NODES];
+    static SimChannel air[BENCH_ACCESS_MAX_CHANNELS];
+    static TdmaCoordinator coordinators[BENCH_ACCESS_MAX_CHANNELS];
+    static uint8_t beacons[BENCH_ACCESS_MAX_CHANNELS][LORA_PAYLOAD_MAX];
+    static size_t beaconLengths[BENCH_ACCESS_MAX_CHANNELS];
+
+    AirtimeModel model(AIR_DATA_RATE_010_24);
+    uint32_t airtime = (model.packetUs(MAX_SIZE_TX_PACKET) + 999) / 1000;
+    uint32_t uartMs = (MAX_SIZE_TX_PACKET * 10 * 1000) / LORA_UART_BAUD + 1;
+    uint32_t detectMs = (BENCH_CAD_SYMBOLS * model.symbolUs() + 999) / 1000;
+    ChannelPlan plan(0, channels);
+    uint8_t slots = (nodes + channels - 1) / channels + 1;
+    for (uint8_t c = 0; c < channels; c++) {
+        air[c].count = 0;
+        coordinators[c] = TdmaCoordinator(slots, TdmaCoordinator::slotMsFor(airtime, 1, slots));
+        beaconLengths[c] = 0;
+    }
+
+    uint32_t seed = 7;
+    auto random = [&seed](uint32_t range) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 8) % range;
+    };
+    for (uint16_t i = 0; i < nodes; i++) {
+        schedules[i] = TdmaSchedule(0x0100 + i);
+        backoffs[i] = CsmaBackoff(mode == ACCESS_CSMA_CAD ? detectMs + 1 : airtime, 0x0100 + i);
+        drift[i] = (int32_t)random(2 * TDMA_CLOCK_PPM + 1) - TDMA_CLOCK_PPM;
+        nextFrame[i] = random(BENCH_ACCESS_PERIOD_MS);
+        nextCheck[i] = UINT32_MAX;
+        backlog[i] = 0;
+        group[i] = plan.channelForNode(0x0100 + i);
+        sending[i] = false;
+    }
+    auto localTime = [](uint16_t node, uint32_t now) {
+        return (uint32_t)(now + (int64_t)now * drift[node] / 1000000);
+    };
+    // Every buoy on the channel not sending sees it busy for this long
+    auto sense = [nodes](uint8_t channel, uint32_t now, uint32_t holdMs) {
+        for (uint16_t i = 0; i < nodes; i++) {
+            if (group[i] == channel && !sending[i]) {
+                backoffs[i].onBusy(now, holdMs);
+                nextCheck[i] = now;
+            }
+        }
+    };
+
+    uint32_t offered = 0;
+    uint32_t overflow = 0;
+    uint32_t delivered = 0;
+    uint32_t collided = 0;
+    uint32_t beaconAirMs = 0;
+    uint32_t endMs = BENCH_ACCESS_SECONDS * 1000UL;
+
+    for (uint32_t now = 0; now < endMs; now++) {
+        for (uint8_t c = 0; c < channels; c++) {
+            SimChannel& channel = air[c];
+
+            // A preamble detector notices a packet a few symbols in
+            for (uint8_t p = 0; mode == ACCESS_CSMA_CAD && p < channel.count; p++) {
+                if (channel.onAir[p].start + detectMs == now) {
+                    sense(c, now, channel.onAir[p].end - now + LORA_CSMA_IFS_MS);
+                }
+            }
+
+            // Packets over: the gateway hears data frames, the buoys the beacon
+            SimPacket packet;
+            while (channel.finish(now, &packet)) {
+                if (mode == ACCESS_CSMA && !packet.collided) {
+                    // The E32 only shows a packet once received, while it goes out on the UART
+                    sense(c, now, uartMs + LORA_CSMA_IFS_MS);
+                }
+                if (packet.sender < 0) {
+                    for (uint16_t i = 0; i < nodes && !packet.collided; i++) {
+                        if (group[i] == c && !sending[i] && random(100) >= BENCH_ACCESS_BEACON_LOSS) {
+                            schedules[i].onBeacon(beacons[c], beaconLengths[c],
+                                                  localTime(i, now + random(TDMA_SYNC_JITTER_MS)));
+                            nextCheck[i] = now;
+                        }
+                    }
+                    continue;
+                }
+                sending[packet.sender] = false;
+                nextCheck[packet.sender] = now;
+                if (packet.collided) {
+                    collided++;
+                    continue;
+                }
+                delivered++;
+                coordinators[c].assign(schedules[packet.sender].node());
+            }
+
+            if (mode == ACCESS_TDMA && coordinators[c].beaconDue(now)) {
+                beaconLengths[c] = coordinators[c].beacon(beacons[c], LORA_PAYLOAD_MAX, now);
+                uint32_t beaconAir = (model.packetUs(beaconLengths[c] + LORA_FIXED_HEADER_SIZE) + 999) / 1000;
+                channel.start(now, beaconAir, -1);
+                beaconAirMs += beaconAir;
+            }
+        }
+
+        for (uint16_t i = 0; i < nodes; i++) {
+            if (now == nextFrame[i]) {
+                // Sampling clocks jitter a little, as on the buoys
+                nextFrame[i] += BENCH_ACCESS_PERIOD_MS - 50 + random(101);
+                offered++;
+                if (backlog[i] < LORA_TX_QUEUE_SLOTS) {
+                    backlog[i]++;
+                    nextCheck[i] = now;
+                }
+                else {
+                    overflow++;
+                }
+            }
+            if (backlog[i] == 0 || sending[i] || now < nextCheck[i]) {
+                continue;
+            }
+            uint32_t wait = 0;
+            if (mode == ACCESS_TDMA) {
+                wait = schedules[i].delayMs(localTime(i, now), airtime);
+            }
+            else if (mode != ACCESS_ALOHA) {
+                wait = backoffs[i].delayMs(now);
+            }
+            if (wait > 0) {
+                nextCheck[i] = wait == UINT32_MAX ? UINT32_MAX : now + wait;
+                continue;
+            }
+            backlog[i]--;
+            sending[i] = true;
+            schedules[i].onSent(localTime(i, now));
+            backoffs[i].onSent();
+            air[group[i]].start(now, airtime, i);
+        }
+    }
+
+    uint32_t waiting = 0;
+    uint32_t backoffCount = 0;
+    for (uint16_t i = 0; i < nodes; i++) {
+        waiting += backlog[i];
+        backoffCount += backoffs[i].stats().backoffs;
+    }
+    static const char* const names[] = { "ALOHA", "CSMA", "CSMA (preamble detect)", "TDMA" };
+    char name[32];
+    if (channels > 1) {
+        snprintf(name, sizeof(name), "%s %u, %u channels", names[mode], nodes, channels);
+    }
+    else {
+        snprintf(name, sizeof(name), "%s %u", names[mode], nodes);
+    }
+    // Load and use per channel
+    uint32_t channelMs = endMs * channels;
+    Serial.printf("%-28s load %5.1f %%, used %5.1f %%, %5.1f %% delivered, %u collided, %u queued, %u overflow",
+                  name, 100.0f * offered * airtime / channelMs, 100.0f * delivered * airtime / channelMs,
+                  100.0f * delivered / offered, (unsigned)collided, (unsigned)waiting, (unsigned)overflow);
+    if (mode == ACCESS_TDMA) {
+        uint16_t assigned = 0;
+        for (uint8_t c = 0; c < channels; c++) {
+            assigned += coordinators[c].assigned();
+        }
+        Serial.printf(", %u slots given, slot %u ms, guard %u ms, beacons %.1f %%", assigned,
+                      coordinators[0].slotMs(), (unsigned)tdmaGuardMs(coordinators[0].superframeMs()),
+                      100.0f * beaconAirMs / channelMs);
+    }
+    else if (mode != ACCESS_ALOHA) {
+        Serial.printf(", %u backoffs, slot %u ms", (unsigned)backoffCount, (unsigned)backoffs[0].slotMs());
+    }
+    Serial.println();
+}
+
+// Both modules sending at random: packets lost to collisions with and without carrier sense
+void benchCsma(LoRa& lora, AirChannel& air, bool enabled) {
+    uint8_t payload[BENCH_PAYLOAD] = {};
+    uint8_t frame[LORA_RX_BUFFER_SIZE];
+    lora.beginReceiveTask();
+    lora.setCsma(enabled);
+    delay(300);
+    while (lora.receive(frame, sizeof(frame)) > 0) {
+    }
+    while (Serial2.read() >= 0) {
+    }
+
+    uint32_t packets = air.packets();
+    uint32_t collisions = air.collisions();
+    uint32_t seed = 3;
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    PeerSink peer;
+    unsigned long nextOwn = millis();
+    unsigned long nextPeer = millis();
+    unsigned long start = millis();
+    while (millis() - start < testSeconds * 1000) {
+        lora.update();
+        unsigned long now = millis();
+        if ((long)(now - nextOwn) >= 0) {
+            seed = seed * 1103515245 + 12345;
+            nextOwn = now + BENCH_CSMA_GAP_MS / 2 + (seed >> 16) % BENCH_CSMA_GAP_MS;
+            if (lora.enqueue(payload, sizeof(payload)) >= 0) {
+                sent++;
+            }
+        }
+        if ((long)(now - nextPeer) >= 0 && digitalRead(PEER_AUX) == HIGH) {
+            seed = seed * 1103515245 + 12345;
+            nextPeer = now + BENCH_CSMA_GAP_MS / 2 + (seed >> 16) % BENCH_CSMA_GAP_MS;
+            peerWrite(Serial2, payload, sizeof(payload));
+            sent++;
+        }
+        while (lora.receive(frame, sizeof(frame)) > 0) {
+            received++;
+        }
+        peer.poll();
+        delayMicroseconds(200);
+    }
+    lora.flushTx(5000);
+    delay(500);
+    while (lora.receive(frame, sizeof(frame)) > 0) {
+        received++;
+    }
+    peer.poll();
+
+    CsmaStats stats = lora.getCsmaStats();
+    lora.setCsma(false);
+    lora.endReceiveTask();
+
+    Serial.printf("%-24s %u packets, %u collided on air, %u of %u frames through\n",
+                  enabled ? "CSMA on" : "CSMA off", (unsigned)(air.packets() - packets),
+                  (unsigned)(air.collisions() - collisions), (unsigned)(received + peer.frames()), (unsigned)sent);
+    if (enabled) {
+        Serial.printf("%-24s %u found busy, %u backoffs (%u ms), %u collisions seen, window %u\n", "",
+                      (unsigned)stats.busy, (unsigned)stats.backoffs, (unsigned)stats.backoffMs,
+                      (unsigned)stats.collisions, stats.window);
+    }
+}
@@ -0,0 +1,51 @@
+// Duty cycle limit (Airtime) on a saturated queue
+#include "bench.h"
+
+#define BENCH_DUTY_PERMILLE 100 // 10 % so a short test reaches the limit
+#define BENCH_DUTY_WINDOW_MS 10000
+
+// Saturated queue under a duty cycle: small frames against full ones for the same budget
+void benchDutyCycle(LoRa& lora, size_t payloadSize) {
+    uint8_t payload[LORA_PAYLOAD_MAX] = {};
+    uint32_t bytes = 0;
+    uint32_t queued = 0;
+
+    delay(500);
+    while (Serial2.read() >= 0) {
+    }
+
+    lora.setDutyCycle(BENCH_DUTY_PERMILLE, BENCH_DUTY_WINDOW_MS);
+    AirtimeStats before = lora.getAirtimeStats();
+    unsigned long start = millis();
+    while (millis() - start < testSeconds * 1000) {
+        lora.update();
+        if (lora.txQueueFree() > 0) {
+            putU32(payload, queued);
+            if (lora.enqueue(payload, payloadSize) >= 0) {
+                queued++;
+            }
+        }
+        uint8_t buf[64];
+        size_t n;
+        while ((n = Serial2.read(buf, sizeof(buf))) > 0) {
+            bytes += n;
+        }
+        delayMicroseconds(200);
+    }
+    unsigned long elapsed = millis() - start;
+    AirtimeStats after = lora.getAirtimeStats();
+
+    // Leave the rest of the queue to go out unthrottled
+    lora.setDutyCycle(0);
+    lora.flushTx(5000);
+
+    uint32_t frames = bytes / (payloadSize + LORA_FIXED_HEADER_SIZE);
+    char name[32];
+    snprintf(name, sizeof(name), "duty cycle (%u B)", (unsigned)payloadSize);
+    printRate(name, frames, frames * payloadSize, elapsed);
+    uint32_t used = after.usedMs - before.usedMs;
+    Serial.printf("%-24s %u ms on air of %u ms (%.1f %%, %u ms per %u ms window), %u deferred, %u ms per frame\n", "",
+                  (unsigned)used, (unsigned)elapsed, 100.0f * used / elapsed, (unsigned)after.budgetMs,
+                  (unsigned)BENCH_DUTY_WINDOW_MS, (unsigned)(after.deferred - before.deferred),
+                  (unsigned)lora.airtimeMs(payloadSize));
+}
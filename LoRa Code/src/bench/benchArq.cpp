@@ -0,0 +1,71 @@
+// Reliable mode (Arq) through the LoRa class
+#include "bench.h"
+#include "Arq.h"
+
+// Reliable mode towards a peer running ArqReceiver on its raw UART
+void benchReliable(LoRa& lora, uint8_t window) {
+    ArqReceiver peer;
+    peer.setAckTimeout(1000);
+    uint8_t payload[ARQ_PAYLOAD] = {};
+    uint8_t frame[64];
+    uint8_t unused[LORA_RX_BUFFER_SIZE];
+    size_t frameLength = 0;
+    unsigned long lastByte = 0;
+    uint32_t offered = 0;
+    uint32_t delivered = 0;
+
+    // Frames of the previous test still on their way would look like another session
+    delay(500);
+    while (Serial2.read() >= 0) {
+    }
+
+    lora.setReliable(true, window);
+    unsigned long start = millis();
+    while (millis() - start < testSeconds * 1000) {
+        lora.update();
+        lora.readMessage(unused, sizeof(unused)); // Picks up the ACKs
+
+        if (lora.reliableWindowFree()) {
+            putU32(payload, offered);
+            if (lora.sendReliable(payload, sizeof(payload))) {
+                offered++;
+            }
+        }
+
+        // Peer: split the UART stream on the gap, answer with ACKs
+        int c;
+        while ((c = Serial2.read()) >= 0) {
+            if (frameLength < sizeof(frame)) {
+                frame[frameLength++] = (uint8_t)c;
+            }
+            lastByte = millis();
+        }
+        if (frameLength > 0 && millis() - lastByte >= LORA_RX_GAP_MS) {
+            peer.accept(frame + LORA_FIXED_HEADER_SIZE, frameLength - LORA_FIXED_HEADER_SIZE, millis());
+            frameLength = 0;
+        }
+        if (peer.ackDue(millis()) && digitalRead(PEER_AUX) == HIGH) {
+            size_t length = peer.ack(frame, sizeof(frame));
+            peerWrite(Serial2, frame, length);
+        }
+        uint8_t received[ARQ_PAYLOAD];
+        while (peer.read(received, sizeof(received)) > 0) {
+            delivered++;
+        }
+        delayMicroseconds(200);
+    }
+    unsigned long elapsed = millis() - start;
+
+    ArqStats stats = lora.getArqStats();
+    ArqStats peerStats = peer.stats();
+    lora.setReliable(false);
+    lora.flushTx(5000);
+
+    char name[32];
+    snprintf(name, sizeof(name), "sendReliable (window %u)", (unsigned)window);
+    printRate(name, delivered, delivered * sizeof(payload), elapsed);
+    Serial.printf("%-24s %u offered, %u retransmits, %u timeouts, %u given up, %u duplicates\n", "",
+                  (unsigned)offered, (unsigned)stats.retransmits, (unsigned)stats.timeouts, (unsigned)stats.failed,
+                  (unsigned)peerStats.duplicates);
+    Serial.printf("%-24s srtt %u ms, rto %u ms\n", "", (unsigned)stats.srttMs, (unsigned)stats.rtoMs);
+}
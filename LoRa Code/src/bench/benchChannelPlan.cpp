@@ -0,0 +1,112 @@
+// Retunes and channel hopping (ChannelPlan)
+#include "bench.h"
+#include "ChannelPlan.h"
+
+#define BENCH_RETUNES 20
+#define BENCH_HOP_CHANNELS 4
+#define BENCH_HOP_DWELL_MS 1000         // Sync, then a frame and the guard, must fit in one hop at 2.4 kbps
+#define BENCH_HOP_SECONDS 15
+#define BENCH_HOP_GAP_MS 250            // Between frames of the buoy while hopping
+
+// Retune time, then the LoRa module as a buoy following a hopping gateway played by
+// the peer: the peer retunes at every hop and sends the sync, the buoy sends frames
+void benchChannels(LoRa& lora, E32Emulator& peer) {
+    E32Registers registers = peer.getRegisters();
+    ChannelPlan plan(registers.chan, BENCH_HOP_CHANNELS);
+    uint8_t payload[BENCH_PAYLOAD] = {};
+    uint8_t frame[LORA_RX_BUFFER_SIZE];
+    PeerSink sink;
+
+    unsigned long start = millis();
+    uint32_t retunes = 0;
+    for (uint8_t i = 1; i <= BENCH_RETUNES; i++) {
+        retunes += lora.setChannel(plan.channel(i)) ? 1 : 0;
+    }
+    float retuneMs = (float)(millis() - start) / BENCH_RETUNES;
+
+    // One frame from another channel, one from the peer's
+    lora.setChannel(plan.channel(1));
+    lora.send(payload, sizeof(payload));
+    delay(500);
+    sink.poll();
+    uint32_t heardOther = sink.frames();
+    lora.setChannel(plan.channel(0));
+    lora.send(payload, sizeof(payload));
+    delay(500);
+    sink.poll();
+    Serial.printf("%-24s %.1f ms each (%u/%u), other channel %u/1 heard, same channel %u/1\n", "setChannel()",
+                  retuneMs, (unsigned)retunes, BENCH_RETUNES, (unsigned)heardOther,
+                  (unsigned)(sink.frames() - heardOther));
+
+    const uint32_t seed = 0x0102;
+    HopSchedule gateway(plan, seed, BENCH_HOP_DWELL_MS);
+    lora.setHopping(plan, seed, BENCH_HOP_DWELL_MS, false);
+    while (lora.receive(frame, sizeof(frame)) > 0) {
+    }
+    sink = PeerSink();
+
+    uint32_t lastHop = UINT32_MAX;
+    uint32_t hops = 0;
+    uint32_t queued = 0;
+    uint32_t loraRetunes = 0;
+    uint32_t followedMs = 0;
+    uint32_t inStepMs = 0;
+    unsigned long sampledAt = 0;
+    uint8_t channel = lora.getChannel();
+    long syncedAfter = -1;
+    start = millis();
+    gateway.start(start);
+    unsigned long nextOwn = start;
+    while (millis() - start < BENCH_HOP_SECONDS * 1000UL) {
+        unsigned long now = millis();
+        uint32_t hop = gateway.hop(now);
+        if (hop != lastHop) {
+            // Gateway side: retune, then the sync as the first frame
+            E32Registers hopped = registers;
+            hopped.chan = gateway.channelAt(hop);
+            peer.setRegisters(hopped, false);
+            uint8_t sync[HOP_SYNC_SIZE];
+            peerWrite(Serial2, sync, gateway.writeSync(sync, now));
+            lastHop = hop;
+            hops++;
+        }
+        if ((long)(now - nextOwn) >= 0 && lora.enqueue(payload, sizeof(payload)) >= 0) {
+            queued++;
+            nextOwn = now + BENCH_HOP_GAP_MS;
+        }
+
+        lora.update();
+        while (lora.readMessage(frame, sizeof(frame)) > 0) {
+        }
+        if (lora.getChannel() != channel) {
+            channel = lora.getChannel();
+            loraRetunes++;
+        }
+        now = millis();
+        bool synced = lora.getHopSchedule().synced(now);
+        if (syncedAfter < 0 && synced) {
+            syncedAfter = now - start;
+        }
+        if (syncedAfter >= 0) {
+            // Time weighted, a retune blocks update() for a while
+            uint32_t stepMs = sampledAt == 0 ? 0 : now - sampledAt;
+            followedMs += stepMs;
+            inStepMs += (synced && channel == gateway.channelAt(gateway.hop(now))) ? stepMs : 0;
+            sampledAt = now;
+        }
+        sink.poll();
+        delayMicroseconds(200);
+    }
+    lora.disableHopping();
+    lora.flushTx(5000);
+    delay(500);
+    sink.poll();
+    lora.setChannel(registers.chan);
+    peer.setRegisters(registers, false);
+
+    char name[32];
+    snprintf(name, sizeof(name), "hopping %u ch, %u ms", BENCH_HOP_CHANNELS, BENCH_HOP_DWELL_MS);
+    Serial.printf("%-24s in step after %ld ms, then %.1f %% of the time, %u hops, %u retunes, %u/%u frames through\n",
+                  name, syncedAfter, followedMs > 0 ? 100.0f * inStepMs / followedMs : 0.0f, (unsigned)hops,
+                  (unsigned)loraRetunes, (unsigned)sink.frames(), (unsigned)queued);
+}
@@ -0,0 +1,84 @@
+// Fragmented messages through the LoRa class
+#include "bench.h"
+#include "Fragmenter.h"
+
+#define BENCH_MESSAGE 500   // Fragmented burst
+
+// Bursts larger than a packet: enqueueMessage() out, readMessage() in
+void benchFragments(LoRa& lora) {
+    static uint8_t message[BENCH_MESSAGE];
+    static uint8_t rebuilt[FRAG_MAX_MESSAGE];
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = (uint8_t)i;
+    }
+
+    // Out: the peer splits its UART stream on the 5 ms gap and reassembles
+    Reassembler peerReassembler;
+    uint8_t frame[64];
+    size_t frameLength = 0;
+    unsigned long lastByte = 0;
+    uint32_t sent = 0;
+    uint32_t intact = 0;
+
+    unsigned long start = millis();
+    // Runs on after the test time until the last burst is off the air and out of the peer
+    unsigned long drainUntil = 0;
+    while (millis() - start < testSeconds * 1000 || (long)(drainUntil - millis()) > 0) {
+        lora.update();
+        if (lora.messagePending() || !lora.txIdle()) {
+            drainUntil = millis() + 500;
+        }
+        if (!lora.messagePending() && millis() - start < testSeconds * 1000) {
+            putU32(message, sent);
+            if (lora.enqueueMessage(message, sizeof(message))) {
+                sent++;
+            }
+        }
+
+        int c;
+        while ((c = Serial2.read()) >= 0) {
+            if (frameLength < sizeof(frame)) {
+                frame[frameLength++] = (uint8_t)c;
+            }
+            lastByte = millis();
+        }
+        if (frameLength > 0 && millis() - lastByte >= LORA_RX_GAP_MS) {
+            // The peer reads its module raw, the ADDH/ADDL/CHAN is still in front
+            size_t size = peerReassembler.accept(frame + LORA_FIXED_HEADER_SIZE, frameLength - LORA_FIXED_HEADER_SIZE, millis());
+            if (size == sizeof(message) && memcmp(peerReassembler.message() + 4, message + 4, size - 4) == 0) {
+                intact++;
+            }
+            frameLength = 0;
+        }
+        delayMicroseconds(200);
+    }
+    printRate("enqueueMessage (500 B)", intact, intact * sizeof(message), millis() - start);
+    Serial.printf("%-24s %u sent\n", "", (unsigned)sent);
+
+    // In: the peer writes fragments one packet at a time
+    Fragmenter peerFragmenter;
+    uint32_t written = 0;
+    uint32_t received = 0;
+
+    start = millis();
+    while (millis() - start < testSeconds * 1000) {
+        if (!peerFragmenter.pending()) {
+            peerFragmenter.begin(message, sizeof(message));
+            written++;
+        }
+        if (digitalRead(PEER_AUX) == HIGH) {
+            size_t length = peerFragmenter.next(frame, sizeof(frame));
+            peerWrite(Serial2, frame, length);
+            delay(LORA_AUX_SETTLE_MS + (length * 10 * 1000) / LORA_UART_BAUD);
+        }
+
+        if (lora.readMessage(rebuilt, sizeof(rebuilt)) == sizeof(message)) {
+            received++;
+        }
+        delayMicroseconds(200);
+    }
+    ReassemblyStats stats = lora.getReassemblyStats();
+    printRate("readMessage (500 B)", received, received * sizeof(message), millis() - start);
+    Serial.printf("%-24s %u written, %u timed out, %u evicted\n", "", (unsigned)written,
+                  (unsigned)stats.timedOut, (unsigned)stats.evicted);
+}
@@ -0,0 +1,359 @@
+// LoRa class against the peer module: sends, receive paths, second module, wake-up
+#include "bench.h"
+#include <atomic>
+
+#define BENCH_DUAL_GAP_MS 300           // Mean time between frames of each buoy
+#define BENCH_APP_BUSY_MS 300           // loop() blocked on prints/sensors between passes
+#define BENCH_APP_RX_FRAMES 8           // Peer frames landing during one long busy stretch
+#define BENCH_BURST_FRAMES 24    // Frames the peer sends while the application is busy
+#define BENCH_WAKE_FRAMES 5     // First packets timed per wake-up time
+
+// Blocking sends, each one waits for AUX (module buffer empty) first
+void benchSendMessage(LoRa& lora, E32Emulator& peer) {
+    PeerSink sink;
+    uint32_t before = peer.getStats().packetsReceived;
+    uint8_t payload[BENCH_PAYLOAD] = {};
+    uint32_t sent = 0;
+
+    unsigned long start = millis();
+    while (millis() - start < testSeconds * 1000) {
+        sink.poll();
+        if (digitalRead(NATIVE_AUX_PIN) == HIGH) {
+            putU32(payload, sent++);
+            lora.sendMessage(NODE_ADDH, NODE_ADDL, payload, sizeof(payload));
+            delay(LORA_AUX_SETTLE_MS);
+        }
+        delayMicroseconds(200);
+    }
+    delay(1000); // Last frames off the air
+    sink.poll();
+
+    unsigned long elapsed = millis() - start;
+    printRate("sendMessage (AUX paced)", sink.frames(), sink.frames() * BENCH_PAYLOAD, elapsed);
+    Serial.printf("%-24s %u sent, %u received by the module\n", "", (unsigned)sent,
+                  (unsigned)(peer.getStats().packetsReceived - before));
+}
+
+// Pipelined sends through the TX queue
+void benchEnqueue(LoRa& lora) {
+    PeerSink sink;
+    uint8_t payload[BENCH_PAYLOAD] = {};
+    uint32_t queued = 0;
+
+    unsigned long start = millis();
+    while (millis() - start < testSeconds * 1000) {
+        lora.update();
+        sink.poll();
+        if (lora.txQueueFree() > 0) {
+            putU32(payload, queued);
+            if (lora.enqueue(payload, sizeof(payload)) >= 0) {
+                queued++;
+            }
+        }
+        delayMicroseconds(200);
+    }
+    lora.flushTx(5000);
+    delay(100);
+    sink.poll();
+
+    printRate("enqueue (pipelined)", sink.frames(), sink.frames() * BENCH_PAYLOAD, millis() - start);
+    Serial.printf("%-24s %u queued\n", "", (unsigned)queued);
+}
+
+// loop() that blocks on slow work between passes: the radio inline in it, then on its own task
+void benchRadioTask(LoRa& lora) {
+    uint8_t payload[BENCH_PAYLOAD] = {};
+
+    for (uint8_t task = 0; task < 2; task++) {
+        if (task) {
+            lora.beginRadioTask();
+        }
+        else {
+            lora.beginReceiveTask();
+        }
+
+        PeerSink sink;
+        uint32_t queued = 0;
+        unsigned long start = millis();
+        while (millis() - start < testSeconds * 1000) {
+            if (!task) {
+                lora.update();
+            }
+            while (lora.txQueueFree() > 0) {
+                putU32(payload, queued);
+                if (lora.enqueue(payload, sizeof(payload)) < 0) {
+                    break;
+                }
+                queued++;
+            }
+            sink.poll();
+            delay(BENCH_APP_BUSY_MS);
+        }
+        unsigned long elapsed = millis() - start;
+        uint32_t frames = sink.frames();
+        lora.flushTx(5000);
+
+        // Peer frames while loop() is busy, read once it comes back
+        delay(500);
+        while (Serial2.read() >= 0) {
+        }
+        uint8_t frame[LORA_RX_BUFFER_SIZE];
+        while (lora.readMessage(frame, sizeof(frame)) > 0) {
+        }
+        for (uint8_t i = 0; i < BENCH_APP_RX_FRAMES; i++) {
+            while (digitalRead(PEER_AUX) == LOW) {
+                delayMicroseconds(200);
+            }
+            payload[0] = i;
+            peerWrite(Serial2, payload, sizeof(payload));
+            delay(LORA_AUX_SETTLE_MS + (sizeof(payload) * 10 * 1000) / LORA_UART_BAUD);
+        }
+        delay(1000);
+        if (!task) {
+            lora.update();
+        }
+        uint32_t received = 0;
+        while (lora.readMessage(frame, sizeof(frame)) > 0) {
+            received++;
+        }
+
+        printRate(task ? "radio task, busy loop()" : "inline, busy loop()", frames, frames * BENCH_PAYLOAD, elapsed);
+        Serial.printf("%-24s %u queued, %u of %u peer frames read after a busy stretch\n", "",
+                      (unsigned)queued, (unsigned)received, BENCH_APP_RX_FRAMES);
+
+        if (task) {
+            lora.endRadioTask();
+        }
+        else {
+            lora.endReceiveTask();
+        }
+    }
+}
+
+// Peer sends timestamped frames, LoRa polls with checkForMessage() and pops the history
+void benchReceive(LoRa& lora) {
+    uint8_t payload[BENCH_PAYLOAD] = {};
+    uint32_t written = 0;
+    uint32_t received = 0;
+    uint64_t latencySum = 0;
+    uint32_t latencyMax = 0;
+
+    unsigned long start = millis();
+    while (millis() - start < testSeconds * 1000) {
+        if (digitalRead(PEER_AUX) == HIGH) {
+            putU32(payload, micros());
+            peerWrite(Serial2, payload, sizeof(payload));
+            written++;
+            delay(LORA_AUX_SETTLE_MS + (sizeof(payload) * 10 * 1000) / LORA_UART_BAUD);
+        }
+
+        uint8_t frame[LORA_RX_BUFFER_SIZE];
+        lora.checkForMessage();
+        while (lora.popMessage(frame, sizeof(frame)) >= 4) {
+            uint32_t latency = micros() - getU32(frame);
+            latencySum += latency;
+            if (latency > latencyMax) {
+                latencyMax = latency;
+            }
+            received++;
+        }
+        delayMicroseconds(200);
+    }
+
+    printRate("receiveMessage", received, received * BENCH_PAYLOAD, millis() - start);
+    Serial.printf("%-24s %u written by the peer, latency avg %.1f ms max %.1f ms\n", "", (unsigned)written,
+                  received ? latencySum / 1000.0 / received : 0.0, latencyMax / 1000.0);
+}
+
+// Frames heard by one gateway module, from its receive task
+struct GatewayCount {
+    std::atomic<uint32_t> frames{0};
+};
+
+static void countFrame(const uint8_t* data, size_t length, void* context) {
+    (void)data;
+    (void)length;
+    ((GatewayCount*)context)->frames++;
+}
+
+// Two buoys sending flat out: first both on the gateway's channel, then one on the
+// channel of a second module driven by its own LoRa instance and receive task
+void benchDualRadio(LoRa& lora, E32Emulator& peer, AirChannel& air) {
+    static HardwareSerial uart3(3);
+    static HardwareSerial uart0(0);
+    static E32Emulator secondModule(uart3, air, SECOND_M0, SECOND_M1, SECOND_AUX);
+    static E32Emulator sender(uart0, air, SENDER_M0, SENDER_M1, SENDER_AUX);
+    E32Registers registers = peer.getRegisters();
+    uint8_t otherChannel = registers.chan + 1;
+
+    // Cold boot of the second module, its config cache kept apart from the first one's
+    LoRa second(uart3, SECOND_M0, SECOND_M1, SECOND_RX, SECOND_TX, SECOND_AUX, "lora2");
+    second.setConfigMode();
+    second.begin();
+    bool configured = second.config(NODE_ADDH, NODE_ADDL, otherChannel);
+    second.setNormalMode();
+    bool cached = second.isConfigCached(NODE_ADDH, NODE_ADDL, otherChannel);
+
+    digitalWrite(SENDER_M0, LOW);
+    digitalWrite(SENDER_M1, LOW);
+    uart0.begin(9600);
+    GatewayCount heard[2];
+    lora.beginReceiveTask(countFrame, &heard[0]);
+    second.beginReceiveTask(countFrame, &heard[1]);
+    Serial.printf("%-24s second module %s, its config cached %s\n", "dual radio",
+                  configured ? "configured" : "failed", cached ? "yes" : "no");
+
+    uint8_t payload[BENCH_PAYLOAD] = {};
+    for (uint8_t channels = 1; channels <= 2; channels++) {
+        E32Registers senderRegisters = registers;
+        senderRegisters.chan = channels == 1 ? registers.chan : otherChannel;
+        sender.setRegisters(senderRegisters, false);
+        delay(500);
+        heard[0].frames = 0;
+        heard[1].frames = 0;
+        uint32_t collisions = air.collisions();
+
+        uint32_t seed = 5;
+        uint32_t sent = 0;
+        unsigned long nextPeer = millis();
+        unsigned long nextSender = millis();
+        unsigned long start = millis();
+        while (millis() - start < testSeconds * 1000) {
+            unsigned long now = millis();
+            if ((long)(now - nextPeer) >= 0 && digitalRead(PEER_AUX) == HIGH) {
+                seed = seed * 1103515245 + 12345;
+                nextPeer = now + (seed >> 16) % (2 * BENCH_DUAL_GAP_MS);
+                peerWrite(Serial2, payload, sizeof(payload));
+                sent++;
+            }
+            if ((long)(now - nextSender) >= 0 && digitalRead(SENDER_AUX) == HIGH) {
+                seed = seed * 1103515245 + 12345;
+                nextSender = now + (seed >> 16) % (2 * BENCH_DUAL_GAP_MS);
+                peerWrite(uart0, payload, sizeof(payload));
+                sent++;
+            }
+            lora.update();
+            second.update();
+            delayMicroseconds(200);
+        }
+        delay(1000);
+
+        uint32_t frames = heard[0].frames + heard[1].frames;
+        Serial.printf("%-24s %u of %u frames heard (%u + %u), %u collided, %.1f frames/s\n",
+                      channels == 1 ? "1 channel, 1 module" : "2 channels, 2 modules",
+                      (unsigned)frames, (unsigned)sent, (unsigned)heard[0].frames, (unsigned)heard[1].frames,
+                      (unsigned)(air.collisions() - collisions), frames * 1000.0f / (millis() - start));
+    }
+
+    lora.endReceiveTask();
+    second.endReceiveTask();
+    sender.setRegisters(registers, false);
+    while (Serial2.read() >= 0) {
+    }
+}
+
+// Peer bursts while the application only calls checkForMessage(), then the history is read
+void benchRxBurst(LoRa& lora, RxDropPolicy policy) {
+    uint8_t payload[BENCH_PAYLOAD] = {};
+    lora.setRxDropPolicy(policy);
+    lora.beginReceiveTask();
+    delay(300);
+    lora.checkForMessage(); // Leftovers of the previous test
+    lora.rxHistory().clear();
+    RxHistoryStats before = lora.rxHistory().stats();
+
+    unsigned long start = millis();
+    for (uint8_t i = 0; i < BENCH_BURST_FRAMES; i++) {
+        while (digitalRead(PEER_AUX) == LOW) {
+            lora.checkForMessage();
+            delayMicroseconds(200);
+        }
+        payload[0] = i;
+        peerWrite(Serial2, payload, sizeof(payload));
+        delay(LORA_AUX_SETTLE_MS + (sizeof(payload) * 10 * 1000) / LORA_UART_BAUD);
+    }
+    while (millis() - start < testSeconds * 1000) {
+        lora.checkForMessage();
+        delay(1);
+    }
+
+    // Kept frames, oldest first, with the gaps the drop policy left
+    uint8_t first = 0xFF;
+    uint8_t last = 0xFF;
+    uint32_t gaps = 0;
+    for (const LoRaRxHistory::Entry& entry : lora.rxHistory()) {
+        if (first == 0xFF) {
+            first = entry.data[0];
+        }
+        last = entry.data[0];
+        gaps += entry.info.dropped;
+    }
+    size_t kept = lora.messageCount();
+    RxHistoryStats stats = lora.rxHistory().stats();
+    lora.rxHistory().clear();
+    lora.endReceiveTask();
+    lora.setRxDropPolicy(RX_DROP_OLDEST);
+
+    Serial.printf("%-24s %u of %u kept (#%u-#%u), %u overwritten, %u refused, %u lost in the ring, %u marked as gaps\n",
+                  policy == RX_DROP_OLDEST ? "burst, drop oldest" : "burst, drop newest", (unsigned)kept,
+                  (unsigned)(stats.received - before.received), first, last,
+                  (unsigned)(stats.overwritten - before.overwritten), (unsigned)(stats.refused - before.refused),
+                  (unsigned)(stats.upstream - before.upstream), (unsigned)gaps);
+}
+
+// Time from enqueue() to the first byte out of the peer's UART, averaged over a few frames
+static float firstPacketLatencyMs(LoRa& lora) {
+    uint8_t payload[BENCH_PAYLOAD] = {};
+    float total = 0.0f;
+    for (uint8_t i = 0; i < BENCH_WAKE_FRAMES; i++) {
+        delay(300);
+        while (Serial2.read() >= 0) {
+        }
+        unsigned long start = micros();
+        lora.enqueue(payload, sizeof(payload));
+        while (Serial2.available() == 0 && micros() - start < 10000000UL) {
+            lora.update();
+            delayMicroseconds(100);
+        }
+        total += (micros() - start) / 1000.0f;
+        lora.flushTx(5000);
+    }
+    return total / BENCH_WAKE_FRAMES;
+}
+
+// Receiver in power saving mode woken by a sender in wake-up mode, against both in normal mode
+void benchWakeUp(LoRa& lora, E32Emulator& peer) {
+    static const uint8_t wakeUpTimes[] = { WAKE_UP_250, WAKE_UP_1000, WAKE_UP_2000 };
+    E32Registers registers = peer.getRegisters();
+
+    float normal = firstPacketLatencyMs(lora);
+    Serial.printf("%-24s %.1f ms to the peer UART\n", "normal -> normal", normal);
+
+    for (uint8_t wakeUpTime : wakeUpTimes) {
+        E32Registers peerRegisters = registers;
+        peerRegisters.option = (registers.option & ~0x38) | (wakeUpTime << 3);
+        peer.setRegisters(peerRegisters, false);
+        digitalWrite(PEER_M0, LOW);
+        digitalWrite(PEER_M1, HIGH);
+
+        lora.setWakeUpTime(wakeUpTime);
+        lora.setWakeUpMode();
+        float latency = firstPacketLatencyMs(lora);
+        lora.setNormalMode();
+
+        // Idle receiver radio on for a channel activity check once per wake-up time
+        uint32_t periodMs = 250 * (wakeUpTime + 1);
+        float listenDuty = 100.0f * BENCH_CAD_SYMBOLS * AirtimeModel(lora.getAirDataRate()).symbolUs() / (periodMs * 1000.0f);
+
+        char name[32];
+        snprintf(name, sizeof(name), "wake-up -> saving %u ms", (unsigned)periodMs);
+        Serial.printf("%-24s %.1f ms to the peer UART (+%.1f ms), %u ms airtime, idle radio on ~%.2f %%\n", name,
+                      latency, latency - normal, (unsigned)lora.airtimeMs(BENCH_PAYLOAD), listenDuty);
+    }
+
+    lora.setWakeUpTime(WAKE_UP_250);
+    peer.setRegisters(registers, false);
+    digitalWrite(PEER_M0, LOW);
+    digitalWrite(PEER_M1, LOW);
+    delay(100);
+}
@@ -0,0 +1,78 @@
+// Gateway node table (NodeTable)
+#include "bench.h"
+#include "NodeTable.h"
+
+#define BENCH_NODES 300             // Buoys heard by one gateway
+#define BENCH_NODE_FRAMES 1000000
+
+// Gateway node table: buoys in turn, with lost, repeated and swapped frames
+void benchNodeTable() {
+    static NodeTable table;
+    static uint8_t nextSequence[BENCH_NODES];
+    table.clear();
+    memset(nextSequence, 0, sizeof(nextSequence));
+
+    uint8_t frame[NODE_HEADER_SIZE + BENCH_PAYLOAD] = {};
+    uint8_t held[sizeof(frame)];
+    bool holding = false;
+    uint32_t seed = 1;
+    uint32_t dropped = 0;
+    uint32_t repeated = 0;
+    uint32_t delivered = 0;
+    uint64_t cycles = 0;
+
+    for (uint32_t n = 0; n < BENCH_NODE_FRAMES; n++) {
+        uint16_t node = 0x0100 + n % BENCH_NODES;
+        writeNodeHeader(frame, node, nextSequence[n % BENCH_NODES]++);
+        // First and last frame of each node always heard, nothing tells what was lost outside them
+        seed = seed * 1103515245 + 12345;
+        bool edge = n < BENCH_NODES || n >= BENCH_NODE_FRAMES - BENCH_NODES;
+        uint32_t roll = edge ? 99 : (seed >> 16) % 100;
+        if (roll < 5) {
+            dropped++;
+            continue;
+        }
+
+        // 2 % wait for the node's next frame (swapped), 3 % are heard twice
+        const uint8_t* sends[3];
+        uint8_t count = 0;
+        if (roll < 7 && !holding) {
+            memcpy(held, frame, sizeof(frame));
+            holding = true;
+            continue;
+        }
+        sends[count++] = frame;
+        if (roll < 10) {
+            sends[count++] = frame;
+            repeated++;
+        }
+        if (holding && (held[1] << 8 | held[2]) == node) {
+            sends[count++] = held;
+            holding = false;
+        }
+
+        for (uint8_t i = 0; i < count; i++) {
+            NodeFrame result;
+            uint32_t before = ESP.getCycleCount();
+            table.accept(sends[i], sizeof(frame), n * 10, &result);
+            cycles += ESP.getCycleCount() - before;
+            if (result.verdict != NODE_DUPLICATE) {
+                delivered++;
+            }
+        }
+    }
+
+    uint32_t lost = 0;
+    for (size_t i = 0; i < table.capacity(); i++) {
+        const NodeEntry* entry = table.slot(i);
+        if (entry != nullptr) {
+            lost += entry->lost;
+        }
+    }
+    NodeTableStats stats = table.stats();
+    Serial.printf("%-24s %u nodes, %.0f cycles/frame, longest probe %u\n", "NodeTable", (unsigned)stats.nodes,
+                  (float)cycles / (delivered + stats.duplicates), (unsigned)stats.maxProbes);
+    Serial.printf("%-24s %u delivered, %u/%u duplicates dropped, %u/%u lost counted, %u gaps flagged\n", "",
+                  (unsigned)delivered, (unsigned)stats.duplicates, (unsigned)repeated, (unsigned)lost,
+                  (unsigned)dropped, (unsigned)stats.gaps);
+}
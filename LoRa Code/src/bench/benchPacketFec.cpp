@@ -0,0 +1,139 @@
+// Erasure coding (PacketFec), on the link and the codec alone
+#include "bench.h"
+#include "PacketFec.h"
+
+#define BENCH_FEC_GROUPS 20000  // Erasure codec, full payloads
+
+// One way link under loss: plain frames against the same payloads with erasure coding
+void benchFec(LoRa& lora, uint8_t k, uint8_t m) {
+    FecDecoder peer;
+    uint8_t payload[FEC_PAYLOAD] = {};
+    uint8_t frame[64];
+    size_t frameLength = 0;
+    unsigned long lastByte = 0;
+    uint32_t offered = 0;
+    uint32_t delivered = 0;
+    static bool seen[1 << 16];
+    memset(seen, 0, sizeof(seen));
+
+    delay(500);
+    while (Serial2.read() >= 0) {
+    }
+
+    if (k > 0) {
+        lora.setFec(k, m, 1000);
+    }
+    unsigned long start = millis();
+    unsigned long drainUntil = 0;
+    while (millis() - start < testSeconds * 1000 || (long)(drainUntil - millis()) > 0) {
+        lora.update();
+        if (lora.fecPending() || !lora.txIdle()) {
+            drainUntil = millis() + 500;
+        }
+        if (millis() - start < testSeconds * 1000 && offered < (1 << 16)) {
+            putU32(payload, offered);
+            bool accepted = k > 0 ? lora.sendFec(payload, sizeof(payload))
+                                  : (lora.txQueueFree() > 0 && lora.enqueue(payload, sizeof(payload)) >= 0);
+            if (accepted) {
+                offered++;
+            }
+        }
+        else if (k > 0 && !lora.fecPending()) {
+            lora.flushFec();
+        }
+
+        // Peer: split the UART stream on the gap, count each payload once
+        int c;
+        while ((c = Serial2.read()) >= 0) {
+            if (frameLength < sizeof(frame)) {
+                frame[frameLength++] = (uint8_t)c;
+            }
+            lastByte = millis();
+        }
+        if (frameLength > 0 && millis() - lastByte >= LORA_RX_GAP_MS) {
+            uint8_t received[FEC_PAYLOAD];
+            size_t size = 0;
+            if (peer.accept(frame + LORA_FIXED_HEADER_SIZE, frameLength - LORA_FIXED_HEADER_SIZE)) {
+                while ((size = peer.read(received, sizeof(received))) > 0) {
+                    uint32_t n = getU32(received);
+                    if (n < offered && !seen[n]) {
+                        seen[n] = true;
+                        delivered++;
+                    }
+                }
+            }
+            else if (frameLength == LORA_FIXED_HEADER_SIZE + sizeof(payload)) {
+                uint32_t n = getU32(frame + LORA_FIXED_HEADER_SIZE);
+                if (n < offered && !seen[n]) {
+                    seen[n] = true;
+                    delivered++;
+                }
+            }
+            frameLength = 0;
+        }
+        delayMicroseconds(200);
+    }
+    unsigned long elapsed = millis() - start;
+    lora.setFec(0);
+
+    char name[32];
+    if (k > 0) {
+        snprintf(name, sizeof(name), "sendFec (k %u, m %u)", (unsigned)k, (unsigned)m);
+    } else {
+        snprintf(name, sizeof(name), "enqueue (no FEC)");
+    }
+    printRate(name, delivered, delivered * sizeof(payload), elapsed);
+    FecStats stats = peer.stats();
+    Serial.printf("%-24s %u offered, %.1f %% lost, %u rebuilt from parity\n", "", (unsigned)offered,
+                  offered ? 100.0f * (offered - delivered) / offered : 0.0f, (unsigned)stats.recovered);
+}
+
+// Erasure codec alone: full payloads, decoding with m data frames lost per group
+void benchFecCodec(uint8_t k, uint8_t m) {
+    FecEncoder encoder(k, m);
+    FecDecoder decoder;
+    uint8_t payload[FEC_PAYLOAD];
+    uint8_t frames[FEC_MAX_K + FEC_MAX_M][LORA_PAYLOAD_MAX];
+    size_t lengths[FEC_MAX_K + FEC_MAX_M];
+    uint8_t decoded[FEC_PAYLOAD];
+    uint64_t encodeCycles = 0;
+    uint64_t decodeCycles = 0;
+    unsigned long encodeUs = 0;
+    unsigned long decodeUs = 0;
+
+    for (uint32_t group = 0; group < BENCH_FEC_GROUPS; group++) {
+        unsigned long t0 = micros();
+        uint32_t before = ESP.getCycleCount();
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < k; i++) {
+            putU32(payload, group * k + i);
+            memset(payload + 4, (uint8_t)(group + i), sizeof(payload) - 4);
+            encoder.add(payload, sizeof(payload));
+            lengths[count] = encoder.next(frames[count], LORA_PAYLOAD_MAX);
+            count++;
+        }
+        while ((lengths[count] = encoder.next(frames[count], LORA_PAYLOAD_MAX)) > 0) {
+            count++;
+        }
+        encodeCycles += ESP.getCycleCount() - before;
+        encodeUs += micros() - t0;
+
+        // Worst case: the first m data frames never arrive
+        t0 = micros();
+        before = ESP.getCycleCount();
+        for (uint8_t i = m; i < count; i++) {
+            decoder.accept(frames[i], lengths[i]);
+            while (decoder.read(decoded, sizeof(decoded)) > 0) {
+            }
+        }
+        decodeCycles += ESP.getCycleCount() - before;
+        decodeUs += micros() - t0;
+    }
+
+    float bytes = (float)BENCH_FEC_GROUPS * k * FEC_PAYLOAD;
+    char name[32];
+    snprintf(name, sizeof(name), "FecEncoder (k %u, m %u)", (unsigned)k, (unsigned)m);
+    Serial.printf("%-24s %.1f MB/s, %.1f cycles/B\n", name, bytes / encodeUs, encodeCycles / bytes);
+    Serial.printf("%-24s %.1f MB/s, %.1f cycles/B with %u lost per group\n", "FecDecoder",
+                  bytes / decodeUs, decodeCycles / bytes, (unsigned)m);
+}
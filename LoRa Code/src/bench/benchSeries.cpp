@@ -0,0 +1,62 @@
+// Time series compression (SeriesCodec)
+#include "bench.h"
+#include "SeriesCodec.h"
+#include "Batcher.h"
+
+#define BENCH_SAMPLES 100000 // Compressed time series
+
+// Compression of a synthetic buoy series, blocks sized like a batch record
+void benchSeries() {
+    TelemetryCodec codec(BuoySchema);
+    SeriesEncoder encoder(BuoySchema, LORA_PAYLOAD_MAX - BATCH_HEADER_SIZE - BATCH_RECORD_HEADER);
+    uint8_t block[SERIES_MAX_BLOCK];
+    uint8_t record[LORA_PAYLOAD_MAX];
+    uint32_t frameBytes = 0;
+    uint32_t recordBytes = 0;
+    uint32_t blockBytes = 0;
+    uint32_t blocks = 0;
+    uint64_t cycles = 0;
+
+    // Slow temperature walk, battery draining, 1 s sampling with a few ms of jitter
+    uint32_t seed = 1;
+    float temperature = 12.0f;
+    float battery = 4.1f;
+    uint32_t timestamp = 0;
+
+    for (uint32_t n = 0; n <= BENCH_SAMPLES; n++) {
+        seed = seed * 1103515245 + 12345;
+        temperature += ((int)((seed >> 16) % 5) - 2) * 0.01f;
+        if (n % 600 == 0) {
+            battery -= 0.001f;
+        }
+        timestamp += 1000 + (seed >> 28) % 4;
+        float values[] = { temperature, battery, timestamp / 1000.0f };
+
+        uint32_t before = ESP.getCycleCount();
+        bool added = n < BENCH_SAMPLES && encoder.add(values, timestamp);
+        cycles += ESP.getCycleCount() - before;
+
+        if (!added) {
+            // Block full (or last one)
+            blockBytes += encoder.take(block, sizeof(block));
+            blocks++;
+            if (n == BENCH_SAMPLES) {
+                break;
+            }
+            before = ESP.getCycleCount();
+            encoder.add(values, timestamp);
+            cycles += ESP.getCycleCount() - before;
+        }
+
+        // What the uncompressed paths would cost
+        frameBytes += codec.encode(values, 0, record, sizeof(record));
+        recordBytes += BATCH_RECORD_HEADER + codec.encodeFields(values, record, sizeof(record));
+    }
+
+    Serial.printf("%-24s %u samples in %u blocks, %.1f samples/block\n", "SeriesEncoder",
+                  (unsigned)BENCH_SAMPLES, (unsigned)blocks, (float)BENCH_SAMPLES / blocks);
+    Serial.printf("%-24s %.2f B/sample, ratio %.2fx vs frames (%.2f B), %.2fx vs batch records (%.2f B)\n", "",
+                  (float)blockBytes / BENCH_SAMPLES, (float)frameBytes / blockBytes, (float)frameBytes / BENCH_SAMPLES,
+                  (float)recordBytes / blockBytes, (float)recordBytes / BENCH_SAMPLES);
+    Serial.printf("%-24s %.0f cycles/sample to encode\n", "", (double)cycles / BENCH_SAMPLES);
+}
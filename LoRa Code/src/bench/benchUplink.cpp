@@ -0,0 +1,50 @@
+// Receiver to host USB framing (Uplink)
+#include "bench.h"
+#include "Uplink.h"
+
+#define BENCH_UPLINK_FRAMES 200000
+#define BENCH_UPLINK_NOISE 64       // One corrupted byte per this many USB writes
+
+// Receiver's USB uplink: full LoRa frames through UplinkWriter, a noisy line, then UplinkReader
+void benchUplink() {
+    UplinkWriter writer;
+    UplinkReader reader;
+    uint8_t frame[MAX_SIZE_TX_PACKET];
+    uint8_t line[UPLINK_BUFFER_SIZE];
+    uint32_t writes = 0;
+
+    unsigned long start = micros();
+    for (uint32_t n = 0; n < BENCH_UPLINK_FRAMES; n++) {
+        // Counter then a pattern with zeros, as binary frames have
+        putU32(frame, n);
+        for (size_t i = 4; i < sizeof(frame); i++) {
+            frame[i] = (n + i) % 7 == 0 ? 0 : (uint8_t)(n * i);
+        }
+        writer.send(UPLINK_LORA_FRAME, frame, sizeof(frame), n);
+
+        // One frame per ms of writer time, so both the batch size and the flush time trigger writes
+        const uint8_t* data;
+        size_t length;
+        while ((length = writer.ready(n, &data)) > 0) {
+            memcpy(line, data, length);
+            writer.consume(length);
+            if (++writes % BENCH_UPLINK_NOISE == 0) {
+                line[length / 2] ^= 0x5A;
+            }
+            size_t used = 0;
+            while (used < length) {
+                used += reader.feed(line + used, length - used);
+            }
+        }
+    }
+    float seconds = (micros() - start) / 1e6f;
+
+    UplinkStats sent = writer.stats();
+    UplinkReaderStats received = reader.stats();
+    Serial.printf("%-24s %.0f frames/s encoded and read back, %.1f %% framing overhead, %.0f B per write\n",
+                  "Uplink (58 B frames)", BENCH_UPLINK_FRAMES / seconds,
+                  100.0f * sent.bytes / ((float)sent.frames * sizeof(frame)) - 100.0f, (float)sent.bytes / sent.writes);
+    Serial.printf("%-24s %u frames, %u rejected, %u lost on %u noisy writes\n", "UplinkReader",
+                  (unsigned)received.frames, (unsigned)received.crcErrors, (unsigned)received.lost,
+                  (unsigned)(writes / BENCH_UPLINK_NOISE));
+}
@@ -0,0 +1,101 @@
+// Native env entry point: runs LoRaConfig unmodified against emulated E32 modules.
+//
+//  Serial1 <-> module A, driven by the LoRa class exactly as on the board
+//  Serial2 <-> module B, a peer configured beforehand and driven raw
+//
+// The benches are in bench/, one file per library. They measure, the checks are the
+// Unity suites in test/ (pio test -e native).
+//
+// Usage: emulator [seconds per test] [latency ms] [loss rate 0-1] [air bit rate, 0 = from SPED] [mean loss burst, packets]
+#include "bench/bench.h"
+#include <stdio.h>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+    AirChannel air;
+    if (argc > 1) testSeconds = atoi(argv[1]);
+    if (argc > 2) air.setLatencyMs(atoi(argv[2]));
+    if (argc > 3) air.setLossRate(atof(argv[3]));
+    if (argc > 4) air.setBitRate(atoi(argv[4]));
+    if (argc > 5) air.setBurstLength(atof(argv[5]));
+
+    E32Emulator moduleA(Serial1, air, LoRa_M0, LoRa_M1, NATIVE_AUX_PIN);
+    E32Emulator moduleB(Serial2, air, PEER_M0, PEER_M1, PEER_AUX);
+    Serial.begin(115200);
+
+    // Same cold boot as transmitter.cpp
+    LoRa LoRaModule(LoRa_M0, LoRa_M1, ESP_RX, ESP_TX, NATIVE_AUX_PIN);
+    unsigned long t0 = millis();
+    LoRaModule.setConfigMode();
+    LoRaModule.begin();
+    LoRaModule.printConfiguration();
+    bool configSuccess = LoRaModule.config(NODE_ADDH, NODE_ADDL, NODE_CHANNEL);
+    Serial.printf("config(): %s, result %d, %lu ms\n", configSuccess ? "ok" : "failed",
+                  LoRaModule.getLastConfigResult(), millis() - t0);
+
+    // Second call must not write again
+    t0 = millis();
+    LoRaModule.config(NODE_ADDH, NODE_ADDL, NODE_CHANNEL);
+    Serial.printf("config() again: result %d, %lu ms\n", LoRaModule.getLastConfigResult(), millis() - t0);
+    LoRaModule.printConfiguration();
+    LoRaModule.setNormalMode();
+
+    E32Registers registers = moduleA.getRegisters();
+    Serial.printf("Module A registers: %02X %02X %02X %02X %02X, %u config commands\n",
+                  registers.addh, registers.addl, registers.sped, registers.chan, registers.option,
+                  (unsigned)moduleA.getStats().commands);
+
+    // Peer was configured beforehand with the same settings and sits in normal mode
+    moduleB.setRegisters(registers);
+    digitalWrite(PEER_M0, LOW);
+    digitalWrite(PEER_M1, LOW);
+    Serial2.begin(9600);
+    delay(200);
+
+    benchSeries();
+    benchFecCodec(4, 2);
+    benchFecCodec(8, 4);
+    benchUplink();
+    benchNodeTable();
+    const uint16_t accessNodes[] = { 1, 4, 16, 32, 64, BENCH_ACCESS_MAX_NODES };
+    for (uint16_t nodes : accessNodes) {
+        benchAccess(nodes, ACCESS_ALOHA);
+        benchAccess(nodes, ACCESS_CSMA);
+        benchAccess(nodes, ACCESS_CSMA_CAD);
+        benchAccess(nodes, ACCESS_TDMA);
+    }
+    const uint16_t channelNodes[] = { 64, BENCH_ACCESS_MAX_NODES };
+    for (uint16_t nodes : channelNodes) {
+        benchAccess(nodes, ACCESS_ALOHA, BENCH_ACCESS_MAX_CHANNELS);
+        benchAccess(nodes, ACCESS_TDMA, BENCH_ACCESS_MAX_CHANNELS);
+    }
+    benchSendMessage(LoRaModule, moduleB);
+    benchEnqueue(LoRaModule);
+    benchRadioTask(LoRaModule);
+    benchReceive(LoRaModule);
+    benchRxBurst(LoRaModule, RX_DROP_OLDEST);
+    benchRxBurst(LoRaModule, RX_DROP_NEWEST);
+    benchFragments(LoRaModule);
+    benchReliable(LoRaModule, 1);
+    benchReliable(LoRaModule, LORA_ARQ_WINDOW);
+    benchFec(LoRaModule, 0, 0);
+    benchFec(LoRaModule, LORA_FEC_K, LORA_FEC_M);
+    benchCsma(LoRaModule, air, false);
+    benchCsma(LoRaModule, air, true);
+    benchChannels(LoRaModule, moduleB);
+    benchDualRadio(LoRaModule, moduleB, air);
+    benchDutyCycle(LoRaModule, BENCH_PAYLOAD);
+    benchDutyCycle(LoRaModule, LORA_PAYLOAD_MAX);
+    benchWakeUp(LoRaModule, moduleB);
+
+    E32Stats a = moduleA.getStats();
+    E32Stats b = moduleB.getStats();
+    Serial.printf("Air: %u packets, %u collisions | A missed %u, B missed %u, A overflows %u\n",
+                  (unsigned)air.packets(), (unsigned)air.collisions(),
+                  (unsigned)a.packetsMissed, (unsigned)b.packetsMissed, (unsigned)a.bufferOverflows);
+    Serial.flush();
+
+    // Detached threads (UART event task) would outlive the globals, skip static destructors
+    fflush(stdout);
+    _exit(0);
+}
@@ -3,4 +3,12 @@
 #define ESP_TX 17  // ESP32 TX -> LoRa RX
 #define LoRa_M0 10  
 #define LoRa_M1 11  
-#define LoRa_AUX_PIN -1 // Not connected
\ No newline at end of file
+#define LoRa_AUX_PIN -1 // Not connected (timed mode switches), set to its GPIO once wired
+// Second module of a dual-radio receiver (RECEIVER_SECOND_MODULE), on Serial2
+#if RECEIVER_SECOND_MODULE
+#define ESP_RX2 5   // ESP32 RX -> LoRa TX
+#define ESP_TX2 4   // ESP32 TX -> LoRa RX
+#define LoRa2_M0 6
+#define LoRa2_M1 7
+#define LoRa2_AUX_PIN -1
+#endif
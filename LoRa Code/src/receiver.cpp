@@ -1,4 +1,13 @@
 #include "LoRaConfig.h"
+#include "TelemetryCodec.h"
+#include "BootProfile.h"
+#include "RateAdapter.h"
+#include "Fragmenter.h"
+#include "Batcher.h"
+#include "SeriesCodec.h"
+#include "Uplink.h"
+#include "NodeTable.h"
+#include "Tdma.h"
 #include <Adafruit_NeoPixel.h>
 #include "pinDef.h"
 
@@ -8,7 +17,343 @@
 Adafruit_NeoPixel pixels(NUMPIXELS, RGB_PIN, NEO_GRB + NEO_KHZ800);
 
 //Instanciate LoRa object
-LoRa LoRaModule(LoRa_M0, LoRa_M1, ESP_RX, ESP_TX);
+LoRa LoRaModule(LoRa_M0, LoRa_M1, ESP_RX, ESP_TX, LoRa_AUX_PIN);
+
+// Module address and channel
+#define NODE_ADDH 0x01
+#define NODE_ADDL 0x02
+#define NODE_CHANNEL 0x30
+
+// Several channels, CHANNEL_PLAN_COUNT of them 1 MHz apart from CHANNEL_PLAN_FIRST
+// (same values on the buoys). Without hopping this gateway listens to the buoys
+// of group RECEIVER_CHANNEL_GROUP (BUOY_ID % CHANNEL_PLAN_COUNT), one gateway or
+// module per group. With CHANNEL_HOP_DWELL_MS it hops over all of them and the
+// buoys follow.
+#ifndef CHANNEL_PLAN_COUNT
+#define CHANNEL_PLAN_COUNT 1
+#endif
+#ifndef CHANNEL_PLAN_FIRST
+#define CHANNEL_PLAN_FIRST NODE_CHANNEL
+#endif
+#ifndef CHANNEL_HOP_DWELL_MS
+#define CHANNEL_HOP_DWELL_MS 0
+#endif
+#ifndef RECEIVER_CHANNEL_GROUP
+#define RECEIVER_CHANNEL_GROUP 0
+#endif
+#define CHANNEL_HOP_SEED ((NODE_ADDH << 8) | NODE_ADDL)
+ChannelPlan channels(CHANNEL_PLAN_FIRST, CHANNEL_PLAN_COUNT);
+
+// Channel stored in the module, hopping starts from the first one
+uint8_t homeChannel() {
+    return CHANNEL_HOP_DWELL_MS ? channels.channel(0) : channels.channel(RECEIVER_CHANNEL_GROUP);
+}
+
+// Second module on Serial2 listening to the next group (RECEIVER_CHANNEL_GROUP + 1,
+// needs CHANNEL_PLAN_COUNT of 2 or more), so one gateway hears two groups at once.
+// Plain listening only: TDMA beacons and hopping stay on the first module.
+// Not built at all without it: no 17 KB object, no pins claimed.
+#ifndef RECEIVER_SECOND_MODULE
+#define RECEIVER_SECOND_MODULE 0
+#endif
+#if RECEIVER_SECOND_MODULE
+LoRa LoRaModule2(Serial2, LoRa2_M0, LoRa2_M1, ESP_RX2, ESP_TX2, LoRa2_AUX_PIN, "lora2");
+#endif
+
+// LoRa I/O on a task of its own pinned to LORA_RADIO_CORE, loop() on the other core
+// handles the frames it hands over through a lock-free ring, so printing, the LED and
+// the USB uplink never hold the radio up. 0 keeps the receive task handler.
+#ifndef RECEIVER_RADIO_TASK
+#define RECEIVER_RADIO_TASK 0
+#endif
+
+// Both receive tasks hand their frames over one at a time
+SemaphoreHandle_t frameMutex = nullptr;
+LoRa* currentModule = &LoRaModule;  // Module of the frame being handled
+
+// Boot phase timestamps
+BootProfile boot;
+
+//Binary telemetry decoder (must match transmitter schema)
+TelemetryCodec codec(BuoySchema);
+SeriesDecoder series(BuoySchema);
+
+// Follows one transmitter's air data rate, shared by the receive task and loop().
+// Switches are refused while other buoys are heard (see RateFollower).
+RateFollower rateFollower(AIR_DATA_RATE_010_24);
+LoRa* rateModule = &LoRaModule;     // Answers go out on the module the transmitter talks to
+portMUX_TYPE rateLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Rebuilds messages sent with enqueueMessage(), only used by the receive task
+Reassembler reassembler;
+
+// Buoys heard (frames with a node header), only used by the receive task
+NodeTable nodes;
+uint16_t currentNode = 0;   // Node of the frame being printed, 0 without a node header
+
+// Gateway of many buoys: a beacon every superframe, each buoy (TRANSMITTER_TDMA=1)
+// gets a slot of its own on its first frame. 0 turns it off, otherwise the slot
+// count with the shared slot, sized from the airtime of a full frame.
+#ifndef RECEIVER_TDMA_SLOTS
+#define RECEIVER_TDMA_SLOTS 0
+#endif
+#define TDMA_FRAMES_PER_SLOT 1
+
+// Slots given by the receive task, beacons written by loop()
+TdmaCoordinator tdma;
+portMUX_TYPE tdmaLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Time of the last frame, written by the receive task
+volatile unsigned long lastFrameAt = 0;
+volatile bool frameReceived = false;
+
+// Stream ids used by the transmitter's batcher
+#define STREAM_TELEMETRY 1
+#define STREAM_TELEMETRY_SERIES 2
+
+// Output to the host: 0 prints text, 1 sends COBS framed binary (see Uplink.h)
+// once setup() is done, read on the host with the uplink env
+#ifndef RECEIVER_UPLINK
+#define RECEIVER_UPLINK 0
+#endif
+#define UPLINK_USB_BUFFER 1024
+
+// Filled by the receive task and loop(), drained by loop() in batches
+UplinkWriter uplink;
+portMUX_TYPE uplinkLock = portMUX_INITIALIZER_UNLOCKED;
+
+void uplinkSend(UplinkType type, const uint8_t* data, size_t length) {
+    portENTER_CRITICAL(&uplinkLock);
+    uplink.send(type, data, length, millis());
+    portEXIT_CRITICAL(&uplinkLock);
+}
+
+// Writes only what the USB buffer takes, so loop() never waits on the host
+void drainUplink() {
+    const uint8_t* data;
+    size_t length = uplink.ready(millis(), &data);
+    if (length == 0) {
+        return;
+    }
+    int room = Serial.availableForWrite();
+    if (room <= 0) {
+        return;
+    }
+    if (length > (size_t)room) {
+        length = room;
+    }
+    uplink.consume(Serial.write(data, length));
+}
+
+// Print one telemetry sample
+void printTelemetry(uint8_t seq, const float* values) {
+    if (RECEIVER_UPLINK) {
+        uint8_t sample[3 + TELEMETRY_MAX_FIELDS * sizeof(float)];
+        sample[0] = currentNode & 0xFF;
+        sample[1] = currentNode >> 8;
+        sample[2] = seq;
+        memcpy(sample + 3, values, BuoySchema.fieldCount * sizeof(float));
+        uplinkSend(UPLINK_TELEMETRY, sample, 3 + BuoySchema.fieldCount * sizeof(float));
+        return;
+    }
+    if (currentNode != 0) {
+        Serial.printf("Node %04X ", currentNode);
+    }
+    Serial.print("Telemetry #");
+    Serial.print(seq);
+    for (uint8_t i = 0; i < BuoySchema.fieldCount; i++) {
+        Serial.print(" | ");
+        Serial.print(BuoySchema.fields[i].name);
+        Serial.print(": ");
+        Serial.print(values[i]);
+    }
+    Serial.println();
+}
+
+// Rate control frame from a transmitter, answers go out on the module that heard it
+void followRate(const RateCtrlFrame& ctrl, uint16_t node) {
+    portENTER_CRITICAL(&rateLock);
+    rateFollower.onControlFrame(ctrl, millis(), node);
+    rateModule = currentModule;
+    portEXIT_CRITICAL(&rateLock);
+}
+
+// Print a telemetry frame, batch or reassembled message, falls back to text for anything else
+void printMessage(const uint8_t* data, size_t length) {
+    float values[TELEMETRY_MAX_FIELDS];
+    uint8_t seq;
+    RateCtrlFrame ctrl;
+    BatchReader batch;
+    if (codec.decode(data, length, values, &seq)) {
+        portENTER_CRITICAL(&rateLock);
+        rateFollower.onDataFrame(seq, millis(), currentNode);
+        portEXIT_CRITICAL(&rateLock);
+
+        printTelemetry(seq, values);
+    }
+    else if (batch.begin(data, length)) {
+        portENTER_CRITICAL(&rateLock);
+        rateFollower.onDataFrame(batch.sequence(), millis(), currentNode);
+        portEXIT_CRITICAL(&rateLock);
+
+        // Samples share the batch sequence, oldest first
+        uint8_t stream;
+        const uint8_t* record;
+        size_t recordLength;
+        while (batch.next(&stream, &record, &recordLength)) {
+            if (stream == STREAM_TELEMETRY && codec.decodeFields(record, recordLength, values) > 0) {
+                printTelemetry(batch.sequence(), values);
+            }
+            else if (stream == STREAM_TELEMETRY_SERIES && series.begin(record, recordLength)) {
+                uint32_t timestamp;
+                while (series.next(values, &timestamp)) {
+                    printTelemetry(batch.sequence(), values);
+                }
+            }
+        }
+    }
+    else if (decodeRateCtrl(data, length, &ctrl)) {
+        followRate(ctrl, currentNode);
+    }
+    else if (isFragment(data, length)) {
+        // Burst larger than one packet, handled like a frame once complete
+        size_t size = reassembler.accept(data, length, millis(), currentNode);
+        if (size > 0) {
+            printMessage(reassembler.message(), size);
+        }
+    }
+    else if (RECEIVER_UPLINK) {
+        uplinkSend(UPLINK_LORA_FRAME, data, length);
+    }
+    else {
+        Serial.print("Last Message Received: ");
+        Serial.write(data, length);
+        Serial.println();
+    }
+}
+
+// Say when a buoy shows up, misses frames or reboots
+void reportNode(const NodeFrame& node) {
+    char line[64];
+    switch (node.verdict) {
+        case NODE_FIRST:
+            snprintf(line, sizeof(line), "Node %04X: first frame #%u", node.node, node.sequence);
+            break;
+        case NODE_GAP:
+            snprintf(line, sizeof(line), "Node %04X: %u frames missing before #%u", node.node, node.missed, node.sequence);
+            break;
+        case NODE_RESTART:
+            snprintf(line, sizeof(line), "Node %04X: restarted at #%u", node.node, node.sequence);
+            break;
+        case NODE_UNTRACKED:
+            snprintf(line, sizeof(line), "Node %04X: node table full", node.node);
+            break;
+        default:
+            return;
+    }
+    if (RECEIVER_UPLINK) {
+        uplinkSend(UPLINK_TEXT, (const uint8_t*)line, strlen(line));
+    }
+    else {
+        Serial.println(line);
+    }
+}
+
+// Runs for every frame, in the LoRa receive task or in loop() with RECEIVER_RADIO_TASK
+void handleFrame(const uint8_t* data, size_t length) {
+    lastFrameAt = millis();
+    frameReceived = true;
+
+    // Rate control behind a node header is not a data frame, keep it out of the node's sequence
+    RateCtrlFrame ctrl;
+    if (hasNodeHeader(data, length) && decodeRateCtrl(data + NODE_HEADER_SIZE, length - NODE_HEADER_SIZE, &ctrl)) {
+        followRate(ctrl, nodeHeaderId(data));
+        return;
+    }
+
+    NodeFrame node;
+    if (!nodes.accept(data, length, millis(), &node)) {
+        // Sender without a node header
+        currentNode = 0;
+        printMessage(data, length);
+        return;
+    }
+    if (node.verdict == NODE_DUPLICATE) {
+        return;
+    }
+    if (RECEIVER_TDMA_SLOTS) {
+        portENTER_CRITICAL(&tdmaLock);
+        tdma.assign(node.node);
+        portEXIT_CRITICAL(&tdmaLock);
+    }
+    reportNode(node);
+    currentNode = node.node;
+    printMessage(node.payload, node.length);
+}
+
+// Receive task handler, the context is the module that heard the frame
+void onFrame(const uint8_t* data, size_t length, void* context) {
+    if (frameMutex != nullptr) {
+        xSemaphoreTake(frameMutex, portMAX_DELAY);
+    }
+    currentModule = (LoRa*)context;
+    handleFrame(data, length);
+    if (frameMutex != nullptr) {
+        xSemaphoreGive(frameMutex);
+    }
+}
+
+#if RECEIVER_SECOND_MODULE
+// Second module: config cached in its own NVS namespace, straight to listening
+void beginSecondModule() {
+    frameMutex = xSemaphoreCreateMutex();
+    LoRaModule2.setConfigMode();
+    LoRaModule2.begin();
+    if (!LoRaModule2.config(NODE_ADDH, NODE_ADDL, channels.channel(RECEIVER_CHANNEL_GROUP + 1))) {
+        Serial.println("Failed to configure second LoRa module");
+    }
+    LoRaModule2.setNormalMode();
+    if (RECEIVER_RADIO_TASK) {
+        LoRaModule2.beginRadioTask();
+    }
+    else {
+        LoRaModule2.beginReceiveTask(onFrame, &LoRaModule2);
+    }
+}
+#endif
+
+// Frames a radio task let through, handled on loop()'s core
+void handleReceived(LoRa& module) {
+    uint8_t frame[LORA_RX_BUFFER_SIZE];
+    size_t length;
+    while ((length = module.receive(frame, sizeof(frame))) > 0) {
+        onFrame(frame, length, &module);
+    }
+}
+
+// Slot length follows the air data rate
+void configureTdma() {
+    uint16_t slotMs = TdmaCoordinator::slotMsFor(LoRaModule.airtimeMs(LORA_PAYLOAD_MAX),
+                                                 TDMA_FRAMES_PER_SLOT, RECEIVER_TDMA_SLOTS);
+    portENTER_CRITICAL(&tdmaLock);
+    tdma.configure(RECEIVER_TDMA_SLOTS, slotMs);
+    portEXIT_CRITICAL(&tdmaLock);
+}
+
+// Queue the beacon once its superframe is over
+void sendBeacon() {
+    uint8_t frame[LORA_PAYLOAD_MAX];
+    size_t length = 0;
+    portENTER_CRITICAL(&tdmaLock);
+    if (tdma.beaconDue(millis())) {
+        length = tdma.beacon(frame, sizeof(frame), millis());
+    }
+    portEXIT_CRITICAL(&tdmaLock);
+
+    if (length > 0) {
+        LoRaModule.enqueue(frame, length);
+    }
+}
 
 void setup() {
     //Start up Pixel for visual without serial
@@ -19,48 +364,154 @@ void setup() {
 
 
     //Start up serial for debug 
+    if (RECEIVER_UPLINK) {
+        Serial.setTxBufferSize(UPLINK_USB_BUFFER);
+    }
     Serial.begin(115200);
-    delay(500);
-
-    LoRaModule.setConfigMode();
-    LoRaModule.begin();
-    LoRaModule.printConfiguration();
-
-    
-    bool configSuccess = LoRaModule.config(0x01, 0x02, 0x30);
-    if (configSuccess) {
-        Serial.println("LoRa module configured successfully");
-    } else {
-        Serial.println("Failed to configure LoRa module");
-    }
-    delay(3000);
-    Serial.println("Updated Configuration:");
-    LoRaModule.printConfiguration();
-    
-    Serial.println("Sending normal mode:");
-    LoRaModule.setNormalMode();
+
+    // Fast boot when NVS says the module already holds our config:
+    // no diagnostic prints, no fixed delays, no UART round trips
+    bool fastBoot = LoRaModule.isConfigCached(NODE_ADDH, NODE_ADDL, homeChannel());
+    boot.setFastBoot(fastBoot);
+    if (!fastBoot) {
+        delay(500); // Give the USB serial monitor time to attach
+    }
+    boot.mark(BOOT_SERIAL_UP);
+
+    if (fastBoot) {
+        // Straight to normal mode, config() only checks the cache
+        LoRaModule.setNormalMode();
+        LoRaModule.begin();
+        boot.mark(BOOT_MODULE_READY);
+
+        LoRaModule.config(NODE_ADDH, NODE_ADDL, homeChannel());
+        boot.mark(BOOT_CONFIG_VERIFIED);
+    }
+    else {
+        LoRaModule.setConfigMode();
+        LoRaModule.begin();
+        boot.mark(BOOT_MODULE_READY);
+        LoRaModule.printConfiguration();
+
+        bool configSuccess = LoRaModule.config(NODE_ADDH, NODE_ADDL, homeChannel());
+        if (configSuccess) {
+            Serial.println("LoRa module configured successfully");
+            boot.mark(BOOT_CONFIG_VERIFIED);
+        } else {
+            Serial.println("Failed to configure LoRa module");
+        }
+        delay(3000);
+        Serial.println("Updated Configuration:");
+        LoRaModule.printConfiguration();
+
+        Serial.println("Sending normal mode:");
+        LoRaModule.setNormalMode();
+    }
+    boot.mark(BOOT_NORMAL_MODE);
+    boot.print(Serial);
+
+    if (RECEIVER_TDMA_SLOTS) {
+        configureTdma();
+    }
+    if (CHANNEL_HOP_DWELL_MS && CHANNEL_PLAN_COUNT > 1) {
+        LoRaModule.setHopping(channels, CHANNEL_HOP_SEED, CHANNEL_HOP_DWELL_MS, true);
+    }
+
+    // Frames are handled by the receive task as they arrive, loop() only drives the LED,
+    // or the radio task takes the module and loop() handles the frames
+#if RECEIVER_SECOND_MODULE
+    beginSecondModule();
+#endif
+    if (RECEIVER_RADIO_TASK) {
+        LoRaModule.beginRadioTask();
+    }
+    else {
+        LoRaModule.beginReceiveTask(onFrame, &LoRaModule);
+    }
 
     //Green = ready to receive
     pixels.setPixelColor(0, pixels.Color(0, 255, 0)); //Green
     pixels.show();
 }
 
+// Send reports/ACKs and follow rate switches
+void handleRateControl() {
+    RateCtrlFrame ctrl;
+
+    portENTER_CRITICAL(&rateLock);
+    bool answer = rateFollower.poll(millis(), &ctrl);
+    bool changed = rateFollower.rateChanged();
+    uint8_t rate = rateFollower.rate();
+    uint16_t node = rateFollower.node();
+    LoRa* module = rateModule;
+    portEXIT_CRITICAL(&rateLock);
+
+    if (answer) {
+        // Addressed to the buoy followed, the others drop it
+        uint8_t frame[NODE_HEADER_SIZE + RATE_CTRL_SIZE];
+        size_t header = node != 0 ? writeNodeHeader(frame, node, 0) : 0;
+        module->enqueue(frame, header + encodeRateCtrl(ctrl, frame + header, sizeof(frame) - header));
+    }
+
+    // ACK has to be on air before the module leaves the old rate, both modules follow
+    bool switched = !changed || LoRaModule.setAirDataRate(rate);
+#if RECEIVER_SECOND_MODULE
+    if (changed) {
+        switched = LoRaModule2.setAirDataRate(rate) && switched;
+    }
+#endif
+    if (!switched) {
+        static const char failed[] = "Failed to change air data rate";
+        if (RECEIVER_UPLINK) {
+            uplinkSend(UPLINK_TEXT, (const uint8_t*)failed, sizeof(failed) - 1);
+        }
+        else {
+            Serial.println(failed);
+        }
+    }
+    else if (changed && RECEIVER_TDMA_SLOTS) {
+        configureTdma();
+    }
+}
+
 void loop() {
-    if (LoRaModule.checkForMessage()) {
+    if (RECEIVER_RADIO_TASK) {
+        handleReceived(LoRaModule);
+#if RECEIVER_SECOND_MODULE
+        handleReceived(LoRaModule2);
+#endif
+    }
+    else {
+        LoRaModule.update();
+#if RECEIVER_SECOND_MODULE
+        LoRaModule2.update();
+#endif
+    }
+    handleRateControl();
+    if (RECEIVER_TDMA_SLOTS) {
+        sendBeacon();
+    }
+
+    if (frameReceived) {
         // Message received - flash white
+        frameReceived = false;
         pixels.setPixelColor(0, pixels.Color(255, 255, 255)); //White = message received
         pixels.setBrightness(100); // bright!
         pixels.show();
-        delay(100);
-
-        LoRaModule.printLastMessage();
     }
-    else {
+    else if (lastFrameAt != 0 && millis() - lastFrameAt >= 100) {
         //Green = ready to receive
+        lastFrameAt = 0;
         pixels.setPixelColor(0, pixels.Color(0, 255, 0)); //Green
         pixels.setBrightness(50); // make it easier on the eyes jeez
         pixels.show();
-        delay(100);
+    }
+    if (RECEIVER_UPLINK) {
+        drainUplink();
+        delay(1); // Keeps the USB fed at thousands of frames per second
+    }
+    else {
+        delay(10); // LED refresh only, receiving does not depend on it
     }
 
 }
\ No newline at end of file
@@ -1,13 +1,57 @@
 #include "LoRaConfig.h"
+#include "PacketFec.h"
 #include "pinDef.h"
 
+#define FEC_BENCH_GROUPS 2000
+
+// Global like in transmitter.cpp: the object and its rings are far too big for the loopTask stack
+LoRa LoRaModule(LoRa_M0, LoRa_M1, ESP_RX, ESP_TX, LoRa_AUX_PIN);
+
+// Erasure codec throughput on the board: full payloads, m data frames lost per group
+void benchFec(uint8_t k, uint8_t m) {
+    FecEncoder encoder(k, m);
+    static FecDecoder decoder;
+    static uint8_t frames[FEC_MAX_K + FEC_MAX_M][LORA_PAYLOAD_MAX];
+    size_t lengths[FEC_MAX_K + FEC_MAX_M];
+    uint8_t payload[FEC_PAYLOAD];
+    uint8_t decoded[FEC_PAYLOAD];
+    uint64_t encodeCycles = 0;
+    uint64_t decodeCycles = 0;
+    uint32_t rebuilt = 0;
+
+    for (uint32_t group = 0; group < FEC_BENCH_GROUPS; group++) {
+        memset(payload, (uint8_t)group, sizeof(payload));
+        uint32_t before = ESP.getCycleCount();
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < k; i++) {
+            encoder.add(payload, sizeof(payload));
+        }
+        while ((lengths[count] = encoder.next(frames[count], LORA_PAYLOAD_MAX)) > 0) {
+            count++;
+        }
+        encodeCycles += ESP.getCycleCount() - before;
+
+        before = ESP.getCycleCount();
+        for (uint8_t i = m; i < count; i++) {
+            decoder.accept(frames[i], lengths[i]);
+            while (decoder.read(decoded, sizeof(decoded)) > 0) {
+                rebuilt++;
+            }
+        }
+        decodeCycles += ESP.getCycleCount() - before;
+    }
+
+    float bytes = (float)FEC_BENCH_GROUPS * k * FEC_PAYLOAD;
+    float mhz = ESP.getCpuFreqMHz();
+    Serial.printf("FEC k %u m %u: encode %.2f MB/s (%.1f cycles/B), decode with %u lost %.2f MB/s (%.1f cycles/B), %u/%u payloads\n",
+                  k, m, bytes * mhz / encodeCycles, encodeCycles / bytes, m, bytes * mhz / decodeCycles,
+                  decodeCycles / bytes, (unsigned)rebuilt, (unsigned)(FEC_BENCH_GROUPS * k));
+}
+
 void setup() {
     Serial.begin(115200);
     delay(2000);
 
-    Serial.println("Creating LoRa object");
-    LoRa LoRaModule(LoRa_M0, LoRa_M1, ESP_RX, ESP_TX);
-
     LoRaModule.setConfigMode();
     LoRaModule.begin();
     LoRaModule.printConfiguration();
@@ -25,6 +69,9 @@ void setup() {
     
     Serial.println("Sending normal mode:");
     LoRaModule.setNormalMode();
+
+    benchFec(4, 2);
+    benchFec(8, 4);
 }
 
 void loop() {
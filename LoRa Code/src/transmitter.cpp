@@ -1,34 +1,351 @@
 #include "LoRaConfig.h"
+#include "TelemetryCodec.h"
+#include "BootProfile.h"
+#include "RateAdapter.h"
+#include "Batcher.h"
+#include "SeriesCodec.h"
+#include "SleepCycle.h"
+#include "NodeTable.h"
 #include "pinDef.h"
 
 //Instanciate LoRa object
-LoRa LoRaModule(LoRa_M0, LoRa_M1, ESP_RX, ESP_TX);
+LoRa LoRaModule(LoRa_M0, LoRa_M1, ESP_RX, ESP_TX, LoRa_AUX_PIN);
 
-void setup() {
-    Serial.begin(115200);
-    delay(500);
+// Module address and channel
+#define NODE_ADDH 0x01
+#define NODE_ADDL 0x02
+#define NODE_CHANNEL 0x30
+
+// Id in front of every data frame, one per buoy sharing a gateway
+#ifndef BUOY_ID
+#define BUOY_ID 0x0001
+#endif
+
+// Several channels, CHANNEL_PLAN_COUNT of them 1 MHz apart from CHANNEL_PLAN_FIRST
+// (same values on the receiver). Without hopping the buoys are spread over them
+// by BUOY_ID, with CHANNEL_HOP_DWELL_MS they all follow the gateway's hops
+// instead (needs SLEEP_NONE to hear its syncs).
+#ifndef CHANNEL_PLAN_COUNT
+#define CHANNEL_PLAN_COUNT 1
+#endif
+#ifndef CHANNEL_PLAN_FIRST
+#define CHANNEL_PLAN_FIRST NODE_CHANNEL
+#endif
+#ifndef CHANNEL_HOP_DWELL_MS
+#define CHANNEL_HOP_DWELL_MS 0
+#endif
+#define CHANNEL_HOP_SEED ((NODE_ADDH << 8) | NODE_ADDL)
+ChannelPlan channels(CHANNEL_PLAN_FIRST, CHANNEL_PLAN_COUNT);
+
+// Channel stored in the module, hopping starts from the first one
+uint8_t homeChannel() {
+    return CHANNEL_HOP_DWELL_MS ? channels.channel(0) : channels.channelForNode(BUOY_ID);
+}
+
+// Boot phase timestamps
+BootProfile boot;
+
+//Binary telemetry encoder (must match receiver schema)
+TelemetryCodec codec(BuoySchema);
+uint8_t sequence = 0;
+
+// Samples are delta compressed into one block per frame, the block leaves when
+// it is full, holds TELEMETRY_BATCH_SAMPLES samples or its first sample is
+// TELEMETRY_MAX_LATENCY_MS old. While the airtime budget is spent it keeps
+// filling instead, so the budget buys full frames. The batch leaves room for the node header.
+#define SAMPLE_INTERVAL_MS 1000
+#define STREAM_TELEMETRY_SERIES 2
+#define TELEMETRY_BATCH_SAMPLES 30
+#define TELEMETRY_MAX_LATENCY_MS 30000
+#define BATCH_CAPACITY (LORA_PAYLOAD_MAX - NODE_HEADER_SIZE)
+Batcher batcher(BATCH_CAPACITY);
+SeriesEncoder series(BuoySchema, BATCH_CAPACITY - BATCH_HEADER_SIZE - BATCH_RECORD_HEADER);
+unsigned long lastSampleAt = 0;
+
+// Air data rate controller, starts from the rate config() stores in EEPROM
+RateAdapter rateAdapter(AIR_DATA_RATE_010_24);
 
-    LoRaModule.setConfigMode();
+// Between samples: SLEEP_NONE keeps listening for rate control, SLEEP_LIGHT and
+// SLEEP_DEEP put the board and the E32 to sleep (fixed air data rate then)
+#ifndef TRANSMITTER_SLEEP
+#define TRANSMITTER_SLEEP SLEEP_NONE
+#endif
+SleepCycle cycle((SleepMode)TRANSMITTER_SLEEP, SAMPLE_INTERVAL_MS);
+
+// Many buoys on one channel: frames only leave in the slot the gateway's beacons
+// give BUOY_ID (receiver built with RECEIVER_TDMA_SLOTS). Needs SLEEP_NONE to hear them.
+// The slots are sized from the airtime at the stored rate, so rate control is off.
+#ifndef TRANSMITTER_TDMA
+#define TRANSMITTER_TDMA 0
+#endif
+
+// Listen before talk with random backoff, from what the module receives (needs
+// SLEEP_NONE as well). No effect on the E32, which cannot sense a packet on air:
+// it delivered no more than without it, use TRANSMITTER_TDMA for many buoys
+#ifndef TRANSMITTER_CSMA
+#define TRANSMITTER_CSMA 0
+#endif
+
+// Kept in RTC memory through deep sleep, restored instead of starting over
+struct RetainedState {
+    uint8_t sequence;
+    SeriesState series;
+    DutyCycleState dutyCycle;   // Airtime of the last window when going to sleep
+    uint32_t sleptAt;           // SleepCycle::nowMs()
+};
+RTC_DATA_ATTR RetainedState retained;
+
+// Per-frame result from the LoRa TX queue
+void onSent(uint32_t frameId, TxStatus status, void* context) {
+    (void)context;
+    if (status != TX_SENT) {
+        Serial.print("Frame ");
+        Serial.print(frameId);
+        Serial.println(status == TX_TIMEOUT ? " timed out" : " failed");
+    }
+}
+
+// Woken from our own deep sleep: the module kept its config and sleeps in mode 3,
+// so setup() only brings it back and restores the cycle state
+void resume() {
     LoRaModule.begin();
-    LoRaModule.printConfiguration();
-
-    bool configSuccess = LoRaModule.config(0x01, 0x02, 0x30);
-    if (configSuccess) {
-        Serial.println("LoRa module configured successfully");
-    } else {
-        Serial.println("Failed to configure LoRa module");
-    }
-    delay(1000);
-    Serial.println("Updated Configuration:");
-    LoRaModule.printConfiguration();
-    
-    Serial.println("Sending normal mode:");
     LoRaModule.setNormalMode();
+    LoRaModule.config(NODE_ADDH, NODE_ADDL, homeChannel()); // NVS cache hit, no UART traffic
+    LoRaModule.onTxComplete(onSent);
+
+    sequence = retained.sequence;
+    series.restore(retained.series);
+#ifdef FREQUENCY_868
+    LoRaModule.setDutyCycle(LORA_DUTY_CYCLE_PERMILLE);
+    LoRaModule.restoreDutyCycle(retained.dutyCycle, SleepCycle::nowMs() - retained.sleptAt);
+#endif
+    batcher.addStream(STREAM_TELEMETRY_SERIES, 1, TELEMETRY_MAX_LATENCY_MS);
+}
+
+void setup() {
+    cycle.begin();
+
+    //Start up serial for debug 
+    Serial.begin(115200);
+
+    if (cycle.resumed()) {
+        resume();
+        return;
+    }
+
+    // Fast boot when NVS says the module already holds our config:
+    // no diagnostic prints, no fixed delays, no UART round trips
+    bool fastBoot = LoRaModule.isConfigCached(NODE_ADDH, NODE_ADDL, homeChannel());
+    boot.setFastBoot(fastBoot);
+    if (!fastBoot) {
+        delay(500); // Give the USB serial monitor time to attach
+    }
+    boot.mark(BOOT_SERIAL_UP);
+
+    if (fastBoot) {
+        // Straight to normal mode, config() only checks the cache
+        LoRaModule.setNormalMode();
+        LoRaModule.begin();
+        boot.mark(BOOT_MODULE_READY);
+
+        LoRaModule.config(NODE_ADDH, NODE_ADDL, homeChannel());
+        boot.mark(BOOT_CONFIG_VERIFIED);
+    }
+    else {
+        LoRaModule.setConfigMode();
+        LoRaModule.begin();
+        boot.mark(BOOT_MODULE_READY);
+        LoRaModule.printConfiguration();
+
+        bool configSuccess = LoRaModule.config(NODE_ADDH, NODE_ADDL, homeChannel());
+        if (configSuccess) {
+            Serial.println("LoRa module configured successfully");
+            boot.mark(BOOT_CONFIG_VERIFIED);
+        } else {
+            Serial.println("Failed to configure LoRa module");
+        }
+        delay(1000);
+        Serial.println("Updated Configuration:");
+        LoRaModule.printConfiguration();
+
+        Serial.println("Sending normal mode:");
+        LoRaModule.setNormalMode();
+    }
+    boot.mark(BOOT_NORMAL_MODE);
+    boot.print(Serial);
+
+    LoRaModule.onTxComplete(onSent);
+#ifdef FREQUENCY_868
+    LoRaModule.setDutyCycle(LORA_DUTY_CYCLE_PERMILLE);
+#endif
+    // One series block per frame, the latency bound is checked on the block itself
+    batcher.addStream(STREAM_TELEMETRY_SERIES, 1, TELEMETRY_MAX_LATENCY_MS);
+
+    // Reports, switch ACKs and beacons from the receiver are read from the RX ring in loop()
+    if (cycle.mode() == SLEEP_NONE) {
+        LoRaModule.beginReceiveTask();
+        if (TRANSMITTER_TDMA) {
+            LoRaModule.setTdma(BUOY_ID);
+        }
+        if (TRANSMITTER_CSMA) {
+            LoRaModule.setCsma(true);
+        }
+        if (CHANNEL_HOP_DWELL_MS && CHANNEL_PLAN_COUNT > 1) {
+            LoRaModule.setHopping(channels, CHANNEL_HOP_SEED, CHANNEL_HOP_DWELL_MS, false);
+        }
+    }
+}
+
+// Feed receiver reports to the rate controller and apply its decisions
+// Returns true while the transmitter has to stay quiet
+bool handleRateControl() {
+    uint32_t now = millis();
+
+    uint8_t rx[LORA_RX_BUFFER_SIZE];
+    size_t length;
+    while ((length = LoRaModule.receive(rx, sizeof(rx))) > 0) {
+        if (LoRaModule.isTdmaEnabled() && LoRaModule.acceptBeacon(rx, length)) {
+            continue;
+        }
+        if (LoRaModule.isHopping() && LoRaModule.acceptHopSync(rx, length)) {
+            continue;
+        }
+        // Gateway answers carry the id of the buoy they are for
+        const uint8_t* payload = rx;
+        if (hasNodeHeader(rx, length)) {
+            if (nodeHeaderId(rx) != BUOY_ID) {
+                continue;
+            }
+            payload += NODE_HEADER_SIZE;
+            length -= NODE_HEADER_SIZE;
+        }
+        RateCtrlFrame ctrl;
+        if (!TRANSMITTER_TDMA && decodeRateCtrl(payload, length, &ctrl)) {
+            rateAdapter.onControlFrame(ctrl, now);
+        }
+    }
+
+    // Fixed rate under TDMA, a switch would overrun the slot
+    if (TRANSMITTER_TDMA) {
+        return false;
+    }
+
+    // Half duplex: the receiver answers right after our frames
+    if (rateAdapter.holdOff(now, LoRaModule.txIdle())) {
+        return true;
+    }
+
+    RateCtrlFrame ctrl;
+    bool requesting = rateAdapter.poll(now, &ctrl);
+    if (requesting) {
+        // Behind our id so the gateway knows which link asks, the sequence is not used up
+        uint8_t frame[NODE_HEADER_SIZE + RATE_CTRL_SIZE];
+        size_t header = writeNodeHeader(frame, BUOY_ID, sequence);
+        LoRaModule.enqueue(frame, header + encodeRateCtrl(ctrl, frame + header, sizeof(frame) - header));
+    }
+
+    if (rateAdapter.rateChanged()) {
+        if (!LoRaModule.setAirDataRate(rateAdapter.rate())) {
+            Serial.println("Failed to change air data rate");
+        }
+    }
+    return requesting;
+}
+
+// Hand the current batch to the TX queue, false if the queue is full
+bool sendBatch() {
+    if (LoRaModule.txQueueFree() == 0) {
+        return false;
+    }
+    uint8_t frame[MAX_SIZE_TX_PACKET];
+    size_t header = writeNodeHeader(frame, BUOY_ID, sequence);
+    size_t size = batcher.take(sequence, frame + header, sizeof(frame) - header);
+    if (size > 0 && LoRaModule.enqueue(frame, header + size) >= 0) {
+        rateAdapter.onSent(sequence++);
+    }
+    return true;
+}
+
+// Move the series block into the batch, false if the previous batch is still waiting
+bool flushSeries() {
+    uint8_t block[SERIES_MAX_BLOCK];
+    if (!batcher.empty() && !sendBatch()) {
+        return false;
+    }
+    uint32_t firstSampleAt = series.firstTimestamp();
+    size_t size = series.take(block, sizeof(block));
+    return size > 0 && batcher.add(STREAM_TELEMETRY_SERIES, block, size, firstSampleAt);
+}
+
+// Sample, in BuoySchema field order, into the series block
+void takeSample() {
+    uint32_t now = SleepCycle::nowMs();
+    float values[] = {
+        temperatureRead(),      // on-chip sensor until the probe is wired
+        0.0f,                   // battery, no divider yet
+        now / 1000.0f,
+    };
+
+    if (!series.add(values, now)) {
+        // Block is full: it goes out and this sample opens the next one (keyframe),
+        // dropped if the queue is backed up
+        if (flushSeries()) {
+            series.add(values, now);
+        }
+    }
+}
+
+// Move the block on once due, then the batch
+void sendDue() {
+    if (!series.empty() && (series.samples() >= TELEMETRY_BATCH_SAMPLES
+                            || SleepCycle::nowMs() - series.firstTimestamp() >= TELEMETRY_MAX_LATENCY_MS)
+        && LoRaModule.txAdmitDelayMs(LORA_PAYLOAD_MAX) == 0) {
+        flushSeries();
+    }
+
+    // Same clock as the sample times, millis() starts over at each wake-up
+    if (batcher.ready(SleepCycle::nowMs())) {
+        sendBatch();
+    }
+}
+
+// One wake-up: sample, send what is due, let it go out, sleep with the module asleep
+void runCycle() {
+    takeSample();
+    sendDue();
+
+    LoRaModule.sleep();
+    retained.sequence = sequence;
+    series.save(&retained.series);
+    retained.dutyCycle = LoRaModule.saveDutyCycle();
+    retained.sleptAt = SleepCycle::nowMs();
+
+    // Previous cycle's figures, this one ends right below
+    cycle.print(Serial);
+    Serial.flush();
+    cycle.sleep();
+
+    // Light sleep comes back here
+    LoRaModule.wake();
 }
 
 void loop() {
-    // Your loop code here
-    LoRaModule.sendBroadcastMessage("Hello from transmitter");
-    delay(2000);
+    // Pushes queued frames into the module and reports completions
+    LoRaModule.update();
 
-}
\ No newline at end of file
+    if (cycle.mode() != SLEEP_NONE) {
+        runCycle();
+        return;
+    }
+
+    if (handleRateControl()) {
+        return;
+    }
+
+    if (millis() - lastSampleAt >= SAMPLE_INTERVAL_MS) {
+        lastSampleAt = millis();
+        takeSample();
+    }
+    sendDue();
+
+}
@@ -0,0 +1,86 @@
+// Host side reader of the receiver's binary uplink (RECEIVER_UPLINK=1)
+// pio run -e uplink && .pio/build/uplink/program /dev/ttyACM2 (no argument: stdin)
+
+#include "Uplink.h"
+#include "TelemetryCodec.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+// Raw mode, the USB-CDC ignores the baud rate
+static bool configurePort(int fd) {
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        return false;
+    }
+    cfmakeraw(&tty);
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
+    return tcsetattr(fd, TCSANOW, &tty) == 0;
+}
+
+static void printFrame(const UplinkReader& reader) {
+    const uint8_t* payload = reader.payload();
+    size_t length = reader.payloadLength();
+    printf("%5u %10u ms ", reader.sequence(), (unsigned)reader.timestamp());
+
+    switch (reader.type()) {
+        case UPLINK_TELEMETRY: {
+            if (length < 3) {
+                break;
+            }
+            printf("node %04X telemetry #%u", payload[0] | (payload[1] << 8), payload[2]);
+            for (uint8_t i = 0; i < BuoySchema.fieldCount && 3 + (i + 1) * sizeof(float) <= length; i++) {
+                float value;
+                memcpy(&value, payload + 3 + i * sizeof(float), sizeof(value));
+                printf(" | %s: %.2f", BuoySchema.fields[i].name, value);
+            }
+            break;
+        }
+        case UPLINK_TEXT:
+            printf("%.*s", (int)length, (const char*)payload);
+            break;
+        default:
+            printf("frame type %u, %u B:", reader.type(), (unsigned)length);
+            for (size_t i = 0; i < length; i++) {
+                printf(" %02X", payload[i]);
+            }
+            break;
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    int fd = STDIN_FILENO;
+    if (argc > 1) {
+        fd = open(argv[1], O_RDONLY | O_NOCTTY);
+        if (fd < 0) {
+            perror(argv[1]);
+            return 1;
+        }
+        if (isatty(fd) && !configurePort(fd)) {
+            perror("termios");
+        }
+    }
+
+    UplinkReader reader;
+    uint8_t buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        size_t used = 0;
+        while (used < (size_t)length) {
+            used += reader.feed(buffer + used, length - used);
+            if (reader.available()) {
+                printFrame(reader);
+            }
+        }
+        fflush(stdout);
+    }
+
+    UplinkReaderStats stats = reader.stats();
+    fprintf(stderr, "%u frames, %u lost, %u rejected\n", (unsigned)stats.frames, (unsigned)stats.lost,
+            (unsigned)stats.crcErrors);
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include <unity.h>
+#include <stdint.h>
+#include "Airtime.h"
+
+#define WINDOW_MS 10000
+#define PERMILLE 100
+#define BUDGET_US ((uint32_t)WINDOW_MS * PERMILLE)
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Greedy sender from start to end, every packet that is admitted goes out.
+// Returns the most airtime found in any window of WINDOW_MS.
+static uint64_t sendGreedy(DutyCycle& dutyCycle, uint32_t airtimeUs, uint32_t start, uint32_t end, uint32_t* sent) {
+    static uint32_t sentAt[4096];
+    uint32_t count = 0;
+    uint64_t worst = 0;
+
+    for (uint32_t now = start; now < end; now++) {
+        if (dutyCycle.delayMs(airtimeUs, now) != 0) {
+            continue;
+        }
+        dutyCycle.charge(airtimeUs, now);
+        sentAt[count++] = now;
+
+        // Window ending now
+        uint64_t inWindow = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (now - sentAt[i] < WINDOW_MS) {
+                inWindow += airtimeUs;
+            }
+        }
+        if (inWindow > worst) {
+            worst = inWindow;
+        }
+    }
+    *sent = count;
+    return worst;
+}
+
+
+////////////////////////////////////////////////////////
+///// AirtimeModel
+////////////////////////////////////////////////////////
+
+static void test_airtime_grows_with_length_and_rate(void) {
+    AirtimeModel slow(0, true, 0);
+    AirtimeModel fast(5, true, 0);
+    TEST_ASSERT_GREATER_THAN(slow.packetUs(10), slow.packetUs(58));
+    TEST_ASSERT_GREATER_THAN(fast.packetUs(58), slow.packetUs(58));
+
+    // 2.4k: SF11, 500 kHz, 4.096 ms symbols
+    AirtimeModel model(2, true, 0);
+    TEST_ASSERT_EQUAL_UINT32(4096, model.symbolUs());
+    TEST_ASSERT_GREATER_THAN(model.packetUs(20, false), model.packetUs(20, true));
+}
+
+
+////////////////////////////////////////////////////////
+///// DutyCycle
+////////////////////////////////////////////////////////
+
+static void test_no_window_exceeds_the_budget(void) {
+    DutyCycle dutyCycle(PERMILLE, WINDOW_MS);
+    uint32_t sent;
+    uint64_t worst = sendGreedy(dutyCycle, 206000, 0, 5 * WINDOW_MS, &sent);
+    TEST_ASSERT_LESS_OR_EQUAL(BUDGET_US, worst);
+
+    // Bursts still go out back to back: 4 packets right away
+    TEST_ASSERT_GREATER_OR_EQUAL(4 * 206000, worst);
+
+    // Long run average close to the duty cycle, slots cost a little
+    uint64_t average = (uint64_t)sent * 206000 * 1000 / (5 * WINDOW_MS);
+    TEST_ASSERT_LESS_OR_EQUAL(PERMILLE * 1000, average);
+    TEST_ASSERT_GREATER_THAN(PERMILLE * 1000 * 3 / 4, average);
+}
+
+static void test_delay_says_when_it_fits(void) {
+    DutyCycle dutyCycle(PERMILLE, WINDOW_MS);
+    dutyCycle.charge(BUDGET_US / 2, 0);
+    dutyCycle.charge(BUDGET_US / 2, 5000);
+    TEST_ASSERT_EQUAL_UINT32(0, dutyCycle.availableUs(6000));
+
+    uint32_t wait = dutyCycle.delayMs(BUDGET_US / 4, 6000);
+    TEST_ASSERT_GREATER_THAN(0, wait);
+    TEST_ASSERT_NOT_EQUAL(UINT32_MAX, wait);
+
+    // Not a ms earlier, fits right then
+    TEST_ASSERT_NOT_EQUAL(0, dutyCycle.delayMs(BUDGET_US / 4, 6000 + wait - 1));
+    TEST_ASSERT_EQUAL_UINT32(0, dutyCycle.delayMs(BUDGET_US / 4, 6000 + wait));
+
+    // The first half left a full window after it was sent
+    TEST_ASSERT_GREATER_OR_EQUAL(WINDOW_MS, 6000 + wait);
+}
+
+static void test_packet_larger_than_budget_never_fits(void) {
+    DutyCycle dutyCycle(PERMILLE, WINDOW_MS);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, dutyCycle.delayMs(BUDGET_US + 1, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, dutyCycle.delayMs(BUDGET_US, 0));
+}
+
+static void test_unlimited_only_counts(void) {
+    DutyCycle dutyCycle;
+    TEST_ASSERT_FALSE(dutyCycle.limited());
+    for (uint32_t now = 0; now < 100; now++) {
+        TEST_ASSERT_EQUAL_UINT32(0, dutyCycle.delayMs(1000000, now));
+        dutyCycle.charge(1000000, now);
+    }
+    TEST_ASSERT_EQUAL(100000000ULL, dutyCycle.usedUs());
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, dutyCycle.availableUs(100));
+}
+
+static void test_window_survives_deep_sleep(void) {
+    DutyCycle before(PERMILLE, WINDOW_MS);
+    before.charge(BUDGET_US, 1000);
+    DutyCycleState state = before.save(1500);
+
+    // millis() starts over on wake-up, 2 s spent asleep: still nothing left
+    DutyCycle after(PERMILLE, WINDOW_MS);
+    after.restore(state, 30, 2000);
+    TEST_ASSERT_EQUAL_UINT32(0, after.availableUs(30));
+    TEST_ASSERT_NOT_EQUAL(0, after.delayMs(1000, 30));
+
+    // A full window after the burst it is all back
+    uint32_t wait = after.delayMs(BUDGET_US, 30);
+    TEST_ASSERT_LESS_OR_EQUAL(WINDOW_MS + WINDOW_MS / DUTY_CYCLE_SLOTS, 500 + 2000 + 30 + wait);
+    TEST_ASSERT_EQUAL_UINT32(BUDGET_US, after.availableUs(30 + wait));
+
+    // Asleep longer than the window: nothing carried
+    DutyCycle late(PERMILLE, WINDOW_MS);
+    late.restore(state, 0, 2 * WINDOW_MS);
+    TEST_ASSERT_EQUAL_UINT32(BUDGET_US, late.availableUs(0));
+}
+
+static void test_clock_wraps(void) {
+    // millis() wraps after 49 days
+    DutyCycle dutyCycle;
+    dutyCycle.setLimit(PERMILLE, WINDOW_MS, UINT32_MAX - 3000);
+    uint32_t sent;
+    uint64_t worst = sendGreedy(dutyCycle, 206000, UINT32_MAX - 3000, UINT32_MAX, &sent);
+    TEST_ASSERT_EQUAL_UINT32(4, sent);
+    TEST_ASSERT_LESS_OR_EQUAL(BUDGET_US, worst);
+    TEST_ASSERT_NOT_EQUAL(0, dutyCycle.delayMs(206000, 100));
+    TEST_ASSERT_EQUAL_UINT32(0, dutyCycle.delayMs(206000, WINDOW_MS + WINDOW_MS / DUTY_CYCLE_SLOTS + 1));
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_airtime_grows_with_length_and_rate);
+    RUN_TEST(test_no_window_exceeds_the_budget);
+    RUN_TEST(test_delay_says_when_it_fits);
+    RUN_TEST(test_packet_larger_than_budget_never_fits);
+    RUN_TEST(test_unlimited_only_counts);
+    RUN_TEST(test_window_survives_deep_sleep);
+    RUN_TEST(test_clock_wraps);
+    return UNITY_END();
+}
@@ -0,0 +1,285 @@
+#include <unity.h>
+#include <string.h>
+#include "Arq.h"
+
+#define STEP_MS 100
+
+static uint8_t frame[LORA_PAYLOAD_MAX];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Payload n: its number then a pattern, so a mixup shows
+static size_t fillPayload(uint8_t* payload, uint32_t n) {
+    size_t size = 8 + n % 30;
+    for (uint8_t i = 0; i < 4; i++) {
+        payload[i] = (n >> (8 * i)) & 0xFF;
+    }
+    for (size_t i = 4; i < size; i++) {
+        payload[i] = (uint8_t)(n * 7 + i);
+    }
+    return size;
+}
+
+// One burst from the sender, frames whose bit is set in lostMask never arrive, returns the frame count
+static uint8_t burst(ArqSender& sender, ArqReceiver& receiver, uint32_t now, uint32_t lostMask = 0) {
+    uint8_t count = 0;
+    size_t length;
+    while ((length = sender.poll(now, frame, sizeof(frame))) > 0) {
+        if (!(lostMask & (1UL << count))) {
+            TEST_ASSERT_TRUE(receiver.accept(frame, length, now));
+        }
+        count++;
+    }
+    if (count > 0) {
+        sender.onBurstSent(now);
+    }
+    return count;
+}
+
+// Receiver's ACK back to the sender, if one is due
+static bool answer(ArqSender& sender, ArqReceiver& receiver, uint32_t now, bool lost = false) {
+    if (!receiver.ackDue(now)) {
+        return false;
+    }
+    size_t length = receiver.ack(frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(ARQ_ACK_SIZE, length);
+    if (!lost) {
+        TEST_ASSERT_TRUE(sender.onAck(frame, length, now));
+    }
+    return true;
+}
+
+
+////////////////////////////////////////////////////////
+///// Bursts and ACKs
+////////////////////////////////////////////////////////
+
+static void test_burst_closes_on_a_flagged_frame(void) {
+    ArqSender sender(4);
+    uint8_t payload[ARQ_PAYLOAD];
+    for (uint32_t n = 0; n < 4; n++) {
+        TEST_ASSERT_TRUE(sender.offer(payload, fillPayload(payload, n)));
+    }
+    TEST_ASSERT_FALSE(sender.canOffer());
+    TEST_ASSERT_FALSE(sender.offer(payload, 8));
+    TEST_ASSERT_FALSE(ArqSender().offer(payload, ARQ_PAYLOAD + 1));
+
+    for (uint8_t seq = 0; seq < 4; seq++) {
+        size_t length = sender.poll(0, frame, sizeof(frame));
+        TEST_ASSERT_TRUE(isArqData(frame, length));
+        TEST_ASSERT_EQUAL_UINT8(seq, frame[1]);
+        TEST_ASSERT_EQUAL_UINT8(0, frame[2]);
+        TEST_ASSERT_EQUAL_UINT8(seq == 3 ? ARQ_FLAG_LAST : 0, frame[3]);
+    }
+
+    // Nothing more until the ACK, or the timeout
+    TEST_ASSERT_EQUAL(0, sender.poll(ARQ_RTO_INITIAL_MS, frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT32(4, sender.inFlight());
+}
+
+static void test_sack_resends_only_what_was_lost(void) {
+    ArqSender sender(4);
+    ArqReceiver receiver;
+    uint8_t payload[ARQ_PAYLOAD];
+    for (uint32_t n = 0; n < 4; n++) {
+        sender.offer(payload, fillPayload(payload, n));
+    }
+    burst(sender, receiver, 0, 0x02);
+    TEST_ASSERT_TRUE(answer(sender, receiver, 300));
+    TEST_ASSERT_EQUAL_UINT8(1, frame[1]);
+    TEST_ASSERT_EQUAL_UINT8(0x03, frame[2]);
+    TEST_ASSERT_EQUAL_UINT32(3, sender.inFlight());
+
+    // Only seq 1 goes out again, then all four come out in order
+    size_t length = sender.poll(400, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_UINT8(1, frame[1]);
+    TEST_ASSERT_EQUAL_UINT8(ARQ_FLAG_LAST, frame[3]);
+    receiver.accept(frame, length, 400);
+    TEST_ASSERT_EQUAL(0, sender.poll(400, frame, sizeof(frame)));
+    sender.onBurstSent(400);
+    TEST_ASSERT_TRUE(answer(sender, receiver, 700));
+    TEST_ASSERT_TRUE(sender.idle());
+    TEST_ASSERT_EQUAL_UINT32(1, sender.stats().retransmits);
+
+    uint8_t received[ARQ_PAYLOAD];
+    for (uint32_t n = 0; n < 4; n++) {
+        size_t size = fillPayload(payload, n);
+        TEST_ASSERT_EQUAL(size, receiver.read(received, sizeof(received)));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, received, size);
+    }
+    TEST_ASSERT_EQUAL(0, receiver.read(received, sizeof(received)));
+}
+
+static void test_lost_ack_times_out_and_backs_off(void) {
+    ArqSender sender(2);
+    ArqReceiver receiver;
+    uint8_t payload[ARQ_PAYLOAD];
+    sender.offer(payload, fillPayload(payload, 0));
+    sender.offer(payload, fillPayload(payload, 1));
+    burst(sender, receiver, 0);
+    answer(sender, receiver, 0, true);
+
+    // The timer runs from onBurstSent(), the whole burst goes again, the receiver drops the copies
+    TEST_ASSERT_EQUAL(0, burst(sender, receiver, ARQ_RTO_INITIAL_MS - 1));
+    TEST_ASSERT_EQUAL(2, burst(sender, receiver, ARQ_RTO_INITIAL_MS));
+    TEST_ASSERT_EQUAL_UINT32(1, sender.stats().timeouts);
+    TEST_ASSERT_EQUAL_UINT32(2 * ARQ_RTO_INITIAL_MS, sender.stats().rtoMs);
+    TEST_ASSERT_EQUAL_UINT32(2, receiver.stats().duplicates);
+
+    TEST_ASSERT_TRUE(answer(sender, receiver, ARQ_RTO_INITIAL_MS));
+    TEST_ASSERT_TRUE(sender.idle());
+    uint8_t received[ARQ_PAYLOAD];
+    TEST_ASSERT_GREATER_THAN(0, receiver.read(received, sizeof(received)));
+    TEST_ASSERT_GREATER_THAN(0, receiver.read(received, sizeof(received)));
+    TEST_ASSERT_EQUAL(0, receiver.read(received, sizeof(received)));
+}
+
+static void test_lost_last_frame_acked_on_receiver_timeout(void) {
+    ArqSender sender(3);
+    ArqReceiver receiver;
+    receiver.setAckTimeout(500);
+    uint8_t payload[ARQ_PAYLOAD];
+    for (uint32_t n = 0; n < 3; n++) {
+        sender.offer(payload, fillPayload(payload, n));
+    }
+    burst(sender, receiver, 0, 0x04);
+    TEST_ASSERT_FALSE(receiver.ackDue(499));
+    TEST_ASSERT_TRUE(answer(sender, receiver, 500));
+    TEST_ASSERT_EQUAL_UINT32(1, sender.inFlight());
+    TEST_ASSERT_EQUAL_UINT32(0, sender.stats().timeouts);
+}
+
+static void test_given_up_frame_is_skipped(void) {
+    ArqSender sender(1);
+    ArqReceiver receiver;
+    uint8_t payload[ARQ_PAYLOAD];
+    uint8_t received[ARQ_PAYLOAD];
+    uint32_t now = 0;
+    sender.offer(payload, fillPayload(payload, 0));
+    burst(sender, receiver, now);
+    answer(sender, receiver, now);
+    receiver.read(received, sizeof(received));
+
+    // Seq 1 never gets through
+    sender.offer(payload, fillPayload(payload, 1));
+    for (uint8_t i = 0; i <= ARQ_MAX_RETRIES; i++) {
+        TEST_ASSERT_EQUAL(1, burst(sender, receiver, now, 0x01));
+        now += ARQ_RTO_MAX_MS;
+    }
+    TEST_ASSERT_EQUAL(0, burst(sender, receiver, now));
+    TEST_ASSERT_EQUAL_UINT32(1, sender.stats().failed);
+    TEST_ASSERT_TRUE(sender.idle());
+
+    // The next frame's base tells the receiver to move on
+    sender.offer(payload, fillPayload(payload, 2));
+    burst(sender, receiver, now);
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.stats().skipped);
+    size_t size = fillPayload(payload, 2);
+    TEST_ASSERT_EQUAL(size, receiver.read(received, sizeof(received)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, received, size);
+}
+
+static void test_frames_past_a_given_up_one_are_acked(void) {
+    // Seq 1 arrives every time but its ACKs are lost, seq 0 never arrives
+    ArqSender sender(2);
+    ArqReceiver receiver;
+    uint8_t payload[ARQ_PAYLOAD];
+    uint8_t received[ARQ_PAYLOAD];
+    uint32_t now = 0;
+    sender.offer(payload, fillPayload(payload, 0));
+    burst(sender, receiver, now, 0x01);
+    now += ARQ_RTO_MAX_MS;
+    sender.offer(payload, fillPayload(payload, 1));
+    for (uint8_t i = 0; i <= ARQ_MAX_RETRIES && sender.stats().failed == 0; i++) {
+        size_t length;
+        while ((length = sender.poll(now, frame, sizeof(frame))) > 0) {
+            if (frame[1] != 0) {
+                receiver.accept(frame, length, now);
+            }
+        }
+        sender.onBurstSent(now);
+        if (sender.stats().failed == 0) {
+            answer(sender, receiver, now, true);
+        }
+        now += ARQ_RTO_MAX_MS;
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, sender.stats().failed);
+
+    // The copy of seq 1 sent after giving up on seq 0 is answered as received
+    TEST_ASSERT_TRUE(answer(sender, receiver, now));
+    TEST_ASSERT_EQUAL_UINT8(2, frame[1]);
+    TEST_ASSERT_TRUE(sender.idle());
+    TEST_ASSERT_EQUAL_UINT32(1, sender.stats().failed);
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.stats().skipped);
+    size_t size = fillPayload(payload, 1);
+    TEST_ASSERT_EQUAL(size, receiver.read(received, sizeof(received)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, received, size);
+}
+
+
+////////////////////////////////////////////////////////
+///// Lossy link
+////////////////////////////////////////////////////////
+
+static void test_lossy_link_delivers_everything_in_order(void) {
+    // One frame or ACK in five lost, the window wrapping the 8 bit sequence several times
+    const uint32_t total = 1000;
+    ArqSender sender(8);
+    ArqReceiver receiver;
+    receiver.setAckTimeout(300);
+    uint8_t payload[ARQ_PAYLOAD];
+    uint8_t received[ARQ_PAYLOAD];
+    uint32_t seed = 7;
+    uint32_t offered = 0;
+    uint32_t delivered = 0;
+
+    for (uint32_t now = 0; delivered < total && now < 3600000; now += STEP_MS) {
+        while (offered < total && sender.canOffer()) {
+            sender.offer(payload, fillPayload(payload, offered++));
+        }
+        size_t length;
+        bool sent = false;
+        while ((length = sender.poll(now, frame, sizeof(frame))) > 0) {
+            seed = seed * 1103515245 + 12345;
+            if ((seed >> 16) % 5 != 0) {
+                receiver.accept(frame, length, now);
+            }
+            sent = true;
+        }
+        if (sent) {
+            sender.onBurstSent(now);
+        }
+        seed = seed * 1103515245 + 12345;
+        answer(sender, receiver, now + STEP_MS / 2, (seed >> 16) % 5 == 0);
+
+        size_t size;
+        while ((size = receiver.read(received, sizeof(received))) > 0) {
+            TEST_ASSERT_EQUAL(fillPayload(payload, delivered), size);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, received, size);
+            delivered++;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(total, delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, sender.stats().failed);
+    TEST_ASSERT_GREATER_THAN(0, sender.stats().retransmits);
+    TEST_ASSERT_GREATER_THAN(0, sender.stats().srttMs);
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_burst_closes_on_a_flagged_frame);
+    RUN_TEST(test_sack_resends_only_what_was_lost);
+    RUN_TEST(test_lost_ack_times_out_and_backs_off);
+    RUN_TEST(test_lost_last_frame_acked_on_receiver_timeout);
+    RUN_TEST(test_given_up_frame_is_skipped);
+    RUN_TEST(test_frames_past_a_given_up_one_are_acked);
+    RUN_TEST(test_lossy_link_delivers_everything_in_order);
+    return UNITY_END();
+}
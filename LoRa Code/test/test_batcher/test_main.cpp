@@ -0,0 +1,163 @@
+#include <unity.h>
+#include <string.h>
+#include "Batcher.h"
+
+#define STREAM_FAST 1
+#define STREAM_SLOW 2
+
+static uint8_t frame[LORA_PAYLOAD_MAX];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+
+////////////////////////////////////////////////////////
+///// Batcher -> BatchReader
+////////////////////////////////////////////////////////
+
+static void test_records_read_back_in_order(void) {
+    Batcher batcher;
+    TEST_ASSERT_TRUE(batcher.addStream(STREAM_FAST, 10, 5000));
+    TEST_ASSERT_TRUE(batcher.addStream(STREAM_SLOW, 10, 60000));
+    const uint8_t a[] = { 1, 2, 3 };
+    const uint8_t b[] = { 9 };
+    TEST_ASSERT_TRUE(batcher.add(STREAM_FAST, a, sizeof(a), 0));
+    TEST_ASSERT_TRUE(batcher.add(STREAM_SLOW, b, sizeof(b), 0));
+    TEST_ASSERT_TRUE(batcher.add(STREAM_FAST, a, 2, 0));
+    TEST_ASSERT_EQUAL(BATCH_HEADER_SIZE + 3 * BATCH_RECORD_HEADER + 6, batcher.size());
+
+    size_t length = batcher.take(42, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(BATCH_HEADER_SIZE + 3 * BATCH_RECORD_HEADER + 6, length);
+    TEST_ASSERT_TRUE(batcher.empty());
+
+    BatchReader reader;
+    TEST_ASSERT_TRUE(reader.begin(frame, length));
+    TEST_ASSERT_EQUAL_UINT8(42, reader.sequence());
+    TEST_ASSERT_EQUAL_UINT8(3, reader.count());
+    const uint8_t* data;
+    size_t size;
+    uint8_t stream;
+    TEST_ASSERT_TRUE(reader.next(&stream, &data, &size));
+    TEST_ASSERT_EQUAL_UINT8(STREAM_FAST, stream);
+    TEST_ASSERT_EQUAL(3, size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(a, data, 3);
+    TEST_ASSERT_TRUE(reader.next(&stream, &data, &size));
+    TEST_ASSERT_EQUAL_UINT8(STREAM_SLOW, stream);
+    TEST_ASSERT_EQUAL_UINT8(9, data[0]);
+    TEST_ASSERT_TRUE(reader.next(&stream, &data, &size));
+    TEST_ASSERT_EQUAL(2, size);
+    TEST_ASSERT_FALSE(reader.next(&stream, &data, &size));
+}
+
+static void test_reader_stops_on_truncated_record(void) {
+    Batcher batcher;
+    batcher.addStream(STREAM_FAST, 10, 5000);
+    const uint8_t a[] = { 1, 2, 3, 4 };
+    batcher.add(STREAM_FAST, a, sizeof(a), 0);
+    batcher.add(STREAM_FAST, a, sizeof(a), 0);
+    size_t length = batcher.take(0, frame, sizeof(frame));
+
+    BatchReader reader;
+    const uint8_t* data;
+    size_t size;
+    uint8_t stream;
+    TEST_ASSERT_TRUE(reader.begin(frame, length - 1));
+    TEST_ASSERT_TRUE(reader.next(&stream, &data, &size));
+    TEST_ASSERT_FALSE(reader.next(&stream, &data, &size));
+
+    frame[0] = 0;
+    TEST_ASSERT_FALSE(reader.begin(frame, length));
+}
+
+
+////////////////////////////////////////////////////////
+///// When a batch is ready
+////////////////////////////////////////////////////////
+
+static void test_ready_on_sample_count(void) {
+    Batcher batcher;
+    batcher.addStream(STREAM_FAST, 3, 60000);
+    const uint8_t sample[4] = {};
+    TEST_ASSERT_FALSE(batcher.ready(0));
+    batcher.add(STREAM_FAST, sample, sizeof(sample), 0);
+    batcher.add(STREAM_FAST, sample, sizeof(sample), 0);
+    TEST_ASSERT_FALSE(batcher.ready(0));
+    batcher.add(STREAM_FAST, sample, sizeof(sample), 0);
+    TEST_ASSERT_TRUE(batcher.ready(0));
+
+    // Counts start over with the next batch
+    batcher.take(0, frame, sizeof(frame));
+    batcher.add(STREAM_FAST, sample, sizeof(sample), 0);
+    TEST_ASSERT_FALSE(batcher.ready(0));
+}
+
+static void test_ready_on_latency_of_the_oldest_sample(void) {
+    Batcher batcher;
+    batcher.addStream(STREAM_FAST, 10, 1000);
+    batcher.addStream(STREAM_SLOW, 10, 60000);
+    const uint8_t sample[4] = {};
+    batcher.add(STREAM_SLOW, sample, sizeof(sample), 0);
+    TEST_ASSERT_EQUAL_UINT32(60000, batcher.msUntilDue(0));
+
+    // A tighter stream brings the deadline forward
+    batcher.add(STREAM_FAST, sample, sizeof(sample), 500);
+    TEST_ASSERT_EQUAL_UINT32(1000, batcher.msUntilDue(500));
+    TEST_ASSERT_FALSE(batcher.ready(1499));
+    TEST_ASSERT_TRUE(batcher.ready(1500));
+    TEST_ASSERT_EQUAL_UINT32(0, batcher.msUntilDue(1500));
+
+    // millis() wrapping in between
+    Batcher wrapping;
+    wrapping.addStream(STREAM_FAST, 10, 1000);
+    wrapping.add(STREAM_FAST, sample, sizeof(sample), UINT32_MAX - 100);
+    TEST_ASSERT_FALSE(wrapping.ready(UINT32_MAX));
+    TEST_ASSERT_TRUE(wrapping.ready(899));
+}
+
+static void test_ready_when_the_next_sample_does_not_fit(void) {
+    Batcher batcher(20);
+    batcher.addStream(STREAM_FAST, 100, 60000);
+    const uint8_t sample[6] = {};
+    TEST_ASSERT_TRUE(batcher.add(STREAM_FAST, sample, sizeof(sample), 0));
+    TEST_ASSERT_TRUE(batcher.add(STREAM_FAST, sample, sizeof(sample), 0));
+    TEST_ASSERT_FALSE(batcher.ready(0));
+
+    // Refused untouched, the batch goes out as is
+    TEST_ASSERT_FALSE(batcher.add(STREAM_FAST, sample, sizeof(sample), 0));
+    TEST_ASSERT_TRUE(batcher.ready(0));
+    TEST_ASSERT_EQUAL_UINT8(2, batcher.records());
+    TEST_ASSERT_LESS_OR_EQUAL(20, batcher.size());
+}
+
+static void test_unknown_stream_and_stream_limit(void) {
+    Batcher batcher;
+    const uint8_t sample[1] = {};
+    TEST_ASSERT_FALSE(batcher.add(7, sample, sizeof(sample), 0));
+    for (uint8_t id = 0; id < BATCH_MAX_STREAMS; id++) {
+        TEST_ASSERT_TRUE(batcher.addStream(id, 1, 1000));
+    }
+    TEST_ASSERT_FALSE(batcher.addStream(BATCH_MAX_STREAMS, 1, 1000));
+
+    // Declaring a stream again only changes its bounds
+    TEST_ASSERT_TRUE(batcher.addStream(0, 2, 1000));
+    TEST_ASSERT_TRUE(batcher.add(0, sample, sizeof(sample), 0));
+    TEST_ASSERT_FALSE(batcher.ready(0));
+    TEST_ASSERT_EQUAL(0, batcher.take(0, frame, 2));
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_records_read_back_in_order);
+    RUN_TEST(test_reader_stops_on_truncated_record);
+    RUN_TEST(test_ready_on_sample_count);
+    RUN_TEST(test_ready_on_latency_of_the_oldest_sample);
+    RUN_TEST(test_ready_when_the_next_sample_does_not_fit);
+    RUN_TEST(test_unknown_stream_and_stream_limit);
+    return UNITY_END();
+}
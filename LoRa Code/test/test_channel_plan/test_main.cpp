@@ -0,0 +1,138 @@
+#include <unity.h>
+#include "ChannelPlan.h"
+
+#define SEED 0x5EED
+#define DWELL_MS 2000
+
+static uint8_t sync[HOP_SYNC_SIZE];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+
+////////////////////////////////////////////////////////
+///// ChannelPlan
+////////////////////////////////////////////////////////
+
+static void test_plan_spacing_and_clamp(void) {
+    ChannelPlan plan(6, 4, 5);
+    TEST_ASSERT_EQUAL_UINT8(4, plan.count());
+    TEST_ASSERT_EQUAL_UINT8(21, plan.channel(3));
+    TEST_ASSERT_EQUAL_UINT16(868, ChannelPlan::frequencyMHz(6));
+
+    // Cut at CHAN 69, a zero spacing taken as 1
+    ChannelPlan high(60, 16, 4);
+    TEST_ASSERT_EQUAL_UINT8(3, high.count());
+    TEST_ASSERT_EQUAL_UINT8(68, high.channel(2));
+    ChannelPlan last(CHANNEL_MAX, 4, 0);
+    TEST_ASSERT_EQUAL_UINT8(1, last.count());
+    TEST_ASSERT_EQUAL_UINT8(CHANNEL_MAX, last.channel(0));
+
+    // No duplicates, nothing out of range, nothing past the maximum
+    TEST_ASSERT_FALSE(plan.add(11));
+    TEST_ASSERT_FALSE(plan.add(CHANNEL_MAX + 1));
+    ChannelPlan full(0, CHANNEL_PLAN_MAX + 4);
+    TEST_ASSERT_EQUAL_UINT8(CHANNEL_PLAN_MAX, full.count());
+    TEST_ASSERT_FALSE(full.add(50));
+}
+
+static void test_nodes_split_over_the_plan(void) {
+    ChannelPlan plan(10, 3, 2);
+    TEST_ASSERT_EQUAL_UINT8(10, plan.channelForNode(0x0100 + 2));
+    TEST_ASSERT_EQUAL_UINT8(12, plan.channelForNode(0x0100 + 3));
+    TEST_ASSERT_EQUAL_UINT8(14, plan.channelForNode(0x0100 + 4));
+}
+
+
+////////////////////////////////////////////////////////
+///// HopSchedule
+////////////////////////////////////////////////////////
+
+static void test_each_cycle_visits_every_channel_once(void) {
+    ChannelPlan plan(0, 8, 3);
+    HopSchedule schedule(plan, SEED, DWELL_MS);
+    HopSchedule again(plan, SEED, DWELL_MS);
+    HopSchedule other(plan, SEED + 1, DWELL_MS);
+    uint8_t differs = 0;
+    for (uint32_t cycle = 0; cycle < 50; cycle++) {
+        bool seen[CHANNEL_MAX + 1] = {};
+        for (uint32_t hop = cycle * 8; hop < (cycle + 1) * 8; hop++) {
+            uint8_t channel = schedule.channelAt(hop);
+            TEST_ASSERT_TRUE(plan.contains(channel));
+            TEST_ASSERT_FALSE(seen[channel]);
+            seen[channel] = true;
+            TEST_ASSERT_EQUAL_UINT8(channel, again.channelAt(hop));
+            differs += other.channelAt(hop) != channel ? 1 : 0;
+        }
+    }
+
+    // Another seed, another order
+    TEST_ASSERT_GREATER_THAN(0, differs);
+}
+
+static void test_follower_in_step_after_sync(void) {
+    ChannelPlan plan(0, 8, 3);
+    HopSchedule master(plan, SEED, DWELL_MS);
+    HopSchedule follower(plan, SEED, DWELL_MS);
+    master.start(1000);
+
+    // Written 3.5 hops in, heard 120 ms later on a clock 50000 ms ahead
+    uint32_t written = 1000 + 7 * DWELL_MS / 2;
+    TEST_ASSERT_EQUAL(HOP_SYNC_SIZE, master.writeSync(sync, written));
+    TEST_ASSERT_FALSE(follower.synced(0));
+    TEST_ASSERT_TRUE(follower.onSync(sync, sizeof(sync), written + 50120, 120));
+    TEST_ASSERT_TRUE(follower.synced(written + 50120));
+
+    // From the sync to its timeout, hop boundaries included
+    for (uint32_t t = written + 120; t < written + 120 + HOP_LOST_HOPS * DWELL_MS; t += 37) {
+        TEST_ASSERT_EQUAL_UINT32(master.hop(t), follower.hop(t + 50000));
+        TEST_ASSERT_EQUAL_UINT8(master.channel(t), follower.channel(t + 50000));
+        TEST_ASSERT_EQUAL_UINT32(master.msToChange(t), follower.msToChange(t + 50000));
+    }
+
+    // Quiet at the start of the next hop until its sync is heard
+    uint32_t nextHop = written + 50000 + master.msToChange(written);
+    TEST_ASSERT_FALSE(follower.awaitingSync(nextHop - 1));
+    TEST_ASSERT_TRUE(follower.awaitingSync(nextHop));
+    TEST_ASSERT_FALSE(follower.awaitingSync(nextHop + DWELL_MS / 2));
+}
+
+static void test_sync_timeout_and_foreign_frames(void) {
+    ChannelPlan plan(0, 8, 3);
+    HopSchedule master(plan, SEED, DWELL_MS);
+    HopSchedule follower(plan, SEED, DWELL_MS);
+    TEST_ASSERT_EQUAL(0, follower.writeSync(sync, 0));
+    master.start(0);
+    master.writeSync(sync, 0);
+    follower.onSync(sync, sizeof(sync), 0, 0);
+    TEST_ASSERT_TRUE(follower.synced(HOP_LOST_HOPS * DWELL_MS - 1));
+    TEST_ASSERT_FALSE(follower.synced(HOP_LOST_HOPS * DWELL_MS));
+    TEST_ASSERT_TRUE(master.synced(100 * HOP_LOST_HOPS * DWELL_MS));
+
+    // Out of step: a whole cycle and one hop on each channel, to hear the gateway come by
+    uint32_t scanMs = 9 * DWELL_MS;
+    TEST_ASSERT_EQUAL_UINT8(plan.channel(1), follower.channel(scanMs));
+    TEST_ASSERT_EQUAL_UINT32(scanMs, follower.msToChange(scanMs));
+
+    // Not a sync, or another network's plan
+    TEST_ASSERT_FALSE(follower.onSync(sync, HOP_SYNC_SIZE - 1, 0, 0));
+    sync[9] = 4;
+    TEST_ASSERT_TRUE(follower.onSync(sync, sizeof(sync), scanMs, 0));
+    TEST_ASSERT_FALSE(follower.synced(scanMs));
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_plan_spacing_and_clamp);
+    RUN_TEST(test_nodes_split_over_the_plan);
+    RUN_TEST(test_each_cycle_visits_every_channel_once);
+    RUN_TEST(test_follower_in_step_after_sync);
+    RUN_TEST(test_sync_timeout_and_foreign_frames);
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+#include <unity.h>
+#include "Csma.h"
+
+#define SLOT_MS 100
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Time of the first delayMs() of 0 from now on, stepping 1 ms
+static uint32_t sendTime(CsmaBackoff& csma, uint32_t now) {
+    while (csma.delayMs(now) > 0) {
+        now++;
+    }
+    return now;
+}
+
+
+////////////////////////////////////////////////////////
+///// Busy channel
+////////////////////////////////////////////////////////
+
+static void test_free_channel_sends_at_once(void) {
+    CsmaBackoff csma(SLOT_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, csma.delayMs(1000));
+    csma.onSent();
+    CsmaStats stats = csma.stats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.sent);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.busy);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.backoffs);
+}
+
+static void test_busy_hold_only_grows(void) {
+    CsmaBackoff csma(SLOT_MS);
+    csma.onBusy(1000, 300);
+    csma.onBusy(1100, 50);
+    TEST_ASSERT_TRUE(csma.busy(1299));
+    TEST_ASSERT_FALSE(csma.busy(1300));
+    csma.onBusy(1200, 300);
+    TEST_ASSERT_TRUE(csma.busy(1499));
+    TEST_ASSERT_FALSE(csma.busy(1500));
+}
+
+static void test_waits_for_the_channel_then_a_backoff(void) {
+    CsmaBackoff csma(SLOT_MS, 7);
+    csma.onBusy(1000, 300);
+    TEST_ASSERT_EQUAL_UINT32(300, csma.delayMs(1000));
+    TEST_ASSERT_EQUAL_UINT32(200, csma.delayMs(1100));
+
+    // Drawn once the channel clears, whole slots within the window
+    uint32_t at = sendTime(csma, 1300);
+    CsmaStats stats = csma.stats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.busy);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.backoffs);
+    TEST_ASSERT_EQUAL_UINT32(at - 1300, stats.backoffMs);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.backoffMs % SLOT_MS);
+    TEST_ASSERT_LESS_THAN(CSMA_MIN_WINDOW * SLOT_MS, stats.backoffMs);
+
+    // Nothing left over for the next frame
+    TEST_ASSERT_EQUAL_UINT32(0, csma.delayMs(at + 1));
+}
+
+static void test_backoff_freezes_and_resumes(void) {
+    // A seed whose first draw is a few slots, in a window widened beforehand
+    CsmaBackoff csma(SLOT_MS);
+    uint32_t backoff = 0;
+    for (uint32_t seed = 1; backoff < 3 * SLOT_MS; seed++) {
+        csma = CsmaBackoff(SLOT_MS, seed);
+        for (uint8_t i = 0; i < 3; i++) {
+            csma.onCollision();
+        }
+        csma.onBusy(0, 100);
+        csma.delayMs(0);
+        backoff = csma.delayMs(100);
+    }
+    uint16_t window = csma.stats().window;
+
+    // Traffic one slot into the backoff pauses it, the rest runs once it clears
+    csma.onBusy(100 + SLOT_MS, 250);
+    TEST_ASSERT_EQUAL_UINT32(250, csma.delayMs(100 + SLOT_MS));
+    TEST_ASSERT_EQUAL_UINT32(backoff - SLOT_MS, csma.delayMs(350 + SLOT_MS));
+    TEST_ASSERT_EQUAL_UINT32(350 + backoff, sendTime(csma, 350 + SLOT_MS));
+    TEST_ASSERT_EQUAL_UINT32(1, csma.stats().backoffs);
+
+    // Frames after it draw from a wider window
+    TEST_ASSERT_EQUAL_UINT16(window * 2, csma.stats().window);
+}
+
+
+////////////////////////////////////////////////////////
+///// Window
+////////////////////////////////////////////////////////
+
+static void test_window_widens_and_halves_within_bounds(void) {
+    CsmaBackoff csma(SLOT_MS);
+    TEST_ASSERT_EQUAL_UINT16(CSMA_MIN_WINDOW, csma.stats().window);
+    for (uint8_t i = 0; i < 10; i++) {
+        csma.onCollision();
+    }
+    TEST_ASSERT_EQUAL_UINT16(CSMA_MAX_WINDOW, csma.stats().window);
+    TEST_ASSERT_EQUAL_UINT32(10, csma.stats().collisions);
+
+    csma.onSent();
+    TEST_ASSERT_EQUAL_UINT16(CSMA_MAX_WINDOW / 2, csma.stats().window);
+    for (uint8_t i = 0; i < 10; i++) {
+        csma.onSent();
+    }
+    TEST_ASSERT_EQUAL_UINT16(CSMA_MIN_WINDOW, csma.stats().window);
+}
+
+static void test_nodes_waiting_on_one_packet_spread(void) {
+    // Eight nodes with their own seed, all waiting on the same packet
+    const uint8_t nodes = 8;
+    uint32_t times[nodes];
+    for (uint8_t n = 0; n < nodes; n++) {
+        CsmaBackoff csma(SLOT_MS, 0x0100 + n * 2654435769UL);
+        for (uint8_t i = 0; i < 3; i++) {
+            csma.onCollision();
+        }
+        csma.onBusy(0, 500);
+        csma.delayMs(0);
+        times[n] = sendTime(csma, 500);
+    }
+    uint8_t distinct = 0;
+    for (uint8_t n = 0; n < nodes; n++) {
+        bool first = true;
+        for (uint8_t m = 0; m < n; m++) {
+            first = first && times[m] != times[n];
+        }
+        distinct += first ? 1 : 0;
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(4, distinct);
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_free_channel_sends_at_once);
+    RUN_TEST(test_busy_hold_only_grows);
+    RUN_TEST(test_waits_for_the_channel_then_a_backoff);
+    RUN_TEST(test_backoff_freezes_and_resumes);
+    RUN_TEST(test_window_widens_and_halves_within_bounds);
+    RUN_TEST(test_nodes_waiting_on_one_packet_spread);
+    return UNITY_END();
+}
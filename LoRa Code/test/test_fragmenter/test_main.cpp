@@ -0,0 +1,197 @@
+#include <unity.h>
+#include <string.h>
+#include "Fragmenter.h"
+
+#define MESSAGE_SIZE 300
+
+static uint8_t message[MESSAGE_SIZE];
+static uint8_t fragments[FRAG_MAX_FRAGMENTS][LORA_PAYLOAD_MAX];
+static size_t lengths[FRAG_MAX_FRAGMENTS];
+
+void setUp(void) {
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = (uint8_t)(i * 7 + 3);
+    }
+}
+
+void tearDown(void) {
+}
+
+// Split one message, returns the fragment count
+static size_t split(Fragmenter& fragmenter, const uint8_t* data, size_t size) {
+    TEST_ASSERT_TRUE(fragmenter.begin(data, size));
+    size_t count = 0;
+    while ((lengths[count] = fragmenter.next(fragments[count], LORA_PAYLOAD_MAX)) > 0) {
+        count++;
+    }
+    return count;
+}
+
+
+////////////////////////////////////////////////////////
+///// Fragmenter
+////////////////////////////////////////////////////////
+
+static void test_fragments_fill_one_frame(void) {
+    Fragmenter fragmenter;
+    size_t count = split(fragmenter, message, sizeof(message));
+    TEST_ASSERT_EQUAL((MESSAGE_SIZE + FRAG_PAYLOAD - 1) / FRAG_PAYLOAD, count);
+    TEST_ASSERT_FALSE(fragmenter.pending());
+
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(isFragment(fragments[i], lengths[i]));
+        TEST_ASSERT_EQUAL_UINT8(i, fragments[i][2]);
+        TEST_ASSERT_EQUAL_UINT8(count, fragments[i][3]);
+        TEST_ASSERT_LESS_OR_EQUAL(LORA_PAYLOAD_MAX, lengths[i]);
+        if (i < count - 1) {
+            TEST_ASSERT_EQUAL(LORA_PAYLOAD_MAX, lengths[i]);
+        }
+    }
+}
+
+static void test_fragmenter_rejects_bad_sizes(void) {
+    Fragmenter fragmenter;
+    static uint8_t big[FRAG_MAX_MESSAGE + 1];
+    TEST_ASSERT_FALSE(fragmenter.begin(message, 0));
+    TEST_ASSERT_FALSE(fragmenter.begin(big, sizeof(big)));
+    TEST_ASSERT_TRUE(fragmenter.begin(big, FRAG_MAX_MESSAGE));
+
+    // Previous message not fully out yet
+    TEST_ASSERT_FALSE(fragmenter.begin(message, 10));
+}
+
+
+////////////////////////////////////////////////////////
+///// Reassembler
+////////////////////////////////////////////////////////
+
+static void test_reassembles_out_of_order(void) {
+    Fragmenter fragmenter;
+    Reassembler reassembler;
+    size_t count = split(fragmenter, message, sizeof(message));
+
+    // Reversed, the last fragment completes nothing until the first arrives
+    for (size_t i = count - 1; i > 0; i--) {
+        TEST_ASSERT_EQUAL(0, reassembler.accept(fragments[i], lengths[i], 100));
+    }
+    TEST_ASSERT_EQUAL(1, reassembler.inProgress());
+    TEST_ASSERT_EQUAL(MESSAGE_SIZE, reassembler.accept(fragments[0], lengths[0], 100));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(message, reassembler.message(), MESSAGE_SIZE);
+    TEST_ASSERT_EQUAL(0, reassembler.inProgress());
+    TEST_ASSERT_EQUAL_UINT32(1, reassembler.stats().completed);
+}
+
+static void test_same_id_from_two_nodes_does_not_mix(void) {
+    // Both nodes start their message ids at 1
+    Fragmenter nodeA;
+    Fragmenter nodeB;
+    static uint8_t otherMessage[MESSAGE_SIZE];
+    for (size_t i = 0; i < sizeof(otherMessage); i++) {
+        otherMessage[i] = (uint8_t)~message[i];
+    }
+    static uint8_t fragmentsA[FRAG_MAX_FRAGMENTS][LORA_PAYLOAD_MAX];
+    static size_t lengthsA[FRAG_MAX_FRAGMENTS];
+    size_t count = split(nodeA, message, sizeof(message));
+    memcpy(fragmentsA, fragments, sizeof(fragments));
+    memcpy(lengthsA, lengths, sizeof(lengths));
+    TEST_ASSERT_EQUAL(count, split(nodeB, otherMessage, sizeof(otherMessage)));
+    TEST_ASSERT_EQUAL_UINT8(fragmentsA[0][1], fragments[0][1]);
+
+    // Interleaved, as a gateway hears them
+    Reassembler reassembler;
+    for (size_t i = 0; i < count - 1; i++) {
+        TEST_ASSERT_EQUAL(0, reassembler.accept(fragmentsA[i], lengthsA[i], 100, 0x0A));
+        TEST_ASSERT_EQUAL(0, reassembler.accept(fragments[i], lengths[i], 100, 0x0B));
+    }
+    TEST_ASSERT_EQUAL(2, reassembler.inProgress());
+    TEST_ASSERT_EQUAL(MESSAGE_SIZE, reassembler.accept(fragmentsA[count - 1], lengthsA[count - 1], 100, 0x0A));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(message, reassembler.message(), MESSAGE_SIZE);
+    TEST_ASSERT_EQUAL(MESSAGE_SIZE, reassembler.accept(fragments[count - 1], lengths[count - 1], 100, 0x0B));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(otherMessage, reassembler.message(), MESSAGE_SIZE);
+    TEST_ASSERT_EQUAL_UINT32(0, reassembler.stats().duplicates);
+}
+
+static void test_late_duplicate_is_dropped(void) {
+    Fragmenter fragmenter;
+    Reassembler reassembler;
+    size_t count = split(fragmenter, message, sizeof(message));
+    for (size_t i = 0; i < count; i++) {
+        reassembler.accept(fragments[i], lengths[i], 100);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, reassembler.stats().completed);
+
+    // A retransmitted copy after completion opens no slot
+    TEST_ASSERT_EQUAL(0, reassembler.accept(fragments[1], lengths[1], 200));
+    TEST_ASSERT_EQUAL(0, reassembler.inProgress());
+    TEST_ASSERT_EQUAL_UINT32(1, reassembler.stats().duplicates);
+
+    // Single fragment messages are not delivered twice either
+    uint8_t single[LORA_PAYLOAD_MAX];
+    size_t length;
+    TEST_ASSERT_TRUE(fragmenter.begin(message, 10));
+    length = fragmenter.next(single, sizeof(single));
+    TEST_ASSERT_EQUAL(10, reassembler.accept(single, length, 300));
+    TEST_ASSERT_EQUAL(0, reassembler.accept(single, length, 400));
+
+    // Forgotten after the timeout, the id can come round again
+    TEST_ASSERT_EQUAL(10, reassembler.accept(single, length, 300 + FRAG_TIMEOUT_MS));
+}
+
+static void test_duplicate_and_stale_fragments(void) {
+    Fragmenter fragmenter;
+    Reassembler reassembler;
+    split(fragmenter, message, sizeof(message));
+
+    reassembler.accept(fragments[0], lengths[0], 0);
+    reassembler.accept(fragments[0], lengths[0], 10);
+    TEST_ASSERT_EQUAL_UINT32(1, reassembler.stats().duplicates);
+
+    // Nothing more for FRAG_TIMEOUT_MS: the message is dropped
+    reassembler.expire(10 + FRAG_TIMEOUT_MS);
+    TEST_ASSERT_EQUAL(0, reassembler.inProgress());
+    TEST_ASSERT_EQUAL_UINT32(1, reassembler.stats().timedOut);
+}
+
+static void test_full_table_evicts_oldest(void) {
+    Fragmenter fragmenters[FRAG_SLOTS + 1];
+    Reassembler reassembler;
+    for (uint16_t node = 0; node <= FRAG_SLOTS; node++) {
+        split(fragmenters[node], message, sizeof(message));
+        reassembler.accept(fragments[0], lengths[0], node, node + 1);
+    }
+    TEST_ASSERT_EQUAL(FRAG_SLOTS, reassembler.inProgress());
+    TEST_ASSERT_EQUAL_UINT32(1, reassembler.stats().evicted);
+}
+
+static void test_invalid_fragments_are_counted(void) {
+    Reassembler reassembler;
+    uint8_t frame[LORA_PAYLOAD_MAX] = { FRAG_MAGIC, 1, 0, 2 };
+
+    // Not the last fragment, but short
+    TEST_ASSERT_EQUAL(0, reassembler.accept(frame, FRAG_HEADER_SIZE + 3, 0));
+    // Index past the count
+    frame[2] = 2;
+    TEST_ASSERT_EQUAL(0, reassembler.accept(frame, sizeof(frame), 0));
+    // More fragments than a message can have
+    frame[2] = 0;
+    frame[3] = FRAG_MAX_FRAGMENTS + 1;
+    TEST_ASSERT_EQUAL(0, reassembler.accept(frame, sizeof(frame), 0));
+    TEST_ASSERT_EQUAL_UINT32(3, reassembler.stats().invalid);
+    TEST_ASSERT_EQUAL(0, reassembler.inProgress());
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_fragments_fill_one_frame);
+    RUN_TEST(test_fragmenter_rejects_bad_sizes);
+    RUN_TEST(test_reassembles_out_of_order);
+    RUN_TEST(test_same_id_from_two_nodes_does_not_mix);
+    RUN_TEST(test_late_duplicate_is_dropped);
+    RUN_TEST(test_duplicate_and_stale_fragments);
+    RUN_TEST(test_full_table_evicts_oldest);
+    RUN_TEST(test_invalid_fragments_are_counted);
+    return UNITY_END();
+}
@@ -0,0 +1,268 @@
+#include <unity.h>
+#include <string.h>
+#include <new>
+#include <thread>
+#include <Arduino.h>
+#include "FrameRing.h"
+#include "LoRaConfig.h"
+
+// Fresh instance on Serial1 for each test, the tests play the module.
+// Placement new: the rings are cache line aligned, plain new is not in C++11.
+alignas(LoRa) static uint8_t loraStorage[sizeof(LoRa)];
+static LoRa* lora = nullptr;
+
+void setUp(void) {
+    lora = new (loraStorage) LoRa(Serial1, -1, -1, 18, 17);
+    lora->beginReceiveTask();
+}
+
+void tearDown(void) {
+    lora->~LoRa();
+    lora = nullptr;
+    while (Serial1.available() > 0) {
+        Serial1.read();
+    }
+}
+
+// Module output: the fixed header, then the payload
+static size_t buildPacket(uint8_t* packet, uint8_t fill, size_t payload) {
+    packet[0] = 0xFF;
+    packet[1] = 0xFF;
+    packet[2] = 0x06;
+    memset(packet + LORA_FIXED_HEADER_SIZE, fill, payload);
+    return payload + LORA_FIXED_HEADER_SIZE;
+}
+
+// Shift the bytes in, then let the line stay idle past the RX timeout
+static void injectBurst(const uint8_t* data, size_t size) {
+    Serial1.injectRx(data, size);
+    while (Serial1.rxBusy()) {
+        delay(1);
+    }
+    delay(LORA_RX_GAP_MS * 2);
+}
+
+static void injectPacket(uint8_t fill, size_t payload) {
+    uint8_t packet[LORA_SUBPACKET_SIZE];
+    injectBurst(packet, buildPacket(packet, fill, payload));
+}
+
+
+////////////////////////////////////////////////////////
+///// FrameRing
+////////////////////////////////////////////////////////
+
+static void test_ring_drains_in_order(void) {
+    FrameRing<4, 8> ring;
+    for (uint8_t i = 0; i < 3; i++) {
+        uint8_t frame[2] = { i, (uint8_t)(i * 2) };
+        TEST_ASSERT_TRUE(ring.push(frame, sizeof(frame), 100 + i));
+    }
+    TEST_ASSERT_EQUAL(3, ring.count());
+
+    for (uint8_t i = 0; i < 3; i++) {
+        size_t length = 0;
+        uint32_t tag = 0;
+        const uint8_t* frame = ring.peek(&length, &tag);
+        TEST_ASSERT_NOT_NULL(frame);
+        TEST_ASSERT_EQUAL(2, length);
+        TEST_ASSERT_EQUAL_UINT8(i, frame[0]);
+        TEST_ASSERT_EQUAL_UINT32(100 + i, tag);
+        ring.release();
+    }
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.dropped());
+}
+
+static void test_ring_overflow_drops_and_counts(void) {
+    FrameRing<4, 8> ring;
+    uint8_t frame[1];
+    for (uint8_t i = 0; i < 4; i++) {
+        frame[0] = i;
+        TEST_ASSERT_TRUE(ring.push(frame, 1));
+    }
+    frame[0] = 4;
+    TEST_ASSERT_FALSE(ring.push(frame, 1));
+    TEST_ASSERT_NULL(ring.reserve());
+    TEST_ASSERT_EQUAL_UINT32(2, ring.dropped());
+    TEST_ASSERT_EQUAL(4, ring.count());
+
+    // Oldest frames are kept, the new ones were lost
+    uint8_t out[8];
+    TEST_ASSERT_EQUAL(1, ring.pop(out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT8(0, out[0]);
+    frame[0] = 5;
+    TEST_ASSERT_TRUE(ring.push(frame, 1));
+    for (uint8_t expected : { 1, 2, 3, 5 }) {
+        TEST_ASSERT_EQUAL(1, ring.pop(out, sizeof(out)));
+        TEST_ASSERT_EQUAL_UINT8(expected, out[0]);
+    }
+    TEST_ASSERT_EQUAL(0, ring.pop(out, sizeof(out)));
+}
+
+static void test_ring_truncates_to_slot(void) {
+    FrameRing<2, 4> ring;
+    const uint8_t frame[6] = { 1, 2, 3, 4, 5, 6 };
+    TEST_ASSERT_TRUE(ring.push(frame, sizeof(frame)));
+
+    uint8_t out[8] = { 0 };
+    TEST_ASSERT_EQUAL(4, ring.pop(out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, out, 4);
+
+    // A short buffer takes what fits, the frame is gone anyway
+    TEST_ASSERT_TRUE(ring.push(frame, 3));
+    TEST_ASSERT_EQUAL(2, ring.pop(out, 2));
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+static void test_ring_wraparound_across_threads(void) {
+    // Many laps of a small ring, producer and consumer on their own threads
+    static FrameRing<8, 8> ring;
+    const uint32_t frames = 200000;
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < frames; i++) {
+            // Only this thread fills the ring, so a free slot stays free
+            while (ring.count() >= ring.capacity()) {
+                std::this_thread::yield();
+            }
+            uint8_t* slot = ring.reserve();
+            memcpy(slot, &i, sizeof(i));
+            slot[4] = (uint8_t)~i;
+            ring.commit(5, i);
+        }
+    });
+
+    uint32_t expected = 0;
+    bool inOrder = true;
+    while (expected < frames) {
+        size_t length;
+        uint32_t tag;
+        const uint8_t* slot = ring.peek(&length, &tag);
+        if (slot == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t value;
+        memcpy(&value, slot, sizeof(value));
+        if (length != 5 || value != expected || tag != expected || slot[4] != (uint8_t)~expected) {
+            inOrder = false;
+        }
+        ring.release();
+        expected++;
+    }
+    producer.join();
+
+    TEST_ASSERT_TRUE(inOrder);
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.dropped());
+}
+
+
+////////////////////////////////////////////////////////
+///// UART event path (LoRa::onUartReceive)
+////////////////////////////////////////////////////////
+
+static void test_back_to_back_frames_drain_in_order(void) {
+    for (uint8_t i = 0; i < 5; i++) {
+        injectPacket(0x10 + i, 10 + i);
+    }
+    TEST_ASSERT_EQUAL(5, lora->pendingFrames());
+
+    // Fixed header stripped, payloads in arrival order
+    uint8_t out[LORA_RX_BUFFER_SIZE];
+    for (uint8_t i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(10 + i, lora->receive(out, sizeof(out)));
+        TEST_ASSERT_EACH_EQUAL_UINT8(0x10 + i, out, 10 + i);
+    }
+    TEST_ASSERT_EQUAL(0, lora->receive(out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT32(0, lora->droppedFrames());
+}
+
+static void test_idle_gap_ends_a_frame(void) {
+    // No gap between two packets: one frame, the second header is payload
+    uint8_t burst[2 * LORA_SUBPACKET_SIZE];
+    size_t first = buildPacket(burst, 0x21, 8);
+    size_t second = buildPacket(burst + first, 0x22, 8);
+    injectBurst(burst, first + second);
+    TEST_ASSERT_EQUAL(1, lora->pendingFrames());
+
+    uint8_t out[LORA_RX_BUFFER_SIZE];
+    TEST_ASSERT_EQUAL(first + second - LORA_FIXED_HEADER_SIZE, lora->receive(out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(burst + LORA_FIXED_HEADER_SIZE, out, first + second - LORA_FIXED_HEADER_SIZE);
+
+    // The same bytes with an idle gap in between: two frames
+    injectBurst(burst, first);
+    injectBurst(burst + first, second);
+    TEST_ASSERT_EQUAL(2, lora->pendingFrames());
+    TEST_ASSERT_EQUAL(8, lora->receive(out, sizeof(out)));
+    TEST_ASSERT_EACH_EQUAL_UINT8(0x21, out, 8);
+    TEST_ASSERT_EQUAL(8, lora->receive(out, sizeof(out)));
+    TEST_ASSERT_EACH_EQUAL_UINT8(0x22, out, 8);
+}
+
+static void test_burst_longer_than_a_slot_is_dropped_whole(void) {
+    // A merged burst is not cut into 64 byte slots, it is counted and dropped
+    uint8_t burst[100];
+    buildPacket(burst, 0x33, sizeof(burst) - LORA_FIXED_HEADER_SIZE);
+    injectBurst(burst, sizeof(burst));
+    TEST_ASSERT_EQUAL(0, lora->pendingFrames());
+    TEST_ASSERT_EQUAL_UINT32(1, lora->droppedFrames());
+
+    // Longer than one sub-packet but within the slot: dropped too
+    buildPacket(burst, 0x34, LORA_SUBPACKET_SIZE + 2 - LORA_FIXED_HEADER_SIZE);
+    injectBurst(burst, LORA_SUBPACKET_SIZE + 2);
+    TEST_ASSERT_EQUAL(0, lora->pendingFrames());
+    TEST_ASSERT_EQUAL_UINT32(2, lora->droppedFrames());
+
+    // The largest packet still fits, and the line recovered
+    injectPacket(0x35, LORA_PAYLOAD_MAX);
+    uint8_t out[LORA_RX_BUFFER_SIZE];
+    TEST_ASSERT_EQUAL(LORA_PAYLOAD_MAX, lora->receive(out, sizeof(out)));
+    TEST_ASSERT_EACH_EQUAL_UINT8(0x35, out, LORA_PAYLOAD_MAX);
+    TEST_ASSERT_EQUAL_UINT32(2, lora->droppedFrames());
+}
+
+static void test_header_only_burst_is_dropped(void) {
+    const uint8_t header[LORA_FIXED_HEADER_SIZE] = { 0xFF, 0xFF, 0x06 };
+    injectBurst(header, sizeof(header));
+    TEST_ASSERT_EQUAL(0, lora->pendingFrames());
+    TEST_ASSERT_EQUAL_UINT32(1, lora->droppedFrames());
+}
+
+static void test_full_ring_drops_and_counts(void) {
+    // Nobody reads: the ring keeps the oldest frames, the rest are counted
+    for (uint8_t i = 0; i < LORA_RX_RING_SLOTS + 3; i++) {
+        injectPacket(i, 4);
+    }
+    TEST_ASSERT_EQUAL(LORA_RX_RING_SLOTS, lora->pendingFrames());
+    TEST_ASSERT_EQUAL_UINT32(3, lora->droppedFrames());
+
+    uint8_t out[LORA_RX_BUFFER_SIZE];
+    for (uint8_t i = 0; i < LORA_RX_RING_SLOTS; i++) {
+        TEST_ASSERT_EQUAL(4, lora->receive(out, sizeof(out)));
+        TEST_ASSERT_EQUAL_UINT8(i, out[0]);
+    }
+
+    // The dropped packets were flushed from the UART, the next one is clean
+    injectPacket(0x44, 6);
+    TEST_ASSERT_EQUAL(6, lora->receive(out, sizeof(out)));
+    TEST_ASSERT_EACH_EQUAL_UINT8(0x44, out, 6);
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_ring_drains_in_order);
+    RUN_TEST(test_ring_overflow_drops_and_counts);
+    RUN_TEST(test_ring_truncates_to_slot);
+    RUN_TEST(test_ring_wraparound_across_threads);
+    RUN_TEST(test_back_to_back_frames_drain_in_order);
+    RUN_TEST(test_idle_gap_ends_a_frame);
+    RUN_TEST(test_burst_longer_than_a_slot_is_dropped_whole);
+    RUN_TEST(test_header_only_burst_is_dropped);
+    RUN_TEST(test_full_ring_drops_and_counts);
+    return UNITY_END();
+}
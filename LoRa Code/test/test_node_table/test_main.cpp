@@ -0,0 +1,173 @@
+#include <unity.h>
+#include <string.h>
+#include "NodeTable.h"
+
+#define PAYLOAD_SIZE 8
+
+// 12 KB, kept off the stack
+static NodeTable table;
+static uint8_t frame[NODE_HEADER_SIZE + PAYLOAD_SIZE];
+
+void setUp(void) {
+    table.clear();
+    memset(frame, 0x5A, sizeof(frame));
+}
+
+void tearDown(void) {
+}
+
+// Hand one frame of a node to the table, returns the verdict
+static NodeVerdict hear(uint16_t node, uint8_t sequence, uint32_t now, NodeFrame* out = nullptr) {
+    NodeFrame result;
+    writeNodeHeader(frame, node, sequence);
+    TEST_ASSERT_TRUE(table.accept(frame, sizeof(frame), now, &result));
+    if (out != nullptr) {
+        *out = result;
+    }
+    return result.verdict;
+}
+
+
+////////////////////////////////////////////////////////
+///// Node header
+////////////////////////////////////////////////////////
+
+static void test_header_round_trip(void) {
+    TEST_ASSERT_EQUAL(NODE_HEADER_SIZE, writeNodeHeader(frame, 0x1234, 7));
+    TEST_ASSERT_TRUE(hasNodeHeader(frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT16(0x1234, nodeHeaderId(frame));
+
+    // A header alone is no frame
+    TEST_ASSERT_FALSE(hasNodeHeader(frame, NODE_HEADER_SIZE));
+    frame[0] = 0;
+    NodeFrame result;
+    TEST_ASSERT_FALSE(table.accept(frame, sizeof(frame), 0, &result));
+    TEST_ASSERT_EQUAL_UINT32(0, table.stats().frames);
+}
+
+static void test_payload_follows_header(void) {
+    NodeFrame result;
+    TEST_ASSERT_EQUAL(NODE_FIRST, hear(0x0102, 9, 0, &result));
+    TEST_ASSERT_EQUAL_UINT16(0x0102, result.node);
+    TEST_ASSERT_EQUAL_UINT8(9, result.sequence);
+    TEST_ASSERT_EQUAL_PTR(frame + NODE_HEADER_SIZE, result.payload);
+    TEST_ASSERT_EQUAL(PAYLOAD_SIZE, result.length);
+    TEST_ASSERT_EQUAL_PTR(table.find(0x0102), result.entry);
+}
+
+
+////////////////////////////////////////////////////////
+///// Sequence tracking
+////////////////////////////////////////////////////////
+
+static void test_in_order_then_gap(void) {
+    NodeFrame result;
+    hear(7, 0, 0);
+    TEST_ASSERT_EQUAL(NODE_IN_ORDER, hear(7, 1, 10));
+    TEST_ASSERT_EQUAL(NODE_GAP, hear(7, 4, 20, &result));
+    TEST_ASSERT_EQUAL_UINT8(2, result.missed);
+    TEST_ASSERT_EQUAL_UINT32(2, table.find(7)->lost);
+    TEST_ASSERT_EQUAL_UINT32(1, table.stats().gaps);
+
+    // The sequence wraps at 256 like any other step
+    for (uint16_t sequence = 5; sequence <= 256; sequence++) {
+        TEST_ASSERT_EQUAL(NODE_IN_ORDER, hear(7, (uint8_t)sequence, 30 + sequence));
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, table.find(7)->lost);
+}
+
+static void test_duplicates_are_dropped(void) {
+    hear(7, 10, 0);
+    hear(7, 11, 10);
+    TEST_ASSERT_EQUAL(NODE_DUPLICATE, hear(7, 11, 20));
+    TEST_ASSERT_EQUAL(NODE_DUPLICATE, hear(7, 10, 30));
+    TEST_ASSERT_EQUAL_UINT32(2, table.stats().duplicates);
+    TEST_ASSERT_EQUAL_UINT16(2, table.find(7)->duplicates);
+    TEST_ASSERT_EQUAL_UINT32(2, table.find(7)->received);
+}
+
+static void test_late_frame_fills_the_gap(void) {
+    hear(7, 0, 0);
+    hear(7, 3, 10);
+    TEST_ASSERT_EQUAL_UINT32(2, table.find(7)->lost);
+
+    // Swapped on the way: counted once, no longer lost, then a copy of it is a duplicate
+    TEST_ASSERT_EQUAL(NODE_LATE, hear(7, 1, 20));
+    TEST_ASSERT_EQUAL_UINT32(1, table.find(7)->lost);
+    TEST_ASSERT_EQUAL(NODE_DUPLICATE, hear(7, 1, 30));
+    TEST_ASSERT_EQUAL(NODE_LATE, hear(7, 2, 40));
+    TEST_ASSERT_EQUAL_UINT32(0, table.find(7)->lost);
+    TEST_ASSERT_EQUAL_UINT32(4, table.find(7)->received);
+}
+
+static void test_going_back_is_a_restart(void) {
+    hear(7, 0, 0);
+    hear(7, 100, 10);
+
+    // Further back than the window: the node rebooted
+    TEST_ASSERT_EQUAL(NODE_RESTART, hear(7, 100 - NODE_RECENT_WINDOW - 1, 20));
+    TEST_ASSERT_EQUAL(NODE_IN_ORDER, hear(7, 100 - NODE_RECENT_WINDOW, 30));
+
+    // Within the window but after a long silence: rebooted too
+    TEST_ASSERT_EQUAL(NODE_RESTART, hear(7, 100 - NODE_RECENT_WINDOW - 2, 30 + NODE_DUPLICATE_MS));
+    TEST_ASSERT_EQUAL_UINT16(2, table.find(7)->restarts);
+}
+
+
+////////////////////////////////////////////////////////
+///// Many nodes
+////////////////////////////////////////////////////////
+
+static void test_nodes_are_kept_apart(void) {
+    // Consecutive ids, as buoys are numbered, each with its own sequence
+    for (uint8_t round = 0; round < 4; round++) {
+        for (uint16_t node = 0x0100; node < 0x0100 + 300; node++) {
+            TEST_ASSERT_EQUAL(round == 0 ? NODE_FIRST : NODE_IN_ORDER, hear(node, round, round * 1000));
+        }
+    }
+    NodeTableStats stats = table.stats();
+    TEST_ASSERT_EQUAL_UINT16(300, stats.nodes);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.gaps);
+
+    size_t used = 0;
+    for (size_t i = 0; i < table.capacity(); i++) {
+        const NodeEntry* entry = table.slot(i);
+        if (entry != nullptr) {
+            TEST_ASSERT_EQUAL_UINT32(4, entry->received);
+            used++;
+        }
+    }
+    TEST_ASSERT_EQUAL(300, used);
+}
+
+static void test_full_table_delivers_untracked(void) {
+    for (uint32_t node = 0; node < NODE_TABLE_SLOTS; node++) {
+        hear(node, 0, 0);
+    }
+    TEST_ASSERT_EQUAL_UINT16(NODE_TABLE_SLOTS, table.stats().nodes);
+
+    // No slot left: the frame still goes through, without checks
+    NodeFrame result;
+    TEST_ASSERT_EQUAL(NODE_UNTRACKED, hear(NODE_TABLE_SLOTS, 0, 0, &result));
+    TEST_ASSERT_NULL(result.entry);
+    TEST_ASSERT_EQUAL(NODE_UNTRACKED, hear(NODE_TABLE_SLOTS, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(2, table.stats().untracked);
+    TEST_ASSERT_NULL(table.find(NODE_TABLE_SLOTS));
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_header_round_trip);
+    RUN_TEST(test_payload_follows_header);
+    RUN_TEST(test_in_order_then_gap);
+    RUN_TEST(test_duplicates_are_dropped);
+    RUN_TEST(test_late_frame_fills_the_gap);
+    RUN_TEST(test_going_back_is_a_restart);
+    RUN_TEST(test_nodes_are_kept_apart);
+    RUN_TEST(test_full_table_delivers_untracked);
+    return UNITY_END();
+}
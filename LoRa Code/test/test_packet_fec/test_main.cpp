@@ -0,0 +1,193 @@
+#include <unity.h>
+#include <string.h>
+#include "PacketFec.h"
+
+static uint8_t frames[FEC_MAX_K + FEC_MAX_M][LORA_PAYLOAD_MAX];
+static size_t lengths[FEC_MAX_K + FEC_MAX_M];
+static uint8_t payloads[FEC_MAX_K][FEC_PAYLOAD];
+static size_t sizes[FEC_MAX_K];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// One group of k payloads of different lengths, returns the frame count
+static uint8_t encodeGroup(FecEncoder& encoder, uint8_t k, uint8_t seed) {
+    for (uint8_t i = 0; i < k; i++) {
+        sizes[i] = FEC_PAYLOAD - (i * 7) % FEC_PAYLOAD;
+        for (size_t b = 0; b < sizes[i]; b++) {
+            payloads[i][b] = (uint8_t)(seed * 31 + i * 17 + b);
+        }
+        TEST_ASSERT_TRUE(encoder.add(payloads[i], sizes[i]));
+    }
+    uint8_t count = 0;
+    while ((lengths[count] = encoder.next(frames[count], LORA_PAYLOAD_MAX)) > 0) {
+        count++;
+    }
+    return count;
+}
+
+// Feed every frame whose bit is clear in lostMask, returns a mask of the payloads read back intact
+static uint32_t decodeGroup(FecDecoder& decoder, uint8_t count, uint32_t lostMask, uint8_t k) {
+    uint32_t intact = 0;
+    uint8_t decoded[FEC_PAYLOAD];
+    for (uint8_t f = 0; f < count; f++) {
+        if (lostMask & (1UL << f)) {
+            continue;
+        }
+        TEST_ASSERT_TRUE(decoder.accept(frames[f], lengths[f]));
+        size_t size;
+        while ((size = decoder.read(decoded, sizeof(decoded))) > 0) {
+            for (uint8_t i = 0; i < k; i++) {
+                if (size == sizes[i] && memcmp(decoded, payloads[i], size) == 0) {
+                    intact |= 1UL << i;
+                }
+            }
+        }
+    }
+    return intact;
+}
+
+static uint8_t bits(uint32_t mask) {
+    uint8_t count = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+}
+
+
+////////////////////////////////////////////////////////
+///// FecEncoder
+////////////////////////////////////////////////////////
+
+static void test_data_goes_out_untouched_then_parity(void) {
+    FecEncoder encoder(4, 2);
+    TEST_ASSERT_EQUAL(6, encodeGroup(encoder, 4, 1));
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(isFec(frames[i], lengths[i]));
+        TEST_ASSERT_EQUAL_UINT8(i, frames[i][2]);
+        TEST_ASSERT_EQUAL_UINT8(sizes[i], frames[i][FEC_HEADER_SIZE]);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(payloads[i], frames[i] + FEC_HEADER_SIZE + 1, sizes[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT8(FEC_PARITY_FLAG | 1, frames[5][2]);
+    TEST_ASSERT_EQUAL_UINT8(0x42, frames[5][3]);
+    TEST_ASSERT_FALSE(encoder.pending());
+}
+
+static void test_encoder_refuses_what_it_cannot_take(void) {
+    FecEncoder encoder(2, 1);
+    uint8_t payload[FEC_PAYLOAD + 1] = {};
+    uint8_t frame[LORA_PAYLOAD_MAX];
+    TEST_ASSERT_FALSE(encoder.add(payload, sizeof(payload)));
+
+    // Group closed, its frames not all out yet
+    TEST_ASSERT_TRUE(encoder.add(payload, 10));
+    TEST_ASSERT_TRUE(encoder.add(payload, 10));
+    TEST_ASSERT_FALSE(encoder.add(payload, 10));
+    while (encoder.next(frame, sizeof(frame)) > 0) {
+    }
+    TEST_ASSERT_TRUE(encoder.add(payload, 10));
+    TEST_ASSERT_GREATER_THAN(0, encoder.next(frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT8(1, frame[1]);
+}
+
+
+////////////////////////////////////////////////////////
+///// FecDecoder
+////////////////////////////////////////////////////////
+
+static void test_any_m_losses_are_rebuilt(void) {
+    // Every pattern of up to m lost frames out of k + m
+    const uint8_t k = 4;
+    const uint8_t m = 2;
+    for (uint32_t lostMask = 0; lostMask < (1UL << (k + m)); lostMask++) {
+        if (bits(lostMask) > m) {
+            continue;
+        }
+        FecEncoder encoder(k, m);
+        FecDecoder decoder;
+        uint8_t count = encodeGroup(encoder, k, (uint8_t)lostMask);
+        TEST_ASSERT_EQUAL_UINT32((1UL << k) - 1, decodeGroup(decoder, count, lostMask, k));
+        TEST_ASSERT_EQUAL_UINT32(bits(lostMask & ((1UL << k) - 1)), decoder.stats().recovered);
+    }
+}
+
+static void test_fade_over_the_first_data_frames(void) {
+    // Widest group: the first m data frames in a row never arrive
+    FecEncoder encoder(FEC_MAX_K, FEC_MAX_M);
+    FecDecoder decoder;
+    uint8_t count = encodeGroup(encoder, FEC_MAX_K, 3);
+    TEST_ASSERT_EQUAL(FEC_MAX_K + FEC_MAX_M, count);
+    TEST_ASSERT_EQUAL_UINT32((1UL << FEC_MAX_K) - 1, decodeGroup(decoder, count, (1UL << FEC_MAX_M) - 1, FEC_MAX_K));
+    TEST_ASSERT_EQUAL_UINT32(FEC_MAX_M, decoder.stats().recovered);
+}
+
+static void test_too_many_losses_are_counted(void) {
+    FecEncoder encoder(4, 1);
+    FecDecoder decoder;
+    uint8_t count = encodeGroup(encoder, 4, 5);
+
+    // Two data frames lost, one parity frame: only what arrived comes out
+    TEST_ASSERT_EQUAL_UINT32(0x0A, decodeGroup(decoder, count, 0x05, 4));
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.stats().recovered);
+
+    // Counted once the group is pushed out by newer ones
+    for (uint8_t g = 1; g <= FEC_GROUPS; g++) {
+        count = encodeGroup(encoder, 4, 5 + g);
+        decodeGroup(decoder, count, 0, 4);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, decoder.stats().lost);
+}
+
+static void test_flushed_group_is_rebuilt(void) {
+    // Two payloads of a group of four, closed early by the timeout
+    FecEncoder encoder(4, 2);
+    FecDecoder decoder;
+    for (uint8_t i = 0; i < 2; i++) {
+        sizes[i] = 20 + i;
+        memset(payloads[i], 0x30 + i, sizes[i]);
+        encoder.add(payloads[i], sizes[i]);
+    }
+    encoder.flush();
+    uint8_t count = 0;
+    while ((lengths[count] = encoder.next(frames[count], LORA_PAYLOAD_MAX)) > 0) {
+        count++;
+    }
+    TEST_ASSERT_EQUAL(4, count);
+    TEST_ASSERT_EQUAL_UINT32(0x03, decodeGroup(decoder, count, 0x01, 2));
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.stats().recovered);
+}
+
+static void test_duplicates_and_foreign_frames(void) {
+    FecEncoder encoder(4, 2);
+    FecDecoder decoder;
+    encodeGroup(encoder, 4, 9);
+    uint8_t decoded[FEC_PAYLOAD];
+
+    TEST_ASSERT_TRUE(decoder.accept(frames[0], lengths[0]));
+    TEST_ASSERT_TRUE(decoder.accept(frames[0], lengths[0]));
+    TEST_ASSERT_EQUAL(sizes[0], decoder.read(decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL(0, decoder.read(decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.stats().received);
+
+    uint8_t plain[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+    TEST_ASSERT_FALSE(decoder.accept(plain, sizeof(plain)));
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_data_goes_out_untouched_then_parity);
+    RUN_TEST(test_encoder_refuses_what_it_cannot_take);
+    RUN_TEST(test_any_m_losses_are_rebuilt);
+    RUN_TEST(test_fade_over_the_first_data_frames);
+    RUN_TEST(test_too_many_losses_are_counted);
+    RUN_TEST(test_flushed_group_is_rebuilt);
+    RUN_TEST(test_duplicates_and_foreign_frames);
+    return UNITY_END();
+}
@@ -0,0 +1,160 @@
+#include <unity.h>
+#include "RateAdapter.h"
+
+#define BASE_RATE 2
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+static RateCtrlFrame switchRequest(uint8_t rate, uint8_t token) {
+    RateCtrlFrame frame = { RATE_SWITCH_REQ, rate, token, 0 };
+    return frame;
+}
+
+
+////////////////////////////////////////////////////////
+///// Control frames
+////////////////////////////////////////////////////////
+
+static void test_control_frame_round_trip(void) {
+    RateCtrlFrame frame = { RATE_REPORT, 4, 0x9C, 0xA5C3F00Fu };
+    uint8_t out[RATE_CTRL_SIZE];
+    TEST_ASSERT_EQUAL(RATE_CTRL_SIZE, encodeRateCtrl(frame, out, sizeof(out)));
+    TEST_ASSERT_EQUAL(0, encodeRateCtrl(frame, out, RATE_CTRL_SIZE - 1));
+
+    RateCtrlFrame decoded;
+    TEST_ASSERT_TRUE(decodeRateCtrl(out, sizeof(out), &decoded));
+    TEST_ASSERT_EQUAL(RATE_REPORT, decoded.type);
+    TEST_ASSERT_EQUAL_UINT8(4, decoded.rate);
+    TEST_ASSERT_EQUAL_UINT8(0x9C, decoded.token);
+    TEST_ASSERT_EQUAL_UINT32(0xA5C3F00Fu, decoded.bitmap);
+
+    TEST_ASSERT_FALSE(decodeRateCtrl(out, sizeof(out) - 1, &decoded));
+    out[0] ^= 0xFF;
+    TEST_ASSERT_FALSE(decodeRateCtrl(out, sizeof(out), &decoded));
+}
+
+
+////////////////////////////////////////////////////////
+///// RateAdapter <-> RateFollower
+////////////////////////////////////////////////////////
+
+static void test_reports_drive_the_delivery_estimate(void) {
+    RateAdapter adapter(BASE_RATE);
+    RateFollower follower(BASE_RATE);
+    RateCtrlFrame report;
+    uint32_t now = 1000;
+
+    // Every other frame lost on the way
+    for (uint8_t seq = 0; seq < RATE_REPORT_EVERY; seq++) {
+        adapter.onSent(seq);
+        if (seq % 2 == 1) {
+            follower.onDataFrame(seq, now, 7);
+        }
+    }
+    TEST_ASSERT_TRUE(follower.poll(now, &report));
+    TEST_ASSERT_EQUAL(RATE_REPORT, report.type);
+    TEST_ASSERT_EQUAL_UINT8(RATE_REPORT_EVERY - 1, report.token);
+    TEST_ASSERT_EQUAL_UINT32(0x55, report.bitmap & 0xFF);
+    TEST_ASSERT_FALSE(follower.poll(now, &report));
+
+    adapter.onControlFrame(report, now);
+    TEST_ASSERT_LESS_THAN(1.0f, adapter.deliveryRatio(BASE_RATE));
+}
+
+static void test_follower_switches_on_request(void) {
+    RateFollower follower(BASE_RATE);
+    RateCtrlFrame answer;
+    follower.onDataFrame(0, 100, 7);
+    follower.onControlFrame(switchRequest(BASE_RATE + 1, 42), 200, 7);
+
+    // ACK first, at the old rate, then the move
+    TEST_ASSERT_FALSE(follower.rateChanged());
+    TEST_ASSERT_TRUE(follower.poll(200, &answer));
+    TEST_ASSERT_EQUAL(RATE_SWITCH_ACK, answer.type);
+    TEST_ASSERT_EQUAL_UINT8(42, answer.token);
+    TEST_ASSERT_TRUE(follower.rateChanged());
+    TEST_ASSERT_EQUAL_UINT8(BASE_RATE + 1, follower.rate());
+    TEST_ASSERT_EQUAL_UINT16(7, follower.node());
+
+    // Nothing at the new rate: back to the old one
+    TEST_ASSERT_FALSE(follower.poll(200 + RATE_VERIFY_TIMEOUT_MS, &answer));
+    TEST_ASSERT_TRUE(follower.rateChanged());
+    TEST_ASSERT_EQUAL_UINT8(BASE_RATE, follower.rate());
+}
+
+
+////////////////////////////////////////////////////////
+///// Gateway of many buoys
+////////////////////////////////////////////////////////
+
+static void test_reports_are_for_one_node(void) {
+    RateFollower follower(BASE_RATE);
+    RateCtrlFrame report;
+
+    // Two buoys interleaved, only the first one heard is reported on
+    for (uint8_t seq = 0; seq < RATE_REPORT_EVERY; seq++) {
+        follower.onDataFrame(seq, 100 + seq, 7);
+        follower.onDataFrame(seq + 100, 100 + seq, 8);
+    }
+    TEST_ASSERT_EQUAL_UINT16(7, follower.node());
+    TEST_ASSERT_TRUE(follower.poll(200, &report));
+    TEST_ASSERT_EQUAL_UINT8(RATE_REPORT_EVERY - 1, report.token);
+    TEST_ASSERT_EQUAL_UINT32(0xFF, report.bitmap);
+    TEST_ASSERT_TRUE(follower.shared(200));
+}
+
+static void test_no_switch_while_others_are_heard(void) {
+    RateFollower follower(BASE_RATE);
+    RateCtrlFrame answer;
+    follower.onDataFrame(0, 100, 7);
+    follower.onDataFrame(0, 150, 8);
+
+    // Left unanswered, the rate stays for everyone
+    follower.onControlFrame(switchRequest(BASE_RATE + 1, 1), 200, 7);
+    TEST_ASSERT_FALSE(follower.poll(200, &answer));
+    TEST_ASSERT_FALSE(follower.rateChanged());
+    TEST_ASSERT_EQUAL_UINT8(BASE_RATE, follower.rate());
+
+    // Requests from the buoy not followed are ignored too
+    follower.onControlFrame(switchRequest(BASE_RATE + 1, 2), 200, 8);
+    TEST_ASSERT_FALSE(follower.poll(200, &answer));
+
+    // The other buoy went quiet: the followed one may switch again
+    uint32_t later = 200 + RATE_LINK_TIMEOUT_MS;
+    follower.onDataFrame(1, later, 7);
+    TEST_ASSERT_FALSE(follower.shared(later));
+    follower.onControlFrame(switchRequest(BASE_RATE + 1, 3), later, 7);
+    TEST_ASSERT_TRUE(follower.poll(later, &answer));
+    TEST_ASSERT_EQUAL(RATE_SWITCH_ACK, answer.type);
+    TEST_ASSERT_EQUAL_UINT8(BASE_RATE + 1, follower.rate());
+}
+
+static void test_quiet_node_hands_over(void) {
+    RateFollower follower(BASE_RATE);
+    follower.onDataFrame(0, 100, 7);
+    follower.onDataFrame(0, 200, 8);
+    TEST_ASSERT_EQUAL_UINT16(7, follower.node());
+
+    // Followed buoy quiet for the link timeout at the base rate: the next one heard is followed
+    follower.onDataFrame(1, 100 + RATE_LINK_TIMEOUT_MS, 8);
+    TEST_ASSERT_EQUAL_UINT16(8, follower.node());
+    TEST_ASSERT_FALSE(follower.shared(100 + RATE_LINK_TIMEOUT_MS));
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_control_frame_round_trip);
+    RUN_TEST(test_reports_drive_the_delivery_estimate);
+    RUN_TEST(test_follower_switches_on_request);
+    RUN_TEST(test_reports_are_for_one_node);
+    RUN_TEST(test_no_switch_while_others_are_heard);
+    RUN_TEST(test_quiet_node_hands_over);
+    return UNITY_END();
+}
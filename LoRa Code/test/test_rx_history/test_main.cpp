@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <string.h>
+#include "RxHistory.h"
+
+#define SLOTS 4
+#define SLOT_SIZE 16
+
+typedef RxHistory<SLOTS, SLOT_SIZE> History;
+
+static uint8_t frame[SLOT_SIZE * 2];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Push frame n, 8 bytes of its number
+static bool pushFrame(History& history, uint8_t n, uint32_t now = 0) {
+    memset(frame, n, 8);
+    return history.push(frame, 8, now);
+}
+
+
+////////////////////////////////////////////////////////
+///// Reading back
+////////////////////////////////////////////////////////
+
+static void test_frames_read_back_in_order_across_the_wrap(void) {
+    History history;
+    uint8_t out[SLOT_SIZE];
+    RxFrameInfo info;
+
+    // Positions go round the slots many times, one frame kept behind
+    pushFrame(history, 0, 100);
+    for (uint8_t n = 1; n < 50; n++) {
+        TEST_ASSERT_TRUE(pushFrame(history, n, 100 + n));
+        TEST_ASSERT_EQUAL(8, history.pop(out, sizeof(out), &info));
+        TEST_ASSERT_EACH_EQUAL_UINT8(n - 1, out, 8);
+        TEST_ASSERT_EQUAL_UINT32(n - 1, info.sequence);
+        TEST_ASSERT_EQUAL_UINT32(100 + n - 1, info.timestamp);
+        TEST_ASSERT_EQUAL_UINT8(RX_OK, info.status);
+    }
+    TEST_ASSERT_EQUAL(1, history.count());
+
+    // Iterator and peek walk the unread frames oldest first, newest is the last one
+    pushFrame(history, 50);
+    pushFrame(history, 51);
+    uint8_t expected = 49;
+    for (History::Iterator it = history.begin(); it != history.end(); ++it) {
+        TEST_ASSERT_EQUAL_UINT32(expected, it->info.sequence);
+        expected++;
+    }
+    TEST_ASSERT_EQUAL_UINT8(52, expected);
+    TEST_ASSERT_EQUAL_UINT32(50, history.peek(1)->info.sequence);
+    TEST_ASSERT_NULL(history.peek(3));
+    TEST_ASSERT_EQUAL_UINT8(51, history.newest()->data[0]);
+
+    history.clear();
+    TEST_ASSERT_TRUE(history.empty());
+    TEST_ASSERT_NULL(history.newest());
+    TEST_ASSERT_EQUAL(0, history.pop(out, sizeof(out)));
+}
+
+static void test_long_frames_are_truncated(void) {
+    History history;
+    memset(frame, 0x33, sizeof(frame));
+    TEST_ASSERT_TRUE(history.push(frame, sizeof(frame), 0));
+    TEST_ASSERT_EQUAL_UINT16(SLOT_SIZE, history.peek()->info.length);
+    TEST_ASSERT_EQUAL_UINT8(RX_TRUNCATED, history.peek()->info.status);
+
+    // Cut by the caller already, and a short copy out
+    TEST_ASSERT_TRUE(history.push(frame, 4, 0, true));
+    TEST_ASSERT_EQUAL_UINT8(RX_TRUNCATED, history.peek(1)->info.status);
+    TEST_ASSERT_EQUAL_UINT32(2, history.stats().truncated);
+    uint8_t out[4];
+    TEST_ASSERT_EQUAL(sizeof(out), history.pop(out, sizeof(out)));
+    TEST_ASSERT_EACH_EQUAL_UINT8(0x33, out, sizeof(out));
+}
+
+
+////////////////////////////////////////////////////////
+///// Full history
+////////////////////////////////////////////////////////
+
+static void test_drop_oldest_charges_the_gap_to_the_next_frame(void) {
+    History history(RX_DROP_OLDEST);
+    for (uint8_t n = 0; n < SLOTS; n++) {
+        pushFrame(history, n);
+    }
+    TEST_ASSERT_TRUE(history.full());
+
+    // Frame 0 goes, frame 1 carries its loss
+    TEST_ASSERT_TRUE(pushFrame(history, SLOTS));
+    TEST_ASSERT_EQUAL(SLOTS, history.count());
+    TEST_ASSERT_EQUAL_UINT32(1, history.peek()->info.sequence);
+    TEST_ASSERT_EQUAL_UINT16(1, history.peek()->info.dropped);
+    TEST_ASSERT_EQUAL_UINT8(RX_AFTER_DROP, history.peek()->info.status);
+
+    // Frame 1 goes too: frame 2 now stands for both
+    TEST_ASSERT_TRUE(pushFrame(history, SLOTS + 1));
+    TEST_ASSERT_EQUAL_UINT32(2, history.peek()->info.sequence);
+    TEST_ASSERT_EQUAL_UINT16(2, history.peek()->info.dropped);
+    TEST_ASSERT_EQUAL_UINT8(SLOTS + 1, history.newest()->data[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, history.stats().overwritten);
+    TEST_ASSERT_EQUAL_UINT32(SLOTS + 2, history.stats().received);
+}
+
+static void test_drop_newest_refuses_and_reports_the_gap(void) {
+    History history(RX_DROP_NEWEST);
+    for (uint8_t n = 0; n < SLOTS; n++) {
+        pushFrame(history, n);
+    }
+    TEST_ASSERT_FALSE(pushFrame(history, SLOTS));
+    TEST_ASSERT_FALSE(pushFrame(history, SLOTS + 1));
+    TEST_ASSERT_EQUAL_UINT32(2, history.stats().refused);
+    TEST_ASSERT_EQUAL_UINT8(SLOTS - 1, history.newest()->data[0]);
+
+    // Room again: the next frame kept counts the refused ones, which kept their numbers
+    history.discard();
+    TEST_ASSERT_TRUE(pushFrame(history, SLOTS + 2));
+    const History::Entry* entry = history.newest();
+    TEST_ASSERT_EQUAL_UINT32(SLOTS + 2, entry->info.sequence);
+    TEST_ASSERT_EQUAL_UINT16(2, entry->info.dropped);
+    TEST_ASSERT_EQUAL_UINT8(RX_AFTER_DROP, entry->info.status);
+    TEST_ASSERT_EQUAL_UINT32(SLOTS + 3, history.stats().received);
+}
+
+static void test_upstream_losses_wait_for_the_next_frame(void) {
+    History history;
+    pushFrame(history, 0);
+
+    // Lost in the UART ring before the history saw them, in two reports
+    history.noteDropped(2);
+    history.noteDropped(1);
+    TEST_ASSERT_EQUAL(1, history.count());
+    pushFrame(history, 1);
+    const History::Entry* entry = history.newest();
+    TEST_ASSERT_EQUAL_UINT32(4, entry->info.sequence);
+    TEST_ASSERT_EQUAL_UINT16(3, entry->info.dropped);
+    TEST_ASSERT_EQUAL_UINT8(RX_AFTER_DROP, entry->info.status);
+    TEST_ASSERT_EQUAL_UINT32(3, history.stats().upstream);
+
+    // Charged once
+    pushFrame(history, 2);
+    TEST_ASSERT_EQUAL_UINT16(0, history.newest()->info.dropped);
+    TEST_ASSERT_EQUAL_UINT8(RX_OK, history.newest()->info.status);
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_read_back_in_order_across_the_wrap);
+    RUN_TEST(test_long_frames_are_truncated);
+    RUN_TEST(test_drop_oldest_charges_the_gap_to_the_next_frame);
+    RUN_TEST(test_drop_newest_refuses_and_reports_the_gap);
+    RUN_TEST(test_upstream_losses_wait_for_the_next_frame);
+    return UNITY_END();
+}
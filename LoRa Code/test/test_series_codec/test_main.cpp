@@ -0,0 +1,220 @@
+#include <unity.h>
+#include <string.h>
+#include "SeriesCodec.h"
+
+#define SAMPLES 20000
+
+// Synthetic buoy series: slow temperature walk, battery draining, 1 s sampling with a few ms of jitter
+struct Series {
+    uint32_t seed = 1;
+    float temperature = 12.0f;
+    float battery = 4.1f;
+    uint32_t timestamp = 0;
+    uint32_t n = 0;
+
+    void next(float* values) {
+        seed = seed * 1103515245 + 12345;
+        temperature += ((int)((seed >> 16) % 5) - 2) * 0.01f;
+        if (n++ % 600 == 0) {
+            battery -= 0.001f;
+        }
+        timestamp += 1000 + (seed >> 28) % 4;
+        values[0] = temperature;
+        values[1] = battery;
+        values[2] = timestamp / 1000.0f;
+    }
+};
+
+// What the decoder has to give back for these values: the schema's quantized ones
+static void quantized(const TelemetrySchema& schema, const float* values, float* out) {
+    for (uint8_t f = 0; f < schema.fieldCount; f++) {
+        out[f] = fieldFromRaw(schema.fields[f], fieldToRaw(schema.fields[f], values[f]));
+    }
+}
+
+static float expected[SERIES_MAX_SAMPLES][TELEMETRY_MAX_FIELDS];
+static uint32_t expectedTimestamps[SERIES_MAX_SAMPLES];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Decode a block and compare it with the samples recorded in expected[]
+static void checkBlock(const TelemetrySchema& schema, const uint8_t* block, size_t size, uint8_t count) {
+    SeriesDecoder decoder(schema);
+    TEST_ASSERT_TRUE(decoder.begin(block, size));
+    TEST_ASSERT_EQUAL_UINT8(count, decoder.count());
+    float decoded[TELEMETRY_MAX_FIELDS];
+    uint32_t timestamp;
+    for (uint8_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(decoder.next(decoded, &timestamp));
+        TEST_ASSERT_EQUAL_UINT32(expectedTimestamps[i], timestamp);
+        TEST_ASSERT_EQUAL_MEMORY(expected[i], decoded, sizeof(float) * schema.fieldCount);
+    }
+    TEST_ASSERT_FALSE(decoder.next(decoded, &timestamp));
+}
+
+
+////////////////////////////////////////////////////////
+///// Round trip
+////////////////////////////////////////////////////////
+
+static void test_long_series_decodes_exactly(void) {
+    // Blocks sized like a batch record
+    SeriesEncoder encoder(BuoySchema, 51);
+    Series series;
+    uint8_t block[SERIES_MAX_BLOCK];
+    uint32_t blockBytes = 0;
+    float values[TELEMETRY_MAX_FIELDS];
+
+    for (uint32_t n = 0; n < SAMPLES; n++) {
+        series.next(values);
+        if (!encoder.add(values, series.timestamp)) {
+            uint8_t count = encoder.samples();
+            size_t size = encoder.take(block, sizeof(block));
+            TEST_ASSERT_LESS_OR_EQUAL(51, size);
+            checkBlock(BuoySchema, block, size, count);
+            blockBytes += size;
+            TEST_ASSERT_TRUE(encoder.add(values, series.timestamp));
+        }
+        uint8_t i = encoder.samples() - 1;
+        expectedTimestamps[i] = series.timestamp;
+        quantized(BuoySchema, values, expected[i]);
+    }
+    uint8_t count = encoder.samples();
+    size_t size = encoder.take(block, sizeof(block));
+    checkBlock(BuoySchema, block, size, count);
+    blockBytes += size;
+
+    // Slow readings cost a few bits each, under half the 9 B of a batch record
+    TEST_ASSERT_LESS_THAN(4 * SAMPLES, blockBytes);
+    TEST_ASSERT_TRUE(encoder.empty());
+}
+
+static void test_every_field_type_round_trips(void) {
+    static const FieldDef fields[] = {
+        { "fixed16", FIELD_FIXED16, 100.0f },
+        { "fixed32", FIELD_FIXED32, 1000.0f },
+        { "varint",  FIELD_VARINT,  10.0f },
+        { "uvarint", FIELD_UVARINT, 1.0f },
+        { "uint8",   FIELD_UINT8,   1.0f },
+        { "float32", FIELD_FLOAT32, 1.0f },
+    };
+    static const TelemetrySchema schema = { 0x42, fields, sizeof(fields) / sizeof(fields[0]) };
+    SeriesEncoder encoder(schema);
+    uint8_t block[SERIES_MAX_BLOCK];
+
+    // Jumps and sign changes so the wide encodings get used, then no change, then a small one
+    const float rows[][6] = {
+        { 12.34f, -1000.5f, 3.2f, 7.0f, 200.0f, 1.5f },
+        { -12.34f, 2000000.25f, -3.2f, 4000000.0f, 0.0f, -1.0e-3f },
+        { -12.34f, 2000000.25f, -3.2f, 4000000.0f, 0.0f, -1.0e-3f },
+        { -12.33f, 2000000.5f, -3.1f, 4000001.0f, 1.0f, -1.5e-3f },
+    };
+    const uint32_t times[] = { 5, 1005, 2005, 3006 };
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(encoder.add(rows[i], times[i]));
+        expectedTimestamps[i] = times[i];
+        quantized(schema, rows[i], expected[i]);
+    }
+    size_t size = encoder.take(block, sizeof(block));
+    checkBlock(schema, block, size, 4);
+}
+
+
+////////////////////////////////////////////////////////
+///// Blocks
+////////////////////////////////////////////////////////
+
+static void test_full_block_refuses_and_keeps_size(void) {
+    SeriesEncoder encoder(BuoySchema, 16);
+    Series series;
+    float values[TELEMETRY_MAX_FIELDS];
+    series.next(values);
+    TEST_ASSERT_TRUE(encoder.add(values, series.timestamp));
+    while (encoder.add(values, series.timestamp)) {
+        series.next(values);
+    }
+    size_t size = encoder.size();
+    TEST_ASSERT_LESS_OR_EQUAL(16, size);
+
+    // Nothing written by the refused add, nor by the next one
+    TEST_ASSERT_FALSE(encoder.add(values, series.timestamp));
+    TEST_ASSERT_EQUAL(size, encoder.size());
+
+    uint8_t small[4];
+    TEST_ASSERT_EQUAL(0, encoder.take(small, sizeof(small)));
+}
+
+static void test_decoder_rejects_bad_blocks(void) {
+    SeriesEncoder encoder(BuoySchema);
+    SeriesDecoder decoder(BuoySchema);
+    uint8_t block[SERIES_MAX_BLOCK];
+    float values[] = { 12.0f, 4.0f, 1.0f };
+    encoder.add(values, 1000);
+    encoder.add(values, 2000);
+    size_t size = encoder.take(block, sizeof(block));
+
+    TEST_ASSERT_FALSE(decoder.begin(block, 1));
+    block[0] ^= 0xFF;
+    TEST_ASSERT_FALSE(decoder.begin(block, size));
+    block[0] ^= 0xFF;
+
+    // Cut short: the keyframe is there (32 bit timestamp, 16 + 32 + 32 bit fields), the second sample is not
+    TEST_ASSERT_TRUE(decoder.begin(block, SERIES_HEADER_SIZE + 14));
+    float decoded[TELEMETRY_MAX_FIELDS];
+    uint32_t timestamp;
+    TEST_ASSERT_TRUE(decoder.next(decoded, &timestamp));
+    TEST_ASSERT_EQUAL_UINT32(1000, timestamp);
+    TEST_ASSERT_FALSE(decoder.next(decoded, &timestamp));
+}
+
+static void test_state_survives_deep_sleep(void) {
+    // Half a block before the sleep, the rest after it: one block that decodes whole
+    Series series;
+    SeriesEncoder before(BuoySchema);
+    float values[TELEMETRY_MAX_FIELDS];
+    for (uint8_t i = 0; i < 8; i++) {
+        series.next(values);
+        TEST_ASSERT_TRUE(before.add(values, series.timestamp));
+        expectedTimestamps[i] = series.timestamp;
+        quantized(BuoySchema, values, expected[i]);
+    }
+    SeriesState state;
+    before.save(&state);
+
+    SeriesEncoder after(BuoySchema);
+    TEST_ASSERT_TRUE(after.restore(state));
+    TEST_ASSERT_EQUAL_UINT8(8, after.samples());
+    for (uint8_t i = 8; i < 16; i++) {
+        series.next(values);
+        TEST_ASSERT_TRUE(after.add(values, series.timestamp));
+        expectedTimestamps[i] = series.timestamp;
+        quantized(BuoySchema, values, expected[i]);
+    }
+    uint8_t block[SERIES_MAX_BLOCK];
+    size_t size = after.take(block, sizeof(block));
+    checkBlock(BuoySchema, block, size, 16);
+
+    // Saved for another schema: refused, left empty
+    static const FieldDef fields[] = { { "other", FIELD_UINT8, 1.0f } };
+    static const TelemetrySchema other = { 0x02, fields, 1 };
+    SeriesEncoder wrong(other);
+    TEST_ASSERT_FALSE(wrong.restore(state));
+    TEST_ASSERT_TRUE(wrong.empty());
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_long_series_decodes_exactly);
+    RUN_TEST(test_every_field_type_round_trips);
+    RUN_TEST(test_full_block_refuses_and_keeps_size);
+    RUN_TEST(test_decoder_rejects_bad_blocks);
+    RUN_TEST(test_state_survives_deep_sleep);
+    return UNITY_END();
+}
@@ -0,0 +1,231 @@
+#include <unity.h>
+#include <string.h>
+#include "Tdma.h"
+
+#define SLOTS 9
+#define SLOT_MS 1000
+#define AIRTIME_MS 300
+
+static uint8_t beacon[LORA_PAYLOAD_MAX];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Node id of the entry at this index in a beacon
+static uint16_t entryNode(size_t index) {
+    size_t at = TDMA_BEACON_HEADER + index * TDMA_ENTRY_SIZE;
+    return (beacon[at] << 8) | beacon[at + 1];
+}
+
+
+////////////////////////////////////////////////////////
+///// TdmaCoordinator
+////////////////////////////////////////////////////////
+
+static void test_slots_are_given_once(void) {
+    TdmaCoordinator coordinator(SLOTS, SLOT_MS);
+    for (uint16_t node = 0; node < SLOTS - 1; node++) {
+        TEST_ASSERT_EQUAL(node + 1, coordinator.assign(0x0100 + node));
+    }
+    TEST_ASSERT_EQUAL(3, coordinator.assign(0x0102));
+    TEST_ASSERT_EQUAL_UINT8(SLOTS - 1, coordinator.assigned());
+
+    // Full: the shared slot, until one is released
+    TEST_ASSERT_EQUAL(TDMA_SHARED_SLOT, coordinator.assign(0x0200));
+    coordinator.release(0x0104);
+    TEST_ASSERT_EQUAL(5, coordinator.assign(0x0200));
+
+    // Fewer slots: the assignments past the new count go
+    coordinator.configure(4, SLOT_MS);
+    TEST_ASSERT_EQUAL_UINT8(3, coordinator.assigned());
+    TEST_ASSERT_EQUAL(TDMA_SHARED_SLOT, coordinator.assign(0x0300));
+}
+
+static void test_beacon_lists_new_assignments_first(void) {
+    TdmaCoordinator coordinator(TDMA_MAX_SLOTS, SLOT_MS);
+    TEST_ASSERT_TRUE(coordinator.beaconDue(0));
+    for (uint16_t node = 0; node < 40; node++) {
+        coordinator.assign(node);
+    }
+    size_t length = coordinator.beacon(beacon, sizeof(beacon), 0);
+    TEST_ASSERT_TRUE(isBeacon(beacon, length));
+    TEST_ASSERT_EQUAL_UINT8(TDMA_MAX_SLOTS, beacon[2]);
+    TEST_ASSERT_EQUAL_UINT16(SLOT_MS, beacon[3] | (beacon[4] << 8));
+    TEST_ASSERT_EQUAL_UINT8(41, beacon[5]);
+    TEST_ASSERT_EQUAL(TDMA_BEACON_HEADER + TDMA_MAX_ENTRIES * TDMA_ENTRY_SIZE, length);
+
+    // Those left out go in the next beacons, then every node comes round
+    bool seen[41] = {};
+    uint32_t now = 0;
+    for (uint8_t b = 0; b < 4; b++) {
+        for (size_t i = 0; i < (length - TDMA_BEACON_HEADER) / TDMA_ENTRY_SIZE; i++) {
+            seen[entryNode(i)] = true;
+        }
+        now += coordinator.superframeMs();
+        length = coordinator.beacon(beacon, sizeof(beacon), now);
+    }
+    for (uint8_t i = 0; i < 40; i++) {
+        TEST_ASSERT_TRUE(seen[i]);
+    }
+
+    // A late node is in the very next beacon, whatever the round robin is at
+    coordinator.assign(0x0ABC);
+    coordinator.beacon(beacon, sizeof(beacon), now + coordinator.superframeMs());
+    TEST_ASSERT_EQUAL_UINT16(0x0ABC, entryNode(0));
+}
+
+static void test_beacon_keeps_its_period(void) {
+    TdmaCoordinator coordinator(SLOTS, SLOT_MS);
+    uint32_t superframe = coordinator.superframeMs();
+    TEST_ASSERT_EQUAL_UINT32((SLOTS + 1) * SLOT_MS, superframe);
+    coordinator.beacon(beacon, sizeof(beacon), 0);
+    TEST_ASSERT_FALSE(coordinator.beaconDue(superframe - 1));
+    TEST_ASSERT_TRUE(coordinator.beaconDue(superframe));
+
+    // Sent late, the next one is still due on the grid
+    coordinator.beacon(beacon, sizeof(beacon), superframe + 40);
+    TEST_ASSERT_TRUE(coordinator.beaconDue(2 * superframe));
+
+    // After a long pause the grid starts over
+    coordinator.beacon(beacon, sizeof(beacon), 10 * superframe + 7);
+    TEST_ASSERT_FALSE(coordinator.beaconDue(11 * superframe));
+    TEST_ASSERT_TRUE(coordinator.beaconDue(11 * superframe + 7));
+}
+
+static void test_slot_length_fits_frames_and_guards(void) {
+    uint16_t slotMs = TdmaCoordinator::slotMsFor(AIRTIME_MS, 2, SLOTS);
+    uint32_t guard = tdmaGuardMs((uint32_t)(SLOTS + 1) * slotMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(TDMA_SYNC_JITTER_MS, guard);
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * AIRTIME_MS + 2 * guard, slotMs);
+}
+
+
+////////////////////////////////////////////////////////
+///// TdmaSchedule
+////////////////////////////////////////////////////////
+
+static void test_node_sends_inside_its_slot(void) {
+    TdmaCoordinator coordinator(SLOTS, SLOT_MS);
+    TdmaSchedule schedule(0x0105);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, schedule.delayMs(0, AIRTIME_MS));
+
+    coordinator.assign(0x0101);
+    coordinator.assign(0x0105);
+    size_t length = coordinator.beacon(beacon, sizeof(beacon), 0);
+    TEST_ASSERT_TRUE(schedule.onBeacon(beacon, length, 100));
+    TEST_ASSERT_EQUAL_UINT8(2, schedule.slot());
+    TEST_ASSERT_FALSE(schedule.onBeacon(beacon, 3, 100));
+
+    // Slot 2 opens two slots after the beacon, past its guard
+    uint32_t guard = tdmaGuardMs(schedule.superframeMs());
+    TEST_ASSERT_EQUAL_UINT32(2 * SLOT_MS + guard, schedule.delayMs(100, AIRTIME_MS));
+    TEST_ASSERT_EQUAL_UINT32(0, schedule.delayMs(100 + 2 * SLOT_MS + guard, AIRTIME_MS));
+
+    // Too late to end before the guard: the same slot a superframe on
+    uint32_t late = 100 + 3 * SLOT_MS - guard - AIRTIME_MS + 1;
+    TEST_ASSERT_EQUAL_UINT32(schedule.superframeMs() + 2 * SLOT_MS + guard - (late - 100),
+                             schedule.delayMs(late, AIRTIME_MS));
+
+    // Longer than the slot, never
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, schedule.delayMs(100, SLOT_MS));
+}
+
+static void test_slots_never_overlap(void) {
+    // Each node starts as soon as allowed at every ms: no two frames are on air together
+    TdmaCoordinator coordinator(SLOTS, SLOT_MS);
+    TdmaSchedule schedules[SLOTS - 1];
+    for (uint8_t i = 0; i < SLOTS - 1; i++) {
+        schedules[i].setNode(0x0100 + i);
+        coordinator.assign(0x0100 + i);
+    }
+    size_t length = coordinator.beacon(beacon, sizeof(beacon), 0);
+    uint32_t ends[SLOTS - 1] = {};
+    for (uint8_t i = 0; i < SLOTS - 1; i++) {
+        schedules[i].onBeacon(beacon, length, 0);
+    }
+    for (uint32_t now = 0; now < coordinator.superframeMs(); now++) {
+        for (uint8_t i = 0; i < SLOTS - 1; i++) {
+            if (now < ends[i] || schedules[i].delayMs(now, AIRTIME_MS) != 0) {
+                continue;
+            }
+            for (uint8_t j = 0; j < SLOTS - 1; j++) {
+                TEST_ASSERT_TRUE(j == i || ends[j] <= now);
+            }
+            ends[i] = now + AIRTIME_MS;
+        }
+    }
+    for (uint8_t i = 0; i < SLOTS - 1; i++) {
+        TEST_ASSERT_GREATER_THAN(0, ends[i]);
+    }
+}
+
+static void test_sync_lost_after_missed_beacons(void) {
+    TdmaCoordinator coordinator(SLOTS, SLOT_MS);
+    TdmaSchedule schedule(0x0100);
+    coordinator.assign(0x0100);
+    schedule.onBeacon(beacon, coordinator.beacon(beacon, sizeof(beacon), 0), 0);
+    uint32_t superframe = schedule.superframeMs();
+    TEST_ASSERT_TRUE(schedule.synced((TDMA_LOST_BEACONS + 1) * superframe - 1));
+    TEST_ASSERT_FALSE(schedule.synced((TDMA_LOST_BEACONS + 1) * superframe));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, schedule.delayMs((TDMA_LOST_BEACONS + 1) * superframe, AIRTIME_MS));
+}
+
+static void test_slot_given_to_another_node(void) {
+    TdmaSchedule schedule(0x0100);
+    TdmaCoordinator coordinator(SLOTS, SLOT_MS);
+    coordinator.assign(0x0100);
+    schedule.onBeacon(beacon, coordinator.beacon(beacon, sizeof(beacon), 0), 0);
+    TEST_ASSERT_EQUAL_UINT8(1, schedule.slot());
+
+    // The gateway restarted and handed slot 1 to someone else
+    TdmaCoordinator restarted(SLOTS, SLOT_MS);
+    restarted.assign(0x0200);
+    schedule.onBeacon(beacon, restarted.beacon(beacon, sizeof(beacon), 0), 10000);
+    TEST_ASSERT_EQUAL_UINT8(TDMA_SHARED_SLOT, schedule.slot());
+}
+
+static void test_shared_slot_backs_off(void) {
+    // No slot free: the node tries the shared slot, then waits whole superframes
+    TdmaCoordinator coordinator(2, SLOT_MS);
+    coordinator.assign(0x0100);
+    TdmaSchedule schedule(0x0200);
+    uint32_t superframe = coordinator.superframeMs();
+    uint32_t now = 0;
+    uint32_t longest = 0;
+    for (uint8_t b = 0; b < 20; b++) {
+        schedule.onBeacon(beacon, coordinator.beacon(beacon, sizeof(beacon), now), now);
+        TEST_ASSERT_EQUAL_UINT8(TDMA_SHARED_SLOT, schedule.slot());
+        uint32_t wait = schedule.delayMs(now, AIRTIME_MS);
+        TEST_ASSERT_NOT_EQUAL(UINT32_MAX, wait);
+        schedule.onSent(now + wait);
+        uint32_t next = schedule.delayMs(now + wait, AIRTIME_MS);
+        if (next > longest) {
+            longest = next;
+        }
+        now += superframe;
+    }
+
+    // The window doubled past a single superframe, never past its maximum
+    TEST_ASSERT_GREATER_THAN(superframe, longest);
+    TEST_ASSERT_LESS_THAN(TDMA_SHARED_BACKOFF_MAX * superframe, longest);
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_slots_are_given_once);
+    RUN_TEST(test_beacon_lists_new_assignments_first);
+    RUN_TEST(test_beacon_keeps_its_period);
+    RUN_TEST(test_slot_length_fits_frames_and_guards);
+    RUN_TEST(test_node_sends_inside_its_slot);
+    RUN_TEST(test_slots_never_overlap);
+    RUN_TEST(test_sync_lost_after_missed_beacons);
+    RUN_TEST(test_slot_given_to_another_node);
+    RUN_TEST(test_shared_slot_backs_off);
+    return UNITY_END();
+}
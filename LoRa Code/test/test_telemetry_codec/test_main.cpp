@@ -0,0 +1,239 @@
+#include <unity.h>
+#include <string.h>
+#include "TelemetryCodec.h"
+
+// One field of every encoding
+static const FieldDef allFields[] = {
+    { "fixed16", FIELD_FIXED16, 100.0f },
+    { "fixed32", FIELD_FIXED32, 1000.0f },
+    { "varint",  FIELD_VARINT,  10.0f },
+    { "uvarint", FIELD_UVARINT, 1000.0f },
+    { "uint8",   FIELD_UINT8,   2.0f },
+    { "float32", FIELD_FLOAT32, 1.0f },
+};
+static const TelemetrySchema allSchema = { 0x42, allFields, sizeof(allFields) / sizeof(allFields[0]) };
+#define ALL_FIELDS (sizeof(allFields) / sizeof(allFields[0]))
+
+static const float sample[ALL_FIELDS] = { -12.34f, 123456.789f, -4321.5f, 3.712f, 99.5f, 1.0e-3f };
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+static size_t encodeSample(uint8_t* frame, size_t capacity, uint8_t sequence = 7) {
+    TelemetryCodec codec(allSchema);
+    return codec.encode(sample, sequence, frame, capacity);
+}
+
+
+////////////////////////////////////////////////////////
+///// Round trip
+////////////////////////////////////////////////////////
+
+static void test_round_trip_every_encoding(void) {
+    TelemetryCodec codec(allSchema);
+    uint8_t frame[64];
+    size_t length = encodeSample(frame, sizeof(frame), 201);
+    TEST_ASSERT_GREATER_THAN(TELEMETRY_HEADER_SIZE, length);
+    TEST_ASSERT_LESS_OR_EQUAL(codec.maxFrameSize(), length);
+
+    float values[ALL_FIELDS];
+    uint8_t sequence = 0;
+    TEST_ASSERT_TRUE(codec.decode(frame, length, values, &sequence));
+    TEST_ASSERT_EQUAL_UINT8(201, sequence);
+
+    // Half a step of each field's resolution
+    for (size_t i = 0; i < ALL_FIELDS; i++) {
+        float step = allFields[i].encoding == FIELD_FLOAT32 ? 0.0f : 0.5f / allFields[i].scale;
+        TEST_ASSERT_FLOAT_WITHIN(step + 1e-6f * (sample[i] < 0 ? -sample[i] : sample[i]), sample[i], values[i]);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(sample[5], values[5]); // Raw IEEE754, bit exact
+}
+
+static void test_round_trip_buoy_schema(void) {
+    TelemetryCodec codec(BuoySchema);
+    const float in[3] = { 18.25f, 3.9f, 86400.0f };
+    uint8_t frame[32];
+    size_t length = codec.encode(in, 1, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(TELEMETRY_HEADER_SIZE + 2 + 2 + 3, length);
+
+    float out[3];
+    TEST_ASSERT_TRUE(codec.decode(frame, length, out));
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 18.25f, out[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0005f, 3.9f, out[1]);
+    TEST_ASSERT_EQUAL_FLOAT(86400.0f, out[2]);
+}
+
+static void test_varint_limits(void) {
+    const uint32_t values[] = { 0, 1, 127, 128, 16383, 16384, 0x0FFFFFFF, 0x10000000, UINT32_MAX };
+    for (uint32_t value : values) {
+        uint8_t buf[5];
+        size_t n = writeVarint(value, buf, sizeof(buf));
+        TEST_ASSERT_GREATER_THAN(0, n);
+        uint32_t back = 0;
+        TEST_ASSERT_EQUAL(n, readVarint(buf, n, &back));
+        TEST_ASSERT_EQUAL_UINT32(value, back);
+    }
+    TEST_ASSERT_EQUAL(-1, zigzagDecode(zigzagEncode(-1)));
+    TEST_ASSERT_EQUAL(INT32_MIN, zigzagDecode(zigzagEncode(INT32_MIN)));
+
+    // Does not fit the buffer
+    uint8_t small[2];
+    TEST_ASSERT_EQUAL(0, writeVarint(16384, small, sizeof(small)));
+}
+
+
+////////////////////////////////////////////////////////
+///// Clamping
+////////////////////////////////////////////////////////
+
+static void test_clamps_at_quantization_limits(void) {
+    const float high[ALL_FIELDS] = { 1000.0f, 1.0e9f, 1.0e12f, 1.0e12f, 1000.0f, 0.0f };
+    const float low[ALL_FIELDS] = { -1000.0f, -1.0e9f, -1.0e12f, -5.0f, -5.0f, 0.0f };
+    TelemetryCodec codec(allSchema);
+    uint8_t frame[64];
+    float values[ALL_FIELDS];
+
+    size_t length = codec.encode(high, 0, frame, sizeof(frame));
+    TEST_ASSERT_TRUE(codec.decode(frame, length, values));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, INT16_MAX / 100.0f, values[0]);
+    TEST_ASSERT_EQUAL_FLOAT(INT32_MAX / 1000.0, values[1]);
+    TEST_ASSERT_EQUAL_FLOAT(INT32_MAX / 10.0, values[2]);
+    TEST_ASSERT_EQUAL_FLOAT(UINT32_MAX / 1000.0, values[3]);
+    TEST_ASSERT_EQUAL_FLOAT(UINT8_MAX / 2.0f, values[4]);
+
+    length = codec.encode(low, 0, frame, sizeof(frame));
+    TEST_ASSERT_TRUE(codec.decode(frame, length, values));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, INT16_MIN / 100.0f, values[0]);
+    TEST_ASSERT_EQUAL_FLOAT(INT32_MIN / 1000.0, values[1]);
+    TEST_ASSERT_EQUAL_FLOAT(INT32_MIN / 10.0, values[2]);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, values[3]);    // Unsigned encodings stop at 0
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, values[4]);
+}
+
+static void test_nan_encodes_as_zero(void) {
+    const FieldDef field = { "t", FIELD_FIXED16, 100.0f };
+    TEST_ASSERT_EQUAL_UINT32(0, fieldToRaw(field, NAN));
+    TEST_ASSERT_EQUAL_FLOAT(-1.5f, fieldFromRaw(field, fieldToRaw(field, -1.5f)));
+}
+
+
+////////////////////////////////////////////////////////
+///// Truncated and corrupted frames
+////////////////////////////////////////////////////////
+
+static void test_truncated_frames_are_rejected(void) {
+    TelemetryCodec codec(allSchema);
+    uint8_t frame[64];
+    size_t length = encodeSample(frame, sizeof(frame));
+    float values[ALL_FIELDS];
+
+    // Every cut, inside the header, a fixed field or a varint
+    for (size_t cut = 0; cut < length; cut++) {
+        TEST_ASSERT_FALSE(codec.decode(frame, cut, values));
+    }
+    TEST_ASSERT_TRUE(codec.decode(frame, length, values));
+
+    // Output buffer too small
+    for (size_t capacity = 0; capacity < length; capacity++) {
+        TEST_ASSERT_EQUAL(0, encodeSample(frame, capacity));
+    }
+}
+
+static void test_truncated_varint_is_rejected(void) {
+    const FieldDef field = { "v", FIELD_UVARINT, 1.0f };
+    const TelemetrySchema schema = { 1, &field, 1 };
+    TelemetryCodec codec(schema);
+    float value = -1.0f;
+
+    // Continuation bit set on the last byte
+    const uint8_t cut[] = { 0x80, 0x80 };
+    TEST_ASSERT_EQUAL(0, codec.decodeFields(cut, sizeof(cut), &value));
+    TEST_ASSERT_EQUAL(0, codec.decodeFields(cut, 0, &value));
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, value);
+}
+
+static void test_overlong_varint_is_rejected(void) {
+    uint32_t value;
+    // 5th byte carries only the top 4 bits of a uint32
+    const uint8_t top[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x0F };
+    TEST_ASSERT_EQUAL(5, readVarint(top, sizeof(top), &value));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, value);
+
+    const uint8_t overflow[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x10 };
+    TEST_ASSERT_EQUAL(0, readVarint(overflow, sizeof(overflow), &value));
+
+    const uint8_t sixBytes[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+    TEST_ASSERT_EQUAL(0, readVarint(sixBytes, sizeof(sixBytes), &value));
+}
+
+static void test_corrupted_header_is_rejected(void) {
+    TelemetryCodec codec(allSchema);
+    uint8_t frame[64];
+    size_t length = encodeSample(frame, sizeof(frame));
+    float values[ALL_FIELDS];
+
+    const size_t offsets[] = { 0, 1, 2 };   // Magic, version, schema id
+    for (size_t offset : offsets) {
+        uint8_t bad[64];
+        memcpy(bad, frame, length);
+        bad[offset] ^= 0x20;
+        TEST_ASSERT_FALSE(codec.decode(bad, length, values));
+    }
+
+    // Another schema's frame
+    TelemetryCodec buoy(BuoySchema);
+    TEST_ASSERT_FALSE(buoy.decode(frame, length, values));
+}
+
+
+////////////////////////////////////////////////////////
+///// Header position
+////////////////////////////////////////////////////////
+
+static void test_header_found_at_offset_zero(void) {
+    uint8_t frame[64];
+    size_t length = encodeSample(frame, sizeof(frame));
+    TEST_ASSERT_TRUE(TelemetryCodec::hasHeader(frame, length));
+    TEST_ASSERT_EQUAL(allSchema.id, TelemetryCodec::peekSchemaId(frame, length));
+    TEST_ASSERT_FALSE(TelemetryCodec::hasHeader(frame, TELEMETRY_HEADER_SIZE - 1));
+    TEST_ASSERT_EQUAL(-1, TelemetryCodec::peekSchemaId(frame, 2));
+}
+
+static void test_fixed_header_prefix_is_not_skipped(void) {
+    // LoRa::receive() strips ADDH/ADDL/CHAN, a frame still carrying them is not telemetry
+    TelemetryCodec codec(allSchema);
+    uint8_t frame[64];
+    size_t length = encodeSample(frame, sizeof(frame));
+    uint8_t prefixed[64 + 3] = { 0x00, 0x12, 0x06 };
+    memcpy(prefixed + 3, frame, length);
+
+    float values[ALL_FIELDS];
+    TEST_ASSERT_FALSE(TelemetryCodec::hasHeader(prefixed, length + 3));
+    TEST_ASSERT_EQUAL(-1, TelemetryCodec::peekSchemaId(prefixed, length + 3));
+    TEST_ASSERT_FALSE(codec.decode(prefixed, length + 3, values));
+
+    // Stripped, it decodes
+    TEST_ASSERT_TRUE(codec.decode(prefixed + 3, length, values));
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_every_encoding);
+    RUN_TEST(test_round_trip_buoy_schema);
+    RUN_TEST(test_varint_limits);
+    RUN_TEST(test_clamps_at_quantization_limits);
+    RUN_TEST(test_nan_encodes_as_zero);
+    RUN_TEST(test_truncated_frames_are_rejected);
+    RUN_TEST(test_truncated_varint_is_rejected);
+    RUN_TEST(test_overlong_varint_is_rejected);
+    RUN_TEST(test_corrupted_header_is_rejected);
+    RUN_TEST(test_header_found_at_offset_zero);
+    RUN_TEST(test_fixed_header_prefix_is_not_skipped);
+    return UNITY_END();
+}
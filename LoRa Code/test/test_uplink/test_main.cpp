@@ -0,0 +1,189 @@
+#include <unity.h>
+#include <string.h>
+#include "Uplink.h"
+
+#define FRAME_SIZE 58
+
+static uint8_t line[UPLINK_BUFFER_SIZE];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Counter then a pattern with zeros, as binary LoRa frames have
+static void fillFrame(uint8_t* frame, uint32_t n) {
+    for (uint8_t i = 0; i < 4; i++) {
+        frame[i] = (n >> (8 * i)) & 0xFF;
+    }
+    for (size_t i = 4; i < FRAME_SIZE; i++) {
+        frame[i] = (n + i) % 7 == 0 ? 0 : (uint8_t)(n * i);
+    }
+}
+
+// Everything the writer has once the flush time passed, as the USB would take it
+static size_t drain(UplinkWriter& writer, uint32_t now, uint8_t* out = line) {
+    const uint8_t* data;
+    size_t length;
+    size_t total = 0;
+    writer.ready(now, &data);
+    while ((length = writer.ready(now + UPLINK_FLUSH_MS, &data)) > 0) {
+        memcpy(out + total, data, length);
+        writer.consume(length);
+        total += length;
+    }
+    return total;
+}
+
+
+////////////////////////////////////////////////////////
+///// CRC and COBS
+////////////////////////////////////////////////////////
+
+static void test_crc_check_value(void) {
+    // CRC-16/CCITT-FALSE of "123456789"
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, uplinkCrc((const uint8_t*)"123456789", 9));
+}
+
+static void test_cobs_round_trip(void) {
+    // Zeros at both ends, a long run without one (254 byte blocks)
+    static uint8_t data[600];
+    static uint8_t encoded[sizeof(data) + sizeof(data) / 254 + 1];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = i < 300 ? (uint8_t)(i % 255 + 1) : (uint8_t)(i % 5);
+    }
+    data[0] = 0;
+    data[sizeof(data) - 1] = 0;
+
+    size_t length = cobsEncode(data, sizeof(data), encoded);
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(encoded), length);
+    TEST_ASSERT_NULL(memchr(encoded, 0, length));
+    TEST_ASSERT_EQUAL(sizeof(data), cobsDecode(encoded, length));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, encoded, sizeof(data));
+
+    // A code byte pointing past the end
+    uint8_t bad[] = { 5, 1, 2 };
+    TEST_ASSERT_EQUAL(0, cobsDecode(bad, sizeof(bad)));
+}
+
+
+////////////////////////////////////////////////////////
+///// UplinkWriter -> UplinkReader
+////////////////////////////////////////////////////////
+
+static void test_frames_read_back(void) {
+    UplinkWriter writer;
+    UplinkReader reader;
+    uint8_t frame[FRAME_SIZE];
+    for (uint32_t n = 0; n < 20; n++) {
+        fillFrame(frame, n);
+        TEST_ASSERT_TRUE(writer.send(UPLINK_LORA_FRAME, frame, sizeof(frame), 1000 + n));
+    }
+    size_t length = drain(writer, 0);
+
+    uint32_t n = 0;
+    size_t used = 0;
+    while (used < length) {
+        used += reader.feed(line + used, length - used);
+        if (reader.available()) {
+            fillFrame(frame, n);
+            TEST_ASSERT_EQUAL(UPLINK_LORA_FRAME, reader.type());
+            TEST_ASSERT_EQUAL_UINT16(n, reader.sequence());
+            TEST_ASSERT_EQUAL_UINT32(1000 + n, reader.timestamp());
+            TEST_ASSERT_EQUAL(sizeof(frame), reader.payloadLength());
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, reader.payload(), sizeof(frame));
+            n++;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(20, n);
+    TEST_ASSERT_EQUAL_UINT32(0, reader.stats().crcErrors);
+    TEST_ASSERT_EQUAL_UINT32(0, reader.stats().lost);
+}
+
+static void test_writes_wait_for_batch_or_flush_time(void) {
+    UplinkWriter writer(20, 256);
+    uint8_t frame[FRAME_SIZE] = {};
+    const uint8_t* data;
+    writer.send(UPLINK_LORA_FRAME, frame, sizeof(frame), 0);
+    TEST_ASSERT_EQUAL(0, writer.ready(100, &data));
+    TEST_ASSERT_EQUAL(0, writer.ready(119, &data));
+    TEST_ASSERT_EQUAL(writer.buffered(), writer.ready(120, &data));
+
+    // A full batch goes at once
+    UplinkWriter fresh(20, 256);
+    while (fresh.buffered() < 256) {
+        fresh.send(UPLINK_LORA_FRAME, frame, sizeof(frame), 0);
+    }
+    TEST_ASSERT_EQUAL(fresh.buffered(), fresh.ready(0, &data));
+}
+
+static void test_full_buffer_shows_as_a_gap(void) {
+    UplinkWriter writer;
+    UplinkReader reader;
+    uint8_t frame[UPLINK_MAX_PAYLOAD] = {};
+    uint32_t sent = 0;
+    while (writer.send(UPLINK_LORA_FRAME, frame, sizeof(frame), 0)) {
+        sent++;
+    }
+    TEST_ASSERT_FALSE(writer.send(UPLINK_LORA_FRAME, frame, sizeof(frame), 0));
+    TEST_ASSERT_EQUAL_UINT32(2, writer.stats().dropped);
+    TEST_ASSERT_FALSE(writer.send(UPLINK_LORA_FRAME, frame, UPLINK_MAX_PAYLOAD + 1, 0));
+
+    // Drained, the next frame lands after the two that were numbered and dropped
+    size_t length = drain(writer, 1000);
+    writer.send(UPLINK_LORA_FRAME, frame, sizeof(frame), 0);
+    length += drain(writer, 2000, line + length);
+    size_t used = 0;
+    while (used < length) {
+        used += reader.feed(line + used, length - used);
+    }
+    TEST_ASSERT_EQUAL_UINT32(sent + 1, reader.stats().frames);
+    TEST_ASSERT_EQUAL_UINT32(2, reader.stats().lost);
+}
+
+static void test_corruption_is_rejected_and_resynced(void) {
+    UplinkWriter writer;
+    UplinkReader reader;
+    uint8_t frame[FRAME_SIZE];
+    for (uint32_t n = 0; n < 3; n++) {
+        fillFrame(frame, n);
+        writer.send(UPLINK_LORA_FRAME, frame, sizeof(frame), n);
+    }
+
+    // Text printed before the uplink started, then one byte flipped in the second frame
+    const char text[] = "boot\r\n";
+    size_t length = sizeof(text) - 1;
+    memcpy(line, text, length);
+    size_t count = drain(writer, 1000, line + length);
+    line[length + count / 2] ^= 0x5A;
+    length += count;
+
+    uint32_t frames = 0;
+    size_t used = 0;
+    while (used < length) {
+        used += reader.feed(line + used, length - used);
+        if (reader.available()) {
+            TEST_ASSERT_EQUAL(sizeof(frame), reader.payloadLength());
+            TEST_ASSERT_EQUAL_UINT32(reader.sequence(), reader.timestamp());
+            frames++;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, frames);
+    TEST_ASSERT_EQUAL_UINT32(2, reader.stats().crcErrors);
+    TEST_ASSERT_EQUAL_UINT32(1, reader.stats().lost);
+}
+
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_check_value);
+    RUN_TEST(test_cobs_round_trip);
+    RUN_TEST(test_frames_read_back);
+    RUN_TEST(test_writes_wait_for_batch_or_flush_time);
+    RUN_TEST(test_full_buffer_shows_as_a_gap);
+    RUN_TEST(test_corruption_is_rejected_and_resynced);
+    return UNITY_END();
+}